@@ -80,6 +80,7 @@ zx_status_t Guest::SetTrap(uint32_t kind, zx_gpaddr_t addr, size_t len,
         }
         break;
     case ZX_GUEST_TRAP_BELL:
+    case ZX_GUEST_TRAP_BELL_COALESCED:
         if (!port) {
             return ZX_ERR_INVALID_ARGS;
         }
@@ -199,6 +199,7 @@ zx_status_t Vcpu::Resume(zx_port_packet_t* packet) {
     do {
         uint64_t curr_hcr = hcr_;
         uint32_t misr = 0;
+        zx_ticks_t exit_ticks;
         if (gich_maybe_interrupt(&gich_state_) || force_virtual_interrupt) {
             curr_hcr |= HCR_EL2_VI;
             force_virtual_interrupt = false;
@@ -221,6 +222,7 @@ zx_status_t Vcpu::Resume(zx_port_packet_t* packet) {
             running_.store(true);
             status = arm64_el2_resume(vttbr, el2_state_.PhysicalAddress(), curr_hcr);
             running_.store(false);
+            exit_ticks = current_ticks();
 
             // If we enabled underflow interrupt before we entered the guest we disable it
             // to deassert it in case it is signalled. For details please refer to ARM Generic
@@ -249,6 +251,7 @@ zx_status_t Vcpu::Resume(zx_port_packet_t* packet) {
             ktrace_vcpu_exit(VCPU_FAILURE, guest_state->system_state.elr_el2);
             dprintf(INFO, "VCPU resume failed: %d\n", status);
         }
+        ktrace_vcpu_exit_handled(exit_ticks);
     } while (status == ZX_OK);
     return status == ZX_ERR_NEXT ? ZX_OK : status;
 }
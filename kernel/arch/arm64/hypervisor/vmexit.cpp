@@ -286,6 +286,12 @@ static zx_status_t handle_data_abort(uint32_t iss, GuestState* guest_state,
         if (!trap->HasPort())
             return ZX_ERR_BAD_STATE;
         return trap->Queue(*packet, nullptr);
+    case ZX_GUEST_TRAP_BELL_COALESCED:
+        if (data_abort.read)
+            return ZX_ERR_NOT_SUPPORTED;
+        if (!trap->HasPort())
+            return ZX_ERR_BAD_STATE;
+        return trap->Ring(nullptr);
     case ZX_GUEST_TRAP_MEM:
         if (!data_abort.valid)
             return ZX_ERR_IO_DATA_INTEGRITY;
@@ -382,6 +382,7 @@ static void handle_exception_types(x86_iframe_t* frame) {
     }
     case X86_INT_APIC_TIMER: {
         apic_timer_interrupt_handler();
+        x86_ipm_timer_interrupt_handler(frame);
         apic_issue_eoi();
         break;
     }
@@ -405,6 +406,12 @@ static void handle_exception_types(x86_iframe_t* frame) {
         /* no return */
         break;
     }
+    case X86_INT_POSTED_INTERRUPT: {
+        /* a VCPU was notified of a posted interrupt after it had exited,
+         * the interrupt is picked up before the VCPU next enters the guest */
+        apic_issue_eoi();
+        break;
+    }
     case X86_INT_APIC_PMI: {
         apic_pmi_interrupt_handler(frame);
         // Note: apic_pmi_interrupt_handler calls apic_issue_eoi().
@@ -4,33 +4,63 @@
 // license that can be found in the LICENSE file or at
 // https://opensource.org/licenses/MIT
 
+#include <bits.h>
+
 #include <arch/x86/apic.h>
 #include <arch/x86/feature.h>
+#include <kernel/cmdline.h>
 #include <zircon/syscalls/hypervisor.h>
 
+#include "vcpu_priv.h"
+#include "vmexit_priv.h"
 #include "vmx_cpu_state_priv.h"
 
-static void ignore_msr(VmxPage* msr_bitmaps_page, bool ignore_writes, uint32_t msr) {
-    // From Volume 3, Section 24.6.9.
-    uint8_t* msr_bitmaps = msr_bitmaps_page->VirtualAddress<uint8_t>();
+static void clear_msr_bit(uint8_t* msr_bitmap, uint32_t msr) {
     if (msr >= 0xc0000000) {
-        msr_bitmaps += 1 << 10;
+        msr_bitmap += 1 << 10;
     }
 
     uint16_t msr_low = msr & 0x1fff;
     uint16_t msr_byte = msr_low / 8;
     uint8_t msr_bit = msr_low % 8;
+    msr_bitmap[msr_byte] &= (uint8_t) ~(1 << msr_bit);
+}
+
+static void ignore_msr(VmxPage* msr_bitmaps_page, bool ignore_writes, uint32_t msr) {
+    // From Volume 3, Section 24.6.9.
+    uint8_t* msr_bitmaps = msr_bitmaps_page->VirtualAddress<uint8_t>();
 
     // Ignore reads to the MSR.
-    msr_bitmaps[msr_byte] &= (uint8_t) ~(1 << msr_bit);
+    clear_msr_bit(msr_bitmaps, msr);
 
     if (ignore_writes) {
         // Ignore writes to the MSR.
-        msr_bitmaps += 2 << 10;
-        msr_bitmaps[msr_byte] &= (uint8_t) ~(1 << msr_bit);
+        clear_msr_bit(msr_bitmaps + (2 << 10), msr);
     }
 }
 
+static void ignore_msr_writes(VmxPage* msr_bitmaps_page, uint32_t msr) {
+    clear_msr_bit(msr_bitmaps_page->VirtualAddress<uint8_t>() + (2 << 10), msr);
+}
+
+// Returns whether the CPU can virtualize the x2APIC and deliver posted
+// interrupts, in which case we no longer need to exit for EOI and TPR
+// accesses, or to inject interrupts.
+static bool apicv_supported() {
+    if (!cmdline_get_bool("kernel.hypervisor.apicv", true)) {
+        return false;
+    }
+    const uint32_t procbased_ctls2 = kProcbasedCtls2x2Apic |
+                                     kProcbasedCtls2ApicRegisterVirt |
+                                     kProcbasedCtls2VirtIntDelivery;
+    uint64_t procbased_msr = read_msr(X86_MSR_IA32_VMX_PROCBASED_CTLS2);
+    if ((BITS_SHIFT(procbased_msr, 63, 32) & procbased_ctls2) != procbased_ctls2) {
+        return false;
+    }
+    uint64_t pinbased_msr = read_msr(X86_MSR_IA32_VMX_TRUE_PINBASED_CTLS);
+    return BITS_SHIFT(pinbased_msr, 63, 32) & kPinbasedCtlsPostedInterrupts;
+}
+
 // static
 zx_status_t Guest::Create(fbl::unique_ptr<Guest>* out) {
     // Check that the CPU supports VMX.
@@ -75,6 +105,20 @@ zx_status_t Guest::Create(fbl::unique_ptr<Guest>* out) {
     ignore_msr(&guest->msr_bitmaps_page_, true, X86_MSR_IA32_SYSENTER_ESP);
     ignore_msr(&guest->msr_bitmaps_page_, true, X86_MSR_IA32_SYSENTER_EIP);
 
+    // With APIC virtualization, the registers that back interrupt delivery
+    // are read from the virtual-APIC page, and writes to TPR, EOI and
+    // SELF_IPI are handled by the CPU. See Volume 3, Section 29.5.
+    guest->apicv_ = apicv_supported();
+    if (guest->apicv_) {
+        ignore_msr(&guest->msr_bitmaps_page_, true, static_cast<uint32_t>(X2ApicMsr::TPR));
+        for (uint32_t msr = static_cast<uint32_t>(X2ApicMsr::ISR_31_0);
+             msr <= static_cast<uint32_t>(X2ApicMsr::IRR_255_224); msr++) {
+            ignore_msr(&guest->msr_bitmaps_page_, false, msr);
+        }
+        ignore_msr_writes(&guest->msr_bitmaps_page_, static_cast<uint32_t>(X2ApicMsr::EOI));
+        ignore_msr_writes(&guest->msr_bitmaps_page_, static_cast<uint32_t>(X2ApicMsr::SELF_IPI));
+    }
+
     // Setup VPID allocator
     fbl::AutoLock lock(&guest->vcpu_mutex_);
     status = guest->vpid_allocator_.Init();
@@ -105,6 +149,7 @@ zx_status_t Guest::SetTrap(uint32_t kind, zx_vaddr_t addr, size_t len,
         }
         break;
     case ZX_GUEST_TRAP_BELL:
+    case ZX_GUEST_TRAP_BELL_COALESCED:
         if (!port) {
             return ZX_ERR_INVALID_ARGS;
         }
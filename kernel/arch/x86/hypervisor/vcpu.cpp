@@ -9,11 +9,13 @@
 #include <arch/x86/descriptor.h>
 #include <arch/x86/feature.h>
 #include <arch/x86/pvclock.h>
+#include <fbl/algorithm.h>
 #include <fbl/auto_call.h>
 #include <hypervisor/cpu.h>
 #include <hypervisor/ktrace.h>
 #include <kernel/mp.h>
 #include <lib/ktrace.h>
+#include <platform.h>
 #include <vm/fault.h>
 #include <vm/pmm.h>
 #include <vm/vm_object.h>
@@ -272,7 +274,8 @@ static void edit_msr_list(VmxPage* msr_list_page, size_t index, uint32_t msr, ui
 
 static zx_status_t vmcs_init(paddr_t vmcs_address, uint16_t vpid, uintptr_t entry,
                              paddr_t msr_bitmaps_address, paddr_t pml4_address, VmxState* vmx_state,
-                             VmxPage* host_msr_page, VmxPage* guest_msr_page) {
+                             VmxPage* host_msr_page, VmxPage* guest_msr_page,
+                             VmxPage* virtual_apic_page, VmxPage* posted_interrupts_page) {
     zx_status_t status = vmclear(vmcs_address);
     if (status != ZX_OK)
         return status;
@@ -304,6 +307,19 @@ static zx_status_t vmcs_init(paddr_t vmcs_address, uint16_t vpid, uintptr_t entr
                     kProcbasedCtls2Invpcid,
                     0);
 
+    const bool apicv = virtual_apic_page != nullptr;
+    if (apicv) {
+        // Enable APIC-register virtualization and virtual-interrupt delivery.
+        // See Volume 3, Chapter 29.
+        status = vmcs.SetControl(VmcsField32::PROCBASED_CTLS2,
+                                 read_msr(X86_MSR_IA32_VMX_PROCBASED_CTLS2),
+                                 vmcs.Read(VmcsField32::PROCBASED_CTLS2),
+                                 kProcbasedCtls2ApicRegisterVirt | kProcbasedCtls2VirtIntDelivery,
+                                 0);
+        if (status != ZX_OK)
+            return status;
+    }
+
     // Setup pin-based VMCS controls.
     status = vmcs.SetControl(VmcsField32::PINBASED_CTLS,
                              read_msr(X86_MSR_IA32_VMX_TRUE_PINBASED_CTLS),
@@ -311,7 +327,9 @@ static zx_status_t vmcs_init(paddr_t vmcs_address, uint16_t vpid, uintptr_t entr
                              // External interrupts cause a VM exit.
                              kPinbasedCtlsExtIntExiting |
                                  // Non-maskable interrupts cause a VM exit.
-                                 kPinbasedCtlsNmiExiting,
+                                 kPinbasedCtlsNmiExiting |
+                                 // Process posted interrupts, if we can.
+                                 (apicv ? kPinbasedCtlsPostedInterrupts : 0),
                              0);
     if (status != ZX_OK)
         return status;
@@ -349,6 +367,25 @@ static zx_status_t vmcs_init(paddr_t vmcs_address, uint16_t vpid, uintptr_t entr
     // processor supports it for later use. So disable it for now.
     vmcs.InterruptWindowExiting(false);
 
+    if (apicv) {
+        // From Volume 3, Section 29.6: When the processor receives the
+        // notification vector while the guest is running, it moves the posted
+        // interrupts into the virtual-APIC page and evaluates them, without a
+        // VM exit. The host only handles the notification if the VCPU exited
+        // before it arrived.
+        vmcs.Write(VmcsField64::VIRTUAL_APIC_ADDRESS, virtual_apic_page->PhysicalAddress());
+        vmcs.Write(VmcsField16::POSTED_INTERRUPT_NOTIFICATION_VECTOR, X86_INT_POSTED_INTERRUPT);
+        vmcs.Write(VmcsField64::POSTED_INTERRUPT_DESCRIPTOR_ADDRESS,
+                   posted_interrupts_page->PhysicalAddress());
+        // Virtualize EOI for all vectors, as we do not emulate level-triggered
+        // interrupts.
+        vmcs.Write(VmcsField64::EOI_EXIT_BITMAP_0, 0);
+        vmcs.Write(VmcsField64::EOI_EXIT_BITMAP_1, 0);
+        vmcs.Write(VmcsField64::EOI_EXIT_BITMAP_2, 0);
+        vmcs.Write(VmcsField64::EOI_EXIT_BITMAP_3, 0);
+        vmcs.Write(VmcsField16::GUEST_INTERRUPT_STATUS, 0);
+    }
+
     // Setup VM-exit VMCS controls.
     status = vmcs.SetControl(VmcsField32::EXIT_CTLS,
                              read_msr(X86_MSR_IA32_VMX_TRUE_EXIT_CTLS),
@@ -669,13 +706,34 @@ zx_status_t Vcpu::Create(Guest* guest, zx_vaddr_t entry, fbl::unique_ptr<Vcpu>*
     status = vcpu->vmcs_page_.Alloc(vmx_info, 0);
     if (status != ZX_OK)
         return status;
+
+    VmxPage* virtual_apic_page = nullptr;
+    VmxPage* posted_interrupts_page = nullptr;
+    if (guest->ApicVirtualization()) {
+        status = vcpu->virtual_apic_page_.Alloc(vmx_info, 0);
+        if (status != ZX_OK)
+            return status;
+        status = vcpu->posted_interrupts_page_.Alloc(vmx_info, 0);
+        if (status != ZX_OK)
+            return status;
+        virtual_apic_page = &vcpu->virtual_apic_page_;
+        posted_interrupts_page = &vcpu->posted_interrupts_page_;
+        vcpu->local_apic_state_.virtual_apic = virtual_apic_page->VirtualAddress<uint8_t>();
+        vcpu->local_apic_state_.posted_interrupts =
+            posted_interrupts_page->VirtualAddress<PostedInterruptDescriptor>();
+    }
     auto_call.cancel();
 
+    // We are pinned to the CPU of the VCPU, which is where notifications of
+    // posted interrupts are sent.
+    vcpu->apic_id_ = x86_get_percpu()->apic_id;
+
     VmxRegion* region = vcpu->vmcs_page_.VirtualAddress<VmxRegion>();
     region->revision_id = vmx_info.revision_id;
     zx_paddr_t table = gpas->arch_aspace()->arch_table_phys();
     status = vmcs_init(vcpu->vmcs_page_.PhysicalAddress(), vpid, entry, guest->MsrBitmapsAddress(),
-                       table, &vcpu->vmx_state_, &vcpu->host_msr_page_, &vcpu->guest_msr_page_);
+                       table, &vcpu->vmx_state_, &vcpu->host_msr_page_, &vcpu->guest_msr_page_,
+                       virtual_apic_page, posted_interrupts_page);
     if (status != ZX_OK)
         return status;
 
@@ -699,6 +757,46 @@ Vcpu::~Vcpu() {
     DEBUG_ASSERT(status == ZX_OK);
 }
 
+// Raises the requesting virtual interrupt to at least |vector|, so that the
+// CPU evaluates it on VM entry. See Volume 3, Section 29.2.1.
+static void local_apic_raise_rvi(AutoVmcs* vmcs, uint32_t vector) {
+    uint16_t status = vmcs->Read(VmcsField16::GUEST_INTERRUPT_STATUS);
+    if ((status & UINT8_MAX) < vector) {
+        vmcs->Write(VmcsField16::GUEST_INTERRUPT_STATUS,
+                    static_cast<uint16_t>((status & ~UINT8_MAX) | vector));
+    }
+}
+
+// Sets |vector| in the virtual IRR, within the virtual-APIC page.
+static void local_apic_set_irr(LocalApicState* local_apic_state, uint32_t vector) {
+    auto irr = reinterpret_cast<uint32_t*>(local_apic_state->virtual_apic + kVirtualApicIrr +
+                                           (vector / 32) * 16);
+    *irr |= 1u << (vector % 32);
+}
+
+// Moves posted interrupts into the virtual-APIC page. Must be called after
+// the VCPU is marked as running, so that an interrupt posted concurrently is
+// either seen here or notifies the CPU.
+static void local_apic_sync_posted(AutoVmcs* vmcs, LocalApicState* local_apic_state) {
+    PostedInterruptDescriptor* pid = local_apic_state->posted_interrupts;
+    if ((pid->control.fetch_and(~kPostedInterruptOn) & kPostedInterruptOn) == 0) {
+        return;
+    }
+    uint32_t max_vector = 0;
+    for (uint32_t i = 0; i < fbl::count_of(pid->pir); i++) {
+        uint64_t requests = pid->pir[i].exchange(0);
+        while (requests != 0) {
+            uint32_t vector = i * 64 + __builtin_ctzl(requests);
+            requests &= requests - 1;
+            local_apic_set_irr(local_apic_state, vector);
+            max_vector = vector;
+        }
+    }
+    if (max_vector != 0) {
+        local_apic_raise_rvi(vmcs, max_vector);
+    }
+}
+
 // Injects an interrupt into the guest, if there is one pending.
 static zx_status_t local_apic_maybe_interrupt(AutoVmcs* vmcs, LocalApicState* local_apic_state) {
     uint32_t vector;
@@ -707,6 +805,22 @@ static zx_status_t local_apic_maybe_interrupt(AutoVmcs* vmcs, LocalApicState* lo
         return status == ZX_ERR_NOT_FOUND ? ZX_OK : status;
     }
 
+    if (local_apic_state->virtual_apic != nullptr) {
+        // With virtual-interrupt delivery, the CPU delivers interrupts from the
+        // virtual-APIC page once the guest can take them. Only exceptions are
+        // injected as events.
+        while (vector >= X86_INT_PLATFORM_BASE) {
+            local_apic_set_irr(local_apic_state, vector);
+            local_apic_raise_rvi(vmcs, vector);
+            status = local_apic_state->interrupt_tracker.Pop(&vector);
+            if (status != ZX_OK) {
+                return status == ZX_ERR_NOT_FOUND ? ZX_OK : status;
+            }
+        }
+        vmcs->IssueInterrupt(vector);
+        return ZX_OK;
+    }
+
     if (vector < X86_INT_PLATFORM_BASE || vmcs->Read(VmcsFieldXX::GUEST_RFLAGS) & X86_FLAGS_IF) {
         // If the vector is non-maskable or interrupts are enabled, we inject an interrupt.
         vmcs->IssueInterrupt(vector);
@@ -739,8 +853,12 @@ zx_status_t Vcpu::Resume(zx_port_packet_t* packet) {
 
         ktrace(TAG_VCPU_ENTER, 0, 0, 0, 0);
         running_.store(true);
+        if (local_apic_state_.posted_interrupts != nullptr) {
+            local_apic_sync_posted(&vmcs, &local_apic_state_);
+        }
         status = vmx_enter(&vmx_state_);
         running_.store(false);
+        const zx_ticks_t exit_ticks = current_ticks();
         if (x86_feature_test(X86_FEATURE_XSAVE)) {
             // Save the guest XCR0, and load the host XCR0.
             vmx_state_.guest_state.xcr0 = x86_xgetbv(0);
@@ -757,6 +875,7 @@ zx_status_t Vcpu::Resume(zx_port_packet_t* packet) {
                                     &pvclock_state_, guest_->AddressSpace(), guest_->Traps(),
                                     packet);
         }
+        ktrace_vcpu_exit_handled(exit_ticks);
     } while (status == ZX_OK);
     return status == ZX_ERR_NEXT ? ZX_OK : status;
 }
@@ -772,6 +891,22 @@ void vmx_exit(VmxState* vmx_state) {
 }
 
 zx_status_t Vcpu::Interrupt(uint32_t vector) {
+    PostedInterruptDescriptor* pid = local_apic_state_.posted_interrupts;
+    if (pid != nullptr && vector >= X86_INT_PLATFORM_BASE && vector < X86_INT_COUNT) {
+        // From Volume 3, Section 29.6: Post the interrupt, and then notify the
+        // VCPU unless a notification is already outstanding.
+        pid->pir[vector / 64].fetch_or(1ul << (vector % 64));
+        if (pid->control.fetch_or(kPostedInterruptOn) & kPostedInterruptOn) {
+            return ZX_OK;
+        }
+        if (running_.load()) {
+            apic_send_ipi(X86_INT_POSTED_INTERRUPT, apic_id_, DELIVERY_MODE_FIXED);
+        } else {
+            local_apic_state_.interrupt_tracker.Signal();
+        }
+        return ZX_OK;
+    }
+
     bool signaled = false;
     zx_status_t status = local_apic_state_.interrupt_tracker.Interrupt(vector, &signaled);
     if (status != ZX_OK) {
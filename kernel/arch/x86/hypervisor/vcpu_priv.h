@@ -26,6 +26,8 @@ static const uint32_t kProcbasedCtls2Rdtscp             = 1u << 3;
 static const uint32_t kProcbasedCtls2x2Apic             = 1u << 4;
 static const uint32_t kProcbasedCtls2Vpid               = 1u << 5;
 static const uint32_t kProcbasedCtls2UnrestrictedGuest  = 1u << 7;
+static const uint32_t kProcbasedCtls2ApicRegisterVirt   = 1u << 8;
+static const uint32_t kProcbasedCtls2VirtIntDelivery    = 1u << 9;
 static const uint32_t kProcbasedCtls2Invpcid            = 1u << 12;
 
 // PROCBASED_CTLS flags.
@@ -44,6 +46,7 @@ static const uint32_t kProcbasedCtlsProcbasedCtls2      = 1u << 31;
 // PINBASED_CTLS flags.
 static const uint32_t kPinbasedCtlsExtIntExiting        = 1u << 0;
 static const uint32_t kPinbasedCtlsNmiExiting           = 1u << 3;
+static const uint32_t kPinbasedCtlsPostedInterrupts     = 1u << 7;
 
 // EXIT_CTLS flags.
 static const uint32_t kExitCtls64bitMode                = 1u << 9;
@@ -86,11 +89,20 @@ static const uint32_t kGuestXxAccessRightsDefault       = kGuestXxAccessRightsTy
 static const uint32_t kInterruptibilityStiBlocking      = 1u << 0;
 static const uint32_t kInterruptibilityMovSsBlocking    = 1u << 1;
 
+// Virtual-APIC page offsets, from Volume 3, Section 29.1.
+static const size_t kVirtualApicPpr                     = 0x0a0;
+static const size_t kVirtualApicIrr                     = 0x200;
+
+// Posted-interrupt descriptor control flags.
+static const uint64_t kPostedInterruptOn                = 1u << 0;
+
 // VMCS fields.
 enum class VmcsField16 : uint64_t {
     VPID                                                = 0x0000,
+    POSTED_INTERRUPT_NOTIFICATION_VECTOR                = 0x0002,
     GUEST_CS_SELECTOR                                   = 0x0802,
     GUEST_TR_SELECTOR                                   = 0x080e,
+    GUEST_INTERRUPT_STATUS                              = 0x0810,
     HOST_ES_SELECTOR                                    = 0x0c00,
     HOST_CS_SELECTOR                                    = 0x0c02,
     HOST_SS_SELECTOR                                    = 0x0c04,
@@ -105,7 +117,13 @@ enum class VmcsField64 : uint64_t {
     EXIT_MSR_STORE_ADDRESS                              = 0x2006,
     EXIT_MSR_LOAD_ADDRESS                               = 0x2008,
     ENTRY_MSR_LOAD_ADDRESS                              = 0x200a,
+    VIRTUAL_APIC_ADDRESS                                = 0x2012,
+    POSTED_INTERRUPT_DESCRIPTOR_ADDRESS                 = 0x2016,
     EPT_POINTER                                         = 0x201a,
+    EOI_EXIT_BITMAP_0                                   = 0x201c,
+    EOI_EXIT_BITMAP_1                                   = 0x201e,
+    EOI_EXIT_BITMAP_2                                   = 0x2020,
+    EOI_EXIT_BITMAP_3                                   = 0x2022,
     GUEST_PHYSICAL_ADDRESS                              = 0x2400,
     LINK_POINTER                                        = 0x2800,
     GUEST_IA32_PAT                                      = 0x2804,
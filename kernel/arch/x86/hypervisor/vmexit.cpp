@@ -329,10 +329,29 @@ static zx_status_t handle_cpuid(const ExitInfo& exit_info, AutoVmcs* vmcs,
     }
 }
 
+// Returns whether the virtual APIC has an interrupt that the guest is able to
+// service. See Volume 3, Section 29.2.1.
+static bool virtual_interrupt_pending(AutoVmcs* vmcs, LocalApicState* local_apic_state) {
+    uint8_t rvi = vmcs->Read(VmcsField16::GUEST_INTERRUPT_STATUS) & UINT8_MAX;
+    uint32_t vppr = *reinterpret_cast<uint32_t*>(local_apic_state->virtual_apic + kVirtualApicPpr);
+    return (rvi & 0xf0) > (vppr & 0xf0);
+}
+
 static zx_status_t handle_hlt(const ExitInfo& exit_info, AutoVmcs* vmcs,
                               LocalApicState* local_apic_state) {
     next_rip(exit_info, vmcs);
-    return local_apic_state->interrupt_tracker.Wait(vmcs);
+    PostedInterruptDescriptor* pid = local_apic_state->posted_interrupts;
+    if (pid == nullptr) {
+        return local_apic_state->interrupt_tracker.Wait(vmcs);
+    }
+    // With APIC virtualization, interrupts may be waiting in the virtual-APIC
+    // page, or be posted while we wait.
+    if (virtual_interrupt_pending(vmcs, local_apic_state)) {
+        return ZX_OK;
+    }
+    return local_apic_state->interrupt_tracker.Wait(vmcs, [pid] {
+        return pid->control.load() & kPostedInterruptOn;
+    });
 }
 
 static zx_status_t handle_cr0_write(AutoVmcs* vmcs, GuestState* guest_state, uint64_t val) {
@@ -904,6 +923,12 @@ static zx_status_t handle_trap(const ExitInfo& exit_info, AutoVmcs* vmcs, bool r
         if (!trap->HasPort())
             return ZX_ERR_BAD_STATE;
         return trap->Queue(*packet, vmcs);
+    case ZX_GUEST_TRAP_BELL_COALESCED:
+        if (read)
+            return ZX_ERR_NOT_SUPPORTED;
+        if (!trap->HasPort())
+            return ZX_ERR_BAD_STATE;
+        return trap->Ring(vmcs);
     case ZX_GUEST_TRAP_MEM: {
         *packet = {};
         packet->key = trap->key();
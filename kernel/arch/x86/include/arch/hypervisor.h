@@ -9,6 +9,7 @@
 #include <arch/x86/apic.h>
 #include <arch/x86/interrupts.h>
 #include <arch/x86/vmx_state.h>
+#include <fbl/atomic.h>
 #include <fbl/ref_ptr.h>
 #include <fbl/unique_ptr.h>
 #include <hypervisor/guest_physical_address_space.h>
@@ -44,6 +45,7 @@ public:
     hypervisor::GuestPhysicalAddressSpace* AddressSpace() const { return gpas_.get(); }
     hypervisor::TrapMap* Traps() { return &traps_; }
     zx_paddr_t MsrBitmapsAddress() const { return msr_bitmaps_page_.PhysicalAddress(); }
+    bool ApicVirtualization() const { return apicv_; }
 
     zx_status_t AllocVpid(uint16_t* vpid);
     zx_status_t FreeVpid(uint16_t vpid);
@@ -52,6 +54,7 @@ private:
     fbl::unique_ptr<hypervisor::GuestPhysicalAddressSpace> gpas_;
     hypervisor::TrapMap traps_;
     VmxPage msr_bitmaps_page_;
+    bool apicv_ = false;
 
     fbl::Mutex vcpu_mutex_;
     // TODO(alexlegg): Find a good place for this constant to live (max VCPUs).
@@ -60,6 +63,16 @@ private:
     Guest() = default;
 };
 
+// Posted-interrupt descriptor, from Volume 3, Section 29.6.
+struct PostedInterruptDescriptor {
+    // Posted-interrupt requests, one bit per vector.
+    fbl::atomic<uint64_t> pir[4];
+    // Bit 0 is the outstanding-notification bit.
+    fbl::atomic<uint64_t> control;
+    uint64_t reserved[3];
+};
+static_assert(sizeof(PostedInterruptDescriptor) == 64, "");
+
 // Stores the local APIC state across VM exits.
 struct LocalApicState {
     // Timer for APIC timer.
@@ -70,6 +83,10 @@ struct LocalApicState {
     uint32_t lvt_timer = LVT_MASKED; // Initial state is masked (Vol 3 Section 10.12.5.1).
     uint32_t lvt_initial_count;
     uint32_t lvt_divide_config;
+    // When APIC virtualization is enabled, the virtual-APIC page and the
+    // posted-interrupt descriptor of the VCPU. Otherwise, nullptr.
+    uint8_t* virtual_apic = nullptr;
+    PostedInterruptDescriptor* posted_interrupts = nullptr;
 };
 
 // System time is time since boot time and boot time is some fixed point in the past. This
@@ -105,6 +122,9 @@ private:
     VmxPage host_msr_page_;
     VmxPage guest_msr_page_;
     VmxPage vmcs_page_;
+    VmxPage virtual_apic_page_;
+    VmxPage posted_interrupts_page_;
+    uint32_t apic_id_;
 
     Vcpu(Guest* guest, uint16_t vpid, const thread_t* thread);
 };
@@ -41,6 +41,7 @@ enum x86_interrupt_vector {
     X86_INT_IPI_RESCHEDULE,
     X86_INT_IPI_INTERRUPT,
     X86_INT_IPI_HALT,
+    X86_INT_POSTED_INTERRUPT,
 
     X86_INT_MAX = 0xff,
     X86_INT_COUNT,
@@ -42,4 +42,8 @@ zx_status_t x86_ipm_fini();
 
 void apic_pmi_interrupt_handler(x86_iframe_t *frame);
 
+// Takes a timer driven sample, if one is due, at the end of an APIC
+// timer interrupt.
+void x86_ipm_timer_interrupt_handler(x86_iframe_t *frame);
+
 #endif // __cplusplus
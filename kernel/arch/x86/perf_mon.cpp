@@ -37,10 +37,19 @@
 // to memory is faster than the wrmsr which is apparently true.
 // TODO(dje): rdpmc
 
+// A note on sampling: Counters with IPM_CONFIG_FLAG_STACK set record the
+// interrupted pc, thread and kernel call stack each time they overflow.
+// Independently of the h/w counters, |timer_period| in the config makes each
+// cpu record the same data from a periodic timer, which is what makes the
+// sampling profiler usable without a PMU (e.g., QEMU without PMU
+// passthrough). Timer samples are taken from the APIC timer interrupt, see
+// x86_ipm_timer_interrupt_handler().
+
 #include <arch/arch_ops.h>
 #include <arch/mmu.h>
 #include <arch/x86.h>
 #include <arch/x86/apic.h>
+#include <arch/x86/descriptor.h>
 #include <arch/x86/feature.h>
 #include <arch/x86/mmu.h>
 #include <arch/x86/perf_mon.h>
@@ -56,6 +65,7 @@
 #include <kernel/mutex.h>
 #include <kernel/stats.h>
 #include <kernel/thread.h>
+#include <kernel/timer.h>
 #include <platform.h>
 #include <vm/vm.h>
 #include <vm/vm_address_region.h>
@@ -68,6 +78,7 @@
 #include <lib/zircon-internal/ktrace.h>
 #include <lib/zircon-internal/mtrace.h>
 #include <zircon/thread_annotations.h>
+#include <zircon/time.h>
 #include <zxcpp/new.h>
 #include <pow2.h>
 #include <string.h>
@@ -163,7 +174,11 @@ static_assert(1
 static uint64_t kGlobalCtrlWritableBits;
 static uint64_t kFixedCounterCtrlWritableBits;
 
-static constexpr size_t kMaxEventRecordSize = sizeof(cpuperf_pc_record_t);
+static constexpr size_t kMaxEventRecordSize = sizeof(cpuperf_stack_record_t);
+
+// Space needed for a timer sample: a TIME record followed by a STACK record.
+static constexpr size_t kTimerSampleSpaceNeeded =
+    sizeof(cpuperf_time_record_t) + sizeof(cpuperf_stack_record_t);
 
 // Commented out values represent currently unsupported features.
 // They remain present for documentation purposes.
@@ -232,6 +247,16 @@ struct PerfmonCpuData {
 
     // The next record to fill.
     cpuperf_record_header_t* buffer_next = nullptr;
+
+    // Drives sampling when |PerfmonState::timer_period| is non-zero.
+    // A copy of the period is kept here for the timer callback.
+    timer_t sample_timer = TIMER_INITIAL_VALUE(sample_timer);
+    zx_duration_t sample_period = 0;
+
+    // Set by |sample_timer| when the next APIC timer interrupt on this cpu
+    // should take a sample. Only accessed on this cpu with interrupts
+    // disabled.
+    bool timer_sample_pending = false;
 } __CPU_ALIGN;
 
 struct MemoryControllerHubData {
@@ -322,6 +347,9 @@ struct PerfmonState {
 
     // IA32_PERFEVTSEL_*
     uint64_t events[IPM_MAX_PROGRAMMABLE_COUNTERS] = {};
+
+    // If non-zero, the period of timer driven sampling, in nanoseconds.
+    zx_duration_t timer_period = 0;
 };
 
 static fbl::Mutex perfmon_lock;
@@ -495,6 +523,9 @@ void x86_perfmon_init(void)
 }
 
 static void x86_perfmon_clear_overflow_indicators() {
+    if (!supports_perfmon)
+        return;
+
     uint64_t value = (IA32_PERF_GLOBAL_OVF_CTRL_CLR_COND_CHGD_MASK |
                       IA32_PERF_GLOBAL_OVF_CTRL_DS_BUFFER_CLR_OVF_MASK |
                       IA32_PERF_GLOBAL_OVF_CTRL_UNCORE_CLR_OVF_MASK);
@@ -590,6 +621,62 @@ static cpuperf_record_header_t* x86_perfmon_write_pc_record(
     return reinterpret_cast<cpuperf_record_header_t*>(rec);
 }
 
+// Walk the kernel frame pointer chain starting at |fp|, storing up to
+// |max_frames| return addresses in |frames|. This runs in interrupt context
+// so every frame is checked to lie within the current thread's kernel stack
+// before it is dereferenced.
+static uint32_t x86_perfmon_capture_kernel_stack(uintptr_t fp, uint64_t* frames,
+                                                 uint32_t max_frames) {
+    const thread_t* thread = get_current_thread();
+    const uintptr_t stack_base = thread->stack.base;
+    const uintptr_t stack_top = thread->stack.top;
+
+    uint32_t n = 0;
+    while (n < max_frames) {
+        if (fp < stack_base || fp > stack_top - 2 * sizeof(uintptr_t) ||
+                (fp & (sizeof(uintptr_t) - 1)) != 0) {
+            break;
+        }
+        const uintptr_t* frame = reinterpret_cast<const uintptr_t*>(fp);
+        uintptr_t ret_addr = frame[1];
+        if (!is_kernel_address(ret_addr))
+            break;
+        frames[n++] = ret_addr;
+        // Frames grow towards higher addresses as we unwind.
+        // Stop if that doesn't hold, the chain is corrupt.
+        if (frame[0] <= fp)
+            break;
+        fp = frame[0];
+    }
+    return n;
+}
+
+static cpuperf_record_header_t* x86_perfmon_write_stack_record(
+        cpuperf_record_header_t* hdr,
+        cpuperf_event_id_t event, uint64_t cr3, const x86_iframe_t* frame) {
+    auto rec = reinterpret_cast<cpuperf_stack_record_t*>(hdr);
+    x86_perfmon_write_header(&rec->header, CPUPERF_RECORD_STACK, event);
+    rec->tid = get_current_thread()->user_tid;
+    rec->aspace = cr3;
+    rec->pc = frame->ip;
+    if (SELECTOR_PL(frame->cs) != 0) {
+        // Walking the user stack would mean reading user memory from
+        // interrupt context, which we can't do safely. Leave that to the
+        // pc alone.
+        rec->header.reserved_flags = CPUPERF_STACK_FLAG_USER;
+        rec->num_frames = 0;
+    } else {
+        // Records are packed, |rec->frames| needn't be aligned.
+        uint64_t frames[CPUPERF_MAX_STACK_FRAMES];
+        uint32_t num_frames = x86_perfmon_capture_kernel_stack(
+            frame->rbp, frames, CPUPERF_MAX_STACK_FRAMES);
+        memcpy(rec->frames, frames, num_frames * sizeof(frames[0]));
+        rec->num_frames = num_frames;
+    }
+    return reinterpret_cast<cpuperf_record_header_t*>(
+        reinterpret_cast<char*>(rec) + CPUPERF_STACK_RECORD_SIZE(rec->num_frames));
+}
+
 zx_status_t x86_ipm_get_properties(zx_x86_ipm_properties_t* props) {
     fbl::AutoLock al(&perfmon_lock);
 
@@ -605,11 +692,12 @@ zx_status_t x86_ipm_get_properties(zx_x86_ipm_properties_t* props) {
     return ZX_OK;
 }
 
+// Note: Unlike x86_ipm_get_properties, the remaining entry points work
+// without a PMU so that timer driven sampling can be used.
+
 zx_status_t x86_ipm_init() {
     fbl::AutoLock al(&perfmon_lock);
 
-    if (!supports_perfmon)
-        return ZX_ERR_NOT_SUPPORTED;
     if (atomic_load(&perfmon_active))
         return ZX_ERR_BAD_STATE;
     if (perfmon_state)
@@ -627,8 +715,6 @@ zx_status_t x86_ipm_init() {
 zx_status_t x86_ipm_assign_buffer(uint32_t cpu, fbl::RefPtr<VmObject> vmo) {
     fbl::AutoLock al(&perfmon_lock);
 
-    if (!supports_perfmon)
-        return ZX_ERR_NOT_SUPPORTED;
     if (atomic_load(&perfmon_active))
         return ZX_ERR_BAD_STATE;
     if (!perfmon_state)
@@ -716,6 +802,11 @@ static zx_status_t x86_ipm_verify_fixed_config(
                 TRACEF("Unused bits set in |fixed_flags[%u]|\n", i);
                 return ZX_ERR_INVALID_ARGS;
             }
+            if ((config->fixed_flags[i] & IPM_CONFIG_FLAG_STACK) &&
+                    !(config->fixed_flags[i] & IPM_CONFIG_FLAG_PC)) {
+                TRACEF("Stack requested without pc for |fixed_flags[%u]|\n", i);
+                return ZX_ERR_INVALID_ARGS;
+            }
             if ((config->fixed_flags[i] & IPM_CONFIG_FLAG_TIMEBASE) &&
                     config->timebase_id == CPUPERF_EVENT_ID_NONE) {
                 TRACEF("Timebase requested for |fixed_flags[%u]|, but not provided\n", i);
@@ -774,6 +865,11 @@ static zx_status_t x86_ipm_verify_programmable_config(
                 TRACEF("Unused bits set in |programmable_flags[%u]|\n", i);
                 return ZX_ERR_INVALID_ARGS;
             }
+            if ((config->programmable_flags[i] & IPM_CONFIG_FLAG_STACK) &&
+                    !(config->programmable_flags[i] & IPM_CONFIG_FLAG_PC)) {
+                TRACEF("Stack requested without pc for |programmable_flags[%u]|\n", i);
+                return ZX_ERR_INVALID_ARGS;
+            }
             if ((config->programmable_flags[i] & IPM_CONFIG_FLAG_TIMEBASE) &&
                     config->timebase_id == CPUPERF_EVENT_ID_NONE) {
                 TRACEF("Timebase requested for |programmable_flags[%u]|, but not provided\n", i);
@@ -815,7 +911,7 @@ static zx_status_t x86_ipm_verify_misc_config(
             }
             // Currently we only support the MCHBAR events.
             // They cannot provide pc. We ignore the OS/USER bits.
-            if (config->misc_flags[i] & IPM_CONFIG_FLAG_PC) {
+            if (config->misc_flags[i] & (IPM_CONFIG_FLAG_PC | IPM_CONFIG_FLAG_STACK)) {
                 TRACEF("Invalid bits (0x%x) in |misc_flags[%zu]|\n",
                        config->misc_flags[i], i);
                 return ZX_ERR_INVALID_ARGS;
@@ -867,12 +963,28 @@ static zx_status_t x86_ipm_verify_timebase_config(
     return ZX_ERR_INVALID_ARGS;
 }
 
+static zx_status_t x86_ipm_verify_timer_config(const zx_x86_ipm_config_t* config) {
+    // Anything faster than this would spend most of its time sampling.
+    constexpr zx_duration_t kMinTimerPeriod = ZX_USEC(10);
+
+    if (config->timer_period < 0 ||
+            (config->timer_period != 0 && config->timer_period < kMinTimerPeriod)) {
+        TRACEF("Invalid |timer_period| %" PRIi64 "\n", config->timer_period);
+        return ZX_ERR_INVALID_ARGS;
+    }
+    return ZX_OK;
+}
+
 static zx_status_t x86_ipm_verify_config(zx_x86_ipm_config_t* config,
                                          PerfmonState* state) {
     auto status = x86_ipm_verify_control_config(config);
     if (status != ZX_OK)
         return status;
 
+    status = x86_ipm_verify_timer_config(config);
+    if (status != ZX_OK)
+        return status;
+
     unsigned num_used_fixed;
     status = x86_ipm_verify_fixed_config(config, &num_used_fixed);
     if (status != ZX_OK)
@@ -897,6 +1009,15 @@ static zx_status_t x86_ipm_verify_config(zx_x86_ipm_config_t* config,
     if (status != ZX_OK)
         return status;
 
+    // Without a PMU only timer driven sampling is available.
+    if (!supports_perfmon &&
+            (state->num_used_fixed != 0 || state->num_used_programmable != 0 ||
+             state->num_used_misc != 0 || config->global_ctrl != 0 ||
+             config->fixed_ctrl != 0 || config->debug_ctrl != 0)) {
+        TRACEF("Counters requested but there is no PMU\n");
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
     return ZX_OK;
 }
 
@@ -983,8 +1104,6 @@ static void x86_ipm_stage_misc_config(const zx_x86_ipm_config_t* config,
 zx_status_t x86_ipm_stage_config(zx_x86_ipm_config_t* config) {
     fbl::AutoLock al(&perfmon_lock);
 
-    if (!supports_perfmon)
-        return ZX_ERR_NOT_SUPPORTED;
     if (atomic_load(&perfmon_active))
         return ZX_ERR_BAD_STATE;
     if (!perfmon_state)
@@ -1002,6 +1121,7 @@ zx_status_t x86_ipm_stage_config(zx_x86_ipm_config_t* config) {
     state->fixed_ctrl = config->fixed_ctrl;
     state->debug_ctrl = config->debug_ctrl;
     state->timebase_id = config->timebase_id;
+    state->timer_period = config->timer_period;
 
     x86_ipm_stage_fixed_config(config, state);
     x86_ipm_stage_programmable_config(config, state);
@@ -1450,12 +1570,37 @@ static zx_status_t x86_ipm_map_buffers_locked(PerfmonState* state) {
     return status;
 }
 
+// Timer driven sampling.
+// The timer callback can't write records itself: it doesn't have the
+// interrupted frame. Instead it marks a sample as pending and
+// |x86_ipm_timer_interrupt_handler()| writes it out on the way out of the
+// timer interrupt.
+
+static void x86_ipm_sample_timer_callback(timer_t* timer, zx_time_t now, void* arg) {
+    auto data = reinterpret_cast<PerfmonCpuData*>(arg);
+    data->timer_sample_pending = true;
+    timer_set(timer, zx_time_add_duration(now, data->sample_period), TIMER_SLACK_CENTER, 0,
+              x86_ipm_sample_timer_callback, arg);
+}
+
 // This is invoked via mp_sync_exec which thread safety analysis cannot follow.
 static void x86_ipm_start_cpu_task(void* raw_context) TA_NO_THREAD_SAFETY_ANALYSIS {
     DEBUG_ASSERT(arch_ints_disabled());
     DEBUG_ASSERT(!atomic_load(&perfmon_active) && raw_context);
 
     auto state = reinterpret_cast<PerfmonState*>(raw_context);
+    auto data = &state->cpu_data[arch_curr_cpu_num()];
+
+    if (state->timer_period != 0) {
+        data->timer_sample_pending = false;
+        data->sample_period = state->timer_period;
+        timer_set(&data->sample_timer,
+                  zx_time_add_duration(current_time(), state->timer_period),
+                  TIMER_SLACK_CENTER, 0, x86_ipm_sample_timer_callback, data);
+    }
+
+    if (!supports_perfmon)
+        return;
 
     for (unsigned i = 0; i < state->num_used_fixed; ++i) {
         unsigned hw_num = state->fixed_hw_map[i];
@@ -1487,8 +1632,6 @@ static void x86_ipm_start_cpu_task(void* raw_context) TA_NO_THREAD_SAFETY_ANALYS
 zx_status_t x86_ipm_start() {
     fbl::AutoLock al(&perfmon_lock);
 
-    if (!supports_perfmon)
-        return ZX_ERR_NOT_SUPPORTED;
     if (atomic_load(&perfmon_active))
         return ZX_ERR_BAD_STATE;
     if (!perfmon_state)
@@ -1505,9 +1648,9 @@ zx_status_t x86_ipm_start() {
     if (status != ZX_OK)
         return status;
 
-    TRACEF("Enabling perfmon, %u fixed, %u programmable, %u misc\n",
+    TRACEF("Enabling perfmon, %u fixed, %u programmable, %u misc, timer %" PRIi64 "ns\n",
            state->num_used_fixed, state->num_used_programmable,
-           state->num_used_misc);
+           state->num_used_misc, state->timer_period);
     if (LOCAL_TRACE) {
         LTRACEF("global ctrl: 0x%" PRIx64 ", fixed ctrl: 0x%" PRIx64 "\n",
                 state->global_ctrl, state->fixed_ctrl);
@@ -1625,8 +1768,10 @@ static void x86_ipm_finalize_buffer(PerfmonState* state, uint32_t cpu) TA_NO_THR
 // This is invoked via mp_sync_exec which thread safety analysis cannot follow.
 static void x86_ipm_stop_cpu_task(void* raw_context) TA_NO_THREAD_SAFETY_ANALYSIS {
     // Disable all counters ASAP.
-    write_msr(IA32_PERF_GLOBAL_CTRL, 0);
-    apic_pmi_mask();
+    if (supports_perfmon) {
+        write_msr(IA32_PERF_GLOBAL_CTRL, 0);
+        apic_pmi_mask();
+    }
 
     DEBUG_ASSERT(arch_ints_disabled());
     DEBUG_ASSERT(!atomic_load(&perfmon_active));
@@ -1636,6 +1781,11 @@ static void x86_ipm_stop_cpu_task(void* raw_context) TA_NO_THREAD_SAFETY_ANALYSI
     auto cpu = arch_curr_cpu_num();
     auto data = &state->cpu_data[cpu];
 
+    if (state->timer_period != 0) {
+        timer_cancel(&data->sample_timer);
+        data->timer_sample_pending = false;
+    }
+
     // Retrieve final event values and write into the trace buffer.
 
     if (data->buffer_start) {
@@ -1651,8 +1801,6 @@ static void x86_ipm_stop_cpu_task(void* raw_context) TA_NO_THREAD_SAFETY_ANALYSI
 zx_status_t x86_ipm_stop() {
     fbl::AutoLock al(&perfmon_lock);
 
-    if (!supports_perfmon)
-        return ZX_ERR_NOT_SUPPORTED;
     if (!perfmon_state)
         return ZX_ERR_BAD_STATE;
 
@@ -1684,6 +1832,9 @@ static void x86_ipm_reset_task(void* raw_context) TA_NO_THREAD_SAFETY_ANALYSIS {
     DEBUG_ASSERT(!atomic_load(&perfmon_active));
     DEBUG_ASSERT(!raw_context);
 
+    if (!supports_perfmon)
+        return;
+
     write_msr(IA32_PERF_GLOBAL_CTRL, 0);
     apic_pmi_mask();
     x86_perfmon_clear_overflow_indicators();
@@ -1708,8 +1859,6 @@ static void x86_ipm_reset_task(void* raw_context) TA_NO_THREAD_SAFETY_ANALYSIS {
 zx_status_t x86_ipm_fini() {
     fbl::AutoLock al(&perfmon_lock);
 
-    if (!supports_perfmon)
-        return ZX_ERR_NOT_SUPPORTED;
     if (atomic_load(&perfmon_active))
         return ZX_ERR_BAD_STATE;
 
@@ -1785,7 +1934,9 @@ static bool pmi_interrupt_handler(x86_iframe_t *frame, PerfmonState* state) {
             } else if (state->programmable_flags[i] & IPM_CONFIG_FLAG_TIMEBASE) {
                 continue;
             }
-            if (state->programmable_flags[i] & IPM_CONFIG_FLAG_PC) {
+            if (state->programmable_flags[i] & IPM_CONFIG_FLAG_STACK) {
+                next = x86_perfmon_write_stack_record(next, id, cr3, frame);
+            } else if (state->programmable_flags[i] & IPM_CONFIG_FLAG_PC) {
                 next = x86_perfmon_write_pc_record(next, id, cr3, frame->ip);
             } else {
                 next = x86_perfmon_write_tick_record(next, id);
@@ -1809,7 +1960,9 @@ static bool pmi_interrupt_handler(x86_iframe_t *frame, PerfmonState* state) {
             } else if (state->fixed_flags[i] & IPM_CONFIG_FLAG_TIMEBASE) {
                 continue;
             }
-            if (state->fixed_flags[i] & IPM_CONFIG_FLAG_PC) {
+            if (state->fixed_flags[i] & IPM_CONFIG_FLAG_STACK) {
+                next = x86_perfmon_write_stack_record(next, id, cr3, frame);
+            } else if (state->fixed_flags[i] & IPM_CONFIG_FLAG_PC) {
                 next = x86_perfmon_write_pc_record(next, id, cr3, frame->ip);
             } else {
                 next = x86_perfmon_write_tick_record(next, id);
@@ -1977,3 +2130,33 @@ void apic_pmi_interrupt_handler(x86_iframe_t *frame) TA_NO_THREAD_SAFETY_ANALYSI
 #endif
     }
 }
+
+// Called at the end of the APIC timer interrupt. If the per-cpu sample timer
+// fired during this interrupt, record where the interrupted thread was.
+void x86_ipm_timer_interrupt_handler(x86_iframe_t *frame) TA_NO_THREAD_SAFETY_ANALYSIS {
+    DEBUG_ASSERT(arch_ints_disabled());
+
+    if (!atomic_load(&perfmon_active))
+        return;
+
+    auto state = perfmon_state.get();
+    uint cpu = arch_curr_cpu_num();
+    auto data = &state->cpu_data[cpu];
+    if (!data->timer_sample_pending)
+        return;
+    data->timer_sample_pending = false;
+
+    if (reinterpret_cast<char*>(data->buffer_next) + kTimerSampleSpaceNeeded >
+            data->buffer_end) {
+        // Leave the timer running, the buffer can't recover but it's cheaper
+        // to keep ignoring it than to try to cancel the timer from here.
+        data->buffer_start->flags |= CPUPERF_BUFFER_FLAG_FULL;
+        return;
+    }
+
+    auto next = data->buffer_next;
+    next = x86_perfmon_write_time_record(next, CPUPERF_EVENT_ID_NONE, rdtsc());
+    next = x86_perfmon_write_stack_record(next, CPUPERF_EVENT_ID_NONE,
+                                          x86_get_cr3(), frame);
+    data->buffer_next = next;
+}
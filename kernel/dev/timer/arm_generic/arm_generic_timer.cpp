@@ -230,6 +230,16 @@ zx_ticks_t ticks_per_second(void) {
     return u64_mul_u32_fp32_64(1000 * 1000 * 1000, cntpct_per_ns);
 }
 
+bool platform_get_ticks_to_time_ratio(struct fp_32_64* ns_per_tick) {
+    // zx_ticks_get() reads the virtual counter, which only matches
+    // current_ticks() if that is what the kernel uses too.
+    if (reg_procs != &cntv_procs) {
+        return false;
+    }
+    *ns_per_tick = ns_per_cntpct;
+    return true;
+}
+
 static uint64_t abs_int64(int64_t a) {
     return (a > 0) ? a : -a;
 }
@@ -30,6 +30,11 @@ void sched_migrate(thread_t* t) TA_REQ(thread_lock);
 // pri should be <= MAX_PRIORITY, negative values disable priority inheritance.
 void sched_inherit_priority(thread_t* t, int pri, bool* local_resched) TA_REQ(thread_lock);
 
+// same as sched_inherit_priority, but for priority inherited through userspace
+// priority inheriting futexes. Unlike sched_inherit_priority, pri always replaces
+// the previous value; negative values disable the inheritance.
+void sched_inherit_futex_priority(thread_t* t, int pri, bool* local_resched) TA_REQ(thread_lock);
+
 // set the priority of a thread and reset the boost value. This function might reschedule.
 // pri should be 0 <= to <= MAX_PRIORITY.
 void sched_change_priority(thread_t* t, int pri) TA_REQ(thread_lock);
@@ -100,12 +100,15 @@ typedef struct thread {
     // priority_boost is a signed value that is moved around within a range by the scheduler.
     // inherited_priority is temporarily set to >0 when inheriting a priority from another
     // thread blocked on a locking primitive this thread holds. -1 means no inherit.
-    // effective_priority is MAX(base_priority + priority boost, inherited_priority) and is
-    // the working priority for run queue decisions.
+    // futex_inherited_priority is the same, but for userspace threads blocked on a priority
+    // inheriting futex this thread owns.
+    // effective_priority is MAX(base_priority + priority boost, inherited_priority,
+    // futex_inherited_priority) and is the working priority for run queue decisions.
     int effec_priority;
     int base_priority;
     int priority_boost;
     int inherited_priority;
+    int futex_inherited_priority;
 
     // current cpu the thread is either running on or in the ready queue, undefined otherwise
     cpu_num_t curr_cpu;
@@ -192,6 +195,10 @@ typedef struct thread {
     //    while preempt_pending is being checked.
     volatile bool preempt_pending;
 
+    // handoff_pending is set between thread_handoff_begin() and
+    // thread_handoff_end().  It is only accessed by the thread itself.
+    bool handoff_pending;
+
     // thread local storage, intialized to zero
     void* tls[THREAD_MAX_TLS_ENTRY];
 
@@ -460,6 +467,21 @@ static inline void thread_resched_reenable(void) {
     }
 }
 
+// thread_handoff_begin() hints that the current thread is about to wait
+// for the next thread it wakes, as the two ends of a zx_channel_call() do.
+// Until thread_handoff_end(), the first thread it wakes is queued at the
+// head of the current CPU's run queue, if its affinity allows, and is
+// given the remainder of the current thread's time slice instead of being
+// sent to another CPU.  This saves the IPI and the cross-CPU wakeup
+// latency when the current thread would otherwise leave its CPU idle.
+static inline void thread_handoff_begin(void) {
+    get_current_thread()->handoff_pending = true;
+}
+
+static inline void thread_handoff_end(void) {
+    get_current_thread()->handoff_pending = false;
+}
+
 // thread_preempt_set_pending() marks a preemption as pending for the
 // current CPU.
 //
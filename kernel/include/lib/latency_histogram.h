@@ -0,0 +1,103 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <arch/ops.h>
+#include <kernel/atomic.h>
+#include <lk/init.h>
+#include <zircon/compiler.h>
+#include <zircon/types.h>
+
+// Latency histograms count how long some operation took, in ticks, bucketed
+// by powers of two. They answer questions like "what is the p99 of
+// zx_channel_write?" without having to enable tracing.
+//
+// A histogram has a group name and a number of rows, one for each kind of
+// operation in the group (e.g. one row per syscall). Every CPU records into
+// its own copy of the buckets, and readers sum them up, so recording is a
+// couple of loads and an add. Like kernel counters, the buckets are not
+// updated atomically on x86 and a preemption in the middle of an update can
+// lose a sample.
+//
+// Histograms are read with ZX_INFO_LATENCY_HISTOGRAMS, or on the console with
+// 'k hist'.
+//
+// Defining a histogram:
+//      static const char* row_name(size_t row) { ... }
+//      LATENCY_HISTOGRAM(my_histogram, "group", num_rows, row_name);
+//
+// Recording a sample:
+//      zx_ticks_t start = current_ticks();
+//      ...
+//      my_histogram.Add(row, current_ticks() - start);
+class LatencyHistogram {
+public:
+    // Bucket 0 counts samples of 0 ticks, and bucket n counts samples in
+    // [2^(n-1), 2^n) ticks. The last bucket also counts anything longer.
+    static constexpr size_t kBuckets = 32;
+
+    using RowNameFn = const char* (*)(size_t row);
+
+    constexpr LatencyHistogram(const char* group, size_t num_rows, RowNameFn row_name)
+        : group_(group), num_rows_(num_rows), row_name_(row_name) {}
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    // Allocates the buckets and makes the histogram visible to readers.
+    // Samples recorded before this are dropped.
+    void Init();
+
+    void Add(size_t row, zx_ticks_t ticks) {
+        uint64_t* buckets = buckets_;
+        if (unlikely(buckets == nullptr || row >= num_rows_)) {
+            return;
+        }
+        uint64_t* slot = &buckets[(arch_curr_cpu_num() * num_rows_ + row) * kBuckets +
+                                  Bucket(ticks)];
+#if defined(__aarch64__)
+        atomic_add_64_relaxed(reinterpret_cast<int64_t*>(slot), 1);
+#else
+        ++*slot;
+#endif
+    }
+
+    static size_t Bucket(zx_ticks_t ticks) {
+        if (ticks <= 0) {
+            return 0;
+        }
+        size_t bucket = 64 - __builtin_clzll(static_cast<uint64_t>(ticks));
+        return bucket < kBuckets ? bucket : kBuckets - 1;
+    }
+
+    // Sums |row| across all CPUs into |out|.
+    void Read(size_t row, uint64_t out[kBuckets]) const;
+
+    const char* group() const { return group_; }
+    size_t num_rows() const { return num_rows_; }
+    const char* RowName(size_t row) const { return row_name_(row); }
+
+    // The initialized histograms, most recently initialized first. The list
+    // only grows, so it may be walked without a lock.
+    static const LatencyHistogram* First();
+    const LatencyHistogram* Next() const { return next_; }
+
+private:
+    const char* const group_;
+    const size_t num_rows_;
+    const RowNameFn row_name_;
+    size_t num_cpus_ = 0;
+    uint64_t* buckets_ = nullptr;
+    const LatencyHistogram* next_ = nullptr;
+};
+
+// The buckets are allocated just before userspace starts, once the number of
+// CPUs is known.
+#define LATENCY_HISTOGRAM(var, group, num_rows, row_name)   \
+    static LatencyHistogram var(group, num_rows, row_name); \
+    static void var##_init(uint level) { var.Init(); }      \
+    LK_INIT_HOOK(var, var##_init, LK_INIT_LEVEL_USER - 1)
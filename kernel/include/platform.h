@@ -38,6 +38,13 @@ zx_ticks_t ticks_per_second(void);
 /* high-precision timer current_ticks */
 zx_ticks_t current_ticks(void);
 
+/* if current_time() is current_ticks() scaled by a constant factor, and
+ * current_ticks() reads the same counter that usermode reads for
+ * zx_ticks_get(), store the nanoseconds per tick in |ns_per_tick| and
+ * return true. */
+struct fp_32_64;
+bool platform_get_ticks_to_time_ratio(struct fp_32_64* ns_per_tick);
+
 /* super early platform initialization, before almost everything */
 void platform_early_init(void);
 
@@ -13,6 +13,7 @@
 #include <kernel/mp.h>
 #include <kernel/percpu.h>
 #include <kernel/thread.h>
+#include <lib/counters.h>
 #include <lib/ktrace.h>
 #include <list.h>
 #include <platform.h>
@@ -53,6 +54,8 @@
 // threads get 10ms to run before they use up their time slice and the scheduler is invoked
 #define THREAD_INITIAL_TIME_SLICE ZX_MSEC(10)
 
+KCOUNTER(sched_handoff_count, "kernel.sched.handoffs");
+
 static bool local_migrate_if_needed(thread_t* curr_thread);
 
 // compute the effective priority of a thread
@@ -61,6 +64,9 @@ static void compute_effec_priority(thread_t* t) {
     if (t->inherited_priority > ep) {
         ep = t->inherited_priority;
     }
+    if (t->futex_inherited_priority > ep) {
+        ep = t->futex_inherited_priority;
+    }
 
     DEBUG_ASSERT(ep >= LOWEST_PRIORITY && ep <= HIGHEST_PRIORITY);
 
@@ -286,6 +292,7 @@ void sched_init_thread(thread_t* t, int priority) {
     t->base_priority = priority;
     t->priority_boost = 0;
     t->inherited_priority = -1;
+    t->futex_inherited_priority = -1;
     compute_effec_priority(t);
 }
 
@@ -303,6 +310,44 @@ void sched_block() {
     sched_resched_internal();
 }
 
+// if the current thread asked to hand off to the next thread it wakes (see
+// thread_handoff_begin()), queue t at the head of the local run queue with the rest of
+// the current thread's time slice, which the current thread gives up. returns true if
+// t was queued.
+static bool handoff_to_thread(thread_t* t) TA_REQ(thread_lock) {
+    thread_t* current_thread = get_current_thread();
+    if (likely(!current_thread->handoff_pending) || arch_blocking_disallowed()) {
+        return false;
+    }
+
+    // the hint only applies to a single wakeup
+    current_thread->handoff_pending = false;
+
+    cpu_num_t cpu = arch_curr_cpu_num();
+    if (!(t->cpu_affinity & cpu_num_to_mask(cpu)) || thread_is_real_time_or_idle(current_thread)) {
+        return false;
+    }
+
+    zx_duration_t used = zx_time_sub_time(current_time(), current_thread->last_started_running);
+    zx_duration_t remaining = zx_duration_sub_duration(
+        current_thread->remaining_time_slice, MIN(used, current_thread->remaining_time_slice));
+    if (remaining > 0) {
+        t->remaining_time_slice = remaining;
+    }
+
+    // the donated time is charged to the donor, so that the pair cannot run for
+    // longer than one slice; the donor goes to the tail of the queue when it is
+    // next preempted, and starts a fresh slice when it next runs
+    current_thread->remaining_time_slice = 0;
+
+    LOCAL_KTRACE2("sched_handoff", (uint32_t)t->user_tid, (uint32_t)remaining);
+
+    t->curr_cpu = cpu;
+    insert_in_run_queue_head(cpu, t);
+    kcounter_add(sched_handoff_count, 1);
+    return true;
+}
+
 // find a cpu to run the thread on, put it in the run queue for that cpu, and accumulate a list
 // of cpus we'll need to reschedule, including the local cpu.
 static void find_cpu_and_insert(thread_t* t, bool* local_resched,
@@ -341,6 +386,10 @@ bool sched_unblock(thread_t* t) {
     // stuff the new thread in the run queue
     t->state = THREAD_READY;
 
+    if (unlikely(handoff_to_thread(t))) {
+        return true;
+    }
+
     bool local_resched = false;
     cpu_mask_t mask = 0;
     find_cpu_and_insert(t, &local_resched, &mask);
@@ -370,6 +419,10 @@ bool sched_unblock_list(struct list_node* list) {
 
         // stuff the new thread in the run queue
         t->state = THREAD_READY;
+        if (unlikely(handoff_to_thread(t))) {
+            local_resched = true;
+            continue;
+        }
         find_cpu_and_insert(t, &local_resched, &accum_cpu_mask);
     }
 
@@ -659,6 +712,26 @@ static void sched_priority_changed(thread_t* t, int old_prio,
     }
 }
 
+// recompute the effective priority of |t| after one of its inherited priorities changed,
+// moving it within its run or wait queue if the effective priority moved
+static void inherited_priority_changed(thread_t* t, bool* local_resched) {
+    int old_ep = t->effec_priority;
+    compute_effec_priority(t);
+    if (old_ep == t->effec_priority) {
+        // same effective priority, nothing to do
+        return;
+    }
+
+    // see if we need to do something based on the state of the thread
+    cpu_mask_t accum_cpu_mask = 0;
+    sched_priority_changed(t, old_ep, local_resched, &accum_cpu_mask);
+
+    // send some ipis based on the previous code
+    if (accum_cpu_mask) {
+        mp_reschedule(accum_cpu_mask, 0);
+    }
+}
+
 // set the priority to the higher value of what it was before and the newly inherited value
 // pri < 0 disables priority inheritance and goes back to the naturally computed values
 void sched_inherit_priority(thread_t* t, int pri, bool* local_resched) {
@@ -673,23 +746,34 @@ void sched_inherit_priority(thread_t* t, int pri, bool* local_resched) {
         return;
     }
 
-    // adjust the priority and remember the old value
+    // adjust the priority and recompute the effective value
     t->inherited_priority = pri;
-    int old_ep = t->effec_priority;
-    compute_effec_priority(t);
-    if (old_ep == t->effec_priority) {
-        // same effective priority, nothing to do
+    inherited_priority_changed(t, local_resched);
+}
+
+// same as sched_inherit_priority, but for the priority inherited from userspace threads
+// blocked on priority inheriting futexes. this is tracked separately so that releasing
+// the last kernel mutex does not drop a boost that a userspace lock still requires.
+// the caller computes pri from every futex the thread owns, so it replaces the old value.
+void sched_inherit_futex_priority(thread_t* t, int pri, bool* local_resched) {
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+
+    if (unlikely(t->state == THREAD_DEATH)) {
         return;
     }
 
-    // see if we need to do something based on the state of the thread
-    cpu_mask_t accum_cpu_mask = 0;
-    sched_priority_changed(t, old_ep, local_resched, &accum_cpu_mask);
+    if (pri > HIGHEST_PRIORITY) {
+        pri = HIGHEST_PRIORITY;
+    } else if (pri < 0) {
+        pri = -1;
+    }
 
-    // send some ipis based on the previous code
-    if (accum_cpu_mask) {
-        mp_reschedule(accum_cpu_mask, 0);
+    if (pri == t->futex_inherited_priority) {
+        return;
     }
+
+    t->futex_inherited_priority = pri;
+    inherited_priority_changed(t, local_resched);
 }
 
 // changes the thread's base priority and if the re-computed effective priority changed
@@ -0,0 +1,106 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <lib/latency_histogram.h>
+
+#include <string.h>
+
+#include <platform.h>
+
+#include <fbl/alloc_checker.h>
+#include <fbl/atomic.h>
+
+#include <lib/console.h>
+
+static fbl::atomic<const LatencyHistogram*> histogram_list;
+
+void LatencyHistogram::Init() {
+    DEBUG_ASSERT(buckets_ == nullptr);
+    size_t num_cpus = arch_max_num_cpus();
+    fbl::AllocChecker ac;
+    uint64_t* buckets = new (&ac) uint64_t[num_cpus * num_rows_ * kBuckets]();
+    if (!ac.check()) {
+        printf("latency histogram %s: no memory for buckets\n", group_);
+        return;
+    }
+    num_cpus_ = num_cpus;
+    buckets_ = buckets;
+
+    // Init hooks run one at a time, but readers may already be walking the
+    // list.
+    next_ = histogram_list.load();
+    histogram_list.store(this);
+}
+
+void LatencyHistogram::Read(size_t row, uint64_t out[kBuckets]) const {
+    memset(out, 0, kBuckets * sizeof(out[0]));
+    if (buckets_ == nullptr || row >= num_rows_) {
+        return;
+    }
+    for (size_t cpu = 0; cpu != num_cpus_; ++cpu) {
+        const uint64_t* buckets = &buckets_[(cpu * num_rows_ + row) * kBuckets];
+        for (size_t ix = 0; ix != kBuckets; ++ix) {
+            out[ix] += buckets[ix];
+        }
+    }
+}
+
+const LatencyHistogram* LatencyHistogram::First() {
+    return histogram_list.load();
+}
+
+// Returns the smallest bucket bound, in ticks, that covers |percentile| of
+// |count| samples.
+static uint64_t percentile_bound(const uint64_t buckets[LatencyHistogram::kBuckets],
+                                 uint64_t count, uint64_t percentile) {
+    uint64_t target = (count * percentile + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t ix = 0; ix != LatencyHistogram::kBuckets; ++ix) {
+        seen += buckets[ix];
+        if (seen >= target) {
+            return ix == 0 ? 0 : 1ul << ix;
+        }
+    }
+    return 1ul << (LatencyHistogram::kBuckets - 1);
+}
+
+static void dump_histograms(const char* prefix) {
+    const uint64_t tps = ticks_per_second();
+    printf("%-12s %-32s %12s %12s %12s\n", "group", "name", "count", "p50(ns)", "p99(ns)");
+    for (auto hist = LatencyHistogram::First(); hist != nullptr; hist = hist->Next()) {
+        for (size_t row = 0; row != hist->num_rows(); ++row) {
+            const char* name = hist->RowName(row);
+            if (prefix != nullptr && strncmp(prefix, name, strlen(prefix)) != 0) {
+                continue;
+            }
+            uint64_t buckets[LatencyHistogram::kBuckets];
+            hist->Read(row, buckets);
+            uint64_t count = 0;
+            for (auto bucket : buckets) {
+                count += bucket;
+            }
+            if (count == 0) {
+                continue;
+            }
+            printf("%-12s %-32s %12lu %12lu %12lu\n", hist->group(), name, count,
+                   percentile_bound(buckets, count, 50) * ZX_SEC(1) / tps,
+                   percentile_bound(buckets, count, 99) * ZX_SEC(1) / tps);
+        }
+    }
+}
+
+static int cmd_hist(int argc, const cmd_args* argv, uint32_t flags) {
+    if (argc > 2) {
+        printf("usage: %s [<name-prefix>]\n", argv[0].str);
+        return 1;
+    }
+    dump_histograms(argc == 2 ? argv[1].str : nullptr);
+    return 0;
+}
+
+STATIC_COMMAND_START
+STATIC_COMMAND("hist", "view latency histograms", &cmd_hist)
+STATIC_COMMAND_END(latency_histogram);
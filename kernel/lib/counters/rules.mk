@@ -9,7 +9,8 @@ LOCAL_DIR := $(GET_LOCAL_DIR)
 MODULE := $(LOCAL_DIR)
 
 MODULE_SRCS += \
-	$(LOCAL_DIR)/counters.cpp
+	$(LOCAL_DIR)/counters.cpp \
+	$(LOCAL_DIR)/latency_histogram.cpp
 
 MODULE_DEPS += \
 	kernel/lib/console
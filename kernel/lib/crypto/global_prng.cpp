@@ -11,6 +11,10 @@
 #include <err.h>
 #include <explicit-memory/bytes.h>
 #include <fbl/algorithm.h>
+#include <fbl/alloc_checker.h>
+#include <arch/ops.h>
+#include <fbl/atomic.h>
+#include <kernel/align.h>
 #include <kernel/auto_lock.h>
 #include <kernel/cmdline.h>
 #include <kernel/mutex.h>
@@ -20,6 +24,7 @@
 #include <lib/crypto/entropy/hw_rng_collector.h>
 #include <lib/crypto/entropy/quality_test.h>
 #include <lib/crypto/prng.h>
+#include <lib/counters.h>
 #include <zxcpp/new.h>
 #include <lk/init.h>
 #include <string.h>
@@ -33,11 +38,75 @@ namespace GlobalPRNG {
 
 static PRNG* kGlobalPrng = nullptr;
 
+namespace {
+
+// A PRNG instance owned by a single CPU.  Each is padded out to its own cache
+// line so that draws on different CPUs do not share lock or counter lines.
+struct __CPU_ALIGN PerCpuPrng {
+    PRNG* prng = nullptr;
+
+    // Bytes drawn from |prng| since it was last reseeded.
+    fbl::atomic<uint64_t> drawn{0};
+
+    // Value of |entropy_generation| when |prng| was last reseeded.
+    fbl::atomic<uint64_t> generation{0};
+};
+
+PerCpuPrng per_cpu_prngs[SMP_MAX_CPUS];
+
+// Set once all of |per_cpu_prngs| have been created.
+fbl::atomic<bool> per_cpu_ready(false);
+
+// Bumped whenever entropy is added to the global PRNG, so that each per-CPU
+// instance picks it up on its next draw.
+fbl::atomic<uint64_t> entropy_generation(0);
+
+} // namespace
+
+KCOUNTER(prng_per_cpu_reseeds, "kernel.prng.per_cpu_reseeds");
+
 PRNG* GetInstance() {
     ASSERT(kGlobalPrng);
     return kGlobalPrng;
 }
 
+static void ReseedPerCpu(PerCpuPrng* pcp, uint64_t generation) {
+    uint8_t seed[PRNG::kMinEntropy];
+    GetInstance()->Draw(seed, sizeof(seed));
+    pcp->prng->AddEntropy(seed, sizeof(seed));
+    mandatory_memset(seed, 0, sizeof(seed));
+
+    // Two threads on the same CPU may race to reseed the same instance.  That
+    // only mixes in some extra entropy; AddEntropy serializes the updates.
+    pcp->drawn.store(0);
+    pcp->generation.store(generation);
+    kcounter_add(prng_per_cpu_reseeds, 1);
+}
+
+void DrawPerCpu(void* out, size_t size) {
+    if (!per_cpu_ready.load()) {
+        GetInstance()->Draw(out, size);
+        return;
+    }
+
+    // If the thread migrates after this point it keeps using the instance of
+    // the CPU it started on.  That is harmless since each instance is itself
+    // thread-safe; it only costs some cache locality.
+    PerCpuPrng* pcp = &per_cpu_prngs[arch_curr_cpu_num()];
+
+    const uint64_t generation = entropy_generation.load();
+    if (pcp->generation.load() != generation ||
+        pcp->drawn.fetch_add(size) + size > kPerCpuReseedInterval) {
+        ReseedPerCpu(pcp, generation);
+    }
+    pcp->prng->Draw(out, size);
+}
+
+void AddEntropy(const void* data, size_t size) {
+    GetInstance()->AddEntropy(data, size);
+    entropy_generation.fetch_add(1);
+}
+
 // Returns true if the kernel cmdline provided at least PRNG::kMinEntropy bytes
 // of entropy, and false otherwise.
 //
@@ -167,6 +236,28 @@ static void BecomeThreadSafe(uint level) {
     GetInstance()->BecomeThreadSafe();
 }
 
+// Creates a thread-safe PRNG for each CPU, seeded from the global PRNG.
+static void CreatePerCpuPrngs(uint level) {
+    const uint64_t generation = entropy_generation.load();
+    for (cpu_num_t i = 0; i < arch_max_num_cpus(); i++) {
+        uint8_t seed[PRNG::kMinEntropy];
+        GetInstance()->Draw(seed, sizeof(seed));
+
+        fbl::AllocChecker ac;
+        PRNG* prng = new (&ac) PRNG(seed, sizeof(seed));
+        mandatory_memset(seed, 0, sizeof(seed));
+        if (!ac.check()) {
+            // Leave the instances that were created unused; DrawPerCpu() keeps
+            // falling back to the global PRNG.
+            printf("WARNING: Failed to allocate per-CPU PRNGs\n");
+            return;
+        }
+        per_cpu_prngs[i].prng = prng;
+        per_cpu_prngs[i].generation.store(generation);
+    }
+    per_cpu_ready.store(true);
+}
+
 } //namespace GlobalPRNG
 
 } // namespace crypto
@@ -177,3 +268,6 @@ LK_INIT_HOOK(global_prng_seed, crypto::GlobalPRNG::EarlyBootSeed,
 
 LK_INIT_HOOK(global_prng_thread_safe, crypto::GlobalPRNG::BecomeThreadSafe,
              LK_INIT_LEVEL_THREADING - 1)
+
+LK_INIT_HOOK(global_prng_per_cpu, crypto::GlobalPRNG::CreatePerCpuPrngs,
+             LK_INIT_LEVEL_THREADING)
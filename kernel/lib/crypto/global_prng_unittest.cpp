@@ -8,6 +8,7 @@
 
 #include <lib/unittest/unittest.h>
 #include <stdint.h>
+#include <string.h>
 
 namespace crypto {
 
@@ -24,10 +25,61 @@ bool identical() {
     END_TEST;
 }
 
+bool per_cpu_draw() {
+    BEGIN_TEST;
+
+    uint8_t zeroes[64] = {0};
+    uint8_t out1[64] = {0};
+    uint8_t out2[64] = {0};
+
+    GlobalPRNG::DrawPerCpu(out1, sizeof(out1));
+    GlobalPRNG::DrawPerCpu(out2, sizeof(out2));
+
+    EXPECT_NE(0, memcmp(out1, zeroes, sizeof(out1)), "");
+    EXPECT_NE(0, memcmp(out1, out2, sizeof(out1)), "");
+
+    END_TEST;
+}
+
+bool per_cpu_draw_across_reseed() {
+    BEGIN_TEST;
+
+    // Draw enough to force the current CPU's instance to reseed at least once.
+    uint8_t prev[32] = {0};
+    uint8_t cur[32];
+    for (size_t drawn = 0; drawn <= 2 * GlobalPRNG::kPerCpuReseedInterval;
+         drawn += sizeof(cur)) {
+        GlobalPRNG::DrawPerCpu(cur, sizeof(cur));
+        ASSERT_NE(0, memcmp(prev, cur, sizeof(cur)), "");
+        memcpy(prev, cur, sizeof(prev));
+    }
+
+    END_TEST;
+}
+
+bool per_cpu_add_entropy() {
+    BEGIN_TEST;
+
+    uint8_t entropy[PRNG::kMinEntropy] = {0};
+    uint8_t out1[32] = {0};
+    uint8_t out2[32] = {0};
+
+    GlobalPRNG::DrawPerCpu(out1, sizeof(out1));
+    GlobalPRNG::AddEntropy(entropy, sizeof(entropy));
+    GlobalPRNG::DrawPerCpu(out2, sizeof(out2));
+
+    EXPECT_NE(0, memcmp(out1, out2, sizeof(out1)), "");
+
+    END_TEST;
+}
+
 } // namespace
 
 UNITTEST_START_TESTCASE(global_prng_tests)
 UNITTEST("Identical", identical)
+UNITTEST("PerCpuDraw", per_cpu_draw)
+UNITTEST("PerCpuDrawAcrossReseed", per_cpu_draw_across_reseed)
+UNITTEST("PerCpuAddEntropy", per_cpu_add_entropy)
 UNITTEST_END_TESTCASE(global_prng_tests, "global_prng",
                       "Validate global PRNG singleton");
 
@@ -16,6 +16,23 @@ namespace GlobalPRNG {
 // guaranteed to be non-null.
 PRNG* GetInstance();
 
+// Fills |out| with |size| bytes of pseudo-random output drawn from a PRNG
+// instance belonging to the current CPU, so that concurrent callers on
+// different CPUs do not serialize on the global instance's lock.  The per-CPU
+// instances are seeded from the global PRNG and reseeded from it after every
+// kPerCpuReseedInterval bytes of output, or after entropy is added through
+// AddEntropy() below.  Before the per-CPU instances exist this draws from the
+// global PRNG directly.  |size| MUST NOT be greater than PRNG::kMaxDrawLen.
+void DrawPerCpu(void* out, size_t size);
+
+// Mixes |data| into the global PRNG and forces every per-CPU instance to
+// reseed before its next draw.  |size| MUST NOT be greater than
+// PRNG::kMaxEntropy.
+void AddEntropy(const void* data, size_t size);
+
+// Number of bytes a per-CPU instance may produce between reseeds.
+constexpr size_t kPerCpuReseedInterval = 64 * 1024;
+
 } //namespace GlobalPRNG
 
 } // namespace crypto
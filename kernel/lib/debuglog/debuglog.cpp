@@ -8,21 +8,34 @@
 
 #include <dev/udisplay.h>
 #include <err.h>
+#include <fbl/algorithm.h>
+#include <fbl/alloc_checker.h>
 #include <fbl/atomic.h>
+#include <kernel/align.h>
+#include <kernel/mp.h>
 #include <kernel/spinlock.h>
 #include <kernel/thread.h>
+#include <lib/console.h>
+#include <lib/counters.h>
 #include <lib/crashlog.h>
 #include <kernel/cmdline.h>
 #include <lib/io.h>
 #include <lib/version.h>
 #include <lk/init.h>
 #include <platform.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include <vm/vm.h>
 #include <zircon/types.h>
 
-#define DLOG_SIZE (128u * 1024u)
+// The size of the log can be set at build time with DEBUGLOG_SIZE_KB
+// (see rules.mk).
+#ifndef DLOG_SIZE_KB
+#define DLOG_SIZE_KB 128u
+#endif
+
+#define DLOG_SIZE (DLOG_SIZE_KB * 1024u)
 #define DLOG_MASK (DLOG_SIZE - 1u)
 
 static_assert((DLOG_SIZE & DLOG_MASK) == 0u, "must be power of two");
@@ -104,40 +117,99 @@ bool dlog_bypass(void) {
 
 #define ALIGN4(n) (((n) + 3) & (~3))
 
-zx_status_t dlog_write(uint32_t flags, const void* data_ptr, size_t len) {
-    const uint8_t* ptr = static_cast<const uint8_t*>(data_ptr);
-    dlog_t* log = &DLOG;
+// Records are not written to the log directly.  Each cpu has a staging
+// buffer laid out like the log, in which writers reserve space with an
+// atomic compare-and-swap and fill in their record with interrupts enabled.
+// A record is complete once its header word, which is written last, is
+// non-zero.  The notifier thread drains the staging buffers into the log,
+// merging them in timestamp order, which keeps the time spent with
+// interrupts disabled under |log->lock| to one copy of one record at a time.
+//
+// Writers that find their staging buffer full, or that run before the
+// staging buffers are set up, fall back to writing to the log directly.
+//
+// Only the ordering of records that are complete when a drain happens is
+// guaranteed: a writer that is preempted in the middle of filling in its
+// record may have it merged after newer ones.
+
+#define DLOG_STAGE_SIZE (8u * 1024u)
+#define DLOG_STAGE_MASK (DLOG_STAGE_SIZE - 1u)
+
+static_assert((DLOG_STAGE_SIZE & DLOG_STAGE_MASK) == 0u, "must be power of two");
+static_assert(DLOG_MAX_RECORD <= DLOG_STAGE_SIZE, "");
+
+struct __CPU_ALIGN dlog_stage {
+    // Next position to reserve, advanced by writers.
+    fbl::atomic<uint64_t> reserve;
+    // Position of the oldest record not yet drained, advanced by the drainer.
+    fbl::atomic<uint64_t> tail;
+    uint8_t* data;
+};
 
-    if (len > DLOG_MAX_DATA) {
-        return ZX_ERR_OUT_OF_RANGE;
-    }
+static dlog_stage dlog_stages[SMP_MAX_CPUS];
 
-    if (log->panic) {
-        return ZX_ERR_BAD_STATE;
-    }
+// Set once the staging buffers are allocated and the notifier thread is
+// running to drain them.
+static fbl::atomic_bool dlog_staging_enabled;
 
-    // Our size "on the wire" must be a multiple of 4, so we know
-    // that worst case there will be room for a header skipping
-    // the last n bytes when the fifo wraps
-    size_t wiresize = DLOG_MIN_RECORD + ALIGN4(len);
+// Set by dlog_init_hook() if every cpu's staging buffer was allocated, and
+// cleared by dlog_shutdown() once the notifier has stopped.  Staging may only
+// be turned on, and the buffers only drained, while this is set.
+static fbl::atomic_bool dlog_staging_available;
 
-    // Prepare the record header before taking the lock
-    dlog_header_t hdr;
-    hdr.header = static_cast<uint32_t>(DLOG_HDR_SET(wiresize, DLOG_MIN_RECORD + len));
-    hdr.datalen = static_cast<uint16_t>(len);
-    hdr.flags = static_cast<uint16_t>(flags);
-    hdr.timestamp = current_time();
-    thread_t* t = get_current_thread();
-    if (t) {
-        hdr.pid = t->user_pid;
-        hdr.tid = t->user_tid;
-    } else {
-        hdr.pid = 0;
-        hdr.tid = 0;
-    }
+KCOUNTER(dlog_staged_count, "kernel.debuglog.staged");
+KCOUNTER(dlog_direct_count, "kernel.debuglog.direct");
 
+// The longest time log->lock has been held, in ticks.  This is time spent
+// with interrupts disabled.
+static fbl::atomic<uint64_t> dlog_max_lock_ticks;
+
+static void ring_write(uint8_t* ring, size_t mask, size_t pos, const void* src, size_t len) {
+    size_t offset = pos & mask;
+    size_t first = fbl::min(len, mask + 1 - offset);
+    memcpy(ring + offset, src, first);
+    memcpy(ring, static_cast<const uint8_t*>(src) + first, len - first);
+}
+
+static void ring_read(const uint8_t* ring, size_t mask, size_t pos, void* dst, size_t len) {
+    size_t offset = pos & mask;
+    size_t first = fbl::min(len, mask + 1 - offset);
+    memcpy(dst, ring + offset, first);
+    memcpy(static_cast<uint8_t*>(dst) + first, ring, len - first);
+}
+
+static void ring_zero(uint8_t* ring, size_t mask, size_t pos, size_t len) {
+    size_t offset = pos & mask;
+    size_t first = fbl::min(len, mask + 1 - offset);
+    memset(ring + offset, 0, first);
+    memset(ring, 0, len - first);
+}
+
+// The header word of a record never wraps, as records are multiples of 4
+// bytes long.
+static uint32_t* header_word(uint8_t* ring, size_t mask, size_t pos) {
+    return reinterpret_cast<uint32_t*>(ring + (pos & mask));
+}
+
+static void dlog_signal(dlog_t* log, bool holding_thread_lock) {
+    [log, holding_thread_lock]() TA_NO_THREAD_SAFETY_ANALYSIS {
+        // if we happen to be called from within the global thread lock, use a
+        // special version of event signal
+        if (holding_thread_lock) {
+            event_signal_thread_locked(&log->event);
+        } else {
+            event_signal(&log->event, false);
+        }
+    }();
+}
+
+// Copies a record into the log, discarding the oldest records to make
+// room.  Returns whether the caller holds the thread lock.
+static bool dlog_append(dlog_t* log, const dlog_header_t* hdr, const uint8_t* ptr,
+                        size_t len, size_t wiresize) {
     spin_lock_saved_state_t state;
     spin_lock_irqsave(&log->lock, state);
+    const uint64_t start = current_ticks();
 
     // Discard records at tail until there is enough
     // space for the new record.
@@ -152,18 +224,19 @@ zx_status_t dlog_write(uint32_t flags, const void* data_ptr, size_t len) {
 
     if (fifospace >= wiresize) {
         // everything fits in one write, simple case!
-        memcpy(log->data + offset, &hdr, sizeof(hdr));
-        memcpy(log->data + offset + sizeof(hdr), ptr, len);
-    } else if (fifospace < sizeof(hdr)) {
+        memcpy(log->data + offset, hdr, sizeof(*hdr));
+        memcpy(log->data + offset + sizeof(*hdr), ptr, len);
+    } else if (fifospace < sizeof(*hdr)) {
         // the wrap happens in the header
-        memcpy(log->data + offset, &hdr, fifospace);
-        memcpy(log->data, reinterpret_cast<uint8_t*>(&hdr) + fifospace, sizeof(hdr) - fifospace);
-        memcpy(log->data + (sizeof(hdr) - fifospace), ptr, len);
+        memcpy(log->data + offset, hdr, fifospace);
+        memcpy(log->data, reinterpret_cast<const uint8_t*>(hdr) + fifospace,
+               sizeof(*hdr) - fifospace);
+        memcpy(log->data + (sizeof(*hdr) - fifospace), ptr, len);
     } else {
         // the wrap happens in the data
-        memcpy(log->data + offset, &hdr, sizeof(hdr));
-        offset += sizeof(hdr);
-        fifospace -= sizeof(hdr);
+        memcpy(log->data + offset, hdr, sizeof(*hdr));
+        offset += sizeof(*hdr);
+        fifospace -= sizeof(*hdr);
         memcpy(log->data + offset, ptr, fifospace);
         memcpy(log->data, ptr + fifospace, len - fifospace);
     }
@@ -181,18 +254,147 @@ zx_status_t dlog_write(uint32_t flags, const void* data_ptr, size_t len) {
     // C2: Running this thread, evaluate arch_curr_cpu_num() -> C2
     bool holding_thread_lock = spin_lock_holder_cpu(&thread_lock) == arch_curr_cpu_num();
 
+    const uint64_t held = current_ticks() - start;
+    uint64_t max = dlog_max_lock_ticks.load(fbl::memory_order_relaxed);
+    while (held > max &&
+           !dlog_max_lock_ticks.compare_exchange_weak(&max, held, fbl::memory_order_relaxed,
+                                                      fbl::memory_order_relaxed)) {
+    }
+
     spin_unlock_irqrestore(&log->lock, state);
+    return holding_thread_lock;
+}
 
-    [log, holding_thread_lock]() TA_NO_THREAD_SAFETY_ANALYSIS {
-        // if we happen to be called from within the global thread lock, use a
-        // special version of event signal
-        if (holding_thread_lock) {
-            event_signal_thread_locked(&log->event);
-        } else {
-            event_signal(&log->event, false);
+// Tries to put a record in the current cpu's staging buffer.  Returns false
+// if staging is unavailable or the buffer is full.
+static bool dlog_stage_record(dlog_t* log, const dlog_header_t* hdr, const uint8_t* ptr,
+                              size_t len, size_t wiresize) {
+    if (!dlog_staging_enabled.load(fbl::memory_order_acquire)) {
+        return false;
+    }
+
+    // The thread may migrate after this, which is harmless: the buffer is
+    // safe to write from any cpu.
+    dlog_stage* stage = &dlog_stages[arch_curr_cpu_num()];
+    uint64_t pos = stage->reserve.load(fbl::memory_order_relaxed);
+    do {
+        if (pos + wiresize - stage->tail.load(fbl::memory_order_acquire) > DLOG_STAGE_SIZE) {
+            return false;
+        }
+    } while (!stage->reserve.compare_exchange_weak(&pos, pos + wiresize,
+                                                   fbl::memory_order_relaxed,
+                                                   fbl::memory_order_relaxed));
+
+    // Fill in everything but the header word, then publish the record by
+    // writing that.
+    constexpr size_t kWord = sizeof(hdr->header);
+    ring_write(stage->data, DLOG_STAGE_MASK, pos + kWord,
+               reinterpret_cast<const uint8_t*>(hdr) + kWord, sizeof(*hdr) - kWord);
+    ring_write(stage->data, DLOG_STAGE_MASK, pos + sizeof(*hdr), ptr, len);
+    __atomic_store_n(header_word(stage->data, DLOG_STAGE_MASK, pos), hdr->header,
+                     __ATOMIC_SEQ_CST);
+
+    // Only wake the drainer if this record is the oldest in the buffer.  If
+    // it isn't, the drainer is either still working through the older ones
+    // or stopped at one that wasn't complete yet, whose writer will wake it.
+    // This pairs with the drainer advancing |tail| and then checking the
+    // next header word.
+    if (stage->tail.load(fbl::memory_order_seq_cst) == pos) {
+        // The thread lock is only held with interrupts disabled, and then
+        // this can't migrate between the two checks.
+        bool holding_thread_lock = arch_ints_disabled() &&
+                                   spin_lock_holder_cpu(&thread_lock) == arch_curr_cpu_num();
+        dlog_signal(log, holding_thread_lock);
+    }
+    return true;
+}
+
+// Moves all complete records from the staging buffers into the log, oldest
+// first.  Only called from the notifier thread.
+static void dlog_drain(dlog_t* log) {
+    if (!dlog_staging_available.load()) {
+        return;
+    }
+
+    dlog_record_t rec;
+    for (;;) {
+        // Find the oldest record at the head of any staging buffer.
+        dlog_stage* next = nullptr;
+        zx_time_t next_timestamp = 0;
+        for (cpu_num_t i = 0; i < arch_max_num_cpus(); i++) {
+            dlog_stage* stage = &dlog_stages[i];
+            uint64_t tail = stage->tail.load(fbl::memory_order_relaxed);
+            if (__atomic_load_n(header_word(stage->data, DLOG_STAGE_MASK, tail),
+                                __ATOMIC_SEQ_CST) == 0) {
+                continue;
+            }
+            zx_time_t timestamp;
+            ring_read(stage->data, DLOG_STAGE_MASK, tail + offsetof(dlog_header_t, timestamp),
+                      &timestamp, sizeof(timestamp));
+            if (next == nullptr || timestamp < next_timestamp) {
+                next = &dlog_stages[i];
+                next_timestamp = timestamp;
+            }
+        }
+        if (next == nullptr) {
+            return;
         }
-    }();
 
+        uint64_t tail = next->tail.load(fbl::memory_order_relaxed);
+        uint32_t header = *header_word(next->data, DLOG_STAGE_MASK, tail);
+        size_t wiresize = DLOG_HDR_GET_FIFOLEN(header);
+        ring_read(next->data, DLOG_STAGE_MASK, tail, &rec, DLOG_HDR_GET_READLEN(header));
+
+        // Clear the record so that stale bytes are never mistaken for a
+        // header word, then hand the space back to writers.
+        ring_zero(next->data, DLOG_STAGE_MASK, tail, wiresize);
+        next->tail.store(tail + wiresize, fbl::memory_order_seq_cst);
+
+        dlog_append(log, &rec.hdr, reinterpret_cast<const uint8_t*>(rec.data),
+                    rec.hdr.datalen, wiresize);
+    }
+}
+
+zx_status_t dlog_write(uint32_t flags, const void* data_ptr, size_t len) {
+    const uint8_t* ptr = static_cast<const uint8_t*>(data_ptr);
+    dlog_t* log = &DLOG;
+
+    if (len > DLOG_MAX_DATA) {
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+
+    if (log->panic) {
+        return ZX_ERR_BAD_STATE;
+    }
+
+    // Our size "on the wire" must be a multiple of 4, so we know
+    // that worst case there will be room for a header skipping
+    // the last n bytes when the fifo wraps
+    size_t wiresize = DLOG_MIN_RECORD + ALIGN4(len);
+
+    // Prepare the record header before taking the lock
+    dlog_header_t hdr;
+    hdr.header = static_cast<uint32_t>(DLOG_HDR_SET(wiresize, DLOG_MIN_RECORD + len));
+    hdr.datalen = static_cast<uint16_t>(len);
+    hdr.flags = static_cast<uint16_t>(flags);
+    hdr.timestamp = current_time();
+    thread_t* t = get_current_thread();
+    if (t) {
+        hdr.pid = t->user_pid;
+        hdr.tid = t->user_tid;
+    } else {
+        hdr.pid = 0;
+        hdr.tid = 0;
+    }
+
+    if (dlog_stage_record(log, &hdr, ptr, len, wiresize)) {
+        kcounter_add(dlog_staged_count, 1);
+        return ZX_OK;
+    }
+
+    kcounter_add(dlog_direct_count, 1);
+    bool holding_thread_lock = dlog_append(log, &hdr, ptr, len, wiresize);
+    dlog_signal(log, holding_thread_lock);
 
     return ZX_OK;
 }
@@ -293,10 +495,15 @@ static int debuglog_notifier(void* arg) {
 
     for (;;) {
         if (notifier_shutdown_requested.load()) {
+            // Pick up anything staged before dlog_shutdown() turned staging
+            // off.
+            dlog_drain(log);
             break;
         }
         event_wait(&log->event);
 
+        dlog_drain(log);
+
         // notify readers that new log items were posted
         mutex_acquire(&log->readers_lock);
         dlog_reader_t* rdr;
@@ -338,6 +545,10 @@ static void debuglog_dumper_notify(void* cookie) {
 
 static event_t dumper_event = EVENT_INITIAL_VALUE(dumper_event, 0, EVENT_FLAG_AUTOUNSIGNAL);
 
+// Set while "dlog storm" runs, so the dumper doesn't spend the test
+// printing its records.
+static fbl::atomic_bool dumper_muted;
+
 static int debuglog_dumper(void* arg) {
     // assembly buffer with room for log text plus header text
     char tmp[DLOG_MAX_DATA + 128];
@@ -359,6 +570,9 @@ static int debuglog_dumper(void* arg) {
         // dump records to kernel console
         size_t actual;
         while (dlog_read(&reader, 0, &rec, DLOG_MAX_RECORD, &actual) == ZX_OK) {
+            if (dumper_muted.load(fbl::memory_order_relaxed)) {
+                continue;
+            }
             if (rec.hdr.datalen && (rec.data[rec.hdr.datalen - 1] == '\n')) {
                 rec.data[rec.hdr.datalen - 1] = 0;
             } else {
@@ -410,6 +624,10 @@ void dlog_shutdown(void) {
     // Limit how long we wait for the threads to terminate.
     const zx_time_t deadline = current_time() + ZX_SEC(5);
 
+    // Send everything through the log from here on, so that the notifier
+    // can drain the staging buffers for the last time on its way out.
+    dlog_staging_enabled.store(false);
+
     // Shutdown the notifier thread first. Ordering is important because the notifier thread is
     // responsible for passing log records to the dumper.
     notifier_shutdown_requested.store(true);
@@ -421,6 +639,7 @@ void dlog_shutdown(void) {
         }
         notifier_thread = nullptr;
     }
+    dlog_staging_available.store(false);
 
     dumper_shutdown_requested.store(true);
     event_signal(&dumper_event, false);
@@ -437,8 +656,23 @@ static void dlog_init_hook(uint level) {
     DEBUG_ASSERT(notifier_thread == nullptr);
     DEBUG_ASSERT(dumper_thread == nullptr);
 
+    // Allocate every staging buffer before the notifier can run, since early
+    // boot writes have already signalled it.
+    bool staging = true;
+    for (cpu_num_t i = 0; i < arch_max_num_cpus(); i++) {
+        fbl::AllocChecker ac;
+        dlog_stages[i].data = new (&ac) uint8_t[DLOG_STAGE_SIZE]();
+        if (!ac.check()) {
+            staging = false;
+            break;
+        }
+    }
+
     if ((notifier_thread = thread_create("debuglog-notifier", debuglog_notifier, NULL,
                                          HIGH_PRIORITY - 1)) != NULL) {
+        // Staging needs the notifier to drain it.
+        dlog_staging_available.store(staging);
+        dlog_staging_enabled.store(staging);
         thread_resume(notifier_thread);
     }
 
@@ -451,3 +685,93 @@ static void dlog_init_hook(uint level) {
 }
 
 LK_INIT_HOOK(debuglog, dlog_init_hook, LK_INIT_LEVEL_THREADING - 1);
+
+// "dlog storm" has one thread on each cpu writing records as fast as it can,
+// first with every record going straight to the log and then through the
+// staging buffers, and reports how long log->lock was held at most.
+struct dlog_storm_args {
+    zx_time_t deadline;
+    uint64_t writes;
+};
+
+static int dlog_storm_thread(void* arg) {
+    auto args = static_cast<dlog_storm_args*>(arg);
+    static const char kMsg[] = "debuglog storm: the quick brown fox jumps over the lazy dog\n";
+    while (current_time() < args->deadline) {
+        dlog_write(0, kMsg, sizeof(kMsg) - 1);
+        args->writes++;
+    }
+    return 0;
+}
+
+static zx_status_t dlog_storm(zx_duration_t duration, bool staging) {
+    if (staging && !dlog_staging_available.load()) {
+        printf("staging buffers are not set up\n");
+        return ZX_ERR_BAD_STATE;
+    }
+    // Put back whatever mode the log was in, so that a storm doesn't change
+    // how the rest of the system logs.
+    const bool was_staging = dlog_staging_enabled.load();
+    dlog_staging_enabled.store(staging);
+    dlog_max_lock_ticks.store(0);
+
+    dlog_storm_args args[SMP_MAX_CPUS] = {};
+    thread_t* threads[SMP_MAX_CPUS] = {};
+    const cpu_mask_t online = mp_get_online_mask();
+    const zx_time_t deadline = current_time() + duration;
+    for (cpu_num_t i = 0; i < arch_max_num_cpus(); i++) {
+        if (!(online & cpu_num_to_mask(i))) {
+            continue;
+        }
+        args[i].deadline = deadline;
+        threads[i] = thread_create("dlog-storm", dlog_storm_thread, &args[i], DEFAULT_PRIORITY);
+        if (threads[i] != nullptr) {
+            thread_set_cpu_affinity(threads[i], cpu_num_to_mask(i));
+            thread_resume(threads[i]);
+        }
+    }
+
+    uint64_t writes = 0;
+    for (cpu_num_t i = 0; i < arch_max_num_cpus(); i++) {
+        if (threads[i] != nullptr) {
+            thread_join(threads[i], nullptr, ZX_TIME_INFINITE);
+            writes += args[i].writes;
+        }
+    }
+
+    const uint64_t max_ticks = dlog_max_lock_ticks.load();
+    printf("%-8s %10" PRIu64 " writes/s, lock held at most %" PRIu64 " ns\n",
+           staging ? "staged" : "direct", writes * ZX_SEC(1) / duration,
+           max_ticks * ZX_SEC(1) / ticks_per_second());
+
+    dlog_staging_enabled.store(was_staging && dlog_staging_available.load());
+    return ZX_OK;
+}
+
+static int cmd_dlog(int argc, const cmd_args* argv, uint32_t flags) {
+    if (argc > 1 && strcmp(argv[1].str, "stats") == 0) {
+        printf("staging %s, %u KiB log, lock held at most %" PRIu64 " ns\n",
+               dlog_staging_enabled.load() ? "enabled" : "disabled", DLOG_SIZE_KB,
+               dlog_max_lock_ticks.load() * ZX_SEC(1) / ticks_per_second());
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1].str, "storm") == 0) {
+        zx_duration_t duration = ZX_MSEC(argc > 2 ? argv[2].u : 1000);
+        dumper_muted.store(true);
+        zx_status_t status = dlog_storm(duration, false);
+        if (status == ZX_OK) {
+            status = dlog_storm(duration, true);
+        }
+        dumper_muted.store(false);
+        return status;
+    }
+
+    printf("usage:\n"
+           "  dlog stats\n"
+           "  dlog storm [ms]\n");
+    return 0;
+}
+
+STATIC_COMMAND_START
+STATIC_COMMAND("dlog", "debuglog statistics and stress test", &cmd_dlog)
+STATIC_COMMAND_END(dlog);
@@ -12,6 +12,11 @@ MODULE := $(LOCAL_DIR)
 MODULE_SRCS := \
     $(LOCAL_DIR)/debuglog.cpp \
 
+# Size of the in-kernel log buffer, in KiB.  Must be a power of two.
+DEBUGLOG_SIZE_KB ?= 128
+
+MODULE_DEFINES += DLOG_SIZE_KB=$(DEBUGLOG_SIZE_KB)u
+
 MODULE_DEPS := \
     kernel/lib/crashlog \
     kernel/lib/version
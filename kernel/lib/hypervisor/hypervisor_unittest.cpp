@@ -7,6 +7,8 @@
 #include <assert.h>
 #include <err.h>
 #include <hypervisor/guest_physical_address_space.h>
+#include <hypervisor/interrupt_tracker.h>
+#include <hypervisor/trap_map.h>
 #include <lib/unittest/unittest.h>
 #include <vm/pmm.h>
 #include <vm/vm.h>
@@ -14,6 +16,7 @@
 #include <vm/vm_aspace.h>
 #include <vm/vm_object.h>
 #include <vm/vm_object_paged.h>
+#include <zircon/syscalls/hypervisor.h>
 
 static constexpr uint kMmuFlags =
     ARCH_MMU_FLAG_PERM_READ |
@@ -517,6 +520,73 @@ static bool guest_physical_address_space_write_combining() {
     END_TEST;
 }
 
+static bool trap_map_find_trap() {
+    BEGIN_TEST;
+
+    // Insert out of order, so that each insert lands somewhere different in
+    // the snapshot that FindTrap() searches.
+    hypervisor::TrapMap traps;
+    const zx_gpaddr_t kAddrs[] = {4 * PAGE_SIZE, 0, 8 * PAGE_SIZE, 2 * PAGE_SIZE};
+    for (zx_gpaddr_t addr : kAddrs) {
+        zx_status_t status = traps.InsertTrap(ZX_GUEST_TRAP_MEM, addr, PAGE_SIZE, nullptr,
+                                              addr);
+        EXPECT_EQ(ZX_OK, status, "Failed to insert trap\n");
+    }
+    zx_status_t status = traps.InsertTrap(ZX_GUEST_TRAP_MEM, 2 * PAGE_SIZE, PAGE_SIZE, nullptr,
+                                          0);
+    EXPECT_EQ(ZX_ERR_ALREADY_EXISTS, status, "Inserted duplicate trap\n");
+
+    for (zx_gpaddr_t addr : kAddrs) {
+        hypervisor::Trap* trap;
+        status = traps.FindTrap(ZX_GUEST_TRAP_BELL, addr + PAGE_SIZE / 2, &trap);
+        EXPECT_EQ(ZX_OK, status, "Failed to find trap\n");
+        if (status == ZX_OK) {
+            EXPECT_EQ(addr, trap->key(), "Found wrong trap\n");
+        }
+    }
+
+    // Gaps between traps, and the end of the last one.
+    hypervisor::Trap* trap;
+    status = traps.FindTrap(ZX_GUEST_TRAP_BELL, PAGE_SIZE, &trap);
+    EXPECT_EQ(ZX_ERR_NOT_FOUND, status, "Found trap in gap\n");
+    status = traps.FindTrap(ZX_GUEST_TRAP_BELL, 9 * PAGE_SIZE, &trap);
+    EXPECT_EQ(ZX_ERR_NOT_FOUND, status, "Found trap past the end\n");
+
+    END_TEST;
+}
+
+static bool interrupt_tracker_wait() {
+    BEGIN_TEST;
+
+    hypervisor::InterruptTracker<256> tracker;
+    ASSERT_EQ(ZX_OK, tracker.Init(), "Failed to initialize interrupt tracker\n");
+
+    // An interrupt delivered outside of the tracker ends the wait without
+    // blocking.
+    zx_status_t status = tracker.Wait(nullptr, [] { return true; });
+    EXPECT_EQ(ZX_OK, status, "Failed to wait for delivered interrupt\n");
+
+    // A tracked interrupt ends the wait.
+    status = tracker.Interrupt(32, nullptr);
+    EXPECT_EQ(ZX_OK, status, "Failed to track interrupt\n");
+    status = tracker.Wait(nullptr);
+    EXPECT_EQ(ZX_OK, status, "Failed to wait for tracked interrupt\n");
+    uint32_t vector;
+    status = tracker.Pop(&vector);
+    EXPECT_EQ(ZX_OK, status, "Failed to pop interrupt\n");
+    EXPECT_EQ(32u, vector, "Popped wrong interrupt\n");
+
+    // A signal wakes the waiter, which then checks for delivered interrupts
+    // again.
+    EXPECT_FALSE(tracker.Signal(), "Signal unblocked a waiter\n");
+    int checks = 0;
+    status = tracker.Wait(nullptr, [&checks] { return ++checks > 1; });
+    EXPECT_EQ(ZX_OK, status, "Failed to wait for signal\n");
+    EXPECT_EQ(2, checks, "Wrong number of checks for delivered interrupts\n");
+
+    END_TEST;
+}
+
 // Use the function name as the test name
 #define HYPERVISOR_UNITTEST(fname) UNITTEST(#fname, fname)
 
@@ -533,4 +603,6 @@ HYPERVISOR_UNITTEST(guest_physical_address_space_map_interrupt_controller)
 HYPERVISOR_UNITTEST(guest_physical_address_space_uncached)
 HYPERVISOR_UNITTEST(guest_physical_address_space_uncached_device)
 HYPERVISOR_UNITTEST(guest_physical_address_space_write_combining)
+HYPERVISOR_UNITTEST(trap_map_find_trap)
+HYPERVISOR_UNITTEST(interrupt_tracker_wait)
 UNITTEST_END_TESTCASE(hypervisor, "hypervisor", "Hypervisor unit tests.");
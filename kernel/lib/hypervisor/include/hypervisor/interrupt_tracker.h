@@ -77,13 +77,30 @@ public:
         return ZX_OK;
     }
 
+    // Signals any waiters, without tracking an interrupt. Returns whether a
+    // waiter was unblocked.
+    bool Signal() {
+        return event_signal(&event_, true) > 0;
+    }
+
     // Waits for an interrupt.
     zx_status_t Wait(StateInvalidator* invalidator) {
+        return Wait(invalidator, [] { return false; });
+    }
+
+    // Waits for an interrupt, or until |delivered| returns true. This is used
+    // when interrupts may also be delivered outside of the tracker, in which
+    // case the party delivering them must call Signal().
+    template <typename F>
+    zx_status_t Wait(StateInvalidator* invalidator, F delivered) {
         if (invalidator != nullptr) {
             invalidator->Invalidate();
         }
         ktrace_vcpu(TAG_VCPU_BLOCK, VCPU_INTERRUPT);
         do {
+            if (delivered()) {
+                break;
+            }
             zx_status_t status = event_wait_deadline(&event_, ZX_TIME_INFINITE, true);
             if (status != ZX_OK) {
                 ktrace_vcpu(TAG_VCPU_UNBLOCK, VCPU_INTERRUPT);
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <zircon/types.h>
 
 enum VcpuMeta : uint32_t {
     // Waits.
@@ -50,5 +51,9 @@ enum VcpuExit : uint32_t {
 };
 
 void ktrace_report_vcpu_meta();
+void ktrace_report_vcpu_exit_counts();
 void ktrace_vcpu(uint32_t tag, VcpuMeta meta);
 void ktrace_vcpu_exit(VcpuExit exit, uint64_t exit_address);
+// Records how long the last VM exit on this CPU took to handle, from
+// |exit_ticks| until now.
+void ktrace_vcpu_exit_handled(zx_ticks_t exit_ticks);
@@ -7,6 +7,8 @@
 #pragma once
 
 #include <fbl/arena.h>
+#include <fbl/array.h>
+#include <fbl/atomic.h>
 #include <fbl/intrusive_wavl_tree.h>
 #include <fbl/ref_ptr.h>
 #include <hypervisor/state_invalidator.h>
@@ -40,6 +42,9 @@ public:
 
     zx_status_t Init();
     zx_status_t Queue(const zx_port_packet_t& packet, StateInvalidator* invalidator);
+    // For ZX_GUEST_TRAP_BELL_COALESCED traps: queues the trap's packet on
+    // its port, unless it is still queued from an earlier access.
+    zx_status_t Ring(StateInvalidator* invalidator);
 
     zx_gpaddr_t GetKey() const { return addr_; }
     bool Contains(zx_gpaddr_t val) const { return val >= addr_ && val < addr_ + len_; }
@@ -57,6 +62,7 @@ private:
     const fbl::RefPtr<PortDispatcher> port_;
     const uint64_t key_; // Key for packets in this port range.
     BlockingPortAllocator port_allocator_;
+    PortPacket bell_packet_; // Queued by Ring().
 };
 
 // Contains all the traps within a guest.
@@ -64,18 +70,36 @@ class TrapMap {
 public:
     zx_status_t InsertTrap(uint32_t kind, zx_gpaddr_t addr, size_t len,
                            fbl::RefPtr<PortDispatcher> port, uint64_t key);
+    // Does not take any locks, so may be called on every VM exit.
     zx_status_t FindTrap(uint32_t kind, zx_gpaddr_t addr, Trap** trap);
 
 private:
     using TrapTree = fbl::WAVLTree<zx_gpaddr_t, fbl::unique_ptr<Trap>>;
 
+    // The traps of a TrapSet sorted by address, for FindTrap() to search.
+    // Each insert publishes a new snapshot. Traps are never removed while
+    // the map is alive, so older snapshots stay valid for any reader still
+    // using them, and are only freed along with the map.
+    struct TrapSnapshot {
+        fbl::Array<Trap*> traps;
+        fbl::unique_ptr<TrapSnapshot> prev;
+    };
+
+    struct TrapSet {
+        // Only modified with |mutex_| held.
+        TrapTree tree;
+        fbl::unique_ptr<TrapSnapshot> snapshots;
+        // The latest snapshot, read without a lock.
+        fbl::atomic<const TrapSnapshot*> current{nullptr};
+    };
+
     fbl::Mutex mutex_;
-    TrapTree mem_traps_ TA_GUARDED(mutex_);
+    TrapSet mem_traps_;
 #ifdef ARCH_X86
-    TrapTree io_traps_ TA_GUARDED(mutex_);
+    TrapSet io_traps_;
 #endif // ARCH_X86
 
-    TrapTree* TreeOf(uint32_t kind);
+    TrapSet* SetOf(uint32_t kind);
 };
 
 } // namespace hypervisor
@@ -4,9 +4,12 @@
 // license that can be found in the LICENSE file or at
 // https://opensource.org/licenses/MIT
 
+#include <fbl/atomic.h>
 #include <hypervisor/ktrace.h>
 #include <kernel/thread.h>
 #include <lib/ktrace.h>
+#include <lib/latency_histogram.h>
+#include <platform.h>
 
 static const char* const vcpu_meta[] = {
         [VCPU_INTERRUPT] = "wait:interrupt",
@@ -46,6 +49,21 @@ static const char* const vcpu_exit[] = {
 static_assert((sizeof(vcpu_exit) / sizeof(vcpu_exit[0])) == VCPU_EXIT_COUNT,
               "vcpu_exit array must match enum VcpuExit");
 
+// VM exits by reason since boot, counted per CPU so that VCPUs do not contend
+// on the counters.
+static fbl::atomic<uint64_t> vcpu_exit_counts[SMP_MAX_CPUS][VCPU_EXIT_COUNT];
+
+// The reason for the last VM exit on each CPU. VCPU threads are pinned, so
+// this is still the right reason once the exit has been handled.
+static VcpuExit vcpu_last_exit[SMP_MAX_CPUS];
+
+static const char* vcpu_exit_row_name(size_t exit) {
+    // Skip the "exit:" prefix.
+    return vcpu_exit[exit] + 5;
+}
+
+LATENCY_HISTOGRAM(vcpu_exit_latency, "vcpu_exit", VCPU_EXIT_COUNT, vcpu_exit_row_name);
+
 void ktrace_report_vcpu_meta() {
     for (uint32_t i = 0; i != VCPU_META_COUNT; i++) {
         ktrace_name_etc(TAG_VCPU_META, i, 0, vcpu_meta[i], true);
@@ -55,11 +73,31 @@ void ktrace_report_vcpu_meta() {
     }
 }
 
+// Records the number of VM exits for each reason, so that a trace can show how
+// many exits occurred while it was running.
+void ktrace_report_vcpu_exit_counts() {
+    for (uint32_t i = 0; i != VCPU_EXIT_COUNT; i++) {
+        uint64_t count = 0;
+        for (uint32_t cpu = 0; cpu != SMP_MAX_CPUS; cpu++) {
+            count += vcpu_exit_counts[cpu][i].load(fbl::memory_order_relaxed);
+        }
+        ktrace(TAG_VCPU_EXIT_COUNT, i, static_cast<uint32_t>(count),
+               static_cast<uint32_t>(count >> 32), 0);
+    }
+}
+
 void ktrace_vcpu(uint32_t tag, VcpuMeta meta) {
     ktrace(tag, meta, 0, 0, 0);
 }
 
 void ktrace_vcpu_exit(VcpuExit exit, uint64_t exit_address) {
+    cpu_num_t cpu = arch_curr_cpu_num();
+    vcpu_exit_counts[cpu][exit].fetch_add(1, fbl::memory_order_relaxed);
+    vcpu_last_exit[cpu] = exit;
     ktrace(TAG_VCPU_EXIT, exit, static_cast<uint32_t>(exit_address),
            static_cast<uint32_t>(exit_address >> 32), 0);
-}
\ No newline at end of file
+}
+
+void ktrace_vcpu_exit_handled(zx_ticks_t exit_ticks) {
+    vcpu_exit_latency.Add(vcpu_last_exit[arch_curr_cpu_num()], current_ticks() - exit_ticks);
+}
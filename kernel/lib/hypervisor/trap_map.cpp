@@ -44,8 +44,11 @@ void BlockingPortAllocator::Free(PortPacket* port_packet) {
 
 Trap::Trap(uint32_t kind, zx_gpaddr_t addr, size_t len, fbl::RefPtr<PortDispatcher> port,
                      uint64_t key)
-    : kind_(kind), addr_(addr), len_(len), port_(fbl::move(port)), key_(key) {
-    (void) key_;
+    : kind_(kind), addr_(addr), len_(len), port_(fbl::move(port)), key_(key),
+      bell_packet_(nullptr, nullptr) {
+    bell_packet_.packet.key = key_;
+    bell_packet_.packet.type = ZX_PKT_TYPE_GUEST_BELL;
+    bell_packet_.packet.guest_bell.addr = addr_;
 }
 
 Trap::~Trap() {
@@ -56,6 +59,10 @@ Trap::~Trap() {
 }
 
 zx_status_t Trap::Init() {
+    if (kind_ == ZX_GUEST_TRAP_BELL_COALESCED) {
+        // Only ever queues |bell_packet_|.
+        return ZX_OK;
+    }
     return port_allocator_.Init();
 }
 
@@ -78,56 +85,106 @@ zx_status_t Trap::Queue(const zx_port_packet_t& packet, StateInvalidator* invali
     return status;
 }
 
+zx_status_t Trap::Ring(StateInvalidator* invalidator) {
+    DEBUG_ASSERT(kind_ == ZX_GUEST_TRAP_BELL_COALESCED);
+    if (invalidator != nullptr) {
+        invalidator->Invalidate();
+    }
+    if (port_ == nullptr) {
+        return ZX_ERR_NOT_FOUND;
+    }
+    // The packet never changes, so there is nothing to update if it is
+    // already queued, and the port leaves it where it is.
+    return port_->Queue(&bell_packet_, ZX_SIGNAL_NONE, 0);
+}
+
 zx_status_t TrapMap::InsertTrap(uint32_t kind, zx_gpaddr_t addr, size_t len,
                                 fbl::RefPtr<PortDispatcher> port, uint64_t key) {
-    TrapTree* traps = TreeOf(kind);
+    TrapSet* traps = SetOf(kind);
     if (traps == nullptr) {
         return ZX_ERR_INVALID_ARGS;
     }
-    auto iter = traps->find(addr);
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<Trap> range(new (&ac) Trap(kind, addr, len, fbl::move(port), key));
+    if (!ac.check()) {
+        return ZX_ERR_NO_MEMORY;
+    }
+    zx_status_t status = range->Init();
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    fbl::AutoLock lock(&mutex_);
+    auto iter = traps->tree.find(addr);
     if (iter.IsValid()) {
         dprintf(INFO, "Trap for kind %u (addr %#lx len %lu key %lu) already exists "
                 "(addr %#lx len %lu key %lu)\n", kind, addr, len, key, iter->addr(), iter->len(),
                 iter->key());
         return ZX_ERR_ALREADY_EXISTS;
     }
-    fbl::AllocChecker ac;
-    fbl::unique_ptr<Trap> range(new (&ac) Trap(kind, addr, len, fbl::move(port), key));
+
+    // Build the snapshot that includes the new trap before inserting it, so
+    // that failing to allocate leaves the map as it was.
+    const size_t count = traps->tree.size() + 1;
+    fbl::unique_ptr<TrapSnapshot> snapshot(new (&ac) TrapSnapshot);
     if (!ac.check()) {
         return ZX_ERR_NO_MEMORY;
     }
-    zx_status_t status = range->Init();
-    if (status != ZX_OK) {
-        return status;
+    Trap** array = new (&ac) Trap*[count];
+    if (!ac.check()) {
+        return ZX_ERR_NO_MEMORY;
+    }
+    snapshot->traps.reset(array, count);
+    size_t i = 0;
+    for (auto& trap : traps->tree) {
+        if (range != nullptr && range->addr() < trap.addr()) {
+            array[i++] = range.get();
+        }
+        array[i++] = &trap;
     }
-    {
-        fbl::AutoLock lock(&mutex_);
-        traps->insert(fbl::move(range));
+    if (i < count) {
+        array[i++] = range.get();
     }
+    DEBUG_ASSERT(i == count);
+
+    traps->tree.insert(fbl::move(range));
+    traps->current.store(snapshot.get(), fbl::memory_order_release);
+    snapshot->prev = fbl::move(traps->snapshots);
+    traps->snapshots = fbl::move(snapshot);
     return ZX_OK;
 }
 
 zx_status_t TrapMap::FindTrap(uint32_t kind, zx_gpaddr_t addr, Trap** trap) {
-    TrapTree* traps = TreeOf(kind);
+    TrapSet* traps = SetOf(kind);
     if (traps == nullptr) {
         return ZX_ERR_INVALID_ARGS;
     }
-    TrapTree::iterator iter;
-    {
-        fbl::AutoLock lock(&mutex_);
-        iter = traps->upper_bound(addr);
+    const TrapSnapshot* snapshot = traps->current.load(fbl::memory_order_acquire);
+    if (snapshot == nullptr) {
+        return ZX_ERR_NOT_FOUND;
+    }
+    // Find the last trap that starts at or below |addr|.
+    size_t lo = 0;
+    size_t hi = snapshot->traps.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (snapshot->traps[mid]->addr() <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
     }
-    --iter;
-    if (!iter.IsValid() || !iter->Contains(addr)) {
+    if (lo == 0 || !snapshot->traps[lo - 1]->Contains(addr)) {
         return ZX_ERR_NOT_FOUND;
     }
-    *trap = const_cast<Trap*>(&*iter);
+    *trap = snapshot->traps[lo - 1];
     return ZX_OK;
 }
 
-TrapMap::TrapTree* TrapMap::TreeOf(uint32_t kind) {
+TrapMap::TrapSet* TrapMap::SetOf(uint32_t kind) {
     switch (kind) {
     case ZX_GUEST_TRAP_BELL:
+    case ZX_GUEST_TRAP_BELL_COALESCED:
     case ZX_GUEST_TRAP_MEM:
         return &mem_traps_;
 #ifdef ARCH_X86
@@ -7,11 +7,17 @@
 #include <debug.h>
 #include <err.h>
 #include <platform.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <arch/ops.h>
 #include <arch/user_copy.h>
+#include <fbl/algorithm.h>
+#include <fbl/auto_lock.h>
+#include <fbl/mutex.h>
 #include <hypervisor/ktrace.h>
+#include <kernel/align.h>
+#include <kernel/atomic.h>
 #include <kernel/cmdline.h>
 #include <lib/ktrace.h>
 #include <lk/init.h>
@@ -75,40 +81,123 @@ static void ktrace_report_probes(void) {
     }
 }
 
-typedef struct ktrace_state {
+// Size of the blocks circular segments are divided into.  Records never
+// straddle a block boundary, so that a reader can always find the start of
+// the oldest surviving record: it is the start of the block after the one
+// currently being written.
+static constexpr uint32_t kCircularBlockSize = 4096;
+
+// Largest record ktrace_open() and ktrace_name_etc() can be asked to write.
+static constexpr uint32_t kMaxRecordSize = KTRACE_LEN(0xF);
+static_assert(kMaxRecordSize < kCircularBlockSize, "records must fit in a block");
+
+// A part of the trace buffer that records are appended to.
+typedef struct ktrace_segment {
+    // offset of the first byte of the segment
+    uint32_t start;
+
+    // offset just past the last byte of the segment
+    uint32_t end;
+
     // where the next record will be written
     int offset;
 
+    // nonzero once a circular segment has wrapped around at least once
+    int wrapped;
+} __CPU_ALIGN ktrace_segment_t;
+
+// A range of the trace buffer returned by ktrace_read_user().
+typedef struct ktrace_extent {
+    uint32_t start;
+    uint32_t len;
+} ktrace_extent_t;
+
+// The name segment, plus up to two extents for each data segment.
+static constexpr uint32_t kMaxExtents = 1 + 2 * SMP_MAX_CPUS;
+
+typedef struct ktrace_state {
     // mask of groups we allow, 0 == tracing disabled
     int grpmask;
 
+    // KTRACE_MODE_* flags; only changed while tracing is disabled
+    uint32_t mode;
+
     // total size of the trace buffer
     uint32_t bufsize;
 
-    // offset where tracing was stopped, 0 if tracing active
-    uint32_t marker;
-
     // raw trace buffer
     uint8_t* buffer;
+
+    // Segment that name records, and the version records at the start of
+    // the buffer, are written to.  In the default mode this is the only
+    // data segment; otherwise it is |header|.
+    ktrace_segment_t* names;
+
+    // Segment holding the name records in the circular and per-CPU modes,
+    // so that they are not overwritten or spread across CPUs.
+    ktrace_segment_t header;
+
+    // Segments that other records are written to: one per CPU with
+    // KTRACE_MODE_PER_CPU, otherwise only the first is used.
+    uint32_t num_segments;
+    ktrace_segment_t segments[SMP_MAX_CPUS];
+
+    // Buffer contents captured when tracing was stopped; 0 extents while
+    // tracing is active.  This is kept across KTRACE_ACTION_REWIND so the
+    // stopped trace can still be read after rewinding.
+    uint32_t num_stopped_extents;
+    ktrace_extent_t stopped_extents[kMaxExtents];
 } ktrace_state_t;
 
 static ktrace_state_t KTRACE_STATE;
 
+// Serializes the ktrace_control() actions that change the buffer layout.
+static fbl::Mutex control_lock;
+
+// Fills |extents| with the parts of the buffer that hold complete records,
+// oldest first within each segment, and returns how many there are.
+static uint32_t ktrace_get_extents(ktrace_state_t* ks, ktrace_extent_t* extents) {
+    uint32_t n = 0;
+    auto add = [&](uint32_t start, uint32_t end) {
+        if (end > start) {
+            extents[n++] = {start, end - start};
+        }
+    };
+
+    if (ks->names != &ks->segments[0]) {
+        add(ks->header.start,
+            fbl::min(static_cast<uint32_t>(atomic_load(&ks->header.offset)), ks->header.end));
+    }
+    for (uint32_t i = 0; i < ks->num_segments; i++) {
+        ktrace_segment_t* seg = &ks->segments[i];
+        uint32_t off = fbl::min(static_cast<uint32_t>(atomic_load(&seg->offset)), seg->end);
+        if (atomic_load(&seg->wrapped)) {
+            // Everything after the block being written survives from the
+            // previous pass; the rest of the current block does not.
+            add(ROUNDUP(off, kCircularBlockSize), seg->end);
+        }
+        add(seg->start, off);
+    }
+    return n;
+}
+
 ssize_t ktrace_read_user(void* ptr, uint32_t off, size_t len) {
     ktrace_state_t* ks = &KTRACE_STATE;
 
-    // Buffer size is limited by the marker if set,
-    // otherwise limited by offset (last written point).
-    // Offset can end up pointing past the end, so clip
-    // it to the actual buffer size to be safe.
-    uint32_t max;
-    if (ks->marker) {
-        max = ks->marker;
-    } else {
-        max = ks->offset;
-        if (max > ks->bufsize) {
-            max = ks->bufsize;
-        }
+    // Read what was captured when tracing stopped if anything was,
+    // otherwise whatever has been written so far.
+    ktrace_extent_t live_extents[kMaxExtents];
+    ktrace_extent_t* extents = ks->stopped_extents;
+    uint32_t num_extents = ks->num_stopped_extents;
+    if (num_extents == 0) {
+        extents = live_extents;
+        num_extents = ktrace_get_extents(ks, live_extents);
+    }
+
+    // The extents are presented to the reader back to back.
+    size_t max = 0;
+    for (uint32_t i = 0; i < num_extents; i++) {
+        max += extents[i].len;
     }
 
     // null read is a query for trace buffer size
@@ -124,39 +213,191 @@ ssize_t ktrace_read_user(void* ptr, uint32_t off, size_t len) {
         len = max - off;
     }
 
-    if (arch_copy_to_user(ptr, ks->buffer + off, len) != ZX_OK) {
+    uint8_t* out = static_cast<uint8_t*>(ptr);
+    size_t copied = 0;
+    for (uint32_t i = 0; i < num_extents && copied < len; i++) {
+        if (off >= extents[i].len) {
+            off -= extents[i].len;
+            continue;
+        }
+        size_t n = fbl::min(static_cast<size_t>(extents[i].len - off), len - copied);
+        if (arch_copy_to_user(out + copied, ks->buffer + extents[i].start + off, n) != ZX_OK) {
+            return ZX_ERR_INVALID_ARGS;
+        }
+        copied += n;
+        off = 0;
+    }
+    return copied;
+}
+
+// Fills [|off|, |end|) with a record that readers skip over.  |end| - |off|
+// is a multiple of 8 and less than kMaxRecordSize.
+static void ktrace_write_pad(ktrace_state_t* ks, uint32_t off, uint32_t end) {
+    if (end > off) {
+        ktrace_header_t* hdr = (ktrace_header_t*) (ks->buffer + off);
+        hdr->tag = (TAG_PAD & 0xFFFFFFF0) | ((end - off) >> 3);
+        hdr->tid = 0;
+    }
+}
+
+// Reserves |len| bytes in a circular segment, wrapping around to the start
+// of the segment when it is full.
+//
+// A writer that is preempted between reserving space and filling it in may
+// find its block reused by the time it resumes, which corrupts a record at
+// worst.  That only happens if a whole segment's worth of records is
+// written in the meantime.
+static uint8_t* ktrace_reserve_circular(ktrace_state_t* ks, ktrace_segment_t* seg,
+                                        uint32_t len) {
+    int off = atomic_load(&seg->offset);
+    for (;;) {
+        uint32_t start = off;
+        uint32_t block_end = ROUNDDOWN(start, kCircularBlockSize) + kCircularBlockSize;
+        if (start == seg->end) {
+            start = seg->start;
+        } else if (start + len > block_end) {
+            start = (block_end == seg->end) ? seg->start : block_end;
+        }
+        if (atomic_cmpxchg(&seg->offset, &off, static_cast<int>(start + len))) {
+            if (start != static_cast<uint32_t>(off)) {
+                ktrace_write_pad(ks, off, fbl::min(block_end, seg->end));
+                if (start == seg->start) {
+                    atomic_store(&seg->wrapped, 1);
+                }
+            }
+            return ks->buffer + start;
+        }
+    }
+}
+
+// Reserves |len| bytes in |seg|.  Returns nullptr if the segment is full,
+// in which case tracing is stopped if |stop_when_full| is set.
+static uint8_t* ktrace_reserve(ktrace_state_t* ks, ktrace_segment_t* seg, uint32_t len,
+                               bool stop_when_full) {
+    if (ks->mode & KTRACE_MODE_CIRCULAR && seg != &ks->header) {
+        return ktrace_reserve_circular(ks, seg, len);
+    }
+
+    uint32_t off = atomic_add(&seg->offset, len);
+    if (off + len > seg->end) {
+        // Only the first record that does not fit lands before the end, so
+        // padding out the remainder cannot race with another writer.
+        if (off < seg->end) {
+            ktrace_write_pad(ks, off, seg->end);
+        }
+        // if we arrive at the end, stop
+        if (stop_when_full) {
+            atomic_store(&ks->grpmask, 0);
+        }
+        return nullptr;
+    }
+    return ks->buffer + off;
+}
+
+// Returns the segment the current CPU writes records other than names to.
+static ktrace_segment_t* ktrace_data_segment(ktrace_state_t* ks) {
+    // A thread that migrates after this still writes to the segment of
+    // the CPU it started on, which is safe since reservation is atomic.
+    if (ks->mode & KTRACE_MODE_PER_CPU) {
+        return &ks->segments[arch_curr_cpu_num()];
+    }
+    return &ks->segments[0];
+}
+
+// Lays out the buffer for |mode|.  Tracing must be disabled.
+static zx_status_t ktrace_set_layout(ktrace_state_t* ks, uint32_t mode) {
+    if (mode & ~KTRACE_MODE_ALL) {
         return ZX_ERR_INVALID_ARGS;
     }
-    return len;
+
+    if (mode == 0) {
+        ks->segments[0].start = 0;
+        ks->segments[0].end = ks->bufsize;
+        ks->num_segments = 1;
+        ks->names = &ks->segments[0];
+        ks->mode = mode;
+        return ZX_OK;
+    }
+
+    // Give names an eighth of the buffer and split the rest evenly.
+    uint32_t header_size = ROUNDDOWN(ks->bufsize / 8, kCircularBlockSize);
+    uint32_t num_segments = (mode & KTRACE_MODE_PER_CPU) ? arch_max_num_cpus() : 1;
+    uint32_t segment_size = ROUNDDOWN((ks->bufsize - header_size) / num_segments,
+                                      kCircularBlockSize);
+    if (header_size < kCircularBlockSize || segment_size < 2 * kCircularBlockSize) {
+        return ZX_ERR_NO_RESOURCES;
+    }
+
+    ks->header.start = 0;
+    ks->header.end = header_size;
+    for (uint32_t i = 0; i < num_segments; i++) {
+        ks->segments[i].start = header_size + i * segment_size;
+        ks->segments[i].end = ks->segments[i].start + segment_size;
+    }
+    ks->num_segments = num_segments;
+    ks->names = &ks->header;
+    ks->mode = mode;
+    return ZX_OK;
+}
+
+// Discards all records except the version records at the start of the
+// buffer.  Tracing must be disabled.
+static void ktrace_reset(ktrace_state_t* ks) {
+    for (uint32_t i = 0; i < ks->num_segments; i++) {
+        atomic_store(&ks->segments[i].offset, ks->segments[i].start);
+        atomic_store(&ks->segments[i].wrapped, 0);
+    }
+    // roll back to just after the metadata
+    atomic_store(&ks->names->offset, KTRACE_RECSIZE * 2);
 }
 
 zx_status_t ktrace_control(uint32_t action, uint32_t options, void* ptr) {
     ktrace_state_t* ks = &KTRACE_STATE;
     switch (action) {
-    case KTRACE_ACTION_START:
+    case KTRACE_ACTION_START: {
+        fbl::AutoLock lock(&control_lock);
         options = KTRACE_GRP_TO_MASK(options);
-        ks->marker = 0;
+        ks->num_stopped_extents = 0;
         atomic_store(&ks->grpmask, options ? options : KTRACE_GRP_TO_MASK(KTRACE_GRP_ALL));
         ktrace_report_live_processes();
         ktrace_report_live_threads();
+        ktrace_report_vcpu_exit_counts();
         break;
+    }
     case KTRACE_ACTION_STOP: {
+        fbl::AutoLock lock(&control_lock);
+        ktrace_report_vcpu_exit_counts();
         atomic_store(&ks->grpmask, 0);
-        uint32_t n = ks->offset;
-        if (n > ks->bufsize) {
-            ks->marker = ks->bufsize;
-        } else {
-            ks->marker = n;
-        }
+        ks->num_stopped_extents = ktrace_get_extents(ks, ks->stopped_extents);
         break;
     }
-    case KTRACE_ACTION_REWIND:
-        // roll back to just after the metadata
-        atomic_store(&ks->offset, KTRACE_RECSIZE * 2);
+    case KTRACE_ACTION_REWIND: {
+        fbl::AutoLock lock(&control_lock);
+        ktrace_reset(ks);
         ktrace_report_syscalls(kt_syscall_info);
         ktrace_report_probes();
         ktrace_report_vcpu_meta();
         break;
+    }
+    case KTRACE_ACTION_SET_MODE: {
+        fbl::AutoLock lock(&control_lock);
+        if (ks->buffer == nullptr) {
+            return ZX_ERR_NOT_SUPPORTED;
+        }
+        if (atomic_load(&ks->grpmask) != 0) {
+            return ZX_ERR_BAD_STATE;
+        }
+        zx_status_t status = ktrace_set_layout(ks, options);
+        if (status != ZX_OK) {
+            return status;
+        }
+        ks->num_stopped_extents = 0;
+        ktrace_reset(ks);
+        ktrace_report_syscalls(kt_syscall_info);
+        ktrace_report_probes();
+        ktrace_report_vcpu_meta();
+        break;
+    }
     case KTRACE_ACTION_NEW_PROBE: {
         fbl::AutoLock lock(&probe_list_lock);
         ktrace_probe_info_t* probe;
@@ -185,6 +426,7 @@ void ktrace_init(unsigned level) {
 
     uint32_t mb = cmdline_get_uint32("ktrace.bufsize", KTRACE_DEFAULT_BUFSIZE);
     uint32_t grpmask = cmdline_get_uint32("ktrace.grpmask", KTRACE_DEFAULT_GRPMASK);
+    uint32_t mode = cmdline_get_uint32("ktrace.mode", 0);
 
     if (mb == 0) {
         dprintf(INFO, "ktrace: disabled\n");
@@ -201,11 +443,13 @@ void ktrace_init(unsigned level) {
         return;
     }
 
-    // The last packet written can overhang the end of the buffer,
-    // so we reduce the reported size by the max size of a record
-    ks->bufsize = mb - 256;
+    ks->bufsize = mb;
+    if (ktrace_set_layout(ks, mode) != ZX_OK) {
+        dprintf(INFO, "ktrace: invalid mode %#x, using default\n", mode);
+        ktrace_set_layout(ks, 0);
+    }
 
-    dprintf(INFO, "ktrace: buffer at %p (%u bytes)\n", ks->buffer, mb);
+    dprintf(INFO, "ktrace: buffer at %p (%u bytes, mode %#x)\n", ks->buffer, mb, ks->mode);
 
     // register all static probes
     {
@@ -227,7 +471,7 @@ void ktrace_init(unsigned level) {
     rec[1].b = (uint32_t)(n >> 32);
 
     // enable tracing
-    atomic_store(&ks->offset, KTRACE_RECSIZE * 2);
+    ktrace_reset(ks);
     ktrace_report_syscalls(kt_syscall_info);
     ktrace_report_probes();
     atomic_store(&ks->grpmask, KTRACE_GRP_TO_MASK(grpmask));
@@ -249,12 +493,9 @@ void ktrace_tiny(uint32_t tag, uint32_t arg) {
     ktrace_state_t* ks = &KTRACE_STATE;
     if (tag & atomic_load(&ks->grpmask)) {
         tag = (tag & 0xFFFFFFF0) | 2;
-        int off;
-        if ((off = atomic_add(&ks->offset, KTRACE_HDRSIZE)) >= (int)ks->bufsize) {
-            // if we arrive at the end, stop
-            atomic_store(&ks->grpmask, 0);
-        } else {
-            ktrace_header_t* hdr = (ktrace_header_t*) (ks->buffer + off);
+        ktrace_header_t* hdr = (ktrace_header_t*) ktrace_reserve(
+            ks, ktrace_data_segment(ks), KTRACE_HDRSIZE, true);
+        if (hdr != nullptr) {
             hdr->ts = ktrace_timestamp();
             hdr->tag = tag;
             hdr->tid = arg;
@@ -268,14 +509,12 @@ void* ktrace_open(uint32_t tag) {
         return nullptr;
     }
 
-    int off;
-    if ((off = atomic_add(&ks->offset, KTRACE_LEN(tag))) >= (int)ks->bufsize) {
-        // if we arrive at the end, stop
-        atomic_store(&ks->grpmask, 0);
+    ktrace_header_t* hdr = (ktrace_header_t*) ktrace_reserve(
+        ks, ktrace_data_segment(ks), KTRACE_LEN(tag), true);
+    if (hdr == nullptr) {
         return nullptr;
     }
 
-    ktrace_header_t* hdr = (ktrace_header_t*) (ks->buffer + off);
     hdr->ts = ktrace_timestamp();
     hdr->tag = tag;
     hdr->tid = (uint32_t)get_current_thread()->user_tid;
@@ -290,12 +529,11 @@ void ktrace_name_etc(uint32_t tag, uint32_t id, uint32_t arg, const char* name,
         // set size to: sizeof(hdr) + len + 1, round up to multiple of 8
         tag = (tag & 0xFFFFFFF0) | ((KTRACE_NAMESIZE + len + 1 + 7) >> 3);
 
-        int off;
-        if ((off = atomic_add(&ks->offset, KTRACE_LEN(tag))) >= (int)ks->bufsize) {
-            // if we arrive at the end, stop
-            atomic_store(&ks->grpmask, 0);
-        } else {
-            ktrace_rec_name_t* rec = (ktrace_rec_name_t*) (ks->buffer + off);
+        // A full name segment only stops tracing when it is shared with
+        // the other records.
+        ktrace_rec_name_t* rec = (ktrace_rec_name_t*) ktrace_reserve(
+            ks, ks->names, KTRACE_LEN(tag), ks->names == &ks->segments[0]);
+        if (rec != nullptr) {
             rec->tag = tag;
             rec->id = id;
             rec->arg = arg;
@@ -0,0 +1,41 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <stdint.h>
+#include <zircon/types.h>
+
+#include <lockdep/common.h>
+
+namespace lockdep {
+
+// Contention statistics for a lock class, summed over all cpus. These are
+// only collected when the kernel is built with ENABLE_LOCK_PROFILING, and
+// only for acquisitions made through Guard.
+struct LockProfileStats {
+    // Number of times a lock of the class was acquired.
+    uint64_t acquisitions;
+
+    // Number of those acquisitions that had to wait for the lock.
+    uint64_t contended;
+
+    // Total time spent waiting to acquire the lock.
+    zx_duration_t total_wait;
+
+    // Longest time the lock was held by a single acquisition.
+    zx_duration_t max_hold;
+};
+
+// Fills in |stats| for the lock class |id|. Returns ZX_ERR_NOT_SUPPORTED if
+// lock profiling is disabled and ZX_ERR_BAD_STATE if profiling has not been
+// initialized yet.
+zx_status_t GetLockProfileStats(LockClassId id, LockProfileStats* stats);
+
+// Resets the statistics of all lock classes.
+void ResetLockProfileStats();
+
+} // namespace lockdep
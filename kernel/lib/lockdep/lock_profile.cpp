@@ -0,0 +1,233 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#include <lib/lock_profile.h>
+
+#include <arch/ops.h>
+#include <kernel/align.h>
+#include <kernel/spinlock.h>
+#include <lib/console.h>
+#include <lib/counters.h>
+#include <lk/init.h>
+#include <platform.h>
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fbl/algorithm.h>
+#include <fbl/alloc_checker.h>
+#include <fbl/atomic.h>
+#include <fbl/unique_ptr.h>
+#include <lockdep/lockdep.h>
+
+#if WITH_LOCK_PROFILING
+
+namespace {
+
+// An acquisition that waits for at least this long is counted as contended.
+// An uncontended acquisition is a handful of atomic operations, so anything
+// that takes longer had to wait for another holder (or was preempted).
+constexpr zx_duration_t kContendedThreshold = ZX_NSEC(250);
+
+KCOUNTER(lock_profile_acquisitions, "kernel.lock_profile.acquisitions");
+KCOUNTER(lock_profile_contended, "kernel.lock_profile.contended");
+KCOUNTER(lock_profile_wait_ticks, "kernel.lock_profile.wait_ticks");
+
+// Per-cpu statistics for one lock class. Times are in ticks.
+struct ClassStats {
+    uint64_t acquisitions;
+    uint64_t contended;
+    uint64_t total_wait;
+    uint64_t max_hold;
+};
+
+// The per-cpu tables, each |num_classes| long. Published by
+// LockProfileInit() once allocated; acquisitions before that are dropped.
+struct __CPU_ALIGN CpuStats {
+    ClassStats* classes;
+};
+CpuStats per_cpu_stats[SMP_MAX_CPUS];
+fbl::atomic<bool> initialized;
+size_t num_classes;
+uint64_t contended_threshold_ticks;
+
+zx_duration_t TicksToDuration(uint64_t ticks) {
+    const uint64_t per_second = ticks_per_second();
+    return ZX_SEC(ticks / per_second) + (ticks % per_second) * ZX_SEC(1) / per_second;
+}
+
+void LockProfileInit(unsigned /*level*/) {
+    num_classes = lockdep::LockClassState::Count();
+    contended_threshold_ticks = kContendedThreshold * ticks_per_second() / ZX_SEC(1);
+
+    for (cpu_num_t i = 0; i < arch_max_num_cpus(); i++) {
+        fbl::AllocChecker ac;
+        per_cpu_stats[i].classes = new (&ac) ClassStats[num_classes]();
+        if (!ac.check()) {
+            printf("lock profile: failed to allocate stats for %zu classes\n", num_classes);
+            return;
+        }
+    }
+
+    initialized.store(true, fbl::memory_order_release);
+}
+
+// Sums the per-cpu statistics of the lock class with ordinal |ordinal|.
+lockdep::LockProfileStats SumStats(size_t ordinal) {
+    uint64_t acquisitions = 0;
+    uint64_t contended = 0;
+    uint64_t total_wait = 0;
+    uint64_t max_hold = 0;
+    for (cpu_num_t i = 0; i < arch_max_num_cpus(); i++) {
+        const ClassStats& stats = per_cpu_stats[i].classes[ordinal];
+        acquisitions += stats.acquisitions;
+        contended += stats.contended;
+        total_wait += stats.total_wait;
+        max_hold = fbl::max(max_hold, stats.max_hold);
+    }
+    return {acquisitions, contended, TicksToDuration(total_wait), TicksToDuration(max_hold)};
+}
+
+struct ClassSummary {
+    const lockdep::LockClassState* state;
+    lockdep::LockProfileStats stats;
+};
+
+int CompareByTotalWait(const void* a, const void* b) {
+    const auto& sa = static_cast<const ClassSummary*>(a)->stats;
+    const auto& sb = static_cast<const ClassSummary*>(b)->stats;
+    if (sa.total_wait != sb.total_wait)
+        return sa.total_wait < sb.total_wait ? 1 : -1;
+    if (sa.contended != sb.contended)
+        return sa.contended < sb.contended ? 1 : -1;
+    return 0;
+}
+
+// Prints the |count| lock classes that spent the most time waiting.
+void DumpLockProfile(size_t count) {
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<ClassSummary[]> summaries{new (&ac) ClassSummary[num_classes]};
+    if (!ac.check()) {
+        printf("Out of memory\n");
+        return;
+    }
+
+    size_t n = 0;
+    for (auto& state : lockdep::LockClassState::Iter()) {
+        summaries[n].state = &state;
+        summaries[n].stats = SumStats(state.ordinal());
+        n++;
+    }
+    qsort(summaries.get(), n, sizeof(summaries[0]), CompareByTotalWait);
+
+    printf("%12s %12s %14s %14s  %s\n",
+           "acquired", "contended", "wait (ns)", "max hold (ns)", "lock class");
+    for (size_t i = 0; i < n && i < count; i++) {
+        const lockdep::LockProfileStats& stats = summaries[i].stats;
+        if (stats.acquisitions == 0)
+            break;
+        printf("%12" PRIu64 " %12" PRIu64 " %14" PRIi64 " %14" PRIi64 "  %s\n",
+               stats.acquisitions, stats.contended, stats.total_wait, stats.max_hold,
+               summaries[i].state->name());
+    }
+}
+
+int CommandLockProfile(int argc, const cmd_args* argv, uint32_t flags) {
+    if (argc < 2) {
+        printf("Not enough arguments:\n");
+    usage:
+        printf("%s dump [count]      : dump the most contended lock classes\n", argv[0].str);
+        printf("%s reset             : reset all statistics\n", argv[0].str);
+        return -1;
+    }
+
+    if (!initialized.load(fbl::memory_order_acquire)) {
+        printf("Lock profiling not initialized\n");
+        return -1;
+    }
+
+    if (strcmp(argv[1].str, "dump") == 0) {
+        DumpLockProfile(argc >= 3 ? argv[2].u : 20);
+    } else if (strcmp(argv[1].str, "reset") == 0) {
+        lockdep::ResetLockProfileStats();
+    } else {
+        printf("Unrecognized subcommand: '%s'\n", argv[1].str);
+        goto usage;
+    }
+
+    return 0;
+}
+
+} // anonymous namespace
+
+STATIC_COMMAND_START
+STATIC_COMMAND("lockprof", "kernel lock contention statistics", &CommandLockProfile)
+STATIC_COMMAND_END(lockprof);
+
+LK_INIT_HOOK(lock_profile, LockProfileInit, LK_INIT_LEVEL_THREADING);
+
+namespace lockdep {
+
+uint64_t SystemLockProfileTimestamp() {
+    return current_ticks();
+}
+
+void SystemLockProfileRecord(LockClassState* lock_class,
+                             uint64_t wait_time, uint64_t hold_time) {
+    if (!initialized.load(fbl::memory_order_acquire))
+        return;
+
+    // Keep the update on one cpu: a mutex holder may be preempted or migrate.
+    spin_lock_saved_state_t irq_state;
+    arch_interrupt_save(&irq_state, SPIN_LOCK_FLAG_INTERRUPTS);
+
+    ClassStats& stats = per_cpu_stats[arch_curr_cpu_num()].classes[lock_class->ordinal()];
+    stats.acquisitions++;
+    stats.total_wait += wait_time;
+    if (hold_time > stats.max_hold)
+        stats.max_hold = hold_time;
+    kcounter_add(lock_profile_acquisitions, 1);
+    kcounter_add(lock_profile_wait_ticks, static_cast<int64_t>(wait_time));
+    if (wait_time >= contended_threshold_ticks) {
+        stats.contended++;
+        kcounter_add(lock_profile_contended, 1);
+    }
+
+    arch_interrupt_restore(irq_state, SPIN_LOCK_FLAG_INTERRUPTS);
+}
+
+zx_status_t GetLockProfileStats(LockClassId id, LockProfileStats* stats) {
+    if (!initialized.load(fbl::memory_order_acquire))
+        return ZX_ERR_BAD_STATE;
+    *stats = SumStats(LockClassState::Get(id)->ordinal());
+    return ZX_OK;
+}
+
+// Updates that race with this on other cpus may survive the reset. This is
+// only a diagnostic aid, so that's acceptable.
+void ResetLockProfileStats() {
+    if (!initialized.load(fbl::memory_order_acquire))
+        return;
+    for (cpu_num_t i = 0; i < arch_max_num_cpus(); i++)
+        memset(per_cpu_stats[i].classes, 0, num_classes * sizeof(ClassStats));
+}
+
+} // namespace lockdep
+
+#else // WITH_LOCK_PROFILING
+
+namespace lockdep {
+
+zx_status_t GetLockProfileStats(LockClassId id, LockProfileStats* stats) {
+    return ZX_ERR_NOT_SUPPORTED;
+}
+
+void ResetLockProfileStats() {}
+
+} // namespace lockdep
+
+#endif // WITH_LOCK_PROFILING
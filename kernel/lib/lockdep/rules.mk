@@ -13,6 +13,7 @@ KERNEL_INCLUDES += $(LOCAL_DIR)/include \
                    $(SRC_DIR)/include
 
 MODULE_SRCS := \
-	$(LOCAL_DIR)/lock_dep.cpp
+	$(LOCAL_DIR)/lock_dep.cpp \
+	$(LOCAL_DIR)/lock_profile.cpp
 
 include make/module.mk
@@ -0,0 +1,52 @@
+// Copyright 2018 The Fuchsia Authors
+//
+// Use of this source code is governed by a MIT-style
+// license that can be found in the LICENSE file or at
+// https://opensource.org/licenses/MIT
+
+#pragma once
+
+// This file is used both in the kernel and in the vDSO implementation.
+// So it must be compatible with both the kernel and userland header
+// environments.  It must use only the basic types so that struct
+// layouts match exactly in both contexts.
+
+#define VDSO_TIME_ALIGN 8
+#define VDSO_TIME_SIZE (6 * 4 + 8)
+
+#ifndef __ASSEMBLER__
+
+#include <stdint.h>
+
+// This struct contains the data the vDSO needs to read the clocks without
+// entering the kernel.  Unlike vdso_constants, the kernel may update it at
+// any time, so it is protected by a sequence lock: the kernel makes |seq|
+// odd while it updates the other fields and even again when it's done.
+// Readers must retry if |seq| was odd or changed while they were reading.
+// All fields are accessed with atomic operations.
+struct vdso_time {
+    uint32_t seq;
+
+    // Nonzero if ZX_CLOCK_MONOTONIC is zx_ticks_get() converted with
+    // |ns_per_tick|.  Otherwise the vDSO must ask the kernel for the time.
+    uint32_t ticks_to_mono_valid;
+
+    // Nanoseconds per tick as a 32.64 fixed-point number, laid out like
+    // struct fp_32_64 in kernel/lib/fixed_point.
+    uint32_t ns_per_tick_l0;
+    uint32_t ns_per_tick_l32;
+    uint32_t ns_per_tick_l64;
+
+    uint32_t padding;
+
+    // Offset of ZX_CLOCK_UTC from ZX_CLOCK_MONOTONIC, set by
+    // zx_clock_adjust().
+    int64_t utc_offset;
+};
+
+static_assert(VDSO_TIME_SIZE == sizeof(vdso_time),
+              "Need to adjust VDSO_TIME_SIZE");
+static_assert(VDSO_TIME_ALIGN == alignof(vdso_time),
+              "Need to adjust VDSO_TIME_ALIGN");
+
+#endif // __ASSEMBLER__
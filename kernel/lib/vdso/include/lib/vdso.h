@@ -50,6 +50,10 @@ public:
     // Return a handle to the VMO for the given variant.
     HandleOwner vmo_handle(Variant) const;
 
+    // Publish a new ZX_CLOCK_UTC offset to the vDSO, so that
+    // zx_clock_get(ZX_CLOCK_UTC) can be read without a syscall.
+    static void SetUtcOffset(int64_t offset);
+
 private:
     VDso();
     void CreateVariant(Variant);
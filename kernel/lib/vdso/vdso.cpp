@@ -6,10 +6,14 @@
 
 #include <lib/vdso.h>
 #include <lib/vdso-constants.h>
+#include <lib/vdso-time.h>
 
 #include <fbl/alloc_checker.h>
 #include <fbl/type_support.h>
+#include <kernel/auto_lock.h>
 #include <kernel/cmdline.h>
+#include <kernel/spinlock.h>
+#include <lib/fixed_point.h>
 #include <object/handle.h>
 #include <platform.h>
 #include <vm/pmm.h>
@@ -200,6 +204,40 @@ void blacklist_##category##_syscalls(VDsoDynSymWindow& dynsym_window, \
 #undef SYSCALL_IN_CATEGORY_END
 #undef SYSCALL_CATEGORY_END
 
+// The kernel's mappings of the vdso_time struct in the vDSO VMO and in
+// each variant's clone of it.  These are never unmapped, so that the time
+// data can be updated for as long as the system runs.
+KernelVmoWindow<vdso_time>* time_windows[VDso::variants()];
+SpinLock time_lock;
+
+// Update one copy of the time data.  See the reader in
+// system/ulib/zircon/zx_clock_get.cpp.
+void update_time_data(vdso_time* data, const fp_32_64* ns_per_tick, int64_t utc_offset) {
+    uint32_t seq = __atomic_load_n(&data->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&data->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if (ns_per_tick) {
+        __atomic_store_n(&data->ns_per_tick_l0, ns_per_tick->l0, __ATOMIC_RELAXED);
+        __atomic_store_n(&data->ns_per_tick_l32, ns_per_tick->l32, __ATOMIC_RELAXED);
+        __atomic_store_n(&data->ns_per_tick_l64, ns_per_tick->l64, __ATOMIC_RELAXED);
+        __atomic_store_n(&data->ticks_to_mono_valid, 1u, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&data->utc_offset, utc_offset, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&data->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void map_time_data(VDso::Variant variant, fbl::RefPtr<VmObject> vmo) {
+    size_t index = static_cast<size_t>(variant);
+    DEBUG_ASSERT(!time_windows[index]);
+
+    fbl::AllocChecker ac;
+    time_windows[index] = new (&ac) KernelVmoWindow<vdso_time>(
+        "vDSO time", fbl::move(vmo), VDSO_DATA_TIME);
+    ASSERT(ac.check());
+}
+
 } // anonymous namespace
 
 const VDso* VDso::instance_ = NULL;
@@ -239,7 +277,8 @@ const VDso* VDso::Create() {
 
     // If ticks_per_second has not been calibrated, it will return 0. In this
     // case, use soft_ticks instead.
-    if (per_second == 0 || cmdline_get_bool("vdso.soft_ticks", false)) {
+    bool soft_ticks = per_second == 0 || cmdline_get_bool("vdso.soft_ticks", false);
+    if (soft_ticks) {
         // Make zx_ticks_per_second return nanoseconds per second.
         constants_window.data()->ticks_per_second = ZX_SEC(1);
 
@@ -248,6 +287,17 @@ const VDso* VDso::Create() {
         REDIRECT_SYSCALL(dynsym_window, zx_ticks_get, soft_ticks_get);
     }
 
+    // Tell the vDSO how to compute ZX_CLOCK_MONOTONIC from the ticks it
+    // reads, if it can.  Otherwise zx_clock_get() always enters the kernel.
+    // The variants are cloned from this, so they inherit the data.
+    static_assert(sizeof(vdso_time) == VDSO_DATA_TIME_SIZE,
+                  "gen-rodso-code.sh is suspect");
+    map_time_data(Variant::FULL, vdso->vmo()->vmo());
+    fp_32_64 ns_per_tick;
+    if (!soft_ticks && platform_get_ticks_to_time_ratio(&ns_per_tick)) {
+        update_time_data(time_windows[0]->data(), &ns_per_tick, 0);
+    }
+
     for (size_t v = static_cast<size_t>(Variant::FULL) + 1;
          v < static_cast<size_t>(Variant::COUNT);
          ++v)
@@ -257,6 +307,15 @@ const VDso* VDso::Create() {
     return instance_;
 }
 
+void VDso::SetUtcOffset(int64_t offset) {
+    AutoSpinLock guard(&time_lock);
+    for (auto window : time_windows) {
+        if (window) {
+            update_time_data(window->data(), nullptr, offset);
+        }
+    }
+}
+
 uintptr_t VDso::base_address(const fbl::RefPtr<VmMapping>& code_mapping) {
     return code_mapping ? code_mapping->base() - VDSO_CODE_START : 0;
 }
@@ -292,6 +351,8 @@ void VDso::CreateVariant(Variant variant) {
                                       false, &new_vmo);
     ASSERT(status == ZX_OK);
 
+    map_time_data(variant, new_vmo);
+
     VDsoDynSymWindow dynsym_window(new_vmo);
     VDsoCodeWindow code_window(new_vmo);
 
@@ -195,7 +195,17 @@ zx_status_t ChannelDispatcher::Write(fbl::unique_ptr<MessagePacket> msg) {
 
     if (!peer_)
         return ZX_ERR_PEER_CLOSED;
+
+    // If this message completes the peer's zx_channel_call(), the caller is
+    // blocked waiting for exactly it, so let it run on this cpu straight away.
+    // Other writes (e.g. streaming to an idle reader) wake their reader the
+    // usual way, without preempting the writer.
+    bool handoff = peer_->HasCallWaiterLocked(msg->get_txid());
+    if (handoff)
+        thread_handoff_begin();
     peer_->WriteSelf(fbl::move(msg));
+    if (handoff)
+        thread_handoff_end();
 
     return ZX_OK;
 }
@@ -246,8 +256,11 @@ alloc_txid:
         // waiter to the list.
         waiters_.push_back(waiter);
 
-        // (1) Write outbound message to opposing endpoint.
+        // (1) Write outbound message to opposing endpoint. We are about to
+        // block until the reader replies, so hand it our cpu and time slice.
+        thread_handoff_begin();
         peer_->WriteSelf(fbl::move(msg));
+        thread_handoff_end();
     }
 
     // Reuse the code from the half-call used for retrying a Call after thread
@@ -298,6 +311,15 @@ size_t ChannelDispatcher::TxMessageMax() const {
     return SIZE_MAX;
 }
 
+bool ChannelDispatcher::HasCallWaiterLocked(zx_txid_t txid) const {
+    for (const auto& waiter: waiters_) {
+        if (waiter.get_txid() == txid) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void ChannelDispatcher::WriteSelf(fbl::unique_ptr<MessagePacket> msg) {
     canary_.Assert();
 
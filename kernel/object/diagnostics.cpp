@@ -656,6 +656,190 @@ zx_status_t GetProcessVmosViaHandles(ProcessDispatcher* process,
     return ZX_OK;
 }
 
+namespace {
+// Cursors for the paged ZX_INFO_PROCESS_MAPS walk hold the base address and
+// depth of the next entry. Together these increase along a depth-first
+// pre-order walk, and as bases are page aligned the depth fits in the low
+// bits.
+constexpr uint64_t kMapsCursorDepthMask = PAGE_SIZE - 1;
+
+class VmMapPageBuilder final : public VmEnumerator {
+public:
+    VmMapPageBuilder(uint64_t cursor, zx_info_maps_t* maps, size_t max)
+        : cursor_(cursor), maps_(maps), max_(max) {}
+
+    bool OnVmAddressRegion(const VmAddressRegion* vmar, uint depth) override {
+        zx_info_maps_t* entry = Next(vmar->base(), depth + 1);
+        if (entry == nullptr) {
+            return status_ == ZX_OK && next_cursor_ == 0;
+        }
+        strlcpy(entry->name, vmar->name(), sizeof(entry->name));
+        entry->base = vmar->base();
+        entry->size = vmar->size();
+        entry->depth = depth + 1; // The root aspace is depth 0.
+        entry->type = ZX_INFO_MAPS_TYPE_VMAR;
+        return true;
+    }
+
+    bool OnVmMapping(const VmMapping* map, const VmAddressRegion* vmar,
+                     uint depth) override {
+        zx_info_maps_t* entry = Next(map->base(), depth + 1);
+        if (entry == nullptr) {
+            return status_ == ZX_OK && next_cursor_ == 0;
+        }
+        auto vmo = map->vmo();
+        vmo->get_name(entry->name, sizeof(entry->name));
+        entry->base = map->base();
+        entry->size = map->size();
+        entry->depth = depth + 1; // The root aspace is depth 0.
+        entry->type = ZX_INFO_MAPS_TYPE_MAPPING;
+        zx_info_maps_mapping_t* u = &entry->u.mapping;
+        u->mmu_flags = arch_mmu_flags_to_vm_flags(map->arch_mmu_flags());
+        u->vmo_koid = vmo->user_id();
+        u->committed_pages = vmo->AllocatedPagesInRange(map->object_offset(), map->size());
+        return true;
+    }
+
+    // Returns the entry to fill in for the node at |base| and |depth|, or
+    // null if the node comes before the cursor or doesn't fit in this batch.
+    zx_info_maps_t* Next(vaddr_t base, size_t depth) {
+        if (depth > kMapsCursorDepthMask) {
+            status_ = ZX_ERR_OUT_OF_RANGE;
+            return nullptr;
+        }
+        uint64_t key = base | depth;
+        if (key < cursor_) {
+            return nullptr;
+        }
+        if (nelem_ == max_) {
+            next_cursor_ = key;
+            return nullptr;
+        }
+        zx_info_maps_t* entry = &maps_[nelem_++];
+        *entry = {};
+        return entry;
+    }
+
+    size_t nelem() const { return nelem_; }
+    uint64_t next_cursor() const { return next_cursor_; }
+    zx_status_t status() const { return status_; }
+
+private:
+    const uint64_t cursor_;
+    zx_info_maps_t* const maps_;
+    const size_t max_;
+
+    size_t nelem_ = 0;
+    uint64_t next_cursor_ = 0;
+    zx_status_t status_ = ZX_OK;
+};
+
+// Collects the VMOs of mappings based at or above a cursor address.
+class AspaceVmoPageEnumerator final : public VmEnumerator {
+public:
+    AspaceVmoPageEnumerator(vaddr_t cursor, zx_info_vmo_t* vmos, size_t max)
+        : cursor_(cursor), vmos_(vmos), max_(max) {}
+
+    bool OnVmMapping(const VmMapping* map, const VmAddressRegion* vmar,
+                     uint depth) override {
+        if (map->base() < cursor_) {
+            return true;
+        }
+        if (nelem_ == max_) {
+            next_cursor_ = map->base();
+            return false;
+        }
+        vmos_[nelem_++] = VmoToInfoEntry(map->vmo().get(),
+                                         /*is_handle=*/false,
+                                         /*handle_rights=*/0);
+        return true;
+    }
+
+    size_t nelem() const { return nelem_; }
+    uint64_t next_cursor() const { return next_cursor_; }
+
+private:
+    const vaddr_t cursor_;
+    zx_info_vmo_t* const vmos_;
+    const size_t max_;
+
+    size_t nelem_ = 0;
+    uint64_t next_cursor_ = 0;
+};
+} // namespace
+
+zx_status_t GetVmAspaceMapsPaged(fbl::RefPtr<VmAspace> aspace, uint64_t cursor,
+                                 zx_info_maps_t* entries, size_t max,
+                                 size_t* actual, uint64_t* next_cursor) {
+    DEBUG_ASSERT(aspace != nullptr);
+    *actual = 0;
+    *next_cursor = 0;
+    if (aspace->is_destroyed()) {
+        return ZX_ERR_BAD_STATE;
+    }
+
+    VmMapPageBuilder b(cursor, entries, max);
+    zx_info_maps_t* entry = b.Next(aspace->base(), 0);
+    if (entry != nullptr) {
+        strlcpy(entry->name, aspace->name(), sizeof(entry->name));
+        entry->base = aspace->base();
+        entry->size = aspace->size();
+        entry->depth = 0;
+        entry->type = ZX_INFO_MAPS_TYPE_ASPACE;
+    }
+    if (b.next_cursor() == 0) {
+        aspace->EnumerateChildren(&b, cursor & ~kMapsCursorDepthMask);
+    }
+    if (b.status() != ZX_OK) {
+        return b.status();
+    }
+    *actual = b.nelem();
+    *next_cursor = b.next_cursor();
+    return ZX_OK;
+}
+
+zx_status_t GetVmAspaceVmosPaged(fbl::RefPtr<VmAspace> aspace, uint64_t cursor,
+                                 zx_info_vmo_t* entries, size_t max,
+                                 size_t* actual, uint64_t* next_cursor) {
+    DEBUG_ASSERT(aspace != nullptr);
+    *actual = 0;
+    *next_cursor = 0;
+    if (aspace->is_destroyed()) {
+        return ZX_ERR_BAD_STATE;
+    }
+
+    AspaceVmoPageEnumerator ave(cursor, entries, max);
+    aspace->EnumerateChildren(&ave, cursor);
+    *actual = ave.nelem();
+    *next_cursor = ave.next_cursor();
+    return ZX_OK;
+}
+
+zx_status_t GetProcessVmosViaHandlesPaged(ProcessDispatcher* process, uint64_t cursor,
+                                          zx_info_vmo_t* entries, size_t max,
+                                          size_t* actual, uint64_t* next_cursor) {
+    DEBUG_ASSERT(process != nullptr);
+    size_t nelem = 0;
+    *next_cursor = process->ForEachHandleFrom(cursor, [&](zx_handle_t handle,
+                                                          zx_rights_t rights,
+                                                          const Dispatcher* disp) {
+        auto vmod = DownCastDispatcher<const VmObjectDispatcher>(disp);
+        if (vmod == nullptr) {
+            // This handle isn't a VMO; skip it.
+            return true;
+        }
+        if (nelem == max) {
+            return false;
+        }
+        entries[nelem++] = VmoToInfoEntry(vmod->vmo().get(),
+                                          /*is_handle=*/true,
+                                          rights);
+        return true;
+    });
+    *actual = nelem;
+    return ZX_OK;
+}
+
 void DumpProcessAddressSpace(zx_koid_t id) {
     auto pd = ProcessDispatcher::LookupProcessById(id);
     if (!pd) {
@@ -7,6 +7,8 @@
 #include <object/futex_context.h>
 
 #include <assert.h>
+#include <kernel/sched.h>
+#include <kernel/thread_lock.h>
 #include <lib/user_copy/user_ptr.h>
 #include <object/thread_dispatcher.h>
 #include <trace.h>
@@ -14,6 +16,35 @@
 
 #define LOCAL_TRACE 0
 
+namespace {
+
+// Recomputes the priority |owner| (if any) inherits through the priority
+// inheriting futexes it owns.  If |head| is not null, it heads the wait
+// queue of one of those futexes, and the priority of its waiters is recorded
+// first; the caller must hold the lock of |head|'s bucket.  Pass a null
+// |head| when |owner| has just stopped owning a futex.
+void UpdatePiOwner(ThreadDispatcher* owner, FutexNode* head) {
+    if (!owner)
+        return;
+
+    Guard<spin_lock_t, IrqSave> thread_lock_guard{ThreadLock::Get()};
+    if (head) {
+        DEBUG_ASSERT(head->pi_owner() == owner);
+        head->set_pi_priority(FutexNode::MaxWaiterPriority(head));
+    }
+    bool local_resched = false;
+    owner->UpdateFutexPriority(&local_resched);
+    if (local_resched)
+        sched_reschedule();
+}
+
+// Records the priority of |head|'s waiters with its PI owner, if it has one.
+void UpdatePiOwner(FutexNode* head) {
+    UpdatePiOwner(head->pi_owner(), head);
+}
+
+} // namespace
+
 FutexContext::FutexContext() {
     LTRACE_ENTRY;
 }
@@ -23,23 +54,42 @@ FutexContext::~FutexContext() {
 
     // All of the threads should have removed themselves from wait queues
     // by the time the process has exited.
-    DEBUG_ASSERT(futex_table_.is_empty());
+    for (const auto& bucket : buckets_) {
+        DEBUG_ASSERT(bucket.table.is_empty());
+    }
 }
 
 zx_status_t FutexContext::FutexWait(user_in_ptr<const int> value_ptr, int current_value, zx_time_t deadline) {
+    return FutexWaitInternal(value_ptr, current_value, nullptr, deadline);
+}
+
+zx_status_t FutexContext::FutexWaitPi(user_in_ptr<const int> value_ptr, int current_value,
+                                      fbl::RefPtr<ThreadDispatcher> owner, zx_time_t deadline) {
+    // A thread cannot block waiting for itself to release a futex.
+    if (owner && owner.get() == ThreadDispatcher::GetCurrent())
+        return ZX_ERR_INVALID_ARGS;
+
+    return FutexWaitInternal(value_ptr, current_value, fbl::move(owner), deadline);
+}
+
+zx_status_t FutexContext::FutexWaitInternal(user_in_ptr<const int> value_ptr, int current_value,
+                                            fbl::RefPtr<ThreadDispatcher> owner,
+                                            zx_time_t deadline) {
     LTRACE_ENTRY;
 
     uintptr_t futex_key = reinterpret_cast<uintptr_t>(value_ptr.get());
     if (futex_key % sizeof(int))
         return ZX_ERR_INVALID_ARGS;
 
+    Bucket* bucket = &GetBucket(futex_key);
+
     // FutexWait() checks that the address value_ptr still contains
     // current_value, and if so it sleeps awaiting a FutexWake() on value_ptr.
     // Those two steps must together be atomic with respect to FutexWake().
     // If a FutexWake() operation could occur between them, a userland mutex
     // operation built on top of futexes would have a race condition that
     // could miss wakeups.
-    Guard<fbl::Mutex> guard{&lock_};
+    Guard<fbl::Mutex> guard{&bucket->lock};
 
     int value;
     zx_status_t result = value_ptr.copy_from_user(&value);
@@ -52,11 +102,24 @@ zx_status_t FutexContext::FutexWait(user_in_ptr<const int> value_ptr, int curren
 
     FutexNode node;
     node.set_hash_key(futex_key);
+    node.set_waiter(get_current_thread());
     node.SetAsSingletonList();
 
-    QueueNodesLocked(&node);
+    FutexNode* head = QueueNodesLocked(bucket, &node);
+
+    if (owner) {
+        // The most recent waiter has the freshest view of which thread owns
+        // the futex, so its claim replaces any earlier one.  The previous
+        // owner (if any) is handed back in |owner| and released once we are
+        // done blocking.
+        fbl::RefPtr<ThreadDispatcher> previous_owner = head->take_pi_owner();
+        head->set_pi_owner(fbl::move(owner));
+        owner = fbl::move(previous_owner);
+        UpdatePiOwner(owner.get(), nullptr);
+    }
+    UpdatePiOwner(head);
 
-    // Block current thread.  This releases lock_ and does not reacquire it.
+    // Block current thread.  This releases the bucket lock and does not reacquire it.
     result = node.BlockThread(guard.take(), deadline);
     if (result == ZX_OK) {
         DEBUG_ASSERT(!node.IsInQueue());
@@ -70,30 +133,44 @@ zx_status_t FutexContext::FutexWait(user_in_ptr<const int> value_ptr, int curren
     //
     // We need to ensure that the thread's node is removed from the wait
     // queue, because FutexWake() probably didn't do that.
-    Guard<fbl::Mutex> guard2{&lock_};
-    if (UnqueueNodeLocked(&node)) {
-        return result;
-    }
-    // The current thread was not found on the wait queue.  This means
-    // that, although we hit the deadline (or were suspended/killed), we
-    // were *also* woken by FutexWake() (which removed the thread from the
-    // wait queue) -- the two raced together.
     //
-    // In this case, we want to return a success status.  This preserves
-    // the property that if FutexWake() is called with wake_count=1 and
-    // there are waiting threads, then at least one FutexWait() call
-    // returns success.
-    //
-    // If that property is broken, it can lead to missed wakeups in
-    // concurrency constructs that are built on top of futexes.  For
-    // example, suppose a FutexWake() call from pthread_mutex_unlock()
-    // races with a FutexWait() deadline from pthread_mutex_timedlock(). A
-    // typical implementation of pthread_mutex_timedlock() will return
-    // immediately without trying again to claim the mutex if this
-    // FutexWait() call returns a timeout status.  If that happens, and if
-    // another thread is waiting on the mutex, then that thread won't get
-    // woken -- the wakeup from the FutexWake() call would have got lost.
-    return ZX_OK;
+    // FutexRequeue() may have moved the node to a futex that lives in a
+    // different bucket.  Requeuing holds the locks of both the old and the
+    // new bucket while it updates keys, so the node's key is stable once we
+    // hold the lock of the bucket it maps to.
+    fbl::RefPtr<ThreadDispatcher> last_owner;
+    for (;;) {
+        Guard<fbl::Mutex> guard2{&bucket->lock};
+        Bucket* current_bucket = &GetBucket(node.GetKey());
+        if (current_bucket != bucket) {
+            bucket = current_bucket;
+            continue;
+        }
+
+        if (UnqueueNodeLocked(bucket, &node, &last_owner)) {
+            return result;
+        }
+        // The current thread was not found on the wait queue.  This means
+        // that, although we hit the deadline (or were suspended/killed), we
+        // were *also* woken by FutexWake() (which removed the thread from the
+        // wait queue) -- the two raced together.
+        //
+        // In this case, we want to return a success status.  This preserves
+        // the property that if FutexWake() is called with wake_count=1 and
+        // there are waiting threads, then at least one FutexWait() call
+        // returns success.
+        //
+        // If that property is broken, it can lead to missed wakeups in
+        // concurrency constructs that are built on top of futexes.  For
+        // example, suppose a FutexWake() call from pthread_mutex_unlock()
+        // races with a FutexWait() deadline from pthread_mutex_timedlock(). A
+        // typical implementation of pthread_mutex_timedlock() will return
+        // immediately without trying again to claim the mutex if this
+        // FutexWait() call returns a timeout status.  If that happens, and if
+        // another thread is waiting on the mutex, then that thread won't get
+        // woken -- the wakeup from the FutexWake() call would have got lost.
+        return ZX_OK;
+    }
 }
 
 zx_status_t FutexContext::FutexWake(user_in_ptr<const int> value_ptr,
@@ -106,38 +183,148 @@ zx_status_t FutexContext::FutexWake(user_in_ptr<const int> value_ptr,
     if (futex_key % sizeof(int))
         return ZX_ERR_INVALID_ARGS;
 
+    Bucket* bucket = &GetBucket(futex_key);
+
+    // Released after the bucket lock if every waiter is woken.
+    fbl::RefPtr<ThreadDispatcher> owner;
+
     AutoReschedDisable resched_disable; // Must come before the Guard.
     resched_disable.Disable();
-    Guard<fbl::Mutex> guard{&lock_};
+    Guard<fbl::Mutex> guard{&bucket->lock};
 
-    FutexNode* node = futex_table_.erase(futex_key);
+    FutexNode* node = bucket->table.erase(futex_key);
     if (!node) {
         // nothing blocked on this futex if we can't find it
         return ZX_OK;
     }
     DEBUG_ASSERT(node->GetKey() == futex_key);
 
+    owner = node->take_pi_owner();
     FutexNode* remaining_waiters =
         FutexNode::WakeThreads(node, count, futex_key);
 
     if (remaining_waiters) {
         DEBUG_ASSERT(remaining_waiters->GetKey() == futex_key);
-        futex_table_.insert(remaining_waiters);
+        if (owner)
+            remaining_waiters->set_pi_owner(fbl::move(owner));
+        bucket->table.insert(remaining_waiters);
+        UpdatePiOwner(remaining_waiters);
+    } else {
+        UpdatePiOwner(owner.get(), nullptr);
     }
 
     return ZX_OK;
 }
 
+zx_status_t FutexContext::FutexWakePi(user_in_ptr<const int> value_ptr) {
+    LTRACE_ENTRY;
+
+    uintptr_t futex_key = reinterpret_cast<uintptr_t>(value_ptr.get());
+    if (futex_key % sizeof(int))
+        return ZX_ERR_INVALID_ARGS;
+
+    Bucket* bucket = &GetBucket(futex_key);
+
+    // Released after the bucket lock.
+    fbl::RefPtr<ThreadDispatcher> old_owner;
+
+    AutoReschedDisable resched_disable; // Must come before the Guard.
+    resched_disable.Disable();
+    Guard<fbl::Mutex> guard{&bucket->lock};
+
+    FutexNode* node = bucket->table.erase(futex_key);
+    if (!node) {
+        // nothing blocked on this futex, so nobody owns it
+        return ZX_OK;
+    }
+    DEBUG_ASSERT(node->GetKey() == futex_key);
+    old_owner = node->take_pi_owner();
+
+    // Split off the thread we are about to wake.  It becomes the new owner,
+    // inheriting the priority of the waiters that remain.  We must boost it
+    // before waking it: once woken it may exit and free its thread_t.
+    FutexNode* remaining_waiters = FutexNode::RemoveFromHead(node, 1, futex_key, futex_key);
+    if (remaining_waiters) {
+        ThreadDispatcher* new_owner =
+            reinterpret_cast<ThreadDispatcher*>(node->waiter()->user_thread);
+        remaining_waiters->set_pi_owner(fbl::WrapRefPtr(new_owner));
+        bucket->table.insert(remaining_waiters);
+        UpdatePiOwner(remaining_waiters);
+    }
+    FutexNode::WakeThreads(node, 1, futex_key);
+
+    // The old owner is handing the futex off, so it no longer needs the
+    // priority of the threads waiting for it; it keeps what it inherits
+    // through any other futexes it owns.
+    UpdatePiOwner(old_owner.get(), nullptr);
+
+    return ZX_OK;
+}
+
 zx_status_t FutexContext::FutexRequeue(user_in_ptr<const int> wake_ptr, uint32_t wake_count, int current_value,
                                        user_in_ptr<const int> requeue_ptr, uint32_t requeue_count) {
+    return FutexRequeueInternal(wake_ptr, wake_count, current_value,
+                                requeue_ptr, requeue_count, nullptr);
+}
+
+zx_status_t FutexContext::FutexRequeuePi(user_in_ptr<const int> wake_ptr, uint32_t wake_count,
+                                         int current_value, user_in_ptr<const int> requeue_ptr,
+                                         uint32_t requeue_count,
+                                         fbl::RefPtr<ThreadDispatcher> requeue_owner) {
+    // On return |requeue_owner| holds any reference the requeue futex no
+    // longer needs; it is released here, after all futex locks are dropped.
+    return FutexRequeueInternal(wake_ptr, wake_count, current_value,
+                                requeue_ptr, requeue_count, &requeue_owner);
+}
+
+zx_status_t FutexContext::FutexRequeueInternal(user_in_ptr<const int> wake_ptr, uint32_t wake_count,
+                                               int current_value,
+                                               user_in_ptr<const int> requeue_ptr,
+                                               uint32_t requeue_count,
+                                               fbl::RefPtr<ThreadDispatcher>* requeue_owner) {
     LTRACE_ENTRY;
 
     if ((requeue_ptr.get() == nullptr) && requeue_count)
         return ZX_ERR_INVALID_ARGS;
 
+    uintptr_t wake_key = reinterpret_cast<uintptr_t>(wake_ptr.get());
+    uintptr_t requeue_key = reinterpret_cast<uintptr_t>(requeue_ptr.get());
+
+    Bucket* wake_bucket = &GetBucket(wake_key);
+    Bucket* requeue_bucket = &GetBucket(requeue_key);
+
+    // Released after the bucket locks if every waiter on |wake_ptr| is woken
+    // or requeued.
+    fbl::RefPtr<ThreadDispatcher> wake_owner;
+
     AutoReschedDisable resched_disable; // Must come before the Guard.
-    Guard<fbl::Mutex> guard{&lock_};
+    if (wake_bucket == requeue_bucket) {
+        Guard<fbl::Mutex> guard{&wake_bucket->lock};
+        return RequeueLocked(wake_bucket, wake_ptr, wake_count, current_value,
+                             requeue_bucket, requeue_ptr, requeue_count,
+                             requeue_owner, &wake_owner, &resched_disable);
+    }
+
+    // GuardMultiple acquires the two bucket locks in address order, which
+    // keeps concurrent requeues in opposite directions from deadlocking.
+    GuardMultiple<2, fbl::Mutex> guard{&wake_bucket->lock, &requeue_bucket->lock};
+    return RequeueLocked(wake_bucket, wake_ptr, wake_count, current_value,
+                         requeue_bucket, requeue_ptr, requeue_count,
+                         requeue_owner, &wake_owner, &resched_disable);
+}
 
+// The caller holds the locks of both |wake_bucket| and |requeue_bucket|
+// (which may be the same bucket).  GuardMultiple does not describe the locks
+// it holds to the thread safety analysis, hence the opt out.
+zx_status_t FutexContext::RequeueLocked(Bucket* wake_bucket, user_in_ptr<const int> wake_ptr,
+                                        uint32_t wake_count, int current_value,
+                                        Bucket* requeue_bucket,
+                                        user_in_ptr<const int> requeue_ptr,
+                                        uint32_t requeue_count,
+                                        fbl::RefPtr<ThreadDispatcher>* requeue_owner,
+                                        fbl::RefPtr<ThreadDispatcher>* wake_owner,
+                                        AutoReschedDisable* resched_disable)
+    TA_NO_THREAD_SAFETY_ANALYSIS {
     int value;
     zx_status_t result = wake_ptr.copy_from_user(&value);
     if (result != ZX_OK) return result;
@@ -150,9 +337,9 @@ zx_status_t FutexContext::FutexRequeue(user_in_ptr<const int> wake_ptr, uint32_t
         return ZX_ERR_INVALID_ARGS;
 
     // This must happen before RemoveFromHead() calls set_hash_key() on
-    // nodes below, because operations on futex_table_ look at the GetKey
-    // field of the list head nodes for wake_key and requeue_key.
-    FutexNode* node = futex_table_.erase(wake_key);
+    // nodes below, because operations on the bucket tables look at the
+    // GetKey field of the list head nodes for wake_key and requeue_key.
+    FutexNode* node = wake_bucket->table.erase(wake_key);
     if (!node) {
         // nothing blocked on this futex if we can't find it
         return ZX_OK;
@@ -160,7 +347,9 @@ zx_status_t FutexContext::FutexRequeue(user_in_ptr<const int> wake_ptr, uint32_t
 
     // This must come before WakeThreads() to be useful, but we want to
     // avoid doing it before copy_from_user() in case that faults.
-    resched_disable.Disable();
+    resched_disable->Disable();
+
+    *wake_owner = node->take_pi_owner();
 
     if (wake_count > 0) {
         node = FutexNode::WakeThreads(node, wake_count, wake_key);
@@ -176,21 +365,35 @@ zx_status_t FutexContext::FutexRequeue(user_in_ptr<const int> wake_ptr, uint32_t
 
             // now requeue our nodes to requeue_ptr mutex
             DEBUG_ASSERT(requeue_head->GetKey() == requeue_key);
-            QueueNodesLocked(requeue_head);
+            requeue_head = QueueNodesLocked(requeue_bucket, requeue_head);
+
+            if (requeue_owner && *requeue_owner) {
+                // Swap the new owner in; the caller releases the old one.
+                fbl::RefPtr<ThreadDispatcher> previous_owner = requeue_head->take_pi_owner();
+                requeue_head->set_pi_owner(fbl::move(*requeue_owner));
+                *requeue_owner = fbl::move(previous_owner);
+                UpdatePiOwner(requeue_owner->get(), nullptr);
+            }
+            UpdatePiOwner(requeue_head);
         }
     }
 
     // add any remaining nodes back to wake_key futex
     if (node != nullptr) {
         DEBUG_ASSERT(node->GetKey() == wake_key);
-        futex_table_.insert(node);
+        if (*wake_owner)
+            node->set_pi_owner(fbl::move(*wake_owner));
+        wake_bucket->table.insert(node);
+        UpdatePiOwner(node);
+    } else {
+        UpdatePiOwner(wake_owner->get(), nullptr);
     }
 
     return ZX_OK;
 }
 
-void FutexContext::QueueNodesLocked(FutexNode* head) {
-    DEBUG_ASSERT(lock_.lock().IsHeld());
+FutexNode* FutexContext::QueueNodesLocked(Bucket* bucket, FutexNode* head) {
+    DEBUG_ASSERT(bucket->lock.lock().IsHeld());
 
     FutexNode::HashTable::iterator iter;
 
@@ -198,15 +401,19 @@ void FutexContext::QueueNodesLocked(FutexNode* head) {
     // succeeds, then the current thread is first to block on this futex and we
     // are finished.  If the insert fails, then there is already a thread
     // waiting on this futex.  Add ourselves to that thread's list.
-    if (!futex_table_.insert_or_find(head, &iter))
+    if (!bucket->table.insert_or_find(head, &iter)) {
         iter->AppendList(head);
+        return &*iter;
+    }
+    return head;
 }
 
 // This attempts to unqueue a thread (which may or may not be waiting on a
 // futex), given its FutexNode.  This returns whether the FutexNode was
 // found and removed from a futex wait queue.
-bool FutexContext::UnqueueNodeLocked(FutexNode* node) {
-    DEBUG_ASSERT(lock_.lock().IsHeld());
+bool FutexContext::UnqueueNodeLocked(Bucket* bucket, FutexNode* node,
+                                     fbl::RefPtr<ThreadDispatcher>* out_owner) {
+    DEBUG_ASSERT(bucket->lock.lock().IsHeld());
 
     if (!node->IsInQueue())
         return false;
@@ -217,10 +424,22 @@ bool FutexContext::UnqueueNodeLocked(FutexNode* node) {
     // FutexRequeue(), so we need to re-get the hash table key here.
     uintptr_t futex_key = node->GetKey();
 
-    FutexNode* old_head = futex_table_.erase(futex_key);
+    FutexNode* old_head = bucket->table.erase(futex_key);
     DEBUG_ASSERT(old_head);
+    fbl::RefPtr<ThreadDispatcher> owner = old_head->take_pi_owner();
     FutexNode* new_head = FutexNode::RemoveNodeFromList(old_head, node);
-    if (new_head)
-        futex_table_.insert(new_head);
+    if (new_head) {
+        // The owner keeps the futex, but no longer inherits the priority of
+        // the thread which stopped waiting.
+        if (owner)
+            new_head->set_pi_owner(fbl::move(owner));
+        bucket->table.insert(new_head);
+        UpdatePiOwner(new_head);
+    } else {
+        // Nobody waits for the futex any more, so its owner inherits nothing
+        // through it.
+        UpdatePiOwner(owner.get(), nullptr);
+        *out_owner = fbl::move(owner);
+    }
     return true;
 }
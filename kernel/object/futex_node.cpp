@@ -25,6 +25,8 @@ FutexNode::~FutexNode() {
     LTRACE_ENTRY;
 
     DEBUG_ASSERT(!IsInQueue());
+    DEBUG_ASSERT(!pi_owner_);
+    DEBUG_ASSERT(!pi_owned_node_.InContainer());
 }
 
 bool FutexNode::IsInQueue() const {
@@ -42,6 +44,40 @@ void FutexNode::AppendList(FutexNode* head) {
     SpliceNodes(this, head);
 }
 
+int FutexNode::MaxWaiterPriority(FutexNode* list_head) {
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+
+    if (!list_head)
+        return -1;
+
+    int priority = -1;
+    FutexNode* node = list_head;
+    do {
+        DEBUG_ASSERT(node->waiter_);
+        if (node->waiter_->effec_priority > priority)
+            priority = node->waiter_->effec_priority;
+        node = node->queue_next_;
+    } while (node != list_head);
+    return priority;
+}
+
+void FutexNode::set_pi_owner(fbl::RefPtr<ThreadDispatcher> owner) {
+    DEBUG_ASSERT(!pi_owner_);
+    if (owner) {
+        Guard<spin_lock_t, IrqSave> guard{ThreadLock::Get()};
+        owner->AddOwnedPiFutex(this);
+    }
+    pi_owner_ = fbl::move(owner);
+}
+
+fbl::RefPtr<ThreadDispatcher> FutexNode::take_pi_owner() {
+    if (pi_owner_) {
+        Guard<spin_lock_t, IrqSave> guard{ThreadLock::Get()};
+        pi_owner_->RemoveOwnedPiFutex(this);
+    }
+    return fbl::move(pi_owner_);
+}
+
 // This removes |node| from the list whose first node is |list_head|.  This
 // returns the new list head, or nullptr if the list has become empty.
 FutexNode* FutexNode::RemoveNodeFromList(FutexNode* list_head,
@@ -83,8 +119,9 @@ FutexNode* FutexNode::WakeThreads(FutexNode* node, uint32_t count,
     FutexNode* const list_end = node->queue_prev_;
     for (uint32_t i = 0; i < count; i++) {
         DEBUG_ASSERT(node->GetKey() == old_hash_key);
-        // Clear this field to avoid any possible confusion.
+        // Clear these fields to avoid any possible confusion.
         node->set_hash_key(0);
+        node->waiter_ = nullptr;
 
         const bool is_last_node = (node == list_end);
         FutexNode* next = node->queue_next_;
@@ -175,11 +212,11 @@ void FutexNode::WakeThread() {
     // cases to consider:
     //  1) The thread's wait times out, or the thread is killed or
     //     suspended.  In those cases, FutexWait() will reacquire the
-    //     FutexContext lock.  We are currently holding that lock, so
+    //     FutexContext bucket lock.  We are currently holding that lock, so
     //     FutexWait() will not race with us.
     //  2) The thread is woken by our wait_queue_wake_one() call.  In
     //     this case, FutexWait() will *not* reacquire the FutexContext
-    //     lock.  To handle this correctly, we must not access |this|
+    //     bucket lock.  To handle this correctly, we must not access |this|
     //     after wait_queue_wake_one().
 
     // We must do this before we wake the thread, to handle case 2.
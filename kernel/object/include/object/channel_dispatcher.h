@@ -106,6 +106,9 @@ private:
     explicit ChannelDispatcher(fbl::RefPtr<PeerHolder<ChannelDispatcher>> holder);
     void Init(fbl::RefPtr<ChannelDispatcher> other);
     void WriteSelf(fbl::unique_ptr<MessagePacket> msg) TA_REQ(get_lock());
+    // Returns whether a zx_channel_call() on this endpoint waits for the
+    // reply with |txid|.
+    bool HasCallWaiterLocked(zx_txid_t txid) const TA_REQ(get_lock());
     zx_status_t UserSignalSelf(uint32_t clear_mask, uint32_t set_mask) TA_REQ(get_lock());
 
     fbl::Canary<fbl::magic("CHAN")> canary_;
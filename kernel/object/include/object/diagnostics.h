@@ -44,6 +44,22 @@ zx_status_t GetProcessVmosViaHandles(ProcessDispatcher* process,
                                      user_out_ptr<zx_info_vmo_t> vmos, size_t max,
                                      size_t* actual, size_t* available);
 
+// Paged versions of the functions above, used by zx_object_get_info_paged().
+// Each call writes at most |max| entries, starting at |cursor| (0 for the
+// first entry), into the kernel buffer |entries|, and sets |next_cursor| to
+// the cursor for the next call or to 0 if there are no more entries. Locks
+// are only held while a call gathers its entries, so entries that change
+// between calls may be missed or reported twice.
+zx_status_t GetVmAspaceMapsPaged(fbl::RefPtr<VmAspace> aspace, uint64_t cursor,
+                                 zx_info_maps_t* entries, size_t max,
+                                 size_t* actual, uint64_t* next_cursor);
+zx_status_t GetVmAspaceVmosPaged(fbl::RefPtr<VmAspace> aspace, uint64_t cursor,
+                                 zx_info_vmo_t* entries, size_t max,
+                                 size_t* actual, uint64_t* next_cursor);
+zx_status_t GetProcessVmosViaHandlesPaged(ProcessDispatcher* process, uint64_t cursor,
+                                          zx_info_vmo_t* entries, size_t max,
+                                          size_t* actual, uint64_t* next_cursor);
+
 // Prints (with the supplied prefix) the number of mapped, committed bytes for
 // each process in the system whose page count > |min_pages|. Does not take
 // sharing into account, and does not count unmapped VMOs.
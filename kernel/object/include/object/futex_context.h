@@ -9,9 +9,12 @@
 #include <lib/user_copy/user_ptr.h>
 #include <zircon/types.h>
 #include <fbl/mutex.h>
+#include <fbl/ref_ptr.h>
 #include <kernel/lockdep.h>
 #include <object/futex_node.h>
 
+class ThreadDispatcher;
+
 // FutexContext is a class that encapsulates support for futex operations.
 // FutexContext uses a hash table keyed on the futex address (a pointer to integer in userspace)
 // to contain all active futexes.
@@ -24,6 +27,15 @@
 // When the thread at the head of the futex's blocked thread list is resumed,
 // The FutexNode for the new head of the blocked thread list is set as the hash table value
 // for the futex.
+//
+// The hash table is sharded into kNumBuckets buckets, each with its own lock, so
+// that operations on unrelated futexes in the same process do not contend.
+//
+// Futexes may optionally be used with priority inheritance (the *Pi operations).
+// A priority inheriting futex has an owner thread, named by the waiters, which
+// inherits the highest priority of the threads blocked on the futex until it
+// calls FutexWakePi().  Each thread keeps a list of the futexes it owns, and
+// its inherited priority is recomputed from all of them whenever one changes.
 class FutexContext {
 public:
     FutexContext();
@@ -48,18 +60,77 @@ public:
     zx_status_t FutexRequeue(user_in_ptr<const int> wake_ptr, uint32_t wake_count, int current_value,
                              user_in_ptr<const int> requeue_ptr, uint32_t requeue_count);
 
+    // FutexWaitPi behaves like FutexWait, but additionally records |owner| as
+    // the owner of the |value_ptr| futex.  The owner inherits the priority of
+    // the current thread (and of any other threads blocked on the futex) until
+    // it calls FutexWakePi.  |owner| may be null, in which case no priority
+    // is inherited.
+    zx_status_t FutexWaitPi(user_in_ptr<const int> value_ptr, int current_value,
+                            fbl::RefPtr<ThreadDispatcher> owner, zx_time_t deadline);
+
+    // FutexWakePi wakes a single thread blocked on the |value_ptr| futex and
+    // makes it the owner of the futex, so that it inherits the priority of
+    // the remaining waiters.  The previous owner drops the priority it
+    // inherited through this futex, but keeps what it inherits through any
+    // other futexes it owns.
+    zx_status_t FutexWakePi(user_in_ptr<const int> value_ptr);
+
+    // FutexRequeuePi behaves like FutexRequeue, but marks |requeue_owner| as
+    // the owner of the |requeue_ptr| futex so that it inherits the priority
+    // of the requeued threads.
+    zx_status_t FutexRequeuePi(user_in_ptr<const int> wake_ptr, uint32_t wake_count,
+                               int current_value, user_in_ptr<const int> requeue_ptr,
+                               uint32_t requeue_count,
+                               fbl::RefPtr<ThreadDispatcher> requeue_owner);
+
 private:
     FutexContext(const FutexContext&) = delete;
     FutexContext& operator=(const FutexContext&) = delete;
 
-    void QueueNodesLocked(FutexNode* head) TA_REQ(lock_);
+    static constexpr size_t kNumBucketsShift = 4;
+    static constexpr size_t kNumBuckets = 1u << kNumBucketsShift;
+
+    struct Bucket {
+        // protects table
+        DECLARE_MUTEX(Bucket) lock;
+
+        // Key is futex address, value is the FutexNode for the head of
+        // futex's blocked thread list.
+        FutexNode::HashTable table TA_GUARDED(lock);
+    };
+
+    // Returns the bucket responsible for |futex_key|.  This uses the high
+    // bits of a multiplicative hash so that it is independent of the low
+    // bits that FutexNode::GetHash() uses to index the bucket's table.
+    Bucket& GetBucket(uintptr_t futex_key) {
+        uint64_t hash = static_cast<uint64_t>(futex_key >> 2) * 0x9E3779B97F4A7C15ull;
+        return buckets_[hash >> (64 - kNumBucketsShift)];
+    }
+
+    zx_status_t FutexWaitInternal(user_in_ptr<const int> value_ptr, int current_value,
+                                  fbl::RefPtr<ThreadDispatcher> owner, zx_time_t deadline);
+
+    zx_status_t FutexRequeueInternal(user_in_ptr<const int> wake_ptr, uint32_t wake_count,
+                                     int current_value, user_in_ptr<const int> requeue_ptr,
+                                     uint32_t requeue_count,
+                                     fbl::RefPtr<ThreadDispatcher>* requeue_owner);
+
+    static zx_status_t RequeueLocked(Bucket* wake_bucket, user_in_ptr<const int> wake_ptr,
+                                     uint32_t wake_count, int current_value,
+                                     Bucket* requeue_bucket, user_in_ptr<const int> requeue_ptr,
+                                     uint32_t requeue_count,
+                                     fbl::RefPtr<ThreadDispatcher>* requeue_owner,
+                                     fbl::RefPtr<ThreadDispatcher>* wake_owner,
+                                     AutoReschedDisable* resched_disable);
 
-    bool UnqueueNodeLocked(FutexNode* node) TA_REQ(lock_);
+    // Returns the head of the wait queue the nodes were added to.
+    static FutexNode* QueueNodesLocked(Bucket* bucket, FutexNode* head) TA_REQ(bucket->lock);
 
-    // protects futex_table_
-    DECLARE_MUTEX(FutexContext) lock_;
+    // |out_owner| receives the futex's owner if |node| was the last waiter,
+    // so that the caller can release it after dropping the bucket lock.
+    static bool UnqueueNodeLocked(Bucket* bucket, FutexNode* node,
+                                  fbl::RefPtr<ThreadDispatcher>* out_owner)
+        TA_REQ(bucket->lock);
 
-    // Hash table for futexes in this context.
-    // Key is futex address, value is the FutexNode for the head of futex's blocked thread list.
-    FutexNode::HashTable futex_table_ TA_GUARDED(lock_);
+    Bucket buckets_[kNumBuckets];
 };
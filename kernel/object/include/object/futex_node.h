@@ -11,14 +11,32 @@
 #include <kernel/wait.h>
 #include <list.h>
 #include <zircon/types.h>
+#include <fbl/intrusive_double_list.h>
 #include <fbl/intrusive_hash_table.h>
 #include <fbl/mutex.h>
+#include <fbl/ref_ptr.h>
+
+class ThreadDispatcher;
 
 // Node for linked list of threads blocked on a futex
 // Intended to be embedded within a ThreadDispatcher Instance
 class FutexNode : public fbl::SinglyLinkedListable<FutexNode*> {
 public:
-    using HashTable = fbl::HashTable<uintptr_t, FutexNode*>;
+    // FutexContext shards its futexes across many small hash tables, so each
+    // one only needs a handful of buckets.
+    static constexpr size_t kHashTableBuckets = 8;
+    using HashTable = fbl::HashTable<uintptr_t, FutexNode*,
+                                     fbl::SinglyLinkedList<FutexNode*>,
+                                     size_t, kHashTableBuckets>;
+
+    // Traits to belong in the list of priority inheriting futexes owned by
+    // a thread.
+    struct PiOwnedListTraits {
+        static fbl::DoublyLinkedListNodeState<FutexNode*>& node_state(FutexNode& node) {
+            return node.pi_owned_node_;
+        }
+    };
+    using PiOwnedList = fbl::DoublyLinkedList<FutexNode*, PiOwnedListTraits>;
 
     FutexNode();
     ~FutexNode();
@@ -50,6 +68,29 @@ public:
         hash_key_ = key;
     }
 
+    // The thread blocked on this node.  Only valid while the node is queued.
+    void set_waiter(thread_t* waiter) { waiter_ = waiter; }
+    thread_t* waiter() const { return waiter_; }
+
+    // Returns the highest effective priority of the threads waiting in the
+    // list starting at |list_head|, or -1 if |list_head| is null.
+    static int MaxWaiterPriority(FutexNode* list_head) TA_REQ(thread_lock);
+
+    // The thread that currently owns a priority inheriting futex.  This is
+    // only meaningful for the node at the head of a futex's wait queue, and
+    // must be moved to the new head whenever the head changes.  Setting and
+    // taking the owner also adds this node to, and removes it from, the
+    // owner's list of owned futexes; both take the thread lock.
+    void set_pi_owner(fbl::RefPtr<ThreadDispatcher> owner);
+    fbl::RefPtr<ThreadDispatcher> take_pi_owner();
+    ThreadDispatcher* pi_owner() const { return pi_owner_.get(); }
+
+    // The highest priority of the threads waiting in this node's list, as
+    // last recorded while holding the lock of the node's bucket.  The owner
+    // reads this rather than walking lists guarded by other buckets' locks.
+    void set_pi_priority(int priority) TA_REQ(thread_lock) { pi_priority_ = priority; }
+    int pi_priority() const TA_REQ(thread_lock) { return pi_priority_; }
+
     // Trait implementation for fbl::HashTable
     uintptr_t GetKey() const { return hash_key_; }
     static size_t GetHash(uintptr_t key) { return (key >> 3); }
@@ -70,6 +111,14 @@ private:
     //    intrusive SinglyLinkedLists).
     uintptr_t hash_key_;
 
+    // See set_waiter() and set_pi_owner().
+    thread_t* waiter_ = nullptr;
+    fbl::RefPtr<ThreadDispatcher> pi_owner_;
+
+    // See set_pi_priority().  Guarded by thread_lock.
+    int pi_priority_ = -1;
+    fbl::DoublyLinkedListNodeState<FutexNode*> pi_owned_node_;
+
     // Used for waking the thread corresponding to the FutexNode.
     WaitQueue wait_queue_;
 
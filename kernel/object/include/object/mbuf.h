@@ -9,6 +9,7 @@
 #include <stdint.h>
 
 #include <lib/user_copy/user_ptr.h>
+#include <vm/page.h>
 #include <zircon/types.h>
 #include <fbl/intrusive_single_list.h>
 
@@ -58,16 +59,26 @@ public:
 
 private:
     // An MBuf is a small fixed-size chainable memory buffer.
+    //
+    // Large stream writes use page MBufs instead.  A page MBuf is constructed at the start of a
+    // page allocated from the PMM, like BufferChain's buffers, and its payload runs to the end of
+    // that page.  Storing a page of data then costs one page allocation rather than two heap
+    // allocations, and fewer, larger copies.
     struct MBuf : public fbl::SinglyLinkedListable<MBuf*> {
         // 8 for the linked list and 4 for the explicit uint32_t fields.
         static constexpr size_t kHeaderSize = 8 + (4 * 4);
         // 16 is for the malloc header.
         static constexpr size_t kMallocSize = 2048 - 16;
         static constexpr size_t kPayloadSize = kMallocSize - kHeaderSize;
+        static constexpr size_t kPagePayloadSize = PAGE_SIZE - kHeaderSize;
+
+        explicit MBuf(size_t cap = kPayloadSize) : cap_(static_cast<uint32_t>(cap)) {}
 
         // Returns number of bytes of free space in this MBuf.
         size_t rem() const;
 
+        bool is_page() const { return cap_ == kPagePayloadSize; }
+
         uint32_t off_ = 0u;
         uint32_t len_ = 0u;
         // pkt_len_ is set to the total number of bytes in a packet
@@ -76,18 +87,29 @@ private:
         //
         // Always 0 in ZX_SOCKET_STREAM mode.
         uint32_t pkt_len_ = 0u;
-        uint32_t unused_;
-        char data_[kPayloadSize] = {0};
-        // TODO: maybe union data_ with char* blocks for large messages
+        // Number of bytes |data_| can hold: kPayloadSize, or kPagePayloadSize for a page MBuf,
+        // whose |data_| extends to the end of its page.
+        const uint32_t cap_;
+        char data_[kPayloadSize];
     };
     static_assert(sizeof(MBuf) == MBuf::kMallocSize, "");
 
     static constexpr size_t kSizeMax = 128 * MBuf::kPayloadSize;
 
+    // Stream writes of at least this many bytes use page MBufs.
+    static constexpr size_t kPageWriteThreshold = MBuf::kPagePayloadSize;
+
+    // Number of free page MBufs to keep for reuse; the rest go back to the PMM.
+    static constexpr size_t kPageFreelistMax = 16;
+
     MBuf* AllocMBuf();
+    MBuf* AllocPageMBuf();
     void FreeMBuf(MBuf* buf);
+    static void DeletePageMBuf(MBuf* buf);
 
     fbl::SinglyLinkedList<MBuf*> freelist_;
+    fbl::SinglyLinkedList<MBuf*> page_freelist_;
+    size_t page_freelist_len_ = 0u;
     fbl::SinglyLinkedList<MBuf*> tail_;
     MBuf* head_ = nullptr;;
     size_t size_ = 0u;
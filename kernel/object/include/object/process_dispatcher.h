@@ -180,6 +180,45 @@ public:
         return ZX_OK;
     }
 
+    // Calls the provided |bool func(zx_handle_t, zx_rights_t, const Dispatcher*)|
+    // on the process's handles, oldest first, starting at |cursor| (0 for the
+    // oldest handle), until |func| returns false. Returns the cursor for the
+    // handle |func| returned false for, from which a later call resumes, or 0
+    // if every handle was visited.
+    //
+    // A cursor holds a handle's value and its position in the table. If that
+    // handle is closed before the walk resumes, the walk picks up at the same
+    // position instead, which may skip or repeat handles if others were closed
+    // too.
+    template <typename T>
+    uint64_t ForEachHandleFrom(uint64_t cursor, T func) {
+        Guard<fbl::Mutex> guard{&handle_table_lock_};
+        if (handles_.is_empty()) {
+            return 0;
+        }
+        uint32_t pos = static_cast<uint32_t>(cursor >> 32);
+        auto itr = handles_.end();
+        --itr;
+        if (cursor != 0) {
+            Handle* handle = GetHandleLocked(static_cast<zx_handle_t>(cursor),
+                                             /*skip_policy=*/true);
+            if (handle != nullptr) {
+                itr = handles_.make_iterator(*handle);
+            } else {
+                for (uint32_t i = 0; i < pos && itr.IsValid(); i++) {
+                    --itr;
+                }
+            }
+        }
+        for (; itr.IsValid(); --itr, pos++) {
+            zx_handle_t value = MapHandleToValue(&*itr);
+            if (!func(value, itr->rights(), itr->dispatcher().get())) {
+                return (static_cast<uint64_t>(pos) << 32) | value;
+            }
+        }
+        return 0;
+    }
+
     // accessors
     Lock<fbl::Mutex>* handle_table_lock() TA_RET_CAP(handle_table_lock_) {
         return &handle_table_lock_;
@@ -204,6 +243,13 @@ public:
                               size_t* actual, size_t* available);
     zx_status_t GetVmos(user_out_ptr<zx_info_vmo_t> vmos, size_t max,
                         size_t* actual, size_t* available);
+    // Paged versions of the above for zx_object_get_info_paged(). Each call
+    // writes at most |max| entries from |cursor| on, and sets |next_cursor|
+    // to where the next call should resume, or to 0 at the end.
+    zx_status_t GetAspaceMapsPaged(uint64_t cursor, zx_info_maps_t* maps, size_t max,
+                                   size_t* actual, uint64_t* next_cursor);
+    zx_status_t GetVmosPaged(uint64_t cursor, zx_info_vmo_t* vmos, size_t max,
+                             size_t* actual, uint64_t* next_cursor);
 
     zx_status_t GetThreads(fbl::Array<zx_koid_t>* threads);
 
@@ -191,6 +191,16 @@ public:
     // Profile support
     zx_status_t SetPriority(int32_t priority);
 
+    // Priority inheritance for futexes owned by this thread.  |head| is the
+    // head of the wait queue of a futex this thread starts or stops owning;
+    // see FutexNode::set_pi_owner().
+    void AddOwnedPiFutex(FutexNode* head) TA_REQ(thread_lock);
+    void RemoveOwnedPiFutex(FutexNode* head) TA_REQ(thread_lock);
+
+    // Recomputes the priority this thread inherits from the threads blocked
+    // on the futexes it still owns.
+    void UpdateFutexPriority(bool* local_resched) TA_REQ(thread_lock);
+
     // For ChannelDispatcher use.
     ChannelDispatcher::MessageWaiter* GetMessageWaiter() { return &channel_waiter_; }
 
@@ -286,6 +296,10 @@ private:
     // in order to suspend a thread.
     ChannelDispatcher::MessageWaiter channel_waiter_;
 
+    // Heads of the wait queues of the priority inheriting futexes this
+    // thread owns.  Guarded by thread_lock.
+    FutexNode::PiOwnedList owned_pi_futexes_;
+
     // LK thread structure
     // put last to ease debugging since this is a pretty large structure
     // (~1.5K on x86_64).
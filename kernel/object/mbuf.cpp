@@ -7,6 +7,9 @@
 #include <object/mbuf.h>
 
 #include <lib/user_copy/user_ptr.h>
+#include <vm/physmap.h>
+#include <vm/pmm.h>
+#include <zxcpp/new.h>
 
 #include <fbl/algorithm.h>
 #include <fbl/alloc_checker.h>
@@ -16,17 +19,28 @@
 constexpr size_t MBufChain::MBuf::kHeaderSize;
 constexpr size_t MBufChain::MBuf::kMallocSize;
 constexpr size_t MBufChain::MBuf::kPayloadSize;
+constexpr size_t MBufChain::MBuf::kPagePayloadSize;
 constexpr size_t MBufChain::kSizeMax;
+constexpr size_t MBufChain::kPageWriteThreshold;
+constexpr size_t MBufChain::kPageFreelistMax;
 
 size_t MBufChain::MBuf::rem() const {
-    return kPayloadSize - (off_ + len_);
+    return cap_ - (off_ + len_);
 }
 
 MBufChain::~MBufChain() {
-    while (!tail_.is_empty())
-        delete tail_.pop_front();
+    while (!tail_.is_empty()) {
+        MBuf* buf = tail_.pop_front();
+        if (buf->is_page()) {
+            DeletePageMBuf(buf);
+        } else {
+            delete buf;
+        }
+    }
     while (!freelist_.is_empty())
         delete freelist_.pop_front();
+    while (!page_freelist_.is_empty())
+        DeletePageMBuf(page_freelist_.pop_front());
 }
 
 bool MBufChain::is_full() const {
@@ -128,8 +142,16 @@ zx_status_t MBufChain::WriteDatagram(user_in_ptr<const void> src, size_t len,
 }
 
 zx_status_t MBufChain::WriteStream(user_in_ptr<const void> src, size_t len, size_t* written) {
+    // Store large writes a page at a time.
+    auto alloc = [this](size_t remaining) {
+        MBuf* buf = nullptr;
+        if (remaining >= kPageWriteThreshold)
+            buf = AllocPageMBuf();
+        return buf != nullptr ? buf : AllocMBuf();
+    };
+
     if (head_ == nullptr) {
-        head_ = AllocMBuf();
+        head_ = alloc(len);
         if (head_ == nullptr)
             return ZX_ERR_SHOULD_WAIT;
         tail_.push_front(head_);
@@ -138,7 +160,7 @@ zx_status_t MBufChain::WriteStream(user_in_ptr<const void> src, size_t len, size
     size_t pos = 0;
     while (pos < len) {
         if (head_->rem() == 0) {
-            auto next = AllocMBuf();
+            auto next = alloc(len - pos);
             if (next == nullptr)
                 break;
             tail_.insert_after(tail_.make_iterator(*head_), next);
@@ -174,8 +196,38 @@ MBufChain::MBuf* MBufChain::AllocMBuf() {
     return freelist_.pop_front();
 }
 
+MBufChain::MBuf* MBufChain::AllocPageMBuf() {
+    if (!page_freelist_.is_empty()) {
+        page_freelist_len_--;
+        return page_freelist_.pop_front();
+    }
+
+    vm_page_t* page;
+    paddr_t pa;
+    if (pmm_alloc_page(0, &page, &pa) != ZX_OK)
+        return nullptr;
+    DEBUG_ASSERT(page->state == VM_PAGE_STATE_ALLOC);
+    page->state = VM_PAGE_STATE_IPC;
+    return new (paddr_to_physmap(pa)) MBuf(MBuf::kPagePayloadSize);
+}
+
+void MBufChain::DeletePageMBuf(MBuf* buf) {
+    DEBUG_ASSERT(buf->is_page());
+    vm_page_t* page = paddr_to_vm_page(physmap_to_paddr(buf));
+    buf->~MBuf();
+    pmm_free_page(page);
+}
+
 void MBufChain::FreeMBuf(MBuf* buf) {
     buf->off_ = 0u;
     buf->len_ = 0u;
-    freelist_.push_front(buf);
+    buf->pkt_len_ = 0u;
+    if (!buf->is_page()) {
+        freelist_.push_front(buf);
+    } else if (page_freelist_len_ < kPageFreelistMax) {
+        page_freelist_.push_front(buf);
+        page_freelist_len_++;
+    } else {
+        DeletePageMBuf(buf);
+    }
 }
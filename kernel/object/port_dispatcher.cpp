@@ -270,6 +270,10 @@ zx_status_t PortDispatcher::Queue(PortPacket* port_packet, zx_signals_t observed
         }
         port_packet->packet.signal.observed = observed;
         port_packet->packet.signal.count = count;
+    } else if (port_packet->InContainer()) {
+        // A packet owned by its source, such as a guest doorbell, is only
+        // queued once until it is dequeued.
+        return ZX_OK;
     }
     packets_.push_back(port_packet);
     ++num_packets_;
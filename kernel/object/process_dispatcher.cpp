@@ -593,6 +593,43 @@ zx_status_t ProcessDispatcher::GetVmos(
     return ZX_OK;
 }
 
+zx_status_t ProcessDispatcher::GetAspaceMapsPaged(
+    uint64_t cursor, zx_info_maps_t* maps, size_t max,
+    size_t* actual, uint64_t* next_cursor) {
+    Guard<fbl::Mutex> guard{get_lock()};
+    if (state_ != State::RUNNING) {
+        return ZX_ERR_BAD_STATE;
+    }
+    return GetVmAspaceMapsPaged(aspace_, cursor, maps, max, actual, next_cursor);
+}
+
+// The paged ZX_INFO_PROCESS_VMOS walk goes through the handle table and then
+// the address space. Cursors into the address space have the top bit set.
+static constexpr uint64_t kVmosCursorMappings = 1ull << 63;
+
+zx_status_t ProcessDispatcher::GetVmosPaged(
+    uint64_t cursor, zx_info_vmo_t* vmos, size_t max,
+    size_t* actual, uint64_t* next_cursor) {
+    Guard<fbl::Mutex> guard{get_lock()};
+    if (state_ != State::RUNNING) {
+        return ZX_ERR_BAD_STATE;
+    }
+    if (!(cursor & kVmosCursorMappings)) {
+        zx_status_t s = GetProcessVmosViaHandlesPaged(this, cursor, vmos, max,
+                                                      actual, next_cursor);
+        if (s == ZX_OK && *next_cursor == 0) {
+            *next_cursor = kVmosCursorMappings;
+        }
+        return s;
+    }
+    zx_status_t s = GetVmAspaceVmosPaged(aspace_, cursor & ~kVmosCursorMappings,
+                                         vmos, max, actual, next_cursor);
+    if (s == ZX_OK && *next_cursor != 0) {
+        *next_cursor |= kVmosCursorMappings;
+    }
+    return s;
+}
+
 zx_status_t ProcessDispatcher::GetThreads(fbl::Array<zx_koid_t>* out_threads) {
     Guard<fbl::Mutex> guard{get_lock()};
     size_t n = thread_list_.size_slow();
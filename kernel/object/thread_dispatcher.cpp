@@ -16,6 +16,7 @@
 #include <arch/debugger.h>
 #include <arch/exception.h>
 
+#include <kernel/sched.h>
 #include <kernel/thread.h>
 #include <vm/kstack.h>
 #include <vm/vm.h>
@@ -972,6 +973,32 @@ zx_status_t ThreadDispatcher::SetPriority(int32_t priority) {
     return ZX_OK;
 }
 
+void ThreadDispatcher::AddOwnedPiFutex(FutexNode* head) {
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+    owned_pi_futexes_.push_back(head);
+}
+
+void ThreadDispatcher::RemoveOwnedPiFutex(FutexNode* head) {
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+    owned_pi_futexes_.erase(*head);
+}
+
+void ThreadDispatcher::UpdateFutexPriority(bool* local_resched) {
+    DEBUG_ASSERT(spin_lock_held(&thread_lock));
+
+    // Threads that have not started yet have nothing to boost, and threads
+    // that are exiting no longer need to be.
+    if (thread_.state == THREAD_INITIAL || thread_.state == THREAD_DEATH)
+        return;
+
+    int priority = -1;
+    for (const FutexNode& head : owned_pi_futexes_) {
+        if (head.pi_priority() > priority)
+            priority = head.pi_priority();
+    }
+    sched_inherit_futex_priority(&thread_, priority, local_resched);
+}
+
 void get_user_thread_process_name(const void* user_thread,
                                   char out_name[ZX_MAX_NAME_LEN]) {
     const ThreadDispatcher* ut =
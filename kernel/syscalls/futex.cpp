@@ -9,6 +9,7 @@
 #include <trace.h>
 
 #include <object/process_dispatcher.h>
+#include <object/thread_dispatcher.h>
 #include <zircon/types.h>
 
 #include "priv.h"
@@ -39,3 +40,60 @@ zx_status_t sys_futex_requeue(user_in_ptr<const zx_futex_t> wake_ptr, uint32_t w
         wake_ptr, wake_count, current_value,
         requeue_ptr, requeue_count);
 }
+
+// Looks up the thread named by |handle| as the owner of a priority
+// inheriting futex.  ZX_HANDLE_INVALID means the futex has no owner.
+static zx_status_t get_futex_owner(zx_handle_t handle, fbl::RefPtr<ThreadDispatcher>* out) {
+    if (handle == ZX_HANDLE_INVALID)
+        return ZX_OK;
+
+    auto up = ProcessDispatcher::GetCurrent();
+    fbl::RefPtr<ThreadDispatcher> thread;
+    zx_status_t status = up->GetDispatcher(handle, &thread);
+    if (status != ZX_OK)
+        return status;
+
+    // Futexes are private to a process, and so are their owners.
+    if (thread->process() != up)
+        return ZX_ERR_INVALID_ARGS;
+
+    *out = fbl::move(thread);
+    return ZX_OK;
+}
+
+zx_status_t sys_futex_wait_pi(user_in_ptr<const zx_futex_t> value_ptr, int32_t current_value,
+                              zx_handle_t owner, zx_time_t deadline) {
+    LTRACEF("futex %p current %d owner %#x\n", value_ptr.get(), current_value, owner);
+
+    fbl::RefPtr<ThreadDispatcher> owner_thread;
+    zx_status_t status = get_futex_owner(owner, &owner_thread);
+    if (status != ZX_OK)
+        return status;
+
+    return ProcessDispatcher::GetCurrent()->futex_context()->FutexWaitPi(
+        value_ptr, current_value, fbl::move(owner_thread), deadline);
+}
+
+zx_status_t sys_futex_wake_pi(user_in_ptr<const zx_futex_t> value_ptr) {
+    LTRACEF("futex %p\n", value_ptr.get());
+
+    return ProcessDispatcher::GetCurrent()->futex_context()->FutexWakePi(value_ptr);
+}
+
+zx_status_t sys_futex_requeue_pi(user_in_ptr<const zx_futex_t> wake_ptr, uint32_t wake_count,
+                                 int32_t current_value, user_in_ptr<const zx_futex_t> requeue_ptr,
+                                 uint32_t requeue_count, zx_handle_t requeue_owner) {
+    LTRACEF("futex %p wake_count %" PRIu32 "current_value %d "
+           "requeue_futex %p requeue_count %" PRIu32 " requeue_owner %#x\n",
+           wake_ptr.get(), wake_count, current_value, requeue_ptr.get(), requeue_count,
+           requeue_owner);
+
+    fbl::RefPtr<ThreadDispatcher> owner_thread;
+    zx_status_t status = get_futex_owner(requeue_owner, &owner_thread);
+    if (status != ZX_OK)
+        return status;
+
+    return ProcessDispatcher::GetCurrent()->futex_context()->FutexRequeuePi(
+        wake_ptr, wake_count, current_value,
+        requeue_ptr, requeue_count, fbl::move(owner_thread));
+}
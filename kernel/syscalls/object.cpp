@@ -12,6 +12,7 @@
 #include <kernel/stats.h>
 #include <kernel/thread_lock.h>
 #include <lib/heap.h>
+#include <lib/latency_histogram.h>
 #include <platform.h>
 #include <vm/pmm.h>
 #include <vm/vm.h>
@@ -30,7 +31,10 @@
 #include <object/vm_address_region_dispatcher.h>
 #include <object/vm_object_dispatcher.h>
 
+#include <fbl/algorithm.h>
+#include <fbl/alloc_checker.h>
 #include <fbl/ref_ptr.h>
+#include <fbl/unique_ptr.h>
 
 #include "priv.h"
 
@@ -112,6 +116,48 @@ zx_status_t single_record_result(user_out_ptr<void> _buffer, size_t buffer_size,
     return ZX_OK;
 }
 
+// zx_object_get_info_paged() gathers entries in batches of this size, and
+// only holds the locks needed to gather them for one batch at a time.
+constexpr size_t kInfoPageBatch = 32;
+
+// Calls |get_page| to fill the user buffer a batch at a time, copying each
+// batch out with no locks held.
+template <typename T, typename F>
+zx_status_t CopyInfoPages(F get_page, uint64_t cursor,
+                          user_out_ptr<void> _buffer, size_t buffer_size,
+                          user_out_ptr<size_t> _actual,
+                          user_out_ptr<uint64_t> _next_cursor) {
+    const size_t count = buffer_size / sizeof(T);
+    if (count == 0)
+        return ZX_ERR_BUFFER_TOO_SMALL;
+
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<T[]> batch(new (&ac) T[kInfoPageBatch]);
+    if (!ac.check())
+        return ZX_ERR_NO_MEMORY;
+
+    auto entries = _buffer.reinterpret<T>();
+    size_t total = 0;
+    do {
+        size_t actual = 0;
+        zx_status_t status = get_page(cursor, batch.get(),
+                                      fbl::min(kInfoPageBatch, count - total),
+                                      &actual, &cursor);
+        if (status != ZX_OK)
+            return status;
+        if (entries.copy_array_to_user(batch.get(), actual, total) != ZX_OK)
+            return ZX_ERR_INVALID_ARGS;
+        total += actual;
+    } while (cursor != 0 && total < count);
+
+    if (_actual) {
+        zx_status_t status = _actual.copy_to_user(total);
+        if (status != ZX_OK)
+            return status;
+    }
+    return _next_cursor.copy_to_user(cursor);
+}
+
 } // namespace
 
 // actual is an optional return parameter for the number of records returned
@@ -631,7 +677,91 @@ zx_status_t sys_object_get_info(zx_handle_t handle, uint32_t topic,
         return single_record_result(
             _buffer, buffer_size, _actual, _avail, &info, sizeof(info));
     }
+    case ZX_INFO_LATENCY_HISTOGRAMS: {
+        auto status = validate_resource(handle, ZX_RSRC_KIND_ROOT);
+        if (status != ZX_OK)
+            return status;
 
+        static_assert(ZX_LATENCY_HISTOGRAM_BUCKETS == LatencyHistogram::kBuckets,
+                      "histogram buckets must match");
+
+        size_t num_space_for = buffer_size / sizeof(zx_info_latency_histogram_t);
+        user_out_ptr<zx_info_latency_histogram_t> hist_buf =
+            _buffer.reinterpret<zx_info_latency_histogram_t>();
+
+        size_t count = 0;
+        for (auto hist = LatencyHistogram::First(); hist != nullptr; hist = hist->Next()) {
+            for (size_t row = 0; row != hist->num_rows(); ++row, ++count) {
+                if (count >= num_space_for)
+                    continue;
+
+                zx_info_latency_histogram_t info = {};
+                strlcpy(info.group, hist->group(), sizeof(info.group));
+                strlcpy(info.name, hist->RowName(row), sizeof(info.name));
+                hist->Read(row, info.buckets);
+
+                // copy out one at a time
+                if (hist_buf.copy_array_to_user(&info, 1, count) != ZX_OK)
+                    return ZX_ERR_INVALID_ARGS;
+            }
+        }
+
+        if (_actual) {
+            zx_status_t status = _actual.copy_to_user(MIN(count, num_space_for));
+            if (status != ZX_OK)
+                return status;
+        }
+        if (_avail) {
+            zx_status_t status = _avail.copy_to_user(count);
+            if (status != ZX_OK)
+                return status;
+        }
+        return ZX_OK;
+    }
+
+    default:
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+}
+
+zx_status_t sys_object_get_info_paged(zx_handle_t handle, uint32_t topic, uint64_t cursor,
+                                      user_out_ptr<void> _buffer, size_t buffer_size,
+                                      user_out_ptr<size_t> _actual,
+                                      user_out_ptr<uint64_t> _next_cursor) {
+    LTRACEF("handle %x topic %u cursor %#" PRIx64 "\n", handle, topic, cursor);
+
+    ProcessDispatcher* up = ProcessDispatcher::GetCurrent();
+
+    // Unlike zx_object_get_info(), these topics may be read from the calling
+    // process: nothing is copied to the user buffer while the process's
+    // locks are held.
+    switch (topic) {
+    case ZX_INFO_PROCESS_MAPS: {
+        fbl::RefPtr<ProcessDispatcher> process;
+        zx_status_t status =
+            up->GetDispatcherWithRights(handle, ZX_RIGHT_INSPECT, &process);
+        if (status != ZX_OK)
+            return status;
+        return CopyInfoPages<zx_info_maps_t>(
+            [&process](uint64_t cursor, zx_info_maps_t* maps, size_t max,
+                       size_t* actual, uint64_t* next_cursor) {
+                return process->GetAspaceMapsPaged(cursor, maps, max, actual, next_cursor);
+            },
+            cursor, _buffer, buffer_size, _actual, _next_cursor);
+    }
+    case ZX_INFO_PROCESS_VMOS: {
+        fbl::RefPtr<ProcessDispatcher> process;
+        zx_status_t status =
+            up->GetDispatcherWithRights(handle, ZX_RIGHT_INSPECT, &process);
+        if (status != ZX_OK)
+            return status;
+        return CopyInfoPages<zx_info_vmo_t>(
+            [&process](uint64_t cursor, zx_info_vmo_t* vmos, size_t max,
+                       size_t* actual, uint64_t* next_cursor) {
+                return process->GetVmosPaged(cursor, vmos, max, actual, next_cursor);
+            },
+            cursor, _buffer, buffer_size, _actual, _next_cursor);
+    }
     default:
         return ZX_ERR_NOT_SUPPORTED;
     }
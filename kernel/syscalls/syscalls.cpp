@@ -8,6 +8,7 @@
 #include <kernel/stats.h>
 #include <kernel/thread.h>
 #include <lib/ktrace.h>
+#include <lib/latency_histogram.h>
 #include <lib/vdso.h>
 #include <object/process_dispatcher.h>
 #include <platform.h>
@@ -31,6 +32,22 @@ int sys_invalid_syscall(uint64_t num, uint64_t pc,
     return ZX_ERR_BAD_SYSCALL;
 }
 
+// Generated table of syscall numbers and names.
+static const struct {
+    uint32_t id;
+    uint32_t nargs;
+    const char* name;
+} syscall_info[] = {
+#include <zircon/syscall-ktrace-info.inc>
+};
+static_assert(countof(syscall_info) == ZX_SYS_COUNT, "syscall numbers must be dense");
+
+static const char* syscall_name(size_t num) {
+    return syscall_info[num].name;
+}
+
+LATENCY_HISTOGRAM(syscall_latency, "syscall", ZX_SYS_COUNT, syscall_name);
+
 // N.B. Interrupts must be disabled on entry and they will be disabled on exit.
 // The reason is the two calls two arch_curr_cpu_num in the ktrace calls: we
 // don't want the cpu changing during the call.
@@ -42,6 +59,8 @@ inline syscall_result do_syscall(uint64_t syscall_num, uint64_t pc,
 
     CPU_STATS_INC(syscalls);
 
+    const zx_ticks_t start = current_ticks();
+
     /* re-enable interrupts to maintain kernel preemptiveness
        This must be done after the above ktrace_tiny call, and after the
        above CPU_STATS_INC call as it also calls arch_curr_cpu_num. */
@@ -68,6 +87,9 @@ inline syscall_result do_syscall(uint64_t syscall_num, uint64_t pc,
 
     ktrace_tiny(TAG_SYSCALL_EXIT, (static_cast<uint32_t>(syscall_num << 8)) | arch_curr_cpu_num());
 
+    // Unknown syscall numbers fall outside the histogram and are dropped.
+    syscall_latency.Add(syscall_num, current_ticks() - start);
+
     // The assembler caller will re-disable interrupts at the appropriate time.
     return {ret, thread_is_signaled(get_current_thread())};
 }
@@ -18,6 +18,7 @@
 #include <kernel/thread.h>
 #include <lib/crypto/global_prng.h>
 #include <lib/user_copy/user_ptr.h>
+#include <lib/vdso.h>
 #include <object/event_dispatcher.h>
 #include <object/event_pair_dispatcher.h>
 #include <object/handle.h>
@@ -28,6 +29,8 @@
 
 #include <fbl/alloc_checker.h>
 #include <fbl/atomic.h>
+#include <fbl/auto_lock.h>
+#include <fbl/mutex.h>
 #include <fbl/ref_ptr.h>
 
 #include <zircon/syscalls/log.h>
@@ -62,7 +65,11 @@ zx_status_t sys_nanosleep(zx_time_t deadline) {
 // update pvclock too.
 fbl::atomic<int64_t> utc_offset;
 
-zx_time_t sys_clock_get(zx_clock_t clock_id) {
+// Serializes updates to utc_offset, so that the vDSO's copy of it
+// always ends up matching.
+static fbl::Mutex utc_offset_lock;
+
+zx_time_t sys_clock_get_via_kernel(zx_clock_t clock_id) {
     switch (clock_id) {
     case ZX_CLOCK_MONOTONIC:
         return current_time();
@@ -76,7 +83,7 @@ zx_time_t sys_clock_get(zx_clock_t clock_id) {
     }
 }
 
-zx_status_t sys_clock_get_new(zx_clock_t clock_id, user_out_ptr<zx_time_t> out_time) {
+zx_status_t sys_clock_get_new_via_kernel(zx_clock_t clock_id, user_out_ptr<zx_time_t> out_time) {
     zx_time_t time;
     switch (clock_id) {
     case ZX_CLOCK_MONOTONIC:
@@ -95,7 +102,7 @@ zx_status_t sys_clock_get_new(zx_clock_t clock_id, user_out_ptr<zx_time_t> out_t
     return out_time.copy_to_user(time);
 }
 
-zx_time_t sys_clock_get_monotonic() {
+zx_time_t sys_clock_get_monotonic_via_kernel() {
     return current_time();
 }
 
@@ -109,9 +116,12 @@ zx_status_t sys_clock_adjust(zx_handle_t hrsrc, zx_clock_t clock_id, int64_t off
     switch (clock_id) {
     case ZX_CLOCK_MONOTONIC:
         return ZX_ERR_ACCESS_DENIED;
-    case ZX_CLOCK_UTC:
+    case ZX_CLOCK_UTC: {
+        fbl::AutoLock lock(&utc_offset_lock);
         utc_offset.store(offset);
+        VDso::SetUtcOffset(offset);
         return ZX_OK;
+    }
     default:
         return ZX_ERR_INVALID_ARGS;
     }
@@ -254,9 +264,8 @@ zx_status_t sys_cprng_draw_once(user_out_ptr<void> buffer, size_t len) {
     // Ensure we get rid of the stack copy of the random data as this function returns.
     explicit_memory::ZeroDtor<uint8_t> zero_guard(kernel_buf, sizeof(kernel_buf));
 
-    auto prng = crypto::GlobalPRNG::GetInstance();
-    ASSERT(prng->is_thread_safe());
-    prng->Draw(kernel_buf, len);
+    ASSERT(crypto::GlobalPRNG::GetInstance()->is_thread_safe());
+    crypto::GlobalPRNG::DrawPerCpu(kernel_buf, len);
 
     if (buffer.copy_array_to_user(kernel_buf, len) != ZX_OK)
         return ZX_ERR_INVALID_ARGS;
@@ -275,9 +284,8 @@ zx_status_t sys_cprng_add_entropy(user_in_ptr<const void> buffer, size_t len) {
     if (buffer.copy_array_from_user(kernel_buf, len) != ZX_OK)
         return ZX_ERR_INVALID_ARGS;
 
-    auto prng = crypto::GlobalPRNG::GetInstance();
-    ASSERT(prng->is_thread_safe());
-    prng->AddEntropy(kernel_buf, len);
+    ASSERT(crypto::GlobalPRNG::GetInstance()->is_thread_safe());
+    crypto::GlobalPRNG::AddEntropy(kernel_buf, len);
 
     return ZX_OK;
 }
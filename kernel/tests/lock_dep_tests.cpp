@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 #include <fbl/mutex.h>
+#include <lib/lock_profile.h>
 #include <lib/unittest/unittest.h>
 #include <lockdep/guard_multiple.h>
 #include <lockdep/lockdep.h>
@@ -228,6 +229,12 @@ struct Number {
     void TestExclude() __TA_EXCLUDES(lock) {}
 };
 
+// Lock class only used by the profiling test, so that the counts it sees are
+// not affected by the other tests.
+struct Profiled {
+    LOCK_DEP_INSTRUMENT(Profiled, Mutex) lock;
+};
+
 lockdep::LockResult GetLastResult() {
 #if WITH_LOCK_DEP
     lockdep::ThreadLockState* state = lockdep::ThreadLockState::Get();
@@ -714,9 +721,45 @@ static bool lock_dep_static_analysis_tests() {
     END_TEST;
 }
 
+static bool lock_dep_profile_tests() {
+    BEGIN_TEST;
+
+    using lockdep::Guard;
+    using lockdep::LockProfileStats;
+    using test::Mutex;
+    using test::Profiled;
+
+    using ProfiledLockClass = decltype(Profiled::lock)::LockClass<>;
+    LockProfileStats before{};
+    zx_status_t status = lockdep::GetLockProfileStats(ProfiledLockClass::Id(), &before);
+#if WITH_LOCK_PROFILING
+    ASSERT_EQ(ZX_OK, status, "");
+
+    constexpr unsigned kIterations = 16;
+    Profiled a{};
+    for (unsigned i = 0; i < kIterations; i++) {
+        Guard<Mutex> guard{&a.lock};
+    }
+
+    // Acquisitions are counted on whichever cpu they happened, but nothing
+    // else uses this lock class so the sum must have moved by exactly this
+    // much.
+    LockProfileStats after{};
+    ASSERT_EQ(ZX_OK, lockdep::GetLockProfileStats(ProfiledLockClass::Id(), &after), "");
+    EXPECT_EQ(before.acquisitions + kIterations, after.acquisitions, "");
+    EXPECT_LE(after.contended, after.acquisitions, "");
+    EXPECT_GE(after.total_wait, before.total_wait, "");
+#else
+    EXPECT_EQ(ZX_ERR_NOT_SUPPORTED, status, "");
+#endif
+
+    END_TEST;
+}
+
 UNITTEST_START_TESTCASE(lock_dep_tests)
 UNITTEST("lock_dep_dynamic_analysis_tests", lock_dep_dynamic_analysis_tests)
 UNITTEST("lock_dep_static_analysis_tests", lock_dep_static_analysis_tests)
+UNITTEST("lock_dep_profile_tests", lock_dep_profile_tests)
 UNITTEST_END_TESTCASE(lock_dep_tests, "lock_dep_tests", "lock_dep_tests");
 
 #endif
@@ -256,7 +256,7 @@ protected:
     size_t AllocatedPagesLocked() const override;
     // Used to implement VmAspace::EnumerateChildren.
     // |aspace_->lock()| must be held.
-    virtual bool EnumerateChildrenLocked(VmEnumerator* ve, uint depth);
+    virtual bool EnumerateChildrenLocked(VmEnumerator* ve, uint depth, vaddr_t min_addr);
 
     friend class VmMapping;
     // Remove *region* from the subregion list
@@ -412,7 +412,7 @@ public:
         return;
     }
 
-    bool EnumerateChildrenLocked(VmEnumerator* ve, uint depth) override {
+    bool EnumerateChildrenLocked(VmEnumerator* ve, uint depth, vaddr_t min_addr) override {
         return false;
     }
 };
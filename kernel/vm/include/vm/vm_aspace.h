@@ -84,7 +84,9 @@ public:
     // Traverses the VM tree rooted at this node, in depth-first pre-order. If
     // any methods of |ve| return false, the traversal stops and this method
     // returns false. Returns true otherwise.
-    bool EnumerateChildren(VmEnumerator* ve);
+    // Subtrees that end at or below |min_addr| are skipped; the nodes that
+    // contain |min_addr| are still visited.
+    bool EnumerateChildren(VmEnumerator* ve, vaddr_t min_addr = 0);
 
     // A collection of memory usage counts.
     struct vm_usage_t {
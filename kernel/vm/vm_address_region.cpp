@@ -535,13 +535,26 @@ zx_status_t VmAddressRegion::AllocSpotLocked(size_t size, uint8_t align_pow2, ui
     return LinearRegionAllocatorLocked(size, align_pow2, arch_mmu_flags, spot);
 }
 
-bool VmAddressRegion::EnumerateChildrenLocked(VmEnumerator* ve, uint depth) {
+bool VmAddressRegion::EnumerateChildrenLocked(VmEnumerator* ve, uint depth, vaddr_t min_addr) {
     canary_.Assert();
     DEBUG_ASSERT(ve != nullptr);
     DEBUG_ASSERT(aspace_->lock()->lock().IsHeld());
 
+    // Returns the first region in |children| that ends above |min_addr|.
+    auto first_child = [min_addr](ChildList& children) {
+        auto itr = children.upper_bound(min_addr);
+        if (itr != children.begin()) {
+            auto prev = itr;
+            --prev;
+            if (min_addr - prev->base() < prev->size()) {
+                itr = prev;
+            }
+        }
+        return itr;
+    };
+
     const uint min_depth = depth;
-    for (auto itr = subregions_.begin(), end = subregions_.end(); itr != end;) {
+    for (auto itr = first_child(subregions_), end = subregions_.end(); itr != end;) {
         DEBUG_ASSERT(itr->IsAliveLocked());
         auto curr = itr++;
         VmAddressRegion* up = curr->parent_;
@@ -558,9 +571,10 @@ bool VmAddressRegion::EnumerateChildrenLocked(VmEnumerator* ve, uint depth) {
             if (!ve->OnVmAddressRegion(vmar, depth)) {
                 return false;
             }
-            if (!vmar->subregions_.is_empty()) {
+            auto child = first_child(vmar->subregions_);
+            if (child != vmar->subregions_.end()) {
                 // If the sub-VMAR is not empty, iterate through its children.
-                itr = vmar->subregions_.begin();
+                itr = child;
                 end = vmar->subregions_.end();
                 depth++;
                 continue;
@@ -575,7 +575,7 @@ void VmAspace::Dump(bool verbose) const {
     }
 }
 
-bool VmAspace::EnumerateChildren(VmEnumerator* ve) {
+bool VmAspace::EnumerateChildren(VmEnumerator* ve, vaddr_t min_addr) {
     canary_.Assert();
     DEBUG_ASSERT(ve != nullptr);
     Guard<fbl::Mutex> guard{&lock_};
@@ -587,7 +587,7 @@ bool VmAspace::EnumerateChildren(VmEnumerator* ve) {
     if (!ve->OnVmAddressRegion(root_vmar_.get(), 0)) {
         return false;
     }
-    return root_vmar_->EnumerateChildrenLocked(ve, 1);
+    return root_vmar_->EnumerateChildrenLocked(ve, 1, min_addr);
 }
 
 void DumpAllAspaces(bool verbose) {
@@ -13,7 +13,9 @@
 #include <kernel/thread_lock.h>
 #include <lib/console.h>
 #include <lib/ktrace.h>
+#include <lib/latency_histogram.h>
 #include <object/diagnostics.h>
+#include <platform.h>
 #include <string.h>
 #include <trace.h>
 #include <vm/fault.h>
@@ -40,7 +42,14 @@ void vmm_context_switch(vmm_aspace_t* oldspace, vmm_aspace_t* newaspace) {
     vmm_context_switch(reinterpret_cast<VmAspace*>(oldspace), reinterpret_cast<VmAspace*>(newaspace));
 }
 
+static const char* page_fault_row_name(size_t row) {
+    return row == 0 ? "kernel" : "user";
+}
+
+LATENCY_HISTOGRAM(page_fault_latency, "page_fault", 2, page_fault_row_name);
+
 zx_status_t vmm_page_fault_handler(vaddr_t addr, uint flags) {
+    const zx_ticks_t start = current_ticks();
 
     // hardware fault, mark it as such
     flags |= VMM_PF_FLAG_HW_FAULT;
@@ -71,6 +80,7 @@ zx_status_t vmm_page_fault_handler(vaddr_t addr, uint flags) {
     }
 
     ktrace(TAG_PAGE_FAULT_EXIT, (uint32_t)(addr >> 32), (uint32_t)addr, flags, arch_curr_cpu_num());
+    page_fault_latency.Add((flags & VMM_PF_FLAG_USER) ? 1 : 0, current_ticks() - start);
 
     return status;
 }
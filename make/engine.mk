@@ -27,6 +27,7 @@ ENABLE_INSTALL_SAMPLES ?= false
 ENABLE_NEW_BOOTDATA := true
 ENABLE_LOCK_DEP ?= false
 ENABLE_LOCK_DEP_TESTS ?= $(ENABLE_LOCK_DEP)
+ENABLE_LOCK_PROFILING ?= false
 DISABLE_UTEST ?= false
 ENABLE_ULIB_ONLY ?= false
 USE_ASAN ?= false
@@ -412,6 +413,14 @@ KERNEL_DEFINES += WITH_LOCK_DEP=1
 KERNEL_DEFINES += LOCK_DEP_ENABLE_VALIDATION=1
 endif
 
+# Kernel lock contention profiling. This is independent of lock validation and
+# can be enabled without it, which keeps the validator's overhead out of the
+# measurements.
+ifeq ($(call TOBOOL,$(ENABLE_LOCK_PROFILING)),true)
+KERNEL_DEFINES += WITH_LOCK_PROFILING=1
+KERNEL_DEFINES += LOCK_DEP_ENABLE_PROFILING=1
+endif
+
 # Kernel lock dependency tracking tests. By default this is enabled when
 # tracking is enabled, but can also be eanbled independently to assess whether
 # the tests build and *fail correctly* when lockdep is disabled.
@@ -158,7 +158,11 @@ typedef struct cpuperf_device {
 } cpuperf_device_t;
 
 static bool ipm_supported = false;
+// True if there is no usable PMU and only timer driven sampling
+// (|cpuperf_config_t.timer_period|) is available.
+static bool ipm_timer_only = false;
 // This is only valid if |ipm_supported| is true.
+// If |ipm_timer_only| is true this is all zeros, so any counter is rejected.
 static zx_x86_ipm_properties_t ipm_properties;
 
 // maximum space, in bytes, for trace buffers (per cpu)
@@ -174,18 +178,25 @@ void cpuperf_init_once(void)
         zx_mtrace_control(resource, MTRACE_KIND_CPUPERF, MTRACE_CPUPERF_GET_PROPERTIES,
                           0, &props, sizeof(props));
     if (status != ZX_OK) {
-        if (status == ZX_ERR_NOT_SUPPORTED)
-            zxlogf(INFO, "%s: No PM support\n", __func__);
-        else
+        if (status == ZX_ERR_NOT_SUPPORTED) {
+            zxlogf(INFO, "%s: No PM support, only timer sampling available\n",
+                   __func__);
+            ipm_supported = true;
+            ipm_timer_only = true;
+        } else {
             zxlogf(INFO, "%s: Error %d fetching ipm properties\n",
                    __func__, status);
+        }
         return;
     }
 
     // Skylake supports version 4. KISS and begin with that.
     // Note: This should agree with the kernel driver's check.
     if (props.pm_version < 4) {
-        zxlogf(INFO, "%s: PM version 4 or above is required\n", __func__);
+        zxlogf(INFO, "%s: PM version 4 or above is required"
+               ", only timer sampling available\n", __func__);
+        ipm_supported = true;
+        ipm_timer_only = true;
         return;
     }
 
@@ -290,6 +301,7 @@ static zx_status_t ipm_get_properties(cpu_trace_device_t* dev,
 
     memset(&props, 0, sizeof(props));
     props.api_version = CPUPERF_API_VERSION;
+    // In timer-only mode all of the following are zero.
     props.pm_version = ipm_properties.pm_version;
     // To the arch-independent API, the misc events on Intel are currently
     // all "fixed" in the sense that they don't occupy a limited number of
@@ -507,6 +519,9 @@ static zx_status_t ipm_stage_fixed_config(const cpuperf_config_t* icfg,
         ocfg->fixed_flags[ss->num_fixed] |= IPM_CONFIG_FLAG_TIMEBASE;
     if (icfg->flags[ii] & CPUPERF_CONFIG_FLAG_PC)
         ocfg->fixed_flags[ss->num_fixed] |= IPM_CONFIG_FLAG_PC;
+    // The stack record includes the pc.
+    if (icfg->flags[ii] & CPUPERF_CONFIG_FLAG_STACK)
+        ocfg->fixed_flags[ss->num_fixed] |= IPM_CONFIG_FLAG_STACK | IPM_CONFIG_FLAG_PC;
 
     ++ss->num_fixed;
     return ZX_OK;
@@ -589,6 +604,9 @@ static zx_status_t ipm_stage_programmable_config(const cpuperf_config_t* icfg,
         ocfg->programmable_flags[ss->num_programmable] |= IPM_CONFIG_FLAG_TIMEBASE;
     if (icfg->flags[ii] & CPUPERF_CONFIG_FLAG_PC)
         ocfg->programmable_flags[ss->num_programmable] |= IPM_CONFIG_FLAG_PC;
+    // The stack record includes the pc.
+    if (icfg->flags[ii] & CPUPERF_CONFIG_FLAG_STACK)
+        ocfg->programmable_flags[ss->num_programmable] |= IPM_CONFIG_FLAG_STACK | IPM_CONFIG_FLAG_PC;
 
     ++ss->num_programmable;
     return ZX_OK;
@@ -721,7 +739,11 @@ static zx_status_t ipm_stage_config(cpu_trace_device_t* dev,
         if (icfg->flags[ii] & CPUPERF_CONFIG_FLAG_TIMEBASE0)
             ss->have_timebase0_user = true;
     }
-    if (ii == 0) {
+    if (icfg->timer_period < 0) {
+        zxlogf(ERROR, "%s: Invalid timer period\n", __func__);
+        return ZX_ERR_INVALID_ARGS;
+    }
+    if (ii == 0 && icfg->timer_period == 0) {
         zxlogf(ERROR, "%s: No events provided\n", __func__);
         return ZX_ERR_INVALID_ARGS;
     }
@@ -738,13 +760,18 @@ static zx_status_t ipm_stage_config(cpu_trace_device_t* dev,
         ocfg->timebase_id = icfg->events[0];
     }
 
+    ocfg->timer_period = icfg->timer_period;
+
 #if TRY_FREEZE_ON_PMI
-    ocfg->debug_ctrl |= IA32_DEBUGCTL_FREEZE_PERFMON_ON_PMI_MASK;
+    // There's nothing to freeze without a PMU, and the kernel rejects
+    // any h/w configuration in that case.
+    if (!ipm_timer_only)
+        ocfg->debug_ctrl |= IA32_DEBUGCTL_FREEZE_PERFMON_ON_PMI_MASK;
 #endif
 
     // Require something to be enabled in order to start tracing.
     // This is mostly a sanity check.
-    if (per_trace->config.global_ctrl == 0) {
+    if (per_trace->config.global_ctrl == 0 && ocfg->timer_period == 0) {
         zxlogf(ERROR, "%s: Requested config doesn't collect any data\n",
                __func__);
         return ZX_ERR_INVALID_ARGS;
@@ -798,7 +825,8 @@ static zx_status_t ipm_start(cpu_trace_device_t* dev) {
 
     // |per_trace->configured| should not have been set if there's nothing
     // to trace.
-    assert(per_trace->config.global_ctrl != 0);
+    assert(per_trace->config.global_ctrl != 0 ||
+           per_trace->config.timer_period != 0);
 
     zx_handle_t resource = get_root_resource();
 
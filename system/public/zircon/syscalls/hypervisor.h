@@ -17,6 +17,7 @@ typedef uint32_t zx_guest_trap_t;
 #define ZX_GUEST_TRAP_BELL ((zx_guest_trap_t) 0u)
 #define ZX_GUEST_TRAP_MEM  ((zx_guest_trap_t) 1u)
 #define ZX_GUEST_TRAP_IO   ((zx_guest_trap_t) 2u)
+#define ZX_GUEST_TRAP_BELL_COALESCED ((zx_guest_trap_t) 3u)
 
 typedef uint32_t zx_vcpu_t;
 
@@ -36,6 +36,7 @@ typedef uint32_t zx_object_info_topic_t;
 #define ZX_INFO_PROCESS_HANDLE_STATS    ((zx_object_info_topic_t) 21u) // zx_info_process_handle_stats_t[1]
 #define ZX_INFO_SOCKET                  ((zx_object_info_topic_t) 22u) // zx_info_socket_t[1]
 #define ZX_INFO_VMO                     ((zx_object_info_topic_t) 23u) // zx_info_vmo_t[1]
+#define ZX_INFO_LATENCY_HISTOGRAMS      ((zx_object_info_topic_t) 24u) // zx_info_latency_histogram_t[n]
 
 typedef uint32_t zx_obj_props_t;
 #define ZX_OBJ_PROP_NONE                ((zx_obj_props_t)0u)
@@ -382,6 +383,20 @@ typedef struct zx_info_resource {
     char name[ZX_MAX_NAME_LEN];
 } zx_info_resource_t;
 
+#define ZX_LATENCY_HISTOGRAM_BUCKETS 32
+
+// How long the kernel took to do one kind of operation, summed over all cpus.
+typedef struct zx_info_latency_histogram {
+    // The kind of operation, e.g. "syscall", "page_fault" or "vcpu_exit".
+    char group[ZX_MAX_NAME_LEN];
+    // The operation within |group|, e.g. "channel_write".
+    char name[ZX_MAX_NAME_LEN];
+    // buckets[0] counts operations that took 0 ticks, and buckets[n] counts
+    // operations that took [2^(n-1), 2^n) ticks. The last bucket also counts
+    // anything longer. Use zx_ticks_per_second() to convert to time.
+    uint64_t buckets[ZX_LATENCY_HISTOGRAM_BUCKETS];
+} zx_info_latency_histogram_t;
+
 #define ZX_INFO_CPU_STATS_FLAG_ONLINE       (1u<<0)
 
 // Object properties.
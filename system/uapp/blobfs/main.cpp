@@ -3,6 +3,7 @@
 // found in the LICENSE file.
 
 #include <dirent.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
 #include <libgen.h>
@@ -17,6 +18,7 @@
 #include <lib/zx/channel.h>
 #include <blobfs/blobfs.h>
 #include <blobfs/fsck.h>
+#include <fbl/algorithm.h>
 #include <fbl/auto_call.h>
 #include <fbl/string.h>
 #include <fbl/unique_fd.h>
@@ -26,9 +28,14 @@
 #include <trace-provider/provider.h>
 #include <zircon/process.h>
 #include <zircon/processargs.h>
+#include <zircon/syscalls.h>
 
 namespace {
 
+// The most threads which dispatch requests to the filesystem. Every thread
+// which touches the block device holds one of its few transaction groups.
+constexpr uint32_t kMaxDispatchThreads = 4;
+
 int Mount(fbl::unique_fd fd, blobfs::MountOptions* options) {
     if (!options->readonly) {
         block_info_t block_info;
@@ -54,7 +61,19 @@ int Mount(fbl::unique_fd fd, blobfs::MountOptions* options) {
                             fbl::move(root), fbl::move(loop_quit)) != ZX_OK) {
         return -1;
     }
+
+    // Serve requests on this thread, and on one more per spare CPU.
+    uint32_t threads = fbl::min(zx_system_get_num_cpus(), kMaxDispatchThreads);
+    for (uint32_t i = 1; i < threads; i++) {
+        zx_status_t status = loop.StartThread("blobfs-dispatch");
+        if (status != ZX_OK) {
+            FS_TRACE_ERROR("blobfs: Failed to start dispatch thread: %d\n", status);
+            break;
+        }
+    }
+
     loop.Run();
+    loop.JoinThreads();
     return ZX_OK;
 }
 
@@ -97,6 +116,8 @@ int usage() {
             "\n"
             "options: -r|--readonly  Mount filesystem read-only\n"
             "         -m|--metrics   Collect filesystem metrics\n"
+            "         -c|--cache-size <MB>\n"
+            "                        Memory kept for the data of closed blobs\n"
             "         -h|--help      Display this message\n"
             "\n"
             "On Fuchsia, blobfs takes the block device argument by handle.\n"
@@ -117,11 +138,12 @@ int ProcessArgs(int argc, char** argv, CommandFunction* func, blobfs::MountOptio
         static struct option opts[] = {
             {"readonly", no_argument, nullptr, 'r'},
             {"metrics", no_argument, nullptr, 'm'},
+            {"cache-size", required_argument, nullptr, 'c'},
             {"help", no_argument, nullptr, 'h'},
             {nullptr, 0, nullptr, 0},
         };
         int opt_index;
-        int c = getopt_long(argc, argv, "rmh", opts, &opt_index);
+        int c = getopt_long(argc, argv, "rmc:h", opts, &opt_index);
         if (c < 0) {
             break;
         }
@@ -132,6 +154,18 @@ int ProcessArgs(int argc, char** argv, CommandFunction* func, blobfs::MountOptio
         case 'm':
             options->metrics = true;
             break;
+        case 'c': {
+            char* end;
+            errno = 0;
+            uint64_t mb = strtoull(optarg, &end, 0);
+            if (errno != 0 || end == optarg || *end != '\0' || optarg[0] == '-' ||
+                mb > (UINT64_MAX >> 20)) {
+                fprintf(stderr, "blobfs: invalid cache size: %s\n", optarg);
+                return usage();
+            }
+            options->cache_size = mb << 20;
+            break;
+        }
         case 'h':
         default:
             return usage();
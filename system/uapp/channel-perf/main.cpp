@@ -9,6 +9,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <threads.h>
 
 #include <fbl/algorithm.h>
 #include <fbl/unique_ptr.h>
@@ -114,6 +115,119 @@ void do_test(uint32_t duration_sec, const TestArgs& test_args) {
            test_args.size, test_args.handles, test_args.queue, its_per_second);
 }
 
+struct CallServerArgs {
+    zx_handle_t channel;
+    uint32_t size;
+    uint32_t handles;
+};
+
+// Echoes every message back to the caller until the channel is closed.
+// Messages start with the txid, so the echo is the reply to the call.
+int call_server(void* arg) {
+    const CallServerArgs* args = static_cast<const CallServerArgs*>(arg);
+
+    fbl::unique_ptr<uint8_t[]> data(new uint8_t[args->size]);
+    fbl::unique_ptr<zx_handle_t[]> handles;
+    if (args->handles)
+        handles.reset(new zx_handle_t[args->handles]);
+
+    for (;;) {
+        zx_signals_t pending;
+        zx_status_t status = zx_object_wait_one(args->channel,
+                                                ZX_CHANNEL_READABLE | ZX_CHANNEL_PEER_CLOSED,
+                                                ZX_TIME_INFINITE, &pending);
+        if (status != ZX_OK || !(pending & ZX_CHANNEL_READABLE))
+            break;
+
+        uint32_t r_size, r_handles;
+        status = zx_channel_read(args->channel, 0u, data.get(), handles.get(), args->size,
+                                 args->handles, &r_size, &r_handles);
+        assert(status == ZX_OK);
+        status = zx_channel_write(args->channel, 0u, data.get(), r_size,
+                                  handles.get(), r_handles);
+        assert(status == ZX_OK);
+    }
+    return 0;
+}
+
+// Measures the round-trip latency of zx_channel_call() to a server thread
+// that blocks waiting for each request.
+void do_call_test(uint32_t duration_sec, const TestArgs& test_args) {
+    __UNUSED zx_status_t status;
+
+    zx_duration_t duration_ns = ZX_SEC(duration_sec);
+
+    // The first four bytes of each message hold the txid.
+    uint32_t size = fbl::max(test_args.size, static_cast<uint32_t>(sizeof(zx_txid_t)));
+
+    // We'll call on mp[0], and the server will reply on mp[1].
+    zx_handle_t mp[2] = {ZX_HANDLE_INVALID, ZX_HANDLE_INVALID};
+    status = zx_channel_create(0u, &mp[0], &mp[1]);
+    assert(status == ZX_OK);
+
+    // We'll send/receive duplicates of this handle.
+    zx_handle_t event;
+    assert(zx_event_create(0u, &event) == ZX_OK);
+
+    fbl::unique_ptr<uint8_t[]> data(new uint8_t[size]);
+    fbl::unique_ptr<zx_handle_t[]> handles;
+    if (test_args.handles)
+        handles.reset(new zx_handle_t[test_args.handles]);
+    duplicate_handles(test_args.handles, event, handles.get());
+
+    CallServerArgs server_args = {mp[1], size, test_args.handles};
+    thrd_t server;
+    __UNUSED int rc = thrd_create(&server, call_server, &server_args);
+    assert(rc == thrd_success);
+
+    // The reply lands in the same buffers, ready to be sent again.
+    zx_channel_call_args_t args = {
+        data.get(), handles.get(), data.get(), handles.get(),
+        size, test_args.handles, size, test_args.handles};
+
+    static constexpr uint32_t big_it_size = 10000;
+    uint64_t big_its = 0;
+    zx_time_t start_ns = zx_clock_get_monotonic();
+    zx_time_t end_ns;
+    for (;;) {
+        big_its++;
+        for (uint32_t i = 0; i < big_it_size; i++) {
+            uint32_t r_size, r_handles;
+            status = zx_channel_call(mp[0], 0u, ZX_TIME_INFINITE, &args, &r_size, &r_handles);
+            assert(status == ZX_OK);
+            assert(r_size == size);
+            assert(r_handles == test_args.handles);
+        }
+
+        end_ns = zx_clock_get_monotonic();
+        if (zx_time_sub_time(end_ns, start_ns) >= duration_ns)
+            break;
+    }
+
+    // Closing our end makes the server exit.
+    status = zx_handle_close(mp[0]);
+    assert(status == ZX_OK);
+    rc = thrd_join(server, nullptr);
+    assert(rc == thrd_success);
+
+    for (uint32_t i = 0; i < test_args.handles; i++) {
+        status = zx_handle_close(handles[i]);
+        assert(status == ZX_OK);
+    }
+    status = zx_handle_close(event);
+    assert(status == ZX_OK);
+    status = zx_handle_close(mp[1]);
+    assert(status == ZX_OK);
+
+    zx_duration_t real_duration = zx_time_sub_time(end_ns, start_ns);
+    double calls = static_cast<double>(big_its) * big_it_size;
+    printf("call %" PRIu32 " bytes, %" PRIu32 " handles: "
+               "%.0f calls/second, %.0f ns/round trip\n",
+           size, test_args.handles,
+           calls * 1000000000.0 / static_cast<double>(real_duration),
+           static_cast<double>(real_duration) / calls);
+}
+
 }  // namespace
 
 int main(int argc, char** argv) {
@@ -124,6 +238,8 @@ int main(int argc, char** argv) {
         "  -h    show help (this)\n"
         "  -o    run single test (default)\n"
         "  -s    run suite (ignores -S/-H/-Q)\n"
+        "  -c    measure zx_channel_call() round trips to a server thread\n"
+        "        (ignores -Q)\n"
         "  -n N  set test repetition count to N (default: 1)\n"
         "  -d N  set test duration to N seconds (default: 5)\n"
         "  -S N  set message size to N bytes (default: 10)\n"
@@ -131,6 +247,7 @@ int main(int argc, char** argv) {
         "  -Q N  set message pre-queue count to N messages (default: 0)\n";
 
     bool run_suite = false;  // -o/-s
+    bool run_call = false;   // -c
     uint32_t duration = 5;   // -d
     uint32_t repeats = 1;    // -n
     // Ignored when running a suite:
@@ -141,7 +258,7 @@ int main(int argc, char** argv) {
     };
 
     int opt;
-    while ((opt = getopt(argc, argv, "+hosn:d:S:H:Q:")) != -1) {
+    while ((opt = getopt(argc, argv, "+hoscn:d:S:H:Q:")) != -1) {
         // Our option values are always unsigned numbers.
         uint32_t value = 0;
         if (optarg) {
@@ -163,6 +280,9 @@ int main(int argc, char** argv) {
             case 's':
                 run_suite = true;
                 break;
+            case 'c':
+                run_call = true;
+                break;
             case 'n':
                 assert(optarg);
                 repeats = value;
@@ -217,8 +337,14 @@ int main(int argc, char** argv) {
                 {100, 0, 1},
                 {1000, 0, 1},
             };
-            for (size_t i = 0; i < fbl::count_of(suite); i++)
-                do_test(duration, suite[i]);
+            for (size_t i = 0; i < fbl::count_of(suite); i++) {
+                if (!run_call)
+                    do_test(duration, suite[i]);
+                else if (suite[i].queue == 0u)
+                    do_call_test(duration, suite[i]);
+            }
+        } else if (run_call) {
+            do_call_test(duration, test_args);
         } else {
             do_test(duration, test_args);
         }
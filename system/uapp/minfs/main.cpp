@@ -14,6 +14,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <fbl/algorithm.h>
 #include <fbl/unique_free_ptr.h>
 #include <fbl/unique_ptr.h>
 #include <fs/trace.h>
@@ -24,9 +25,14 @@
 #include <zircon/compiler.h>
 #include <zircon/process.h>
 #include <zircon/processargs.h>
+#include <zircon/syscalls.h>
 
 namespace {
 
+// The most threads which dispatch requests to the filesystem. Every thread
+// which touches the block device holds one of its few transaction groups.
+constexpr uint32_t kMaxDispatchThreads = 4;
+
 int Fsck(fbl::unique_ptr<minfs::Bcache> bc, const minfs::MountOptions& options) {
     return Fsck(fbl::move(bc));
 }
@@ -55,7 +61,19 @@ int Mount(fbl::unique_ptr<minfs::Bcache> bc, const minfs::MountOptions& options)
         fprintf(stderr, "minfs: Mounted successfully\n");
     }
 
+    // Serve requests on this thread, and on one more per spare CPU.
+    uint32_t threads = fbl::min(zx_system_get_num_cpus(), kMaxDispatchThreads);
+    for (uint32_t i = 1; i < threads; i++) {
+        if ((status = loop.StartThread("minfs-dispatch")) != ZX_OK) {
+            if (options.verbose) {
+                fprintf(stderr, "minfs: Failed to start dispatch thread: %d\n", status);
+            }
+            break;
+        }
+    }
+
     loop.Run();
+    loop.JoinThreads();
     return 0;
 }
 
@@ -0,0 +1,202 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <zircon/status.h>
+#include <zircon/syscalls.h>
+#include <zircon/syscalls/object.h>
+#include <zircon/types.h>
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "resources.h"
+
+// Reads all of the kernel's latency histograms. The caller must free
+// |*hists|.
+static zx_status_t read_histograms(zx_handle_t root_resource,
+                                   zx_info_latency_histogram_t** hists, size_t* count) {
+    size_t actual = 0;
+    size_t avail = 0;
+    zx_info_latency_histogram_t* buf = NULL;
+    for (;;) {
+        zx_status_t status = zx_object_get_info(root_resource, ZX_INFO_LATENCY_HISTOGRAMS,
+                                                buf, avail * sizeof(*buf), &actual, &avail);
+        if (status != ZX_OK) {
+            fprintf(stderr, "ZX_INFO_LATENCY_HISTOGRAMS returns %d (%s)\n",
+                    status, zx_status_get_string(status));
+            free(buf);
+            return status;
+        }
+        if (actual == avail && (buf != NULL || avail == 0)) {
+            break;
+        }
+        free(buf);
+        buf = malloc(avail * sizeof(*buf));
+        if (buf == NULL) {
+            return ZX_ERR_NO_MEMORY;
+        }
+    }
+    *hists = buf;
+    *count = actual;
+    return ZX_OK;
+}
+
+// Returns the upper bound, in ticks, of the bucket that holds the sample at
+// |percentile| (out of 1000).
+static uint64_t percentile_ticks(const uint64_t* buckets, uint64_t total,
+                                 uint64_t percentile) {
+    uint64_t target = (total * percentile + 999) / 1000;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < ZX_LATENCY_HISTOGRAM_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= target) {
+            return i == 0 ? 0 : 1ull << i;
+        }
+    }
+    return 1ull << (ZX_LATENCY_HISTOGRAM_BUCKETS - 1);
+}
+
+static uint64_t ticks_to_ns(uint64_t ticks) {
+    return ticks * ZX_SEC(1) / zx_ticks_per_second();
+}
+
+static bool matches(const zx_info_latency_histogram_t* hist, int num_filters, char** filters) {
+    if (num_filters == 0) {
+        return true;
+    }
+    for (int i = 0; i < num_filters; i++) {
+        size_t len = strlen(filters[i]);
+        if (strncmp(hist->name, filters[i], len) == 0 ||
+            strcmp(hist->group, filters[i]) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void print_histograms(const zx_info_latency_histogram_t* hists, size_t count,
+                             bool all, bool buckets, int num_filters, char** filters) {
+    printf("%-12s %-32s %12s %10s %10s %10s %10s\n",
+           "group", "name", "count", "p50(ns)", "p90(ns)", "p99(ns)", "max(ns)");
+    for (size_t i = 0; i < count; i++) {
+        const zx_info_latency_histogram_t* hist = &hists[i];
+        if (!matches(hist, num_filters, filters)) {
+            continue;
+        }
+        uint64_t total = 0;
+        size_t last = 0;
+        for (size_t b = 0; b < ZX_LATENCY_HISTOGRAM_BUCKETS; b++) {
+            total += hist->buckets[b];
+            if (hist->buckets[b] != 0) {
+                last = b;
+            }
+        }
+        if (total == 0 && !all) {
+            continue;
+        }
+        printf("%-12s %-32s %12" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+               " %10" PRIu64 "\n",
+               hist->group, hist->name, total,
+               ticks_to_ns(percentile_ticks(hist->buckets, total, 500)),
+               ticks_to_ns(percentile_ticks(hist->buckets, total, 900)),
+               ticks_to_ns(percentile_ticks(hist->buckets, total, 990)),
+               ticks_to_ns(last == 0 ? 0 : 1ull << last));
+        if (buckets) {
+            for (size_t b = 0; b < ZX_LATENCY_HISTOGRAM_BUCKETS; b++) {
+                if (hist->buckets[b] != 0) {
+                    printf("    < %10" PRIu64 "ns: %" PRIu64 "\n",
+                           ticks_to_ns(b == 0 ? 1 : 1ull << b), hist->buckets[b]);
+                }
+            }
+        }
+    }
+}
+
+static void print_help(FILE* f) {
+    fprintf(f, "Usage: klatency [options] [<name-prefix>|<group>...]\n");
+    fprintf(f, "Prints how long the kernel takes to handle syscalls, page faults\n");
+    fprintf(f, "and VM exits. Times are bucketed by powers of two, so each time is\n");
+    fprintf(f, "the upper bound of the bucket the percentile falls into.\n");
+    fprintf(f, "Options:\n");
+    fprintf(f, " -a              Include operations that never happened\n");
+    fprintf(f, " -b              Print the buckets of each histogram\n");
+    fprintf(f, " -d <delay>      Only count the next <delay> seconds, instead of\n");
+    fprintf(f, "                 everything since boot\n");
+}
+
+int main(int argc, char** argv) {
+    bool all = false;
+    bool buckets = false;
+    zx_duration_t delay = 0;
+
+    int c;
+    while ((c = getopt(argc, argv, "abd:h")) > 0) {
+        switch (c) {
+            case 'a':
+                all = true;
+                break;
+            case 'b':
+                buckets = true;
+                break;
+            case 'd':
+                delay = ZX_SEC(atoi(optarg));
+                if (delay <= 0) {
+                    fprintf(stderr, "Bad -d value '%s'\n", optarg);
+                    print_help(stderr);
+                    return 1;
+                }
+                break;
+            case 'h':
+                print_help(stdout);
+                return 0;
+            default:
+                fprintf(stderr, "Unknown option\n");
+                print_help(stderr);
+                return 1;
+        }
+    }
+
+    zx_handle_t root_resource;
+    zx_status_t status = get_root_resource(&root_resource);
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    zx_info_latency_histogram_t* hists;
+    size_t count;
+    status = read_histograms(root_resource, &hists, &count);
+    if (status == ZX_OK && delay > 0) {
+        zx_nanosleep(zx_deadline_after(delay));
+
+        zx_info_latency_histogram_t* after;
+        size_t after_count;
+        status = read_histograms(root_resource, &after, &after_count);
+        if (status == ZX_OK) {
+            // The set of histograms is fixed once the kernel has booted, so
+            // the two reads line up.
+            for (size_t i = 0; i < after_count && i < count; i++) {
+                for (size_t b = 0; b < ZX_LATENCY_HISTOGRAM_BUCKETS; b++) {
+                    after[i].buckets[b] -= hists[i].buckets[b];
+                }
+            }
+            free(hists);
+            hists = after;
+            count = after_count;
+        } else {
+            free(hists);
+        }
+    }
+    zx_handle_close(root_resource);
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    print_histograms(hists, count, all, buckets, argc - optind, argv + optind);
+    free(hists);
+    return 0;
+}
@@ -228,3 +228,22 @@ MODULE_STATIC_LIBS := \
     system/ulib/task-utils \
 
 include make/module.mk
+
+
+MODULE := $(LOCAL_DIR).klatency
+
+MODULE_TYPE := userapp
+
+MODULE_SRCS += \
+    $(LOCAL_DIR)/klatency.c \
+    $(LOCAL_DIR)/resources.c
+
+MODULE_NAME := klatency
+MODULE_GROUP := core
+
+MODULE_LIBS := \
+    system/ulib/fdio \
+    system/ulib/zircon \
+    system/ulib/c
+
+include make/module.mk
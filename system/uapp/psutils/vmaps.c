@@ -17,22 +17,31 @@
 #include <stdlib.h>
 #include <string.h>
 
-// Reads the zx_info_maps_t entries for the process.
+// Reads the zx_info_maps_t entries for the process, a page at a time.
 // Caller is responsible for the |out_maps| pointer.
 zx_status_t get_maps(zx_koid_t koid, zx_handle_t process,
                      zx_info_maps_t** out_maps, size_t* out_count,
                      size_t* out_avail) {
-    size_t count = 4096; // Should be more than enough.
+    size_t capacity = 0;
+    size_t count = 0;
     zx_info_maps_t* maps = NULL;
-    int pass = 3;
-    while (true) {
-        maps = (zx_info_maps_t*)realloc(maps, count * sizeof(zx_info_maps_t));
+    uint64_t cursor = 0;
+    do {
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            zx_info_maps_t* grown =
+                (zx_info_maps_t*)realloc(maps, capacity * sizeof(zx_info_maps_t));
+            if (grown == NULL) {
+                free(maps);
+                return ZX_ERR_NO_MEMORY;
+            }
+            maps = grown;
+        }
 
         size_t actual;
-        size_t avail;
-        zx_status_t s = zx_object_get_info(process, ZX_INFO_PROCESS_MAPS,
-                                           maps, count * sizeof(zx_info_maps_t),
-                                           &actual, &avail);
+        zx_status_t s = zx_object_get_info_paged(
+            process, ZX_INFO_PROCESS_MAPS, cursor, maps + count,
+            (capacity - count) * sizeof(zx_info_maps_t), &actual, &cursor);
         if (s != ZX_OK) {
             fprintf(stderr,
                     "ERROR: couldn't get maps for process with koid %" PRIu64
@@ -41,15 +50,13 @@ zx_status_t get_maps(zx_koid_t koid, zx_handle_t process,
             free(maps);
             return s;
         }
-        if (actual < avail && pass-- > 0) {
-            count = (avail * 10) / 9;
-            continue;
-        }
-        *out_maps = maps;
-        *out_count = actual;
-        *out_avail = avail;
-        return ZX_OK;
-    }
+        count += actual;
+    } while (cursor != 0);
+
+    *out_maps = maps;
+    *out_count = count;
+    *out_avail = count;
+    return ZX_OK;
 }
 
 void print_ptr(zx_vaddr_t addr) {
@@ -16,31 +16,41 @@
 
 // Reads the zx_info_vmo_t entries for the process.
 // Caller is responsible for the |out_vmos| pointer.
+//
+// The entries are read a page at a time, which keeps the kernel from
+// holding the process's locks for the whole walk.
 zx_status_t get_vmos(zx_handle_t process,
                      zx_info_vmo_t** out_vmos, size_t* out_count,
                      size_t* out_avail) {
-    size_t count = 4096; // Should be more than enough.
+    size_t capacity = 0;
+    size_t count = 0;
     zx_info_vmo_t* vmos = NULL;
-    int pass = 3;
-    while (true) {
-        vmos = (zx_info_vmo_t*)realloc(vmos, count * sizeof(zx_info_vmo_t));
+    uint64_t cursor = 0;
+    do {
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            zx_info_vmo_t* grown =
+                (zx_info_vmo_t*)realloc(vmos, capacity * sizeof(zx_info_vmo_t));
+            if (grown == NULL) {
+                free(vmos);
+                return ZX_ERR_NO_MEMORY;
+            }
+            vmos = grown;
+        }
 
         size_t actual;
-        size_t avail;
-        zx_status_t s = zx_object_get_info(process, ZX_INFO_PROCESS_VMOS,
-                                           vmos, count * sizeof(zx_info_vmo_t),
-                                           &actual, &avail);
+        zx_status_t s = zx_object_get_info_paged(
+            process, ZX_INFO_PROCESS_VMOS, cursor, vmos + count,
+            (capacity - count) * sizeof(zx_info_vmo_t), &actual, &cursor);
         if (s != ZX_OK) {
             free(vmos);
             return s;
         }
-        if (actual < avail && pass-- > 0) {
-            count = (avail * 10) / 9;
-            continue;
-        }
-        *out_vmos = vmos;
-        *out_count = actual;
-        *out_avail = avail;
-        return ZX_OK;
-    }
+        count += actual;
+    } while (cursor != 0);
+
+    *out_vmos = vmos;
+    *out_count = count;
+    *out_avail = count;
+    return ZX_OK;
 }
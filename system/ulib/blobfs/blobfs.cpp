@@ -146,23 +146,45 @@ Inode* Blobfs::GetNode(size_t index) const {
     return &reinterpret_cast<Inode*>(node_map_->GetData())[index];
 }
 
-zx_status_t VnodeBlob::Verify() const {
-    TRACE_DURATION("blobfs", "Blobfs::Verify");
+zx_status_t VnodeBlob::Verify(uint64_t offset, uint64_t length) const {
+    TRACE_DURATION("blobfs", "Blobfs::Verify", "offset", offset, "length", length);
     fs::Ticker ticker(blobfs_->CollectingMetrics());
 
     const void* data = inode_.blob_size ? GetData() : nullptr;
     const void* tree = inode_.blob_size ? GetMerkle() : nullptr;
     const uint64_t data_size = inode_.blob_size;
     const uint64_t merkle_size = MerkleTree::GetTreeLength(data_size);
-    // TODO(smklein): We could lazily verify more of the VMO if
-    // we could fault in pages on-demand.
-    //
-    // For now, we aggressively verify the entire VMO up front.
     Digest digest;
     digest = reinterpret_cast<const uint8_t*>(&digest_[0]);
-    zx_status_t status = MerkleTree::Verify(data, data_size, tree,
-                                            merkle_size, 0, data_size, digest);
-    blobfs_->UpdateMerkleVerifyMetrics(data_size, merkle_size, ticker.End());
+
+    // Each node of the first level of the tree covers kSubtreeSize bytes of
+    // data, and the data under different nodes can be verified in parallel.
+    // Every subtree is checked all the way up to the root, which costs
+    // little compared to hashing the data.
+    constexpr uint64_t kSubtreeSize =
+        MerkleTree::kNodeSize * (MerkleTree::kNodeSize / Digest::kLength);
+    const uint64_t first = offset / kSubtreeSize;
+    const uint64_t end = fbl::round_up(offset + length, kSubtreeSize) / kSubtreeSize;
+    zx_status_t status;
+    fs::Duration cpu_time;
+    if (end - first <= 1) {
+        status = MerkleTree::Verify(data, data_size, tree, merkle_size, offset, length, digest);
+        cpu_time = ticker.End();
+    } else {
+        const bool collecting = blobfs_->CollectingMetrics();
+        fbl::atomic<zx_ticks_t> cpu_ticks(0);
+        status = blobfs_->workers_->Run(end - first, [&](size_t index) {
+            fs::Ticker subtree_ticker(collecting);
+            uint64_t start = fbl::max(offset, (first + index) * kSubtreeSize);
+            uint64_t stop = fbl::min(offset + length, (first + index + 1) * kSubtreeSize);
+            zx_status_t status = MerkleTree::Verify(data, data_size, tree, merkle_size,
+                                                    start, stop - start, digest);
+            cpu_ticks.fetch_add(subtree_ticker.End().get());
+            return status;
+        });
+        cpu_time = zx::ticks(cpu_ticks.load());
+    }
+    blobfs_->UpdateMerkleVerifyMetrics(length, merkle_size, ticker.End(), cpu_time);
 
     if (status != ZX_OK) {
         char name[Digest::kLength * 2 + 1];
@@ -174,6 +196,17 @@ zx_status_t VnodeBlob::Verify() const {
 }
 
 zx_status_t VnodeBlob::InitVmos() {
+    zx_status_t status = InitVmosOnce();
+    if (status == ZX_ERR_NO_MEMORY) {
+        // Running out of memory is the sign of memory pressure blobfs has,
+        // so make room by dropping the data of every closed blob.
+        blobfs_->ShrinkCache(0);
+        status = InitVmosOnce();
+    }
+    return status;
+}
+
+zx_status_t VnodeBlob::InitVmosOnce() {
     TRACE_DURATION("blobfs", "Blobfs::InitVmos");
 
     if (blob_ != nullptr) {
@@ -200,19 +233,34 @@ zx_status_t VnodeBlob::InitVmos() {
         FS_TRACE_ERROR("Failed to attach VMO to block device; error: %d\n", status);
         return status;
     }
+    if ((status = verified_blocks_.Reset(data_blocks)) != ZX_OK) {
+        return status;
+    }
 
     if ((inode_.flags & kBlobFlagLZ4Compressed) != 0) {
+        // The compressed data can only be decompressed as a whole, so it is
+        // verified as a whole too.
         if ((status = InitCompressed()) != ZX_OK) {
             return status;
         }
+        if ((status = Verify(0, inode_.blob_size)) != ZX_OK) {
+            return status;
+        }
+        verified_blocks_.Set(0, data_blocks);
+    } else if ((inode_.flags & kBlobFlagLZ4Chunked) != 0) {
+        if (blobfs_->info_.version < kBlobfsChunkedVersion) {
+            FS_TRACE_ERROR("blobfs: Chunked blob on a version %u filesystem\n",
+                           blobfs_->info_.version);
+            return ZX_ERR_IO_DATA_INTEGRITY;
+        }
+        if ((status = InitChunked()) != ZX_OK) {
+            return status;
+        }
     } else {
         if ((status = InitUncompressed()) != ZX_OK) {
             return status;
         }
     }
-    if ((status = Verify()) != ZX_OK) {
-        return status;
-    }
 
     cleanup.cancel();
     return ZX_OK;
@@ -276,26 +324,229 @@ zx_status_t VnodeBlob::InitCompressed() {
         return ZX_ERR_IO_DATA_INTEGRITY;
     }
 
+    fs::Duration decompress_time = ticker.End();
     blobfs_->UpdateMerkleDecompressMetrics((compressed_blocks) * kBlobfsBlockSize,
-                                           inode_.blob_size, read_time, ticker.End());
+                                           inode_.blob_size, read_time, decompress_time,
+                                           decompress_time);
     return ZX_OK;
 }
 
 zx_status_t VnodeBlob::InitUncompressed() {
     TRACE_DURATION("blobfs", "Blobfs::InitUncompressed", "size", inode_.blob_size,
                    "blocks", inode_.num_blocks);
+    uint64_t merkle_blocks = MerkleTreeBlocks(inode_);
+    if (merkle_blocks == 0) {
+        return ZX_OK;
+    }
     fs::Ticker ticker(blobfs_->CollectingMetrics());
     fs::ReadTxn txn(blobfs_);
     uint64_t start = inode_.start_block + DataStartBlock(blobfs_->info_);
 
-    // Read both the uncompressed merkle tree and data.
-    uint64_t length = BlobDataBlocks(inode_) + MerkleTreeBlocks(inode_);
-    txn.Enqueue(vmoid_, 0, start, length);
+    // Read only the merkle tree; the data is read on demand.
+    txn.Enqueue(vmoid_, 0, start, merkle_blocks);
     zx_status_t status = txn.Transact();
-    blobfs_->UpdateMerkleDiskReadMetrics(length * kBlobfsBlockSize, ticker.End());
+    blobfs_->UpdateMerkleDiskReadMetrics(merkle_blocks * kBlobfsBlockSize, ticker.End());
     return status;
 }
 
+zx_status_t VnodeBlob::InitChunked() {
+    TRACE_DURATION("blobfs", "Blobfs::InitChunked", "size", inode_.blob_size,
+                   "blocks", inode_.num_blocks);
+    fs::Ticker ticker(blobfs_->CollectingMetrics());
+    fs::ReadTxn txn(blobfs_);
+    uint64_t start = inode_.start_block + DataStartBlock(blobfs_->info_);
+    uint64_t merkle_blocks = MerkleTreeBlocks(inode_);
+
+    size_t compressed_blocks = (inode_.num_blocks - merkle_blocks);
+    size_t compressed_size;
+    if (mul_overflow(compressed_blocks, kBlobfsBlockSize, &compressed_size)) {
+        FS_TRACE_ERROR("Multiplication overflow\n");
+        return ZX_ERR_OUT_OF_RANGE;
+    }
+    uint64_t table_blocks = fbl::round_up(ChunkTableSize(inode_.blob_size),
+                                          kBlobfsBlockSize) / kBlobfsBlockSize;
+    if (table_blocks > compressed_blocks) {
+        FS_TRACE_ERROR("Seek table does not fit in compressed blob\n");
+        return ZX_ERR_IO_DATA_INTEGRITY;
+    }
+
+    // The compressed VMO only commits the pages which are read into it.
+    zx_status_t status = fzl::MappedVmo::Create(compressed_size, "compressed-blob", &compressed_);
+    if (status != ZX_OK) {
+        FS_TRACE_ERROR("Failed to initialized compressed vmo; error: %d\n", status);
+        return status;
+    }
+    if ((status = blobfs_->AttachVmo(compressed_->GetVmo(), &compressed_vmoid_)) != ZX_OK) {
+        FS_TRACE_ERROR("Failed to attach commpressed VMO to blkdev: %d\n", status);
+        compressed_ = nullptr;
+        return status;
+    }
+
+    // Read the merkle tree and the seek table.
+    txn.Enqueue(vmoid_, 0, start, merkle_blocks);
+    txn.Enqueue(compressed_vmoid_, 0, start + merkle_blocks, table_blocks);
+    if ((status = txn.Transact()) != ZX_OK) {
+        FS_TRACE_ERROR("Failed to flush read transaction: %d\n", status);
+        return status;
+    }
+    blobfs_->UpdateMerkleDiskReadMetrics((merkle_blocks + table_blocks) * kBlobfsBlockSize,
+                                         ticker.End());
+
+    if ((status = ChunkedDecompressor::ValidateTable(compressed_->GetData(), inode_.blob_size,
+                                                     compressed_size)) != ZX_OK) {
+        FS_TRACE_ERROR("Invalid seek table in compressed blob\n");
+        return status;
+    }
+    return ZX_OK;
+}
+
+zx_status_t VnodeBlob::LoadRange(uint64_t offset, uint64_t length) {
+    TRACE_DURATION("blobfs", "Blobfs::LoadRange", "offset", offset, "length", length);
+    ZX_DEBUG_ASSERT(offset + length <= inode_.blob_size);
+
+    // Read ahead a little, so that reading a blob sequentially in small
+    // chunks does not need a transaction and a verification per chunk.
+    constexpr uint64_t kReadAheadBlocks = 16;
+    const uint64_t data_blocks = BlobDataBlocks(inode_);
+    uint64_t first = offset / kBlobfsBlockSize;
+    uint64_t last = fbl::round_up(offset + length, kBlobfsBlockSize) / kBlobfsBlockSize;
+    if (verified_blocks_.Get(first, last)) {
+        return ZX_OK;
+    }
+    first = fbl::round_down(first, kReadAheadBlocks);
+    last = fbl::min(fbl::round_up(last, kReadAheadBlocks), data_blocks);
+    if ((inode_.flags & kBlobFlagLZ4Chunked) != 0) {
+        return LoadChunks(first, last);
+    }
+
+    // Read each run of blocks which has not been verified yet.
+    fs::Ticker ticker(blobfs_->CollectingMetrics());
+    fs::ReadTxn txn(blobfs_);
+    const uint64_t merkle_blocks = MerkleTreeBlocks(inode_);
+    const uint64_t start = inode_.start_block + DataStartBlock(blobfs_->info_) + merkle_blocks;
+    uint64_t read_blocks = 0;
+    size_t block;
+    verified_blocks_.Get(first, last, &block);
+    const uint64_t verify_start = block;
+    while (block < last) {
+        size_t end;
+        if (verified_blocks_.Scan(block, last, false, &end)) {
+            end = last;
+        }
+        txn.Enqueue(vmoid_, merkle_blocks + block, start + block, end - block);
+        read_blocks += end - block;
+        verified_blocks_.Get(end, last, &block);
+    }
+    zx_status_t status = txn.Transact();
+    blobfs_->UpdateMerkleDiskReadMetrics(read_blocks * kBlobfsBlockSize, ticker.End());
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    // Blocks in the middle of the range which were already verified are
+    // verified again, which is cheaper than splitting up the verification.
+    const uint64_t verify_end = fbl::min(last * kBlobfsBlockSize, inode_.blob_size);
+    status = Verify(verify_start * kBlobfsBlockSize, verify_end - verify_start * kBlobfsBlockSize);
+    if (status != ZX_OK) {
+        return status;
+    }
+    verified_blocks_.Set(verify_start, last);
+    return ZX_OK;
+}
+
+zx_status_t VnodeBlob::LoadChunks(uint64_t first, uint64_t last) {
+    TRACE_DURATION("blobfs", "Blobfs::LoadChunks", "first", first, "last", last);
+    constexpr uint64_t kChunkBlocks = kBlobfsChunkSize / kBlobfsBlockSize;
+    const uint64_t data_blocks = BlobDataBlocks(inode_);
+    const uint64_t first_chunk = first / kChunkBlocks;
+    const uint64_t last_chunk = fbl::round_up(last, kChunkBlocks) / kChunkBlocks;
+    auto chunk_verified = [this, data_blocks](uint64_t chunk) {
+        return verified_blocks_.Get(chunk * kChunkBlocks,
+                                    fbl::min((chunk + 1) * kChunkBlocks, data_blocks));
+    };
+
+    // Read the compressed data of each run of chunks which has not been
+    // verified yet. Neighbouring chunks may share a block, which is harmless
+    // to read again.
+    fs::Ticker ticker(blobfs_->CollectingMetrics());
+    fs::ReadTxn txn(blobfs_);
+    const uint64_t* offsets = ChunkedDecompressor::Offsets(compressed_->GetData());
+    const uint64_t start = inode_.start_block + DataStartBlock(blobfs_->info_) +
+                           MerkleTreeBlocks(inode_);
+    uint64_t read_blocks = 0;
+    uint64_t verify_chunk = last_chunk;
+    uint64_t chunk = first_chunk;
+    while (chunk < last_chunk) {
+        if (chunk_verified(chunk)) {
+            chunk++;
+            continue;
+        }
+        verify_chunk = fbl::min(verify_chunk, chunk);
+        uint64_t end = chunk + 1;
+        while (end < last_chunk && !chunk_verified(end)) {
+            end++;
+        }
+        uint64_t block = offsets[chunk] / kBlobfsBlockSize;
+        uint64_t end_block = fbl::round_up(offsets[end], kBlobfsBlockSize) / kBlobfsBlockSize;
+        txn.Enqueue(compressed_vmoid_, block, start + block, end_block - block);
+        read_blocks += end_block - block;
+        chunk = end;
+    }
+    zx_status_t status = txn.Transact();
+    if (status != ZX_OK) {
+        return status;
+    }
+    fs::Duration read_time = ticker.End();
+    ticker.Reset();
+
+    // Decompress the chunks in parallel. Nothing changes verified_blocks_
+    // until they are all done.
+    const bool collecting = blobfs_->CollectingMetrics();
+    fbl::atomic<uint64_t> decompressed(0);
+    fbl::atomic<zx_ticks_t> cpu_ticks(0);
+    status = blobfs_->workers_->Run(last_chunk - verify_chunk, [&](size_t index) {
+        uint64_t chunk = verify_chunk + index;
+        if (chunk_verified(chunk)) {
+            return ZX_OK;
+        }
+        fs::Ticker chunk_ticker(collecting);
+        uint64_t offset = chunk * kBlobfsChunkSize;
+        size_t size = fbl::min<uint64_t>(kBlobfsChunkSize, inode_.blob_size - offset);
+        zx_status_t status = ChunkedDecompressor::DecompressChunk(
+                static_cast<uint8_t*>(GetData()) + offset, size, compressed_->GetData(), chunk);
+        decompressed.fetch_add(size);
+        cpu_ticks.fetch_add(chunk_ticker.End().get());
+        return status;
+    });
+    blobfs_->UpdateMerkleDecompressMetrics(read_blocks * kBlobfsBlockSize, decompressed.load(),
+                                           read_time, ticker.End(),
+                                           zx::ticks(cpu_ticks.load()));
+    if (status != ZX_OK) {
+        FS_TRACE_ERROR("Failed to decompress data: %d\n", status);
+        return status;
+    }
+
+    // Chunks in the middle of the range which were already verified are
+    // verified again, which is cheaper than splitting up the verification.
+    const uint64_t verify_start = verify_chunk * kBlobfsChunkSize;
+    const uint64_t verify_end = fbl::min(last_chunk * kBlobfsChunkSize, inode_.blob_size);
+    if (verify_start >= verify_end) {
+        return ZX_OK;
+    }
+    if ((status = Verify(verify_start, verify_end - verify_start)) != ZX_OK) {
+        return status;
+    }
+    verified_blocks_.Set(verify_chunk * kChunkBlocks,
+                         fbl::min(last_chunk * kChunkBlocks, data_blocks));
+
+    // Once the whole blob is in memory, the compressed data is not needed.
+    if (verified_blocks_.Get(0, data_blocks)) {
+        blobfs_->DetachVmo(compressed_vmoid_);
+        compressed_ = nullptr;
+    }
+    return ZX_OK;
+}
+
 void VnodeBlob::PopulateInode(size_t node_index) {
     ZX_DEBUG_ASSERT(map_index_ == 0);
     ZX_DEBUG_ASSERT(inode_.start_block < kStartBlockMinimum);
@@ -305,6 +556,14 @@ void VnodeBlob::PopulateInode(size_t node_index) {
     inode_ = *inode;
 }
 
+uint64_t VnodeBlob::SizeCached() const {
+    uint64_t size = blob_ != nullptr ? blob_->GetSize() : 0;
+    if (compressed_ != nullptr) {
+        size += compressed_->GetSize();
+    }
+    return size;
+}
+
 uint64_t VnodeBlob::SizeData() const {
     if (GetState() == kBlobStateReadable) {
         return inode_.blob_size;
@@ -324,6 +583,10 @@ VnodeBlob::VnodeBlob(Blobfs* bs)
       syncing_(false), clone_watcher_(this) {}
 
 void VnodeBlob::BlobCloseHandles() {
+    if (compressed_ != nullptr) {
+        blobfs_->DetachVmo(compressed_vmoid_);
+        compressed_ = nullptr;
+    }
     blob_ = nullptr;
     readable_event_.reset();
 }
@@ -338,8 +601,11 @@ zx_status_t VnodeBlob::SpaceAllocate(uint64_t size_data) {
 
     // Find a free node, mark it as reserved.
     zx_status_t status;
-    if ((status = blobfs_->ReserveNode(&map_index_)) != ZX_OK) {
-        return status;
+    {
+        fbl::AutoLock lock(&blobfs_->metadata_lock_);
+        if ((status = blobfs_->ReserveNode(&map_index_)) != ZX_OK) {
+            return status;
+        }
     }
 
     // Initialize the inode with known fields
@@ -352,7 +618,7 @@ zx_status_t VnodeBlob::SpaceAllocate(uint64_t size_data) {
         // Toss a valid block to the null blob, to distinguish it from
         // unallocated nodes.
         inode_.start_block = kStartBlockMinimum;
-        if ((status = Verify()) != ZX_OK) {
+        if ((status = Verify(0, 0)) != ZX_OK) {
             return status;
         }
         SetState(kBlobStateDataWrite);
@@ -377,19 +643,25 @@ zx_status_t VnodeBlob::SpaceAllocate(uint64_t size_data) {
     }
 
     // Reserve space for the blob.
-    if ((status = blobfs_->ReserveBlocks(inode_.num_blocks, &inode_.start_block)) != ZX_OK) {
+    {
+        fbl::AutoLock lock(&blobfs_->metadata_lock_);
+        status = blobfs_->ReserveBlocks(inode_.num_blocks, &inode_.start_block);
+    }
+    if (status != ZX_OK) {
         goto fail;
     }
 
     write_info_ = fbl::make_unique<WritebackInfo>();
-    if (inode_.blob_size >= kCompressionMinBytesSaved) {
+    if (inode_.blob_size >= kCompressionMinBytesSaved &&
+        blobfs_->info_.version >= kBlobfsChunkedVersion) {
         size_t max = write_info_->compressor.BufferMax(inode_.blob_size);
         status = fzl::MappedVmo::Create(max, "compressed-blob", &write_info_->compressed_blob);
         if (status != ZX_OK) {
             return status;
         }
         status = write_info_->compressor.Initialize(write_info_->compressed_blob->GetData(),
-                                                    write_info_->compressed_blob->GetSize());
+                                                    write_info_->compressed_blob->GetSize(),
+                                                    inode_.blob_size);
         if (status != ZX_OK) {
             fprintf(stderr, "blobfs: Failed to initalize compressor: %d\n", status);
             return status;
@@ -402,6 +674,7 @@ zx_status_t VnodeBlob::SpaceAllocate(uint64_t size_data) {
 
 fail:
     BlobCloseHandles();
+    fbl::AutoLock lock(&blobfs_->metadata_lock_);
     blobfs_->FreeNode(nullptr, map_index_);
     return status;
 }
@@ -434,6 +707,7 @@ zx_status_t VnodeBlob::WriteMetadata(fbl::unique_ptr<WritebackWork> wb) {
     atomic_store(&syncing_, true);
 
     // Allocate and persist previously reserved blocks/node.
+    fbl::AutoLock lock(&blobfs_->metadata_lock_);
     if (inode_.blob_size) {
         blobfs_->PersistBlocks(wb.get(), inode_.num_blocks, inode_.start_block);
     }
@@ -505,10 +779,13 @@ zx_status_t VnodeBlob::WriteInternal(const void* data, size_t len, size_t* actua
             }
             blocks += MerkleTreeBlocks(inode_);
             ZX_DEBUG_ASSERT(inode_.num_blocks > blocks);
-            blobfs_->UnreserveBlocks(inode_.num_blocks - blocks,
-                                     inode_.start_block + blocks);
+            {
+                fbl::AutoLock lock(&blobfs_->metadata_lock_);
+                blobfs_->UnreserveBlocks(inode_.num_blocks - blocks,
+                                         inode_.start_block + blocks);
+            }
             inode_.num_blocks = blocks;
-            inode_.flags |= kBlobFlagLZ4Compressed;
+            inode_.flags |= kBlobFlagLZ4Chunked;
         } else {
             uint64_t blocks = fbl::round_up(inode_.blob_size, kBlobfsBlockSize) / kBlobfsBlockSize;
             if ((status = EnqueuePaginated(&wb, blobfs_, this, blob_->GetVmo(),
@@ -541,7 +818,7 @@ zx_status_t VnodeBlob::WriteInternal(const void* data, size_t len, size_t* actua
             uint64_t dev_offset = DataStartBlock(blobfs_->info_) + inode_.start_block;
             wb->Enqueue(blob_->GetVmo(), 0, dev_offset, merkle_blocks);
             generation_time = ticker.End();
-        } else if ((status = Verify()) != ZX_OK) {
+        } else if ((status = Verify(0, inode_.blob_size)) != ZX_OK) {
             // Small blobs may not have associated Merkle Trees, and will
             // require validation, since we are not regenerating and checking
             // the digest.
@@ -549,6 +826,14 @@ zx_status_t VnodeBlob::WriteInternal(const void* data, size_t len, size_t* actua
             return status;
         }
 
+        // All of the data is in memory and matches the digest.
+        const uint64_t data_blocks = BlobDataBlocks(inode_);
+        if ((status = verified_blocks_.Reset(data_blocks)) != ZX_OK ||
+            (status = verified_blocks_.Set(0, data_blocks)) != ZX_OK) {
+            SetState(kBlobStateError);
+            return status;
+        }
+
         // No more data to write. Flush to disk.
         fs::Ticker ticker(blobfs_->CollectingMetrics()); // Tracking enqueue time.
         if ((status = WriteMetadata(fbl::move(wb))) != ZX_OK) {
@@ -604,8 +889,12 @@ zx_status_t VnodeBlob::CloneVmo(zx_rights_t rights, zx_handle_t* out) {
         return status;
     }
 
+    // Clients read the clone directly, so all of it must be verified.
     // TODO(smklein): Only clone / verify the part of the vmo that
     // was requested.
+    if ((status = LoadRange(0, inode_.blob_size)) != ZX_OK) {
+        return status;
+    }
     const size_t merkle_bytes = MerkleTreeBlocks(inode_) * kBlobfsBlockSize;
     zx_handle_t clone;
     if ((status = zx_vmo_clone(blob_->GetVmo(), ZX_VMO_CLONE_COPY_ON_WRITE,
@@ -642,9 +931,15 @@ void VnodeBlob::HandleNoClones(async_dispatcher_t* dispatcher, async::WaitBase*
                                zx_status_t status, const zx_packet_signal_t* signal) {
     ZX_DEBUG_ASSERT(status == ZX_OK);
     ZX_DEBUG_ASSERT((signal->observed & ZX_VMO_ZERO_CHILDREN) != 0);
-    ZX_DEBUG_ASSERT(clone_watcher_.object() != ZX_HANDLE_INVALID);
-    clone_watcher_.set_object(ZX_HANDLE_INVALID);
-    clone_ref_ = nullptr;
+    // This may be the last reference to the blob, so release it only once
+    // the blob is unlocked.
+    fbl::RefPtr<VnodeBlob> clone_ref;
+    {
+        fbl::AutoLock lock(&lock_);
+        ZX_DEBUG_ASSERT(clone_watcher_.object() != ZX_HANDLE_INVALID);
+        clone_watcher_.set_object(ZX_HANDLE_INVALID);
+        clone_ref = fbl::move(clone_ref_);
+    }
 }
 
 zx_status_t VnodeBlob::ReadInternal(void* data, size_t len, size_t off, size_t* actual) {
@@ -664,9 +959,6 @@ zx_status_t VnodeBlob::ReadInternal(void* data, size_t len, size_t off, size_t*
         return status;
     }
 
-    Digest d;
-    d = reinterpret_cast<const uint8_t*>(&digest_[0]);
-
     if (off >= inode_.blob_size) {
         *actual = 0;
         return ZX_OK;
@@ -674,6 +966,9 @@ zx_status_t VnodeBlob::ReadInternal(void* data, size_t len, size_t off, size_t*
     if (len > (inode_.blob_size - off)) {
         len = inode_.blob_size - off;
     }
+    if ((status = LoadRange(off, len)) != ZX_OK) {
+        return status;
+    }
 
     const size_t merkle_bytes = MerkleTreeBlocks(inode_) * kBlobfsBlockSize;
     status = zx_vmo_read(blob_->GetVmo(), data, merkle_bytes + off, len);
@@ -684,6 +979,7 @@ zx_status_t VnodeBlob::ReadInternal(void* data, size_t len, size_t off, size_t*
 }
 
 void VnodeBlob::QueueUnlink() {
+    fbl::AutoLock lock(&lock_);
     flags_ |= kBlobFlagDeletable;
     // Attempt to purge in case the blob has been unlinked with no open fds
     TryPurge();
@@ -701,11 +997,18 @@ zx_status_t VnodeBlob::VerifyBlob(Blobfs* bs, size_t node_index) {
     }
 
     vn->PopulateInode(node_index);
-    vn->InitVmos();
 
     // Set blob state to "Purged" so we do not try to add it to the cached map on recycle.
     vn->SetState(kBlobStatePurged);
-    return vn->Verify();
+
+    if (vn->inode_.blob_size == 0) {
+        return vn->Verify(0, 0);
+    }
+    zx_status_t status = vn->InitVmos();
+    if (status != ZX_OK) {
+        return status;
+    }
+    return vn->LoadRange(0, vn->inode_.blob_size);
 }
 
 zx_status_t Blobfs::VerifyBlob(size_t node_index) {
@@ -1038,6 +1341,7 @@ zx_status_t Blobfs::PurgeBlob(VnodeBlob* vn) {
             return status;
         }
 
+        fbl::AutoLock lock(&metadata_lock_);
         FreeNode(wb.get(), node_index);
         FreeBlocks(wb.get(), nblocks, start_block);
         VnodeReleaseHard(vn);
@@ -1087,6 +1391,7 @@ zx_status_t Blobfs::Readdir(fs::vdircookie_t* cookie, void* dirents, size_t len,
     TRACE_DURATION("blobfs", "Blobfs::Readdir", "len", len);
     fs::DirentFiller df(dirents, len);
     dircookie_t* c = reinterpret_cast<dircookie_t*>(cookie);
+    fbl::AutoLock lock(&metadata_lock_);
 
     for (size_t i = c->index; i < info_.inode_count; ++i) {
         if (GetNode(i)->start_block >= kStartBlockMinimum) {
@@ -1151,7 +1456,12 @@ zx_status_t Blobfs::LookupBlob(const Digest& digest, fbl::RefPtr<VnodeBlob>* out
     }
 
     if (vn != nullptr) {
-        UpdateLookupMetrics(vn->SizeData());
+        uint64_t size;
+        {
+            fbl::AutoLock lock(&vn->lock_);
+            size = vn->SizeData();
+        }
+        UpdateLookupMetrics(size);
         if (out != nullptr) {
             *out = fbl::move(vn);
         }
@@ -1311,6 +1621,7 @@ void Blobfs::Sync(SyncCallback closure) {
 
 void Blobfs::UpdateAllocationMetrics(uint64_t size_data, const fs::Duration& duration) {
     if (CollectingMetrics()) {
+        fbl::AutoLock lock(&metrics_lock_);
         metrics_.blobs_created++;
         metrics_.blobs_created_total_size += size_data;
         metrics_.total_allocation_time_ticks += duration;
@@ -1319,15 +1630,36 @@ void Blobfs::UpdateAllocationMetrics(uint64_t size_data, const fs::Duration& dur
 
 void Blobfs::UpdateLookupMetrics(uint64_t size) {
     if (CollectingMetrics()) {
+        fbl::AutoLock lock(&metrics_lock_);
         metrics_.blobs_opened++;
         metrics_.blobs_opened_total_size += size;
     }
 }
 
+void Blobfs::UpdateCacheMetrics(bool hit) {
+    if (CollectingMetrics()) {
+        fbl::AutoLock lock(&metrics_lock_);
+        if (hit) {
+            metrics_.cache_hits++;
+        } else {
+            metrics_.cache_misses++;
+        }
+    }
+}
+
+void Blobfs::UpdateCacheEvictionMetrics(uint64_t size) {
+    if (CollectingMetrics()) {
+        fbl::AutoLock lock(&metrics_lock_);
+        metrics_.cache_evictions++;
+        metrics_.cache_evicted_size += size;
+    }
+}
+
 void Blobfs::UpdateClientWriteMetrics(uint64_t data_size, uint64_t merkle_size,
                                       const fs::Duration& enqueue_duration,
                                       const fs::Duration& generate_duration) {
     if (CollectingMetrics()) {
+        fbl::AutoLock lock(&metrics_lock_);
         metrics_.data_bytes_written += data_size;
         metrics_.merkle_bytes_written += merkle_size;
         metrics_.total_write_enqueue_time_ticks += enqueue_duration;
@@ -1337,6 +1669,7 @@ void Blobfs::UpdateClientWriteMetrics(uint64_t data_size, uint64_t merkle_size,
 
 void Blobfs::UpdateWritebackMetrics(uint64_t size, const fs::Duration& duration) {
     if (CollectingMetrics()) {
+        fbl::AutoLock lock(&metrics_lock_);
         metrics_.total_writeback_time_ticks += duration;
         metrics_.total_writeback_bytes_written += size;
     }
@@ -1344,6 +1677,7 @@ void Blobfs::UpdateWritebackMetrics(uint64_t size, const fs::Duration& duration)
 
 void Blobfs::UpdateMerkleDiskReadMetrics(uint64_t size, const fs::Duration& duration) {
     if (CollectingMetrics()) {
+        fbl::AutoLock lock(&metrics_lock_);
         metrics_.total_read_from_disk_time_ticks += duration;
         metrics_.bytes_read_from_disk += size;
     }
@@ -1352,22 +1686,28 @@ void Blobfs::UpdateMerkleDiskReadMetrics(uint64_t size, const fs::Duration& dura
 void Blobfs::UpdateMerkleDecompressMetrics(uint64_t size_compressed,
                                            uint64_t size_uncompressed,
                                            const fs::Duration& read_duration,
-                                           const fs::Duration& decompress_duration) {
+                                           const fs::Duration& decompress_duration,
+                                           const fs::Duration& decompress_cpu_duration) {
     if (CollectingMetrics()) {
+        fbl::AutoLock lock(&metrics_lock_);
         metrics_.bytes_compressed_read_from_disk += size_compressed;
         metrics_.bytes_decompressed_from_disk += size_uncompressed;
         metrics_.total_read_compressed_time_ticks += read_duration;
         metrics_.total_decompress_time_ticks += decompress_duration;
+        metrics_.total_decompress_cpu_time_ticks += decompress_cpu_duration;
     }
 }
 
 void Blobfs::UpdateMerkleVerifyMetrics(uint64_t size_data, uint64_t size_merkle,
-                                       const fs::Duration& duration) {
+                                       const fs::Duration& duration,
+                                       const fs::Duration& cpu_duration) {
     if (CollectingMetrics()) {
+        fbl::AutoLock lock(&metrics_lock_);
         metrics_.blobs_verified++;
         metrics_.blobs_verified_total_size_data += size_data;
         metrics_.blobs_verified_total_size_merkle += size_merkle;
         metrics_.total_verification_time_ticks += duration;
+        metrics_.total_verification_cpu_time_ticks += cpu_duration;
     }
 }
 
@@ -1380,6 +1720,10 @@ Blobfs::~Blobfs() {
     writeback_ = nullptr;
 
     ZX_ASSERT(open_hash_.is_empty());
+    {
+        fbl::AutoLock lock(&hash_lock_);
+        ShrinkCacheLocked(0);
+    }
     closed_hash_.clear();
 
     if (blockfd_) {
@@ -1399,6 +1743,7 @@ zx_status_t Blobfs::Create(fbl::unique_fd fd, const MountOptions& options,
     fbl::AllocChecker ac;
     auto fs = fbl::unique_ptr<Blobfs>(new Blobfs(fbl::move(fd), info));
     fs->SetReadonly(options.readonly);
+    fs->cache_limit_ = options.cache_size;
     if (options.metrics) {
         fs->CollectMetrics();
     }
@@ -1452,6 +1797,10 @@ zx_status_t Blobfs::Create(fbl::unique_fd fd, const MountOptions& options,
     } else if ((status = fs->CreateFsId()) != ZX_OK) {
         fprintf(stderr, "blobfs: Failed to create fs_id: %d\n", status);
         return status;
+    } else if ((status = WorkerPool::Create(zx_system_get_num_cpus() - 1,
+                                            &fs->workers_)) != ZX_OK) {
+        fprintf(stderr, "blobfs: Failed to start worker threads: %d\n", status);
+        return status;
     } else if ((status = fs->InitializeVnodes() != ZX_OK)) {
         fprintf(stderr, "blobfs: Failed to initialize Vnodes\n");
         return status;
@@ -1511,17 +1860,46 @@ zx_status_t Blobfs::VnodeInsertClosedLocked(fbl::RefPtr<VnodeBlob> vn) {
         vn->SetState(kBlobStatePurged);
         return ZX_ERR_ALREADY_EXISTS;
     }
-    vn->TearDown();
+    uint64_t size = vn->SizeCached();
+    if (vn->GetState() == kBlobStateReadable && size > 0 && size <= cache_limit_) {
+        // Keep the verified data in memory, in case the blob is opened again.
+        closed_lru_.push_front(vn.get());
+        cache_size_ += size;
+        ShrinkCacheLocked(cache_limit_);
+    } else {
+        vn->TearDown();
+    }
     __UNUSED auto leak = vn.leak_ref();
     return ZX_OK;
 }
 
+void Blobfs::ShrinkCache(uint64_t size) {
+    fbl::AutoLock lock(&hash_lock_);
+    ShrinkCacheLocked(size);
+}
+
+void Blobfs::ShrinkCacheLocked(uint64_t size) {
+    while (cache_size_ > size && !closed_lru_.is_empty()) {
+        VnodeBlob* vn = closed_lru_.pop_back();
+        uint64_t vn_size = vn->SizeCached();
+        cache_size_ -= vn_size;
+        vn->TearDown();
+        UpdateCacheEvictionMetrics(vn_size);
+    }
+}
+
 fbl::RefPtr<VnodeBlob> Blobfs::VnodeUpgradeLocked(const uint8_t* key) {
     ZX_DEBUG_ASSERT(open_hash_.find(key).CopyPointer() == nullptr);
     VnodeBlob* raw_vn = closed_hash_.erase(key);
     if (raw_vn == nullptr) {
         return nullptr;
     }
+    bool cached = VnodeBlob::LruTraits::node_state(*raw_vn).InContainer();
+    if (cached) {
+        closed_lru_.erase(*raw_vn);
+        cache_size_ -= raw_vn->SizeCached();
+    }
+    UpdateCacheMetrics(cached);
     open_hash_.insert(raw_vn);
     // To have existed in the closed_hash_, this RefPtr must have
     // been leaked.
@@ -46,9 +46,9 @@ zx_status_t CheckSuperblock(const Superblock* info, uint64_t max) {
         fprintf(stderr, "blobfs: bad magic\n");
         return ZX_ERR_INVALID_ARGS;
     }
-    if (info->version != kBlobfsVersion) {
-        fprintf(stderr, "blobfs: FS Version: %08x. Driver version: %08x\n", info->version,
-                kBlobfsVersion);
+    if (info->version < kBlobfsMinVersion || info->version > kBlobfsVersion) {
+        fprintf(stderr, "blobfs: FS Version: %08x. Driver versions: %08x to %08x\n",
+                info->version, kBlobfsMinVersion, kBlobfsVersion);
         return ZX_ERR_INVALID_ARGS;
     }
     if (info->block_size != kBlobfsBlockSize) {
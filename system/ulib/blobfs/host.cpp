@@ -134,12 +134,13 @@ zx_status_t blobfs_add_mapped_blob_with_merkle(Blobfs* bs, void* blob_data, uint
                                                digest::Digest digest, fbl::Array<uint8_t> merkle) {
     // Attempt to optionally compress the blob.
     size_t data_blocks = fbl::round_up(length, kBlobfsBlockSize) / kBlobfsBlockSize;
-    Compressor compressor;
+    ChunkedCompressor compressor;
     size_t max = compressor.BufferMax(length);
     auto compressed_data = fbl::unique_ptr<uint8_t[]>(new uint8_t[max]);
     bool compressed = false;
     if ((length >= kCompressionMinBytesSaved) &&
-        (compressor.Initialize(compressed_data.get(), max) == ZX_OK) &&
+        (bs->Info().version >= kBlobfsChunkedVersion) &&
+        (compressor.Initialize(compressed_data.get(), max, length) == ZX_OK) &&
         (compressor.Update(blob_data, length) == ZX_OK) &&
         (compressor.End() == ZX_OK) &&
         (length - kCompressionMinBytesSaved >= compressor.Size())) {
@@ -165,7 +166,7 @@ zx_status_t blobfs_add_mapped_blob_with_merkle(Blobfs* bs, void* blob_data, uint
     Inode* inode = inode_block->GetInode();
     inode->blob_size = length;
     inode->num_blocks = MerkleTreeBlocks(*inode) + data_blocks;
-    inode->flags |= (compressed ? kBlobFlagLZ4Compressed : 0);
+    inode->flags |= (compressed ? kBlobFlagLZ4Chunked : 0);
 
     if ((status = bs->AllocateBlocks(inode->num_blocks,
                                      reinterpret_cast<size_t*>(&inode->start_block))) != ZX_OK) {
@@ -584,7 +585,7 @@ zx_status_t Blobfs::VerifyBlob(size_t node_index) {
     // Create data buffer.
     fbl::unique_ptr<uint8_t[]> data(new uint8_t[target_size]);
 
-    if (inode.flags & kBlobFlagLZ4Compressed) {
+    if (inode.flags & (kBlobFlagLZ4Compressed | kBlobFlagLZ4Chunked)) {
         // Read in uncompressed merkle blocks.
         for (unsigned i = 0; i < merkle_blocks; i++) {
             ReadBlock(data_start_block_ + inode.start_block + i);
@@ -612,8 +613,16 @@ zx_status_t Blobfs::VerifyBlob(size_t node_index) {
         zx_status_t status;
         target_size = inode.blob_size;
         uint8_t* data_ptr = data.get() + (merkle_blocks * kBlobfsBlockSize);
-        if ((status = Decompressor::Decompress(data_ptr, &target_size, compressed_data.get(),
-                                               &compressed_size)) != ZX_OK) {
+        if (inode.flags & kBlobFlagLZ4Chunked) {
+            if ((status = ChunkedDecompressor::Decompress(data_ptr, inode.blob_size,
+                                                          compressed_data.get(),
+                                                          compressed_size)) != ZX_OK) {
+                fprintf(stderr, "Failed to decompress chunked blob: %d\n", status);
+                return status;
+            }
+        } else if ((status = Decompressor::Decompress(data_ptr, &target_size,
+                                                      compressed_data.get(),
+                                                      &compressed_size)) != ZX_OK) {
             return status;
         }
         if (target_size != inode.blob_size) {
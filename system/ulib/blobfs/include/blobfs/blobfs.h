@@ -15,12 +15,15 @@
 
 #include <bitmap/raw-bitmap.h>
 #include <bitmap/rle-bitmap.h>
+#include <bitmap/storage.h>
 #include <block-client/cpp/client.h>
 #include <digest/digest.h>
 #include <fbl/algorithm.h>
+#include <fbl/auto_lock.h>
 #include <fbl/intrusive_double_list.h>
 #include <fbl/intrusive_wavl_tree.h>
 #include <fbl/macros.h>
+#include <fbl/mutex.h>
 #include <fbl/ref_counted.h>
 #include <fbl/ref_ptr.h>
 #include <fbl/unique_fd.h>
@@ -42,6 +45,7 @@
 #include <blobfs/format.h>
 #include <blobfs/lz4.h>
 #include <blobfs/metrics.h>
+#include <blobfs/workers.h>
 #include <blobfs/writeback.h>
 
 namespace blobfs {
@@ -83,6 +87,10 @@ public:
     struct TypeWavlTraits {
         static WAVLTreeNodeState& node_state(VnodeBlob& b) { return b.type_wavl_state_; }
     };
+    using LruNodeState = fbl::DoublyLinkedListNodeState<VnodeBlob*>;
+    struct LruTraits {
+        static LruNodeState& node_state(VnodeBlob& b) { return b.lru_state_; }
+    };
     const uint8_t* GetKey() const {
         return &digest_[0];
     };
@@ -117,6 +125,9 @@ public:
         return inode_;
     }
 
+    // Returns the size of the VMOs holding the blob's data in memory.
+    uint64_t SizeCached() const;
+
     // Constructs the "directory" blob
     VnodeBlob(Blobfs* bs);
     // Constructs actual blobs
@@ -147,7 +158,9 @@ public:
     static zx_status_t VerifyBlob(Blobfs* bs, size_t node_index);
 
 private:
+    friend class Blobfs;
     friend struct TypeWavlTraits;
+    friend struct LruTraits;
 
     DISALLOW_COPY_ASSIGN_AND_MOVE(VnodeBlob);
 
@@ -221,26 +234,47 @@ private:
     zx_status_t GetVmo(int flags, zx_handle_t* out) final;
     void Sync(SyncCallback closure) final;
 
-    // Read both VMOs into memory, if we haven't already.
+    // Create the blob's VMO and read in its Merkle tree, if we haven't already.
+    //
+    // Blobs compressed as a single LZ4 frame are read, decompressed and
+    // verified in full. The data of uncompressed and chunk-compressed blobs is
+    // read (and decompressed) and verified as it is needed, by LoadRange().
     //
     // TODO(ZX-1481): When we have can register the Blob Store as a pager
     // service, and it can properly handle pages faults on a vnode's contents,
-    // then we can avoid reading the entire blob up-front. Until then, read
-    // the contents of a VMO into memory when it is opened.
+    // then we can also avoid reading the entire blob up-front when it is
+    // mapped.
     zx_status_t InitVmos();
 
+    // Does the work of InitVmos(), once.
+    zx_status_t InitVmosOnce();
+
     // Initialize a compressed blob by reading it from disk and decompressing
     // it.
     // Does not verify the blob.
     zx_status_t InitCompressed();
 
-    // Initialize a deompressed blob by reading it from disk.
-    // Does not verify the blob.
+    // Initialize an uncompressed blob by reading its Merkle tree from disk.
+    // Does not read or verify any data.
     zx_status_t InitUncompressed();
 
-    // Verify the integrity of the in-memory Blob.
+    // Initialize a chunk-compressed blob by reading its Merkle tree and seek
+    // table from disk.
+    // Does not read or verify any data.
+    zx_status_t InitChunked();
+
+    // Ensures that the data blocks covering [offset, offset + length) have
+    // been read from disk and verified against the Merkle tree.
     // InitVmos() must have already been called for this blob.
-    zx_status_t Verify() const;
+    zx_status_t LoadRange(uint64_t offset, uint64_t length);
+
+    // Reads, decompresses and verifies the chunks of a chunk-compressed blob
+    // which cover data blocks [first, last) and have not been verified yet.
+    zx_status_t LoadChunks(uint64_t first, uint64_t last);
+
+    // Verify the integrity of [offset, offset + length) of the in-memory
+    // Blob. Those blocks must already be in memory.
+    zx_status_t Verify(uint64_t offset, uint64_t length) const;
 
     // Called by Blob once the last write has completed, updating the
     // on-disk metadata.
@@ -251,8 +285,15 @@ private:
     void* GetMerkle() const;
 
     WAVLTreeNodeState type_wavl_state_ = {};
+    // Links closed blobs which keep their data in memory.
+    LruNodeState lru_state_ = {};
 
     Blobfs* const blobfs_;
+
+    // Guards the state of the blob below against the dispatch threads.
+    // Acquired before |Blobfs::metadata_lock_| and |Blobfs::hash_lock_|.
+    // A reference to the blob must never be dropped while holding it.
+    fbl::Mutex lock_;
     BlobFlags flags_ = {};
     fbl::atomic_bool syncing_;
 
@@ -262,6 +303,14 @@ private:
     fbl::unique_ptr<fzl::MappedVmo> blob_ = {};
     vmoid_t vmoid_ = {};
 
+    // The data blocks of blob_ which have been read and verified.
+    bitmap::RawBitmapGeneric<bitmap::DefaultStorage> verified_blocks_ = {};
+
+    // The on-disk data of a chunk-compressed blob, laid out as it is on disk.
+    // Only the seek table and the chunks which have been loaded are read.
+    fbl::unique_ptr<fzl::MappedVmo> compressed_ = {};
+    vmoid_t compressed_vmoid_ = {};
+
     // Watches any clones of "blob_" provided to clients.
     // Observes the ZX_VMO_ZERO_CHILDREN signal.
     async::WaitMethod<VnodeBlob, &VnodeBlob::HandleNoClones> clone_watcher_;
@@ -282,7 +331,7 @@ private:
     // Data used exclusively during writeback.
     struct WritebackInfo {
         uint64_t bytes_written = {};
-        Compressor compressor;
+        ChunkedCompressor compressor;
         fbl::unique_ptr<fzl::MappedVmo> compressed_blob = {};
     };
 
@@ -304,9 +353,15 @@ struct MerkleRootTraits {
 
 
 // Toggles that may be set on blobfs during initialization.
+// By default, blobfs keeps the data of up to this many bytes of recently
+// closed blobs in memory.
+constexpr uint64_t kDefaultBlobCacheSize = 64 * (1 << 20);
+
 struct MountOptions {
     bool readonly = false;
     bool metrics = false;
+    // The most data of closed blobs to keep in memory, in bytes.
+    uint64_t cache_size = kDefaultBlobCacheSize;
 };
 
 class Blobfs : public fs::ManagedVfs, public fbl::RefCounted<Blobfs>,
@@ -353,9 +408,14 @@ public:
     void DisableMetrics() { collecting_metrics_ = false; }
     void DumpMetrics() const {
         if (collecting_metrics_) {
+            fbl::AutoLock lock(&metrics_lock_);
             metrics_.Dump();
         }
     }
+    BlobfsMetrics GetMetrics() const {
+        fbl::AutoLock lock(&metrics_lock_);
+        return metrics_;
+    }
 
     void SetUnmountCallback(fbl::Closure closure) {
         on_unmount_ = fbl::move(closure);
@@ -391,7 +451,7 @@ public:
     zx_status_t NewBlob(const Digest& digest, fbl::RefPtr<VnodeBlob>* out);
 
     // Removes blob from 'active' hashmap and deletes all metadata associated with it.
-    zx_status_t PurgeBlob(VnodeBlob* blob);
+    zx_status_t PurgeBlob(VnodeBlob* blob) __TA_EXCLUDES(metadata_lock_, hash_lock_);
 
     zx_status_t Readdir(fs::vdircookie_t* cookie, void* dirents, size_t len, size_t* out_actual);
 
@@ -424,6 +484,14 @@ public:
     // since mounting.
     void UpdateLookupMetrics(uint64_t size);
 
+    // Updates aggregate information about how often blobs which are opened
+    // still have their data in memory.
+    void UpdateCacheMetrics(bool hit);
+
+    // Updates aggregate information about dropping the data of closed
+    // blobs from memory.
+    void UpdateCacheEvictionMetrics(uint64_t size);
+
     // Updates aggregates information about blobs being written back
     // to blobfs since mounting.
     void UpdateClientWriteMetrics(uint64_t data_size, uint64_t merkle_size,
@@ -439,15 +507,19 @@ public:
     void UpdateMerkleDiskReadMetrics(uint64_t size, const fs::Duration& duration);
 
     // Updates aggregate information about decompressing blobs from storage
-    // since mounting.
+    // since mounting. |decompress_cpu_duration| is the time spent
+    // decompressing summed over all the threads which took part.
     void UpdateMerkleDecompressMetrics(uint64_t size_compressed, uint64_t size_uncompressed,
                                        const fs::Duration& read_duration,
-                                       const fs::Duration& decompress_duration);
+                                       const fs::Duration& decompress_duration,
+                                       const fs::Duration& decompress_cpu_duration);
 
     // Updates aggregate information about general verification info
-    // since mounting.
+    // since mounting. |cpu_duration| is the time spent verifying summed over
+    // all the threads which took part.
     void UpdateMerkleVerifyMetrics(uint64_t size_data, uint64_t size_merkle,
-                                   const fs::Duration& duration);
+                                   const fs::Duration& duration,
+                                   const fs::Duration& cpu_duration);
 
     Superblock info_;
 
@@ -483,6 +555,12 @@ public:
     // no strong references.
     void VnodeReleaseSoft(VnodeBlob* vn) __TA_EXCLUDES(hash_lock_);
 
+    // Drops the in-memory data of the least recently closed blobs until the
+    // data of closed blobs takes up no more than |size| bytes.
+    //
+    // Called with a |size| of zero when memory runs short.
+    void ShrinkCache(uint64_t size) __TA_EXCLUDES(hash_lock_);
+
 private:
     friend class BlobfsChecker;
 
@@ -501,6 +579,10 @@ private:
     // Returns an error if the Vnode already exists in the cache.
     zx_status_t VnodeInsertClosedLocked(fbl::RefPtr<VnodeBlob> vn) __TA_REQUIRES(hash_lock_);
 
+    // Tears down closed Vnodes, least recently closed first, until the
+    // cached data of closed blobs is at most |size| bytes.
+    void ShrinkCacheLocked(uint64_t size) __TA_REQUIRES(hash_lock_);
+
     // Upgrades a Vnode which exists in the |closed_hash_| into |open_hash_|,
     // and acquire the strong reference the Vnode which was leaked by
     // |VnodeInsertClosedLocked()|, if it exists.
@@ -563,6 +645,12 @@ private:
     // Verifies that the contents of a blob are valid.
     zx_status_t VerifyBlob(size_t node_index);
 
+    // Guards the allocation maps, the node map and the allocation counts of
+    // |info_| once the filesystem is serving requests. It is held from the
+    // moment metadata changes until the work carrying those changes has been
+    // enqueued, so that works reach the disk in the order they were made.
+    fbl::Mutex metadata_lock_;
+
     // VnodeBlobs exist in the WAVLTree as long as one or more reference exists;
     // when the Vnode is deleted, it is immediately removed from the WAVL tree.
     using WAVLTreeByMerkle = fbl::WAVLTree<const uint8_t*,
@@ -573,6 +661,13 @@ private:
     WAVLTreeByMerkle open_hash_ __TA_GUARDED(hash_lock_){};   // All 'in use' blobs.
     WAVLTreeByMerkle closed_hash_ __TA_GUARDED(hash_lock_){}; // All 'closed' blobs.
 
+    // The closed blobs which still hold their data in memory, most recently
+    // closed first, and the size of that data.
+    using LruList = fbl::DoublyLinkedList<VnodeBlob*, VnodeBlob::LruTraits>;
+    LruList closed_lru_ __TA_GUARDED(hash_lock_){};
+    uint64_t cache_size_ __TA_GUARDED(hash_lock_) = 0;
+    uint64_t cache_limit_ = kDefaultBlobCacheSize;
+
     fbl::unique_fd blockfd_;
     block_info_t block_info_ = {};
     fbl::atomic<groupid_t> next_group_ = {};
@@ -598,7 +693,11 @@ private:
     size_t free_node_lower_bound_ = 0;
 
     bool collecting_metrics_ = false;
-    BlobfsMetrics metrics_ = {};
+    mutable fbl::Mutex metrics_lock_;
+    BlobfsMetrics metrics_ __TA_GUARDED(metrics_lock_) = {};
+
+    // Decompresses and verifies blobs in parallel.
+    fbl::unique_ptr<WorkerPool> workers_ = {};
 
     fbl::Closure on_unmount_ = {};
 };
@@ -27,7 +27,12 @@ namespace blobfs {
 
 constexpr uint64_t kBlobfsMagic0  = (0xac2153479e694d21ULL);
 constexpr uint64_t kBlobfsMagic1  = (0x985000d4d4d3d314ULL);
-constexpr uint32_t kBlobfsVersion = 0x00000006;
+constexpr uint32_t kBlobfsVersion = 0x00000007;
+// Oldest version which can still be mounted. Version 6 images hold no
+// kBlobFlagLZ4Chunked blobs, and new blobs are not compressed in chunks on
+// them, so that the previous driver can still read them.
+constexpr uint32_t kBlobfsMinVersion = 0x00000006;
+constexpr uint32_t kBlobfsChunkedVersion = 0x00000007;
 
 constexpr uint32_t kBlobFlagClean        = 1;
 constexpr uint32_t kBlobFlagDirty        = 2;
@@ -136,6 +141,30 @@ constexpr uint64_t kStartBlockMinimum  = 1; // Smallest 'data' block possible.
 // Identifies that the on-disk storage of the blob is LZ4 compressed.
 constexpr uint32_t kBlobFlagLZ4Compressed = 0x00000001;
 
+// Identifies that the on-disk storage of the blob is LZ4 compressed in chunks
+// which can be decompressed independently of each other.
+//
+// The compressed data (which follows the Merkle tree) starts with a
+// ChunkTableHeader and a table of offsets, followed by one LZ4 frame for each
+// kBlobfsChunkSize bytes of the blob (the last frame may hold fewer bytes).
+constexpr uint32_t kBlobFlagLZ4Chunked = 0x00000002;
+
+constexpr uint64_t kBlobfsChunkTableMagic = 0x6b6e7568432d5a4cull; // "LZ-Chunk"
+constexpr uint64_t kBlobfsChunkSize = 8 * kBlobfsBlockSize;
+
+struct ChunkTableHeader {
+    uint64_t magic;
+    uint64_t chunk_size;
+    uint64_t chunk_count;
+    uint64_t reserved;
+    // Followed by uint64_t offsets[chunk_count + 1]. Chunk i is stored at
+    // [offsets[i], offsets[i + 1]) of the compressed data, counting from the
+    // start of this header.
+};
+
+static_assert(kBlobfsChunkSize % kBlobfsBlockSize == 0,
+              "Blobfs chunks should be made of whole blocks");
+
 using digest::Digest;
 
 struct Inode {
@@ -157,4 +186,15 @@ constexpr uint64_t BlobDataBlocks(const Inode& blobNode) {
     return fbl::round_up(blobNode.blob_size, kBlobfsBlockSize) / kBlobfsBlockSize;
 }
 
+// Number of chunks a blob of |blob_size| bytes is split into when it is stored
+// with kBlobFlagLZ4Chunked.
+constexpr uint64_t ChunkCount(uint64_t blob_size) {
+    return fbl::round_up(blob_size, kBlobfsChunkSize) / kBlobfsChunkSize;
+}
+
+// Size of the ChunkTableHeader and offsets of a blob of |blob_size| bytes.
+constexpr uint64_t ChunkTableSize(uint64_t blob_size) {
+    return sizeof(ChunkTableHeader) + (ChunkCount(blob_size) + 1) * sizeof(uint64_t);
+}
+
 } // namespace blobfs
@@ -84,6 +84,8 @@ public:
     zx_status_t WriteNode(fbl::unique_ptr<InodeBlock> ino_block);
     zx_status_t WriteInfo();
 
+    const Superblock& Info() const { return info_; }
+
 private:
     struct BlockCache {
         size_t bno;
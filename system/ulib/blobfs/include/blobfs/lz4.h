@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <blobfs/format.h>
 #include <lz4/lz4frame.h>
+#include <zircon/types.h>
 
 namespace blobfs {
 
@@ -62,6 +64,66 @@ private:
     size_t buf_used_;
 };
 
+// A ChunkedCompressor compresses a blob in the kBlobFlagLZ4Chunked format:
+// a seek table followed by one LZ4 frame per kBlobfsChunkSize bytes of the
+// blob, so that any part of the blob can be decompressed without
+// decompressing everything before it.
+class ChunkedCompressor {
+public:
+    ChunkedCompressor();
+
+    // Identifies if compression is underway.
+    bool Compressing() const {
+        return buf_ != nullptr;
+    }
+
+    // Resets the compression process.
+    void Reset();
+
+    // Returns the compressed size of the blob so far, including the seek
+    // table.
+    size_t Size() const;
+
+    // Initializes the compression object with a provided buffer of a
+    // specified size, for a blob of |blob_size| bytes.
+    //
+    // As with Compressor, the buffer is not owned by the ChunkedCompressor.
+    zx_status_t Initialize(void* buf, size_t buf_max, uint64_t blob_size);
+
+    // Returns the maximum possible size a buffer would need to be
+    // in order to compress a blob of size |blob_size|.
+    size_t BufferMax(size_t blob_size) const {
+        return ChunkTableSize(blob_size) +
+               ChunkCount(blob_size) * LZ4F_compressFrameBound(kBlobfsChunkSize, nullptr);
+    }
+
+    // Continues the compression after initialization.
+    zx_status_t Update(const void* data, size_t length);
+
+    // Finishes the compression process, once all |blob_size| bytes have been
+    // passed to Update().
+    zx_status_t End();
+
+private:
+    DISALLOW_COPY_ASSIGN_AND_MOVE(ChunkedCompressor);
+
+    uint64_t* Offsets() const {
+        return reinterpret_cast<uint64_t*>(reinterpret_cast<ChunkTableHeader*>(buf_) + 1);
+    }
+
+    // Ends the frame of the current chunk.
+    zx_status_t EndChunk();
+
+    Compressor frame_;
+    void* buf_;
+    size_t buf_max_;
+    // Bytes used by the seek table and the frames of finished chunks.
+    size_t buf_used_;
+    uint64_t chunk_count_;
+    uint64_t chunk_;
+    size_t chunk_used_;
+};
+
 // A Decompressor is used to decompress a blob transparently before it is
 // read back from disk.
 class Decompressor {
@@ -73,4 +135,37 @@ public:
                                   const void* src_buf, size_t* src_size);
 };
 
+// A ChunkedDecompressor decompresses blobs stored in the kBlobFlagLZ4Chunked
+// format, a chunk at a time.
+class ChunkedDecompressor {
+public:
+    // Checks that |src_buf|, which holds at least the first
+    // ChunkTableSize(|blob_size|) bytes of |compressed_size| bytes of
+    // compressed data, starts with a valid seek table for a blob of
+    // |blob_size| bytes.
+    static zx_status_t ValidateTable(const void* src_buf, uint64_t blob_size,
+                                     size_t compressed_size);
+
+    // Returns the offsets of the chunks within the compressed data, which
+    // must start with a valid seek table.
+    static const uint64_t* Offsets(const void* src_buf) {
+        return reinterpret_cast<const uint64_t*>(
+                reinterpret_cast<const ChunkTableHeader*>(src_buf) + 1);
+    }
+
+    // Decompresses chunk |chunk| of the compressed data |src_buf| into
+    // |target_buf|, which must be exactly |target_size| bytes: the size of
+    // the chunk once it is decompressed.
+    //
+    // Only the bytes of |src_buf| which hold the seek table and the frame of
+    // |chunk| need to be present.
+    static zx_status_t DecompressChunk(void* target_buf, size_t target_size,
+                                       const void* src_buf, uint64_t chunk);
+
+    // Validates and decompresses all of |src_buf| into |target_buf|, which
+    // is |blob_size| bytes long.
+    static zx_status_t Decompress(void* target_buf, uint64_t blob_size,
+                                  const void* src_buf, size_t src_size);
+};
+
 } // namespace blobfs
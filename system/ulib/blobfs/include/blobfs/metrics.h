@@ -50,6 +50,8 @@ struct BlobfsMetrics {
 
     zx::ticks total_read_compressed_time_ticks = {};
     zx::ticks total_decompress_time_ticks = {};
+    // Decompression time summed over the threads doing it in parallel.
+    zx::ticks total_decompress_cpu_time_ticks = {};
     uint64_t bytes_compressed_read_from_disk = 0;
     uint64_t bytes_decompressed_from_disk = 0;
 
@@ -61,6 +63,18 @@ struct BlobfsMetrics {
     uint64_t blobs_verified_total_size_data = 0;
     uint64_t blobs_verified_total_size_merkle = 0;
     zx::ticks total_verification_time_ticks = {};
+    // Verification time summed over the threads doing it in parallel.
+    zx::ticks total_verification_cpu_time_ticks = {};
+
+    // CACHE STATS
+
+    // Closed blobs which were opened again while their data was still in
+    // memory, and blobs which had to be read from disk.
+    uint64_t cache_hits = 0;
+    uint64_t cache_misses = 0;
+    // Closed blobs whose data was dropped from memory.
+    uint64_t cache_evictions = 0;
+    uint64_t cache_evicted_size = 0;
 
     // FVM STATS
     // TODO(smklein)
@@ -0,0 +1,51 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#ifndef __Fuchsia__
+#error Fuchsia-only Header
+#endif
+
+#include <fbl/function.h>
+#include <fbl/macros.h>
+#include <fbl/unique_ptr.h>
+#include <lib/async-loop/cpp/loop.h>
+#include <zircon/types.h>
+
+namespace blobfs {
+
+// A WorkerPool spreads CPU-bound work on a blob, such as decompressing its
+// chunks or verifying its Merkle subtrees, across the cores of the system.
+class WorkerPool {
+public:
+    using WorkFn = fbl::Function<zx_status_t(size_t index)>;
+
+    // Creates a pool with |threads| worker threads. A pool without threads
+    // does all of its work on the calling thread.
+    static zx_status_t Create(uint32_t threads, fbl::unique_ptr<WorkerPool>* out);
+
+    ~WorkerPool();
+
+    // Calls |fn| once for each index in [0, |count|), on the worker threads
+    // and on the calling thread, and returns once all the calls are done.
+    //
+    // Returns the first error returned by |fn|. Once a call has failed, the
+    // indices which have not been started yet are skipped.
+    //
+    // |fn| must not call Run() itself.
+    zx_status_t Run(size_t count, const WorkFn& fn);
+
+    uint32_t threads() const { return threads_; }
+
+private:
+    DISALLOW_COPY_ASSIGN_AND_MOVE(WorkerPool);
+
+    explicit WorkerPool(uint32_t threads);
+
+    async::Loop loop_;
+    const uint32_t threads_;
+};
+
+} // namespace blobfs
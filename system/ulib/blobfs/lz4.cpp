@@ -2,6 +2,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <inttypes.h>
 #include <lz4/lz4frame.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -51,7 +52,7 @@ zx_status_t Compressor::Initialize(void* buf, size_t buf_max) {
 }
 
 zx_status_t Compressor::Update(const void* data, size_t length) {
-    size_t r = LZ4F_compressUpdate(ctx_, Buffer(), buf_max_, data, length, nullptr);
+    size_t r = LZ4F_compressUpdate(ctx_, Buffer(), buf_max_ - buf_used_, data, length, nullptr);
     if (LZ4F_isError(r)) {
         return ZX_ERR_IO_DATA_INTEGRITY;
     }
@@ -60,7 +61,7 @@ zx_status_t Compressor::Update(const void* data, size_t length) {
 }
 
 zx_status_t Compressor::End() {
-    size_t r = LZ4F_compressEnd(ctx_, Buffer(), buf_max_, nullptr);
+    size_t r = LZ4F_compressEnd(ctx_, Buffer(), buf_max_ - buf_used_, nullptr);
     if (LZ4F_isError(r)) {
         return ZX_ERR_IO_DATA_INTEGRITY;
     }
@@ -73,6 +74,92 @@ size_t Compressor::Size() const {
     return buf_used_;
 }
 
+ChunkedCompressor::ChunkedCompressor() : buf_(nullptr) {}
+
+void ChunkedCompressor::Reset() {
+    frame_.Reset();
+    buf_ = nullptr;
+}
+
+zx_status_t ChunkedCompressor::Initialize(void* buf, size_t buf_max, uint64_t blob_size) {
+    ZX_DEBUG_ASSERT(!Compressing());
+    if (buf_max < ChunkTableSize(blob_size)) {
+        return ZX_ERR_BUFFER_TOO_SMALL;
+    }
+
+    buf_ = buf;
+    buf_max_ = buf_max;
+    buf_used_ = ChunkTableSize(blob_size);
+    chunk_count_ = ChunkCount(blob_size);
+    chunk_ = 0;
+    chunk_used_ = 0;
+
+    ChunkTableHeader* header = reinterpret_cast<ChunkTableHeader*>(buf_);
+    header->magic = kBlobfsChunkTableMagic;
+    header->chunk_size = kBlobfsChunkSize;
+    header->chunk_count = chunk_count_;
+    header->reserved = 0;
+    return ZX_OK;
+}
+
+zx_status_t ChunkedCompressor::Update(const void* data_, size_t length) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(data_);
+    zx_status_t status;
+    while (length > 0) {
+        if (!frame_.Compressing()) {
+            if (chunk_ == chunk_count_) {
+                return ZX_ERR_OUT_OF_RANGE;
+            }
+            Offsets()[chunk_] = buf_used_;
+            if ((status = frame_.Initialize(reinterpret_cast<uint8_t*>(buf_) + buf_used_,
+                                            buf_max_ - buf_used_)) != ZX_OK) {
+                return status;
+            }
+        }
+
+        size_t to_compress = fbl::min<size_t>(length, kBlobfsChunkSize - chunk_used_);
+        if ((status = frame_.Update(data, to_compress)) != ZX_OK) {
+            return status;
+        }
+        data += to_compress;
+        length -= to_compress;
+        chunk_used_ += to_compress;
+        if (chunk_used_ == kBlobfsChunkSize && (status = EndChunk()) != ZX_OK) {
+            return status;
+        }
+    }
+    return ZX_OK;
+}
+
+zx_status_t ChunkedCompressor::EndChunk() {
+    zx_status_t status = frame_.End();
+    if (status != ZX_OK) {
+        return status;
+    }
+    buf_used_ += frame_.Size();
+    frame_.Reset();
+    chunk_used_ = 0;
+    chunk_++;
+    return ZX_OK;
+}
+
+zx_status_t ChunkedCompressor::End() {
+    zx_status_t status;
+    if (frame_.Compressing() && (status = EndChunk()) != ZX_OK) {
+        return status;
+    }
+    if (chunk_ != chunk_count_) {
+        return ZX_ERR_BAD_STATE;
+    }
+    Offsets()[chunk_count_] = buf_used_;
+    return ZX_OK;
+}
+
+size_t ChunkedCompressor::Size() const {
+    ZX_DEBUG_ASSERT(Compressing());
+    return buf_used_ + (frame_.Compressing() ? frame_.Size() : 0);
+}
+
 zx_status_t Decompressor::Decompress(void* target_buf_, size_t* target_size,
                                      const void* src_buf_, size_t* src_size) {
     TRACE_DURATION("blobfs", "Decompressor::Decompress", "target_size", *target_size,
@@ -114,9 +201,13 @@ zx_status_t Decompressor::Decompress(void* target_buf_, size_t* target_size,
             break;
         }
 
+        // Never read past the end of the source, even if the frame claims
+        // there is more of it.
+        if (src_drained == *src_size) {
+            return ZX_ERR_IO_DATA_INTEGRITY;
+        }
         dst_sz_next = *target_size - target_drained;
-        src_sz_next = r;
-
+        src_sz_next = fbl::min(r, *src_size - src_drained);
     }
 
     *target_size = target_drained;
@@ -124,4 +215,64 @@ zx_status_t Decompressor::Decompress(void* target_buf_, size_t* target_size,
     return ZX_OK;
 }
 
+zx_status_t ChunkedDecompressor::ValidateTable(const void* src_buf, uint64_t blob_size,
+                                               size_t compressed_size) {
+    if (compressed_size < ChunkTableSize(blob_size)) {
+        return ZX_ERR_IO_DATA_INTEGRITY;
+    }
+    const ChunkTableHeader* header = reinterpret_cast<const ChunkTableHeader*>(src_buf);
+    if (header->magic != kBlobfsChunkTableMagic || header->chunk_size != kBlobfsChunkSize ||
+        header->chunk_count != ChunkCount(blob_size)) {
+        return ZX_ERR_IO_DATA_INTEGRITY;
+    }
+    const uint64_t* offsets = Offsets(src_buf);
+    if (offsets[0] != ChunkTableSize(blob_size)) {
+        return ZX_ERR_IO_DATA_INTEGRITY;
+    }
+    for (uint64_t i = 0; i < header->chunk_count; i++) {
+        if (offsets[i + 1] <= offsets[i]) {
+            return ZX_ERR_IO_DATA_INTEGRITY;
+        }
+    }
+    if (offsets[header->chunk_count] > compressed_size) {
+        return ZX_ERR_IO_DATA_INTEGRITY;
+    }
+    return ZX_OK;
+}
+
+zx_status_t ChunkedDecompressor::DecompressChunk(void* target_buf, size_t target_size,
+                                                 const void* src_buf, uint64_t chunk) {
+    const uint64_t* offsets = Offsets(src_buf);
+    size_t src_size = offsets[chunk + 1] - offsets[chunk];
+    size_t decompressed = target_size;
+    zx_status_t status = Decompressor::Decompress(
+            target_buf, &decompressed,
+            reinterpret_cast<const uint8_t*>(src_buf) + offsets[chunk], &src_size);
+    if (status != ZX_OK) {
+        return status;
+    } else if (decompressed != target_size) {
+        FS_TRACE_ERROR("Failed to fully decompress chunk %" PRIu64 " (%zu of %zu expected)\n",
+                       chunk, decompressed, target_size);
+        return ZX_ERR_IO_DATA_INTEGRITY;
+    }
+    return ZX_OK;
+}
+
+zx_status_t ChunkedDecompressor::Decompress(void* target_buf, uint64_t blob_size,
+                                            const void* src_buf, size_t src_size) {
+    zx_status_t status = ValidateTable(src_buf, blob_size, src_size);
+    if (status != ZX_OK) {
+        return status;
+    }
+    uint8_t* target = reinterpret_cast<uint8_t*>(target_buf);
+    for (uint64_t chunk = 0; chunk < ChunkCount(blob_size); chunk++) {
+        uint64_t offset = chunk * kBlobfsChunkSize;
+        size_t target_size = fbl::min<uint64_t>(kBlobfsChunkSize, blob_size - offset);
+        if ((status = DecompressChunk(target + offset, target_size, src_buf, chunk)) != ZX_OK) {
+            return status;
+        }
+    }
+    return ZX_OK;
+}
+
 } // namespace blobfs
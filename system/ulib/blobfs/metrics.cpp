@@ -17,6 +17,14 @@ size_t TicksToMs(const zx::ticks& ticks) {
     return fzl::TicksToNs(ticks) / zx::msec(1);
 }
 
+// Prints how much CPU time some work took, and how much faster running it on
+// several threads made it.
+void PrintParallelism(const char* work, const zx::ticks& wall, const zx::ticks& cpu) {
+    size_t speedup = wall.get() > 0 ? static_cast<size_t>(cpu.get() * 100 / wall.get()) : 100;
+    printf("  Spent %zu ms of CPU time %s, %zu.%02zux parallel speedup\n",
+           TicksToMs(cpu), work, speedup / 100, speedup % 100);
+}
+
 } // namespace
 
 void BlobfsMetrics::Dump() const {
@@ -45,6 +53,19 @@ void BlobfsMetrics::Dump() const {
            TicksToMs(total_read_from_disk_time_ticks),
            bytes_read_from_disk / mb,
            TicksToMs(total_verification_time_ticks));
+    PrintParallelism("verifying", total_verification_time_ticks,
+                     total_verification_cpu_time_ticks);
+    printf("  Spent %zu ms reading %zu MB of compressed data, %zu ms decompressing %zu MB\n",
+           TicksToMs(total_read_compressed_time_ticks),
+           bytes_compressed_read_from_disk / mb,
+           TicksToMs(total_decompress_time_ticks),
+           bytes_decompressed_from_disk / mb);
+    PrintParallelism("decompressing", total_decompress_time_ticks,
+                     total_decompress_cpu_time_ticks);
+    printf("Cache Info:\n");
+    printf("  Found %zu blobs in memory, read %zu blobs from disk\n",
+           cache_hits, cache_misses);
+    printf("  Evicted %zu blobs (%zu MB)\n", cache_evictions, cache_evicted_size / mb);
 }
 
 } // namespace blobfs
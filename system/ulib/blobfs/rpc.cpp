@@ -23,6 +23,7 @@ namespace blobfs {
 
 zx_status_t VnodeBlob::GetHandles(uint32_t flags, zx_handle_t* hnd, uint32_t* type,
                                   zxrio_node_info_t* extra) {
+    fbl::AutoLock lock(&lock_);
     if (IsDirectory()) {
         *type = fuchsia_io_NodeInfoTag_directory;
         return ZX_OK;
@@ -24,6 +24,7 @@ MODULE_SRCS := \
     $(LOCAL_DIR)/metrics.cpp \
     $(LOCAL_DIR)/writeback.cpp \
     $(LOCAL_DIR)/vnode.cpp \
+    $(LOCAL_DIR)/workers.cpp \
     $(LOCAL_DIR)/rpc.cpp \
 
 MODULE_STATIC_LIBS := \
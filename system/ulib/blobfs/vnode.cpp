@@ -45,7 +45,11 @@ void VnodeBlob::TearDown() {
     if (blob_ != nullptr) {
         blobfs_->DetachVmo(vmoid_);
     }
+    if (compressed_ != nullptr) {
+        blobfs_->DetachVmo(compressed_vmoid_);
+    }
     blob_ = nullptr;
+    compressed_ = nullptr;
 }
 
 VnodeBlob::~VnodeBlob() {
@@ -53,6 +57,7 @@ VnodeBlob::~VnodeBlob() {
 }
 
 zx_status_t VnodeBlob::ValidateFlags(uint32_t flags) {
+    fbl::AutoLock lock(&lock_);
     if ((flags & ZX_FS_FLAG_DIRECTORY) && !IsDirectory()) {
         return ZX_ERR_NOT_DIR;
     }
@@ -78,6 +83,7 @@ zx_status_t VnodeBlob::Readdir(fs::vdircookie_t* cookie, void* dirents, size_t l
 
 zx_status_t VnodeBlob::Read(void* data, size_t len, size_t off, size_t* out_actual) {
     TRACE_DURATION("blobfs", "VnodeBlob::Read", "len", len, "off", off);
+    fbl::AutoLock lock(&lock_);
 
     if (IsDirectory()) {
         return ZX_ERR_NOT_FILE;
@@ -89,6 +95,7 @@ zx_status_t VnodeBlob::Read(void* data, size_t len, size_t off, size_t* out_actu
 zx_status_t VnodeBlob::Write(const void* data, size_t len, size_t offset,
                              size_t* out_actual) {
     TRACE_DURATION("blobfs", "VnodeBlob::Write", "len", len, "off", offset);
+    fbl::AutoLock lock(&lock_);
     if (IsDirectory()) {
         return ZX_ERR_NOT_FILE;
     }
@@ -97,6 +104,7 @@ zx_status_t VnodeBlob::Write(const void* data, size_t len, size_t offset,
 
 zx_status_t VnodeBlob::Append(const void* data, size_t len, size_t* out_end,
                               size_t* out_actual) {
+    fbl::AutoLock lock(&lock_);
     zx_status_t status = WriteInternal(data, len, out_actual);
     if (GetState() == kBlobStateDataWrite) {
         ZX_DEBUG_ASSERT(write_info_ != nullptr);
@@ -134,6 +142,7 @@ zx_status_t VnodeBlob::Lookup(fbl::RefPtr<fs::Vnode>* out, fbl::StringPiece name
 }
 
 zx_status_t VnodeBlob::Getattr(vnattr_t* a) {
+    fbl::AutoLock lock(&lock_);
     memset(a, 0, sizeof(vnattr_t));
     a->mode = (IsDirectory() ? V_TYPE_DIR : V_TYPE_FILE) | V_IRUSR;
     a->inode = fuchsia_io_INO_UNKNOWN;
@@ -163,13 +172,17 @@ zx_status_t VnodeBlob::Create(fbl::RefPtr<fs::Vnode>* out, fbl::StringPiece name
     if ((status = blobfs_->NewBlob(digest, &vn)) != ZX_OK) {
         return status;
     }
-    vn->fd_count_ = 1;
+    {
+        fbl::AutoLock lock(&vn->lock_);
+        vn->fd_count_ = 1;
+    }
     *out = fbl::move(vn);
     return ZX_OK;
 }
 
 zx_status_t VnodeBlob::Truncate(size_t len) {
     TRACE_DURATION("blobfs", "VnodeBlob::Truncate", "len", len);
+    fbl::AutoLock lock(&lock_);
 
     if (IsDirectory()) {
         return ZX_ERR_NOT_SUPPORTED;
@@ -191,6 +204,7 @@ zx_status_t VnodeBlob::QueryFilesystem(fuchsia_io_FilesystemInfo* info) {
     info->max_filename_size = Digest::kLength * 2;
     info->fs_type = VFS_TYPE_BLOBFS;
     info->fs_id = blobfs_->GetFsId();
+    fbl::AutoLock lock(&blobfs_->metadata_lock_);
     info->total_bytes = blobfs_->info_.block_count * blobfs_->info_.block_size;
     info->used_bytes = blobfs_->info_.alloc_block_count * blobfs_->info_.block_size;
     info->total_nodes = blobfs_->info_.inode_count;
@@ -231,6 +245,7 @@ zx_status_t VnodeBlob::Unlink(fbl::StringPiece name, bool must_be_dir) {
 
 zx_status_t VnodeBlob::GetVmo(int flags, zx_handle_t* out) {
     TRACE_DURATION("blobfs", "VnodeBlob::GetVmo", "flags", flags);
+    fbl::AutoLock lock(&lock_);
 
     if (IsDirectory()) {
         return ZX_ERR_NOT_SUPPORTED;
@@ -275,8 +290,9 @@ void VnodeBlob::CompleteSync() {
 }
 
 fbl::RefPtr<VnodeBlob> VnodeBlob::CloneWatcherTeardown() {
-    if (clone_watcher_.is_pending()) {
-        clone_watcher_.Cancel();
+    // If the wait is cancelled, |HandleNoClones| will not run to release the
+    // reference; if it could not be, the handler is already on its way.
+    if (clone_watcher_.Cancel() == ZX_OK) {
         clone_watcher_.set_object(ZX_HANDLE_INVALID);
         return fbl::move(clone_ref_);
     }
@@ -284,11 +300,13 @@ fbl::RefPtr<VnodeBlob> VnodeBlob::CloneWatcherTeardown() {
 }
 
 zx_status_t VnodeBlob::Open(uint32_t flags, fbl::RefPtr<Vnode>* out_redirect) {
+    fbl::AutoLock lock(&lock_);
     fd_count_++;
     return ZX_OK;
 }
 
 zx_status_t VnodeBlob::Close() {
+    fbl::AutoLock lock(&lock_);
     ZX_DEBUG_ASSERT_MSG(fd_count_ > 0, "Closing blob with no fds open");
     fd_count_--;
     // Attempt purge in case blob was unlinked prior to close
@@ -0,0 +1,105 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <fbl/algorithm.h>
+#include <fbl/alloc_checker.h>
+#include <fbl/atomic.h>
+#include <fbl/unique_ptr.h>
+#include <lib/async/cpp/task.h>
+#include <lib/sync/completion.h>
+#include <zircon/types.h>
+
+#include <blobfs/workers.h>
+
+namespace blobfs {
+namespace {
+
+// The state of one call to WorkerPool::Run(), shared by every thread which
+// works on it.
+struct Job {
+    Job(size_t count, const WorkerPool::WorkFn& fn) : count(count), fn(fn) {}
+
+    // Claims indices until there are none left, or a call has failed.
+    void Work() {
+        size_t index;
+        while (status.load() == ZX_OK && (index = next.fetch_add(1)) < count) {
+            zx_status_t result = fn(index);
+            if (result != ZX_OK) {
+                zx_status_t expected = ZX_OK;
+                status.compare_exchange_strong(&expected, result, fbl::memory_order_seq_cst,
+                                               fbl::memory_order_seq_cst);
+            }
+        }
+    }
+
+    // Called by each thread once it has stopped working on the job.
+    void Release() {
+        if (workers.fetch_sub(1) == 1) {
+            sync_completion_signal(&done);
+        }
+    }
+
+    const size_t count;
+    const WorkerPool::WorkFn& fn;
+    fbl::atomic<size_t> next = {0};
+    fbl::atomic<zx_status_t> status = {ZX_OK};
+    // Starts at one for the thread which called Run().
+    fbl::atomic<uint32_t> workers = {1};
+    sync_completion_t done;
+};
+
+} // namespace
+
+WorkerPool::WorkerPool(uint32_t threads)
+    : loop_(&kAsyncLoopConfigNoAttachToThread), threads_(threads) {}
+
+WorkerPool::~WorkerPool() {
+    loop_.Shutdown();
+}
+
+zx_status_t WorkerPool::Create(uint32_t threads, fbl::unique_ptr<WorkerPool>* out) {
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<WorkerPool> pool(new (&ac) WorkerPool(threads));
+    if (!ac.check()) {
+        return ZX_ERR_NO_MEMORY;
+    }
+    for (uint32_t i = 0; i < threads; i++) {
+        zx_status_t status = pool->loop_.StartThread("blobfs-worker");
+        if (status != ZX_OK) {
+            return status;
+        }
+    }
+    *out = fbl::move(pool);
+    return ZX_OK;
+}
+
+zx_status_t WorkerPool::Run(size_t count, const WorkFn& fn) {
+    if (count == 0) {
+        return ZX_OK;
+    }
+    Job job(count, fn);
+
+    // Only wake as many workers as there are indices for, beyond the one
+    // this thread takes on. A worker which is slow to start finds nothing
+    // left to do, which is fine.
+    size_t helpers = fbl::min<size_t>(threads_, count - 1);
+    for (size_t i = 0; i < helpers; i++) {
+        job.workers.fetch_add(1);
+        zx_status_t status = async::PostTask(loop_.dispatcher(), [&job]() {
+            job.Work();
+            job.Release();
+        });
+        if (status != ZX_OK) {
+            job.workers.fetch_sub(1);
+            break;
+        }
+    }
+
+    job.Work();
+    job.Release();
+    sync_completion_wait(&job.done, ZX_TIME_INFINITE);
+    return job.status.load();
+}
+
+} // namespace blobfs
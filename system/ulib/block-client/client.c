@@ -3,13 +3,14 @@
 // found in the LICENSE file.
 
 #include <assert.h>
+#include <stdbool.h>
+#include <threads.h>
 #include <unistd.h>
 
 #include <block-client/client.h>
 #include <zircon/compiler.h>
 #include <zircon/device/block.h>
 #include <zircon/syscalls.h>
-#include <lib/sync/completion.h>
 
 // Writes on a FIFO, repeating the write later if the FIFO is full.
 static zx_status_t do_write(zx_handle_t fifo, block_fifo_request_t* request, size_t count) {
@@ -59,14 +60,23 @@ static zx_status_t do_read(zx_handle_t fifo, block_fifo_response_t* response) {
     }
 }
 
-typedef struct block_completion {
-    sync_completion_t completion;
+typedef struct block_group {
     zx_status_t status;
-} block_sync_completion_t;
+    // Set from the time a transaction is sent on the group until it has been
+    // waited for.
+    bool in_flight;
+    // Set once the response of the transaction has been read.
+    bool done;
+} block_group_t;
 
 typedef struct fifo_client {
     zx_handle_t fifo;
-    block_sync_completion_t groups[MAX_TXN_GROUP_COUNT];
+    mtx_t lock;
+    // Signalled whenever a response has been read.
+    cnd_t response_read;
+    // Set while a waiting thread is reading responses on behalf of all of them.
+    bool reading;
+    block_group_t groups[MAX_TXN_GROUP_COUNT];
 } fifo_client_t;
 
 zx_status_t block_fifo_create_client(zx_handle_t fifo, fifo_client_t** out) {
@@ -76,6 +86,8 @@ zx_status_t block_fifo_create_client(zx_handle_t fifo, fifo_client_t** out) {
         return ZX_ERR_NO_MEMORY;
     }
     client->fifo = fifo;
+    mtx_init(&client->lock, mtx_plain);
+    cnd_init(&client->response_read);
     *out = client;
     return ZX_OK;
 }
@@ -86,46 +98,96 @@ void block_fifo_release_client(fifo_client_t* client) {
     }
 
     zx_handle_close(client->fifo);
+    cnd_destroy(&client->response_read);
+    mtx_destroy(&client->lock);
     free(client);
 }
 
-zx_status_t block_fifo_txn(fifo_client_t* client, block_fifo_request_t* requests, size_t count) {
+zx_status_t block_fifo_txn_begin(fifo_client_t* client, block_fifo_request_t* requests,
+                                 size_t count) {
     if (count == 0) {
-        return ZX_OK;
+        return ZX_ERR_INVALID_ARGS;
     }
 
     groupid_t group = requests[0].group;
     assert(group < MAX_TXN_GROUP_COUNT);
-    sync_completion_reset(&client->groups[group].completion);
-    client->groups[group].status = ZX_ERR_IO;
-
-    zx_status_t status;
     for (size_t i = 0; i < count; i++) {
         assert(requests[i].group == group);
-        requests[i].opcode = (requests[i].opcode & BLOCKIO_OP_MASK) | BLOCKIO_GROUP_ITEM;
+        requests[i].opcode = (requests[i].opcode & (BLOCKIO_OP_MASK | BLOCKIO_BARRIER_BEFORE |
+                                                    BLOCKIO_BARRIER_AFTER)) |
+                             BLOCKIO_GROUP_ITEM;
     }
+    requests[count - 1].opcode |= BLOCKIO_GROUP_LAST;
 
-    requests[0].opcode |= BLOCKIO_BARRIER_BEFORE;
-    requests[count - 1].opcode |= BLOCKIO_GROUP_LAST | BLOCKIO_BARRIER_AFTER;
+    mtx_lock(&client->lock);
+    assert(!client->groups[group].in_flight);
+    client->groups[group].in_flight = true;
+    client->groups[group].done = false;
+    client->groups[group].status = ZX_ERR_IO;
+    mtx_unlock(&client->lock);
 
-    if ((status = do_write(client->fifo, &requests[0], count)) != ZX_OK) {
-        return status;
+    zx_status_t status = do_write(client->fifo, &requests[0], count);
+    if (status != ZX_OK) {
+        mtx_lock(&client->lock);
+        client->groups[group].in_flight = false;
+        mtx_unlock(&client->lock);
     }
+    return status;
+}
 
-    // As expected by the protocol, when we send one "BLOCKIO_GROUP_LAST" message, we
-    // must read a reply message.
-    block_fifo_response_t response;
-    if ((status = do_read(client->fifo, &response)) != ZX_OK) {
-        return status;
+zx_status_t block_fifo_txn_wait(fifo_client_t* client, groupid_t group) {
+    assert(group < MAX_TXN_GROUP_COUNT);
+
+    zx_status_t status = ZX_OK;
+    mtx_lock(&client->lock);
+    assert(client->groups[group].in_flight);
+    while (!client->groups[group].done) {
+        if (client->reading) {
+            cnd_wait(&client->response_read, &client->lock);
+            continue;
+        }
+
+        // Nobody else is reading responses, so read one, which may belong to
+        // any group.  Only threads which wait read responses, so a response
+        // is never left unread while its group is waited for.
+        client->reading = true;
+        mtx_unlock(&client->lock);
+        block_fifo_response_t response;
+        status = do_read(client->fifo, &response);
+        mtx_lock(&client->lock);
+        client->reading = false;
+        if (status == ZX_OK && response.group < MAX_TXN_GROUP_COUNT &&
+            client->groups[response.group].in_flight) {
+            client->groups[response.group].status = response.status;
+            client->groups[response.group].done = true;
+        }
+        cnd_broadcast(&client->response_read);
+        if (status != ZX_OK) {
+            break;
+        }
     }
+    if (status == ZX_OK) {
+        status = client->groups[group].status;
+    }
+    client->groups[group].in_flight = false;
+    mtx_unlock(&client->lock);
+    return status;
+}
 
-    // Wake up someone who is waiting (it might be ourselves)
-    groupid_t response_group = response.group;
-    client->groups[response_group].status = response.status;
-    sync_completion_signal(&client->groups[response_group].completion);
+zx_status_t block_fifo_txn(fifo_client_t* client, block_fifo_request_t* requests, size_t count) {
+    if (count == 0) {
+        return ZX_OK;
+    }
 
-    // Wait for someone to signal us.
-    sync_completion_wait(&client->groups[group].completion, ZX_TIME_INFINITE);
+    for (size_t i = 0; i < count; i++) {
+        requests[i].opcode &= BLOCKIO_OP_MASK;
+    }
+    requests[0].opcode |= BLOCKIO_BARRIER_BEFORE;
+    requests[count - 1].opcode |= BLOCKIO_BARRIER_AFTER;
 
-    return client->groups[group].status;
+    zx_status_t status;
+    if ((status = block_fifo_txn_begin(client, requests, count)) != ZX_OK) {
+        return status;
+    }
+    return block_fifo_txn_wait(client, requests[0].group);
 }
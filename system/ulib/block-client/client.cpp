@@ -43,6 +43,16 @@ zx_status_t Client::Transaction(block_fifo_request_t* requests, size_t count) co
     return block_fifo_txn(client_, requests, count);
 }
 
+zx_status_t Client::BeginTransaction(block_fifo_request_t* requests, size_t count) const {
+    ZX_DEBUG_ASSERT(client_ != nullptr);
+    return block_fifo_txn_begin(client_, requests, count);
+}
+
+zx_status_t Client::WaitTransaction(groupid_t group) const {
+    ZX_DEBUG_ASSERT(client_ != nullptr);
+    return block_fifo_txn_wait(client_, group);
+}
+
 void Client::Reset(fifo_client_t* client) {
     if (client_ != nullptr) {
         block_fifo_release_client(client_);
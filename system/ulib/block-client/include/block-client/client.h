@@ -15,7 +15,7 @@ __BEGIN_CDECLS
 typedef struct fifo_client fifo_client_t;
 
 // Allocates a block fifo client. The client is thread-safe, as long
-// as each thread accessing the client uses a distinct reqid.
+// as each transaction in flight at once uses a distinct group.
 // This function takes ownership of |fifo|.
 //
 // Valid groups are in the range [0, MAX_TXN_GROUP_COUNT).
@@ -25,9 +25,8 @@ zx_status_t block_fifo_create_client(zx_handle_t fifo, fifo_client_t** out);
 void block_fifo_release_client(fifo_client_t* client);
 
 // Sends 'count' block device requests and waits for a response.
-// The current implementation is thread-safe, but may only be called from a
-// single process, as it differentiates callers by stack addresses (in an
-// effort to make each transaction require no heap allocation).
+// The requests are fenced by barriers, so they are not reordered with
+// any other requests on the device.
 //
 // Each of the requests should set the following:
 // FIELD                                    OPS
@@ -40,4 +39,19 @@ void block_fifo_release_client(fifo_client_t* client);
 // dev_offset                               read, write
 zx_status_t block_fifo_txn(fifo_client_t* client, block_fifo_request_t* requests, size_t count);
 
+// Sends 'count' (at least one) block device requests without waiting for a
+// response, so that transactions on several groups may be in flight at once.
+// The requests are set up as for block_fifo_txn, and may also set
+// BLOCKIO_BARRIER_BEFORE and BLOCKIO_BARRIER_AFTER; no other barriers are
+// added.
+//
+// block_fifo_txn_wait must be called for the group before the group is used
+// again.  The requests themselves may be reused as soon as this returns.
+zx_status_t block_fifo_txn_begin(fifo_client_t* client, block_fifo_request_t* requests,
+                                 size_t count);
+
+// Waits for the transaction sent on 'group' by block_fifo_txn_begin, and
+// returns its status.
+zx_status_t block_fifo_txn_wait(fifo_client_t* client, groupid_t group);
+
 __END_CDECLS
@@ -45,6 +45,15 @@ public:
     // and waits for a response.
     zx_status_t Transaction(block_fifo_request_t* requests, size_t count) const;
 
+    // Issues a group of block requests over the underlying fifo, without
+    // waiting for a response. |WaitTransaction| must be called for the
+    // group before it is used again.
+    zx_status_t BeginTransaction(block_fifo_request_t* requests, size_t count) const;
+
+    // Waits for the response to the requests last issued on |group| by
+    // |BeginTransaction|.
+    zx_status_t WaitTransaction(groupid_t group) const;
+
 private:
     // Replace the current fifo_client with a new one.
     void Reset(fifo_client_t* client = nullptr);
@@ -14,6 +14,8 @@
 #include <zircon/assert.h>
 #include <zircon/errors.h>
 
+#include "sha256-lanes.h"
+
 namespace digest {
 
 // Size of a node in bytes.  Defined in tree.h.
@@ -75,6 +77,44 @@ void DigestFinal(Digest* digest, size_t offset) {
     digest->Final();
 }
 
+// Hashes as many whole nodes at once as the CPU can, starting at the
+// node-aligned |offset| in a level of |data_len| bytes, and using at most
+// |length| bytes of |in|.  Writes the digests to |out| and their number to
+// |count|.  Returns the number of bytes hashed, or 0 if there are too few
+// nodes in |in| for this to beat hashing them one at a time.
+size_t DigestNodes(const uint8_t* in, size_t offset, size_t length, size_t data_len,
+                   uint64_t level, uint8_t (*out)[Digest::kLength], size_t* count) {
+    ZX_DEBUG_ASSERT(offset % MerkleTree::kNodeSize == 0);
+    size_t lanes = internal::Lanes();
+    if (lanes < 2) {
+        return 0;
+    }
+    // Each node is hashed after its locality and length, as in DigestInit.
+    uint8_t prefixes[internal::kMaxLanes][sizeof(uint64_t) + sizeof(uint32_t)];
+    internal::Lane nodes[internal::kMaxLanes];
+    size_t n = 0;
+    size_t hashed = 0;
+    while (n < lanes && offset + hashed < data_len) {
+        size_t node_len = fbl::min(data_len - offset - hashed, MerkleTree::kNodeSize);
+        if (node_len > length - hashed) {
+            break;
+        }
+        uint64_t locality = (offset + hashed) | level;
+        uint32_t len32 = static_cast<uint32_t>(node_len);
+        memcpy(prefixes[n], &locality, sizeof(locality));
+        memcpy(prefixes[n] + sizeof(locality), &len32, sizeof(len32));
+        nodes[n] = {prefixes[n], sizeof(prefixes[n]), in + hashed, node_len};
+        hashed += node_len;
+        ++n;
+    }
+    if (n < 2) {
+        return 0;
+    }
+    internal::HashLanes(nodes, n, sizeof(prefixes[0]) + MerkleTree::kNodeSize, out);
+    *count = n;
+    return hashed;
+}
+
 ////////
 // Helper functions for working between levels of the tree.
 
@@ -170,34 +210,50 @@ zx_status_t MerkleTree::CreateUpdate(const void* data, size_t length, void* tree
     // Consume the data.
     zx_status_t rc = ZX_OK;
     while (length > 0 && rc == ZX_OK) {
-        // Check if this is the start of a node.
-        if (offset_ % kNodeSize == 0 &&
-            (rc = DigestInit(&digest_, offset_ | level_, length_ - offset_)) != ZX_OK) {
-            break;
-        }
-        // Hash the node data.
-        size_t chunk = DigestUpdate(&digest_, in, offset_, length);
-        in += chunk;
-        offset_ += chunk;
-        length -= chunk;
-        // Done if not at the end of a node.
-        if (offset_ % kNodeSize != 0 && offset_ != length_) {
-            break;
+        uint8_t digests[internal::kMaxLanes][Digest::kLength];
+        size_t count = 0;
+        size_t chunk = 0;
+        // Hash several whole nodes at once if there are enough of them.
+        if (offset_ % kNodeSize == 0 && length_ > kNodeSize) {
+            chunk = DigestNodes(in, offset_, length, length_, level_, digests, &count);
+            in += chunk;
+            offset_ += chunk;
+            length -= chunk;
         }
-        DigestFinal(&digest_, offset_);
-        // Done if at the top of the tree.
-        if (length_ <= kNodeSize) {
-            break;
+        if (chunk == 0) {
+            // Check if this is the start of a node.
+            if (offset_ % kNodeSize == 0 &&
+                (rc = DigestInit(&digest_, offset_ | level_, length_ - offset_)) != ZX_OK) {
+                break;
+            }
+            // Hash the node data.
+            chunk = DigestUpdate(&digest_, in, offset_, length);
+            in += chunk;
+            offset_ += chunk;
+            length -= chunk;
+            // Done if not at the end of a node.
+            if (offset_ % kNodeSize != 0 && offset_ != length_) {
+                break;
+            }
+            DigestFinal(&digest_, offset_);
+            // Done if at the top of the tree.
+            if (length_ <= kNodeSize) {
+                break;
+            }
+            digest_.CopyTo(digests[0], Digest::kLength);
+            count = 1;
         }
-        // If this is the first digest in a new node, first initialize it.
-        if (tree_off % kNodeSize == 0) {
-            memset(out, 0, kNodeSize);
+        for (size_t i = 0; i < count && rc == ZX_OK; ++i) {
+            // If this is the first digest in a new node, first initialize it.
+            if (tree_off % kNodeSize == 0) {
+                memset(out, 0, kNodeSize);
+            }
+            // Add the digest and ascend the tree.
+            memcpy(out, digests[i], Digest::kLength);
+            rc = next_->CreateUpdate(out, Digest::kLength, next);
+            out += Digest::kLength;
+            tree_off += Digest::kLength;
         }
-        // Add the digest and ascend the tree.
-        digest_.CopyTo(out, Digest::kLength);
-        rc = next_->CreateUpdate(out, Digest::kLength, next);
-        out += Digest::kLength;
-        tree_off += Digest::kLength;
     }
     return rc;
 }
@@ -308,12 +364,28 @@ zx_status_t MerkleTree::VerifyLevel(const void* data, size_t data_len, const voi
     // The digests are in the next level up.
     Digest actual;
     const uint8_t* expected = static_cast<const uint8_t*>(tree) + (offset / kDigestsPerNode);
-    // Check the data of this level against the digests.
+    // Check the data of this level against the digests, several nodes at a
+    // time if there are enough of them.
     while (length > 0) {
+        uint8_t digests[internal::kMaxLanes][Digest::kLength];
+        size_t count;
+        size_t chunk = DigestNodes(in, offset, length, data_len, level, digests, &count);
+        if (chunk != 0) {
+            for (size_t i = 0; i < count; ++i) {
+                if (memcmp(digests[i], expected, Digest::kLength) != 0) {
+                    return ZX_ERR_IO_DATA_INTEGRITY;
+                }
+                expected += Digest::kLength;
+            }
+            in += chunk;
+            offset += chunk;
+            length -= chunk;
+            continue;
+        }
         if ((rc = DigestInit(&actual, offset | level, data_len - offset)) != ZX_OK) {
             return rc;
         }
-        size_t chunk = DigestUpdate(&actual, in, offset, length);
+        chunk = DigestUpdate(&actual, in, offset, length);
         in += chunk;
         offset += chunk;
         length -= chunk;
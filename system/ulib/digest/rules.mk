@@ -10,10 +10,11 @@ MODULE_TYPE := userlib
 
 MODULE_SRCS += \
     $(LOCAL_DIR)/digest.cpp \
-    $(LOCAL_DIR)/merkle-tree.cpp
+    $(LOCAL_DIR)/merkle-tree.cpp \
+    $(LOCAL_DIR)/sha256-lanes.cpp
 
 MODULE_SO_NAME := digest
-MODULE_LIBS := system/ulib/c
+MODULE_LIBS := system/ulib/c system/ulib/zircon
 
 MODULE_STATIC_LIBS := \
     third_party/ulib/uboringssl \
@@ -33,7 +34,8 @@ MODULE_COMPILEFLAGS := \
 
 MODULE_SRCS += \
     $(LOCAL_DIR)/digest.cpp \
-    $(LOCAL_DIR)/merkle-tree.cpp
+    $(LOCAL_DIR)/merkle-tree.cpp \
+    $(LOCAL_DIR)/sha256-lanes.cpp
 
 MODULE_HOST_LIBS := \
     third_party/ulib/uboringssl.hostlib \
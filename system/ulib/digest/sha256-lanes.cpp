@@ -0,0 +1,229 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "sha256-lanes.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <fbl/algorithm.h>
+#include <fbl/atomic.h>
+#include <zircon/assert.h>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#elif defined(__aarch64__) && defined(__Fuchsia__)
+#include <zircon/features.h>
+#include <zircon/syscalls.h>
+#endif
+
+namespace digest {
+namespace internal {
+namespace {
+
+constexpr size_t kBlockSize = 64;
+
+constexpr uint32_t kInitialState[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+constexpr uint32_t kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+// Four and eight 32-bit lanes.  The compiler turns arithmetic on these into
+// SSE2, AVX2 or NEON instructions.
+typedef uint32_t U32x4 __attribute__((vector_size(16)));
+typedef uint32_t U32x8 __attribute__((vector_size(32)));
+
+// These work on scalars and vectors alike.  They are macros rather than
+// functions so that no vector is ever passed by value, which would tie the
+// code to the calling convention of the baseline instruction set.
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z) (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define BSIG0(x) (ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
+#define BSIG1(x) (ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
+#define SSIG0(x) (ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
+#define SSIG1(x) (ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
+
+uint32_t LoadBE32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+           static_cast<uint32_t>(p[2]) << 8 | static_cast<uint32_t>(p[3]);
+}
+
+void StoreBE32(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v >> 24);
+    p[1] = static_cast<uint8_t>(v >> 16);
+    p[2] = static_cast<uint8_t>(v >> 8);
+    p[3] = static_cast<uint8_t>(v);
+}
+
+// Returns the block at |offset| of the message in |lane|, once padded as
+// SHA-256 requires.  Blocks which are entirely data are returned in place;
+// the others are assembled in |buf|.
+const uint8_t* GetBlock(const Lane& lane, size_t msg_len, size_t offset,
+                        uint8_t buf[kBlockSize]) {
+    size_t start = lane.prefix_len;
+    size_t end = lane.prefix_len + lane.data_len;
+    if (offset >= start && offset + kBlockSize <= end) {
+        return lane.data + (offset - start);
+    }
+    memset(buf, 0, kBlockSize);
+    if (offset < start) {
+        memcpy(buf, lane.prefix + offset, fbl::min(start - offset, kBlockSize));
+    }
+    size_t lo = fbl::max(offset, start);
+    size_t hi = fbl::min(offset + kBlockSize, end);
+    if (lo < hi) {
+        memcpy(buf + (lo - offset), lane.data + (lo - start), hi - lo);
+    }
+    if (msg_len >= offset && msg_len < offset + kBlockSize) {
+        buf[msg_len - offset] = 0x80;
+    }
+    if (offset + kBlockSize == fbl::round_up(msg_len + 9, kBlockSize)) {
+        uint64_t bits = static_cast<uint64_t>(msg_len) * 8;
+        StoreBE32(buf + kBlockSize - 8, static_cast<uint32_t>(bits >> 32));
+        StoreBE32(buf + kBlockSize - 4, static_cast<uint32_t>(bits));
+    }
+    return buf;
+}
+
+// Hashes up to |N| messages, with lane |i| of |V| holding the state of
+// message |i|.  Unused lanes hash a copy of the first message.
+template <typename V, size_t N>
+__attribute__((always_inline)) inline void HashLanesN(const Lane* lanes, size_t count,
+                                                      size_t msg_len,
+                                                      uint8_t (*out)[Digest::kLength]) {
+    V h[8];
+    for (size_t i = 0; i < 8; ++i) {
+        h[i] = V{} + kInitialState[i];
+    }
+    uint8_t bufs[N][kBlockSize];
+    alignas(sizeof(V)) uint32_t words[16][N];
+    size_t padded_len = fbl::round_up(msg_len + 9, kBlockSize);
+    for (size_t offset = 0; offset < padded_len; offset += kBlockSize) {
+        // Transpose the blocks so that each vector holds the same word of
+        // every message.
+        for (size_t lane = 0; lane < N; ++lane) {
+            const uint8_t* block =
+                GetBlock(lanes[lane < count ? lane : 0], msg_len, offset, bufs[lane]);
+            for (size_t t = 0; t < 16; ++t) {
+                words[t][lane] = LoadBE32(block + 4 * t);
+            }
+        }
+        V w[16];
+        memcpy(w, words, sizeof(w));
+
+        V a = h[0], b = h[1], c = h[2], d = h[3];
+        V e = h[4], f = h[5], g = h[6], k = h[7];
+        for (size_t t = 0; t < 64; ++t) {
+            if (t >= 16) {
+                w[t % 16] += SSIG1(w[(t - 2) % 16]) + w[(t - 7) % 16] + SSIG0(w[(t - 15) % 16]);
+            }
+            V t1 = k + BSIG1(e) + CH(e, f, g) + kRoundConstants[t] + w[t % 16];
+            V t2 = BSIG0(a) + MAJ(a, b, c);
+            k = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+        h[5] += f;
+        h[6] += g;
+        h[7] += k;
+    }
+    for (size_t lane = 0; lane < count; ++lane) {
+        for (size_t i = 0; i < 8; ++i) {
+            StoreBE32(&out[lane][4 * i], h[i][lane]);
+        }
+    }
+}
+
+void HashLanes4(const Lane* lanes, size_t count, size_t msg_len,
+                uint8_t (*out)[Digest::kLength]) {
+    HashLanesN<U32x4, 4>(lanes, count, msg_len, out);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2"))) void HashLanes8(const Lane* lanes, size_t count,
+                                               size_t msg_len,
+                                               uint8_t (*out)[Digest::kLength]) {
+    HashLanesN<U32x8, 8>(lanes, count, msg_len, out);
+}
+#endif
+
+size_t DetectLanes() {
+#if defined(__x86_64__)
+    // SSE2 is always there, AVX2 needs both the CPU and the OS to support it.
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, nullptr) < 7) {
+        return 4;
+    }
+    __cpuid(1, eax, ebx, ecx, edx);
+    if ((ecx & bit_OSXSAVE) == 0) {
+        return 4;
+    }
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx & bit_AVX2) != 0 && (xcr0_lo & 0x6) == 0x6 ? 8 : 4;
+#elif defined(__aarch64__) && defined(__Fuchsia__)
+    // BoringSSL uses the SHA-2 instructions when there are some, and they
+    // beat hashing in NEON lanes.
+    uint32_t features;
+    if (zx_system_get_features(ZX_FEATURE_KIND_CPU, &features) == ZX_OK &&
+        (features & ZX_ARM64_FEATURE_ISA_SHA2) != 0) {
+        return 1;
+    }
+    return 4;
+#else
+    return 1;
+#endif
+}
+
+fbl::atomic<size_t> gLanes(0);
+
+} // namespace
+
+size_t Lanes() {
+    size_t lanes = gLanes.load(fbl::memory_order_relaxed);
+    if (lanes == 0) {
+        lanes = DetectLanes();
+        gLanes.store(lanes, fbl::memory_order_relaxed);
+    }
+    return lanes;
+}
+
+void HashLanes(const Lane* lanes, size_t count, size_t msg_len,
+               uint8_t (*out)[Digest::kLength]) {
+    ZX_DEBUG_ASSERT(count <= kMaxLanes);
+#if defined(__x86_64__)
+    if (Lanes() == 8) {
+        HashLanes8(lanes, count, msg_len, out);
+        return;
+    }
+#endif
+    ZX_DEBUG_ASSERT(count <= 4);
+    HashLanes4(lanes, count, msg_len, out);
+}
+
+} // namespace internal
+} // namespace digest
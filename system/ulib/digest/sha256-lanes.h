@@ -0,0 +1,41 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <digest/digest.h>
+
+namespace digest {
+namespace internal {
+
+// SHA-256 of several messages at once, one message per SIMD lane.  This is
+// only faster than hashing the messages one at a time when they all have the
+// same length, which is the case for the nodes of a Merkle tree.
+
+// The most messages |HashLanes| hashes at once.
+constexpr size_t kMaxLanes = 8;
+
+// A message made of |prefix_len| bytes of |prefix|, then |data_len| bytes of
+// |data|, then zeros up to the message length given to |HashLanes|.
+struct Lane {
+    const uint8_t* prefix;
+    size_t prefix_len;
+    const uint8_t* data;
+    size_t data_len;
+};
+
+// Returns how many messages this CPU hashes at once with |HashLanes|, or 1 if
+// hashing them one at a time with |Digest| is faster.
+size_t Lanes();
+
+// Writes the SHA-256 digests of the |count| messages in |lanes|, which are
+// all |msg_len| bytes long, to |out|.  |count| must be at most |Lanes()|.
+void HashLanes(const Lane* lanes, size_t count, size_t msg_len,
+               uint8_t (*out)[Digest::kLength]);
+
+} // namespace internal
+} // namespace digest
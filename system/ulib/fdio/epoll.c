@@ -0,0 +1,418 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <poll.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <threads.h>
+
+#include <zircon/syscalls.h>
+#include <zircon/syscalls/port.h>
+#include <lib/fdio/util.h>
+
+#include "private.h"
+#include "unistd.h"
+
+// An epoll instance is a port with an async wait registered for each
+// descriptor in its interest set.  The waits stay registered between calls
+// to epoll_wait(), so a wait only costs time for descriptors that are
+// actually ready.
+//
+// Level-triggered registrations use one-shot waits.  After one is
+// reported it is re-armed at the start of the next epoll_wait(): if the
+// descriptor is still ready then, the kernel queues a new packet straight
+// away.  Edge-triggered registrations use repeating waits and are never
+// re-armed.
+
+// The event bits that may be requested.  The rest are flags.
+#define EPOLL_EVENT_MASK (EPOLLIN | EPOLLPRI | EPOLLOUT | EPOLLRDHUP | EPOLLERR | EPOLLHUP)
+
+typedef struct epoll_entry epoll_entry_t;
+struct epoll_entry {
+    // The registered descriptor, acquired for as long as it's registered.
+    fdio_t* io;
+    int fd;
+    zx_handle_t handle;
+    zx_signals_t signals;
+
+    // As passed to epoll_ctl().
+    uint32_t events;
+    epoll_data_t data;
+
+    // Distinguishes this registration's packets from those of earlier
+    // registrations of the same descriptor.
+    uint32_t generation;
+
+    // Set while a wait is registered.
+    bool armed;
+
+    // Set while on the instance's list of entries to re-arm.
+    bool rearm_pending;
+    epoll_entry_t* rearm_next;
+};
+
+typedef struct fdio_epoll {
+    fdio_t io;
+    zx_handle_t port;
+
+    // Protects everything below.
+    mtx_t lock;
+    uint32_t generation;
+    epoll_entry_t* entries[FDIO_MAX_FD];
+
+    // Level-triggered entries that have been reported since the last call
+    // to epoll_wait().
+    epoll_entry_t* rearm_list;
+} fdio_epoll_t;
+
+static uint64_t epoll_key(const epoll_entry_t* entry) {
+    return ((uint64_t)entry->generation << 32) | (uint32_t)entry->fd;
+}
+
+// Registers the async wait for |entry| on the port.
+static zx_status_t epoll_arm(fdio_epoll_t* ep, epoll_entry_t* entry) {
+    uint32_t options = (entry->events & (EPOLLET | EPOLLONESHOT)) == EPOLLET
+                           ? ZX_WAIT_ASYNC_REPEATING
+                           : ZX_WAIT_ASYNC_ONCE;
+    zx_status_t status = zx_object_wait_async(entry->handle, ep->port, epoll_key(entry),
+                                              entry->signals, options);
+    if (status == ZX_OK) {
+        entry->armed = true;
+    }
+    return status;
+}
+
+static void epoll_remove_rearm(fdio_epoll_t* ep, epoll_entry_t* entry) {
+    if (!entry->rearm_pending) {
+        return;
+    }
+    epoll_entry_t** link = &ep->rearm_list;
+    while (*link != entry) {
+        link = &(*link)->rearm_next;
+    }
+    *link = entry->rearm_next;
+    entry->rearm_pending = false;
+}
+
+static void epoll_entry_free(fdio_epoll_t* ep, epoll_entry_t* entry) {
+    epoll_remove_rearm(ep, entry);
+    if (entry->armed) {
+        // This fails harmlessly if the descriptor has been closed, as that
+        // cancels the wait anyway.
+        zx_port_cancel(ep->port, entry->handle, epoll_key(entry));
+    }
+    fdio_release(entry->io);
+    free(entry);
+}
+
+// Sets up |entry| to wait for |events| on its descriptor.
+static zx_status_t epoll_entry_init(fdio_epoll_t* ep, epoll_entry_t* entry,
+                                    const struct epoll_event* event) {
+    entry->events = event->events;
+    entry->data = event->data;
+    entry->generation = ep->generation++;
+    entry->armed = false;
+    epoll_remove_rearm(ep, entry);
+
+    // EPOLLERR and EPOLLHUP are always reported, as with poll().
+    uint32_t events = (event->events & EPOLL_EVENT_MASK) | EPOLLERR | EPOLLHUP;
+    entry->io->ops->wait_begin(entry->io, events, &entry->handle, &entry->signals);
+    if (entry->handle == ZX_HANDLE_INVALID) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+    return epoll_arm(ep, entry);
+}
+
+static zx_status_t epoll_close(fdio_t* io) {
+    fdio_epoll_t* ep = (fdio_epoll_t*)io;
+    mtx_lock(&ep->lock);
+    for (int fd = 0; fd < FDIO_MAX_FD; fd++) {
+        if (ep->entries[fd] != NULL) {
+            epoll_entry_free(ep, ep->entries[fd]);
+            ep->entries[fd] = NULL;
+        }
+    }
+    zx_handle_close(ep->port);
+    ep->port = ZX_HANDLE_INVALID;
+    mtx_unlock(&ep->lock);
+    return ZX_OK;
+}
+
+static fdio_ops_t fdio_epoll_ops = {
+    .read = fdio_default_read,
+    .read_at = fdio_default_read_at,
+    .write = fdio_default_write,
+    .write_at = fdio_default_write_at,
+    .seek = fdio_default_seek,
+    .misc = fdio_default_misc,
+    .close = epoll_close,
+    .open = fdio_default_open,
+    .clone = fdio_default_clone,
+    .ioctl = fdio_default_ioctl,
+    .unwrap = fdio_default_unwrap,
+    .wait_begin = fdio_default_wait_begin,
+    .wait_end = fdio_default_wait_end,
+    .posix_ioctl = fdio_default_posix_ioctl,
+    .get_vmo = fdio_default_get_vmo,
+    .get_token = fdio_default_get_token,
+    .get_attr = fdio_default_get_attr,
+    .set_attr = fdio_default_set_attr,
+    .sync = fdio_default_sync,
+    .readdir = fdio_default_readdir,
+    .rewind = fdio_default_rewind,
+    .unlink = fdio_default_unlink,
+    .truncate = fdio_default_truncate,
+    .rename = fdio_default_rename,
+    .link = fdio_default_link,
+    .get_flags = fdio_default_get_flags,
+    .set_flags = fdio_default_set_flags,
+    .recvfrom = fdio_default_recvfrom,
+    .sendto = fdio_default_sendto,
+    .recvmsg = fdio_default_recvmsg,
+    .sendmsg = fdio_default_sendmsg,
+    .shutdown = fdio_default_shutdown,
+};
+
+// Returns the epoll instance behind |epfd|, acquired, or NULL.
+static fdio_epoll_t* fd_to_epoll(int epfd) {
+    fdio_t* io = fd_to_io(epfd);
+    if (io == NULL) {
+        return NULL;
+    }
+    if (!(io->ioflag & IOFLAG_EPOLL)) {
+        fdio_release(io);
+        return NULL;
+    }
+    return (fdio_epoll_t*)io;
+}
+
+__EXPORT
+int epoll_create1(int flags) {
+    if (flags & ~EPOLL_CLOEXEC) {
+        return ERRNO(EINVAL);
+    }
+
+    fdio_epoll_t* ep = fdio_alloc(sizeof(*ep));
+    if (ep == NULL) {
+        return ERRNO(ENOMEM);
+    }
+    zx_status_t status = zx_port_create(0, &ep->port);
+    if (status != ZX_OK) {
+        free(ep);
+        return ERROR(status);
+    }
+    mtx_init(&ep->lock, mtx_plain);
+    ep->io.ops = &fdio_epoll_ops;
+    ep->io.magic = FDIO_MAGIC;
+    ep->io.refcount = 1;
+    ep->io.ioflag = IOFLAG_EPOLL;
+    if (flags & EPOLL_CLOEXEC) {
+        ep->io.ioflag |= IOFLAG_CLOEXEC;
+    }
+
+    int fd = fdio_bind_to_fd(&ep->io, -1, 0);
+    if (fd < 0) {
+        fdio_close(&ep->io);
+        fdio_release(&ep->io);
+        return ERRNO(EMFILE);
+    }
+    return fd;
+}
+
+__EXPORT
+int epoll_create(int size) {
+    if (size <= 0) {
+        return ERRNO(EINVAL);
+    }
+    return epoll_create1(0);
+}
+
+__EXPORT
+int epoll_ctl(int epfd, int op, int fd, struct epoll_event* event) {
+    if (fd < 0 || fd >= FDIO_MAX_FD || fd == epfd) {
+        return ERRNO(fd == epfd ? EINVAL : EBADF);
+    }
+    if (op != EPOLL_CTL_DEL && event == NULL) {
+        return ERRNO(EFAULT);
+    }
+
+    fdio_epoll_t* ep = fd_to_epoll(epfd);
+    if (ep == NULL) {
+        return ERRNO(EBADF);
+    }
+    fdio_t* io = fd_to_io(fd);
+    if (io == NULL) {
+        fdio_release(&ep->io);
+        return ERRNO(EBADF);
+    }
+
+    int result = 0;
+    mtx_lock(&ep->lock);
+
+    // A registration outlives its descriptor being closed, as it holds a
+    // reference.  If the number now refers to something else, the old
+    // registration is dead: drop it.
+    epoll_entry_t* entry = ep->entries[fd];
+    if (entry != NULL && entry->io != io) {
+        epoll_entry_free(ep, entry);
+        ep->entries[fd] = entry = NULL;
+    }
+
+    switch (op) {
+    case EPOLL_CTL_ADD: {
+        if (entry != NULL) {
+            result = ERRNO(EEXIST);
+            break;
+        }
+        entry = calloc(1, sizeof(*entry));
+        if (entry == NULL) {
+            result = ERRNO(ENOMEM);
+            break;
+        }
+        fdio_acquire(io);
+        entry->io = io;
+        entry->fd = fd;
+        zx_status_t status = epoll_entry_init(ep, entry, event);
+        if (status != ZX_OK) {
+            epoll_entry_free(ep, entry);
+            result = status == ZX_ERR_NOT_SUPPORTED ? ERRNO(EPERM) : ERROR(status);
+            break;
+        }
+        ep->entries[fd] = entry;
+        break;
+    }
+    case EPOLL_CTL_MOD: {
+        if (entry == NULL) {
+            result = ERRNO(ENOENT);
+            break;
+        }
+        if (entry->armed) {
+            zx_port_cancel(ep->port, entry->handle, epoll_key(entry));
+        }
+        zx_status_t status = epoll_entry_init(ep, entry, event);
+        if (status != ZX_OK) {
+            epoll_entry_free(ep, entry);
+            ep->entries[fd] = NULL;
+            result = ERROR(status);
+        }
+        break;
+    }
+    case EPOLL_CTL_DEL:
+        if (entry == NULL) {
+            result = ERRNO(ENOENT);
+            break;
+        }
+        epoll_entry_free(ep, entry);
+        ep->entries[fd] = NULL;
+        break;
+    default:
+        result = ERRNO(EINVAL);
+        break;
+    }
+
+    mtx_unlock(&ep->lock);
+    fdio_release(io);
+    fdio_release(&ep->io);
+    return result;
+}
+
+// Translates |packet| into |event|.  Returns false if the packet is stale or
+// reports nothing that was asked for.
+static bool epoll_deliver(fdio_epoll_t* ep, const zx_port_packet_t* packet,
+                          struct epoll_event* event) {
+    if (!ZX_PKT_IS_SIGNAL_ONE(packet->type) && !ZX_PKT_IS_SIGNAL_REP(packet->type)) {
+        return false;
+    }
+    uint32_t fd = (uint32_t)packet->key;
+    if (fd >= FDIO_MAX_FD) {
+        return false;
+    }
+    epoll_entry_t* entry = ep->entries[fd];
+    if (entry == NULL || epoll_key(entry) != packet->key) {
+        return false;
+    }
+
+    if (ZX_PKT_IS_SIGNAL_ONE(packet->type)) {
+        entry->armed = false;
+        if (!(entry->events & EPOLLONESHOT)) {
+            entry->rearm_next = ep->rearm_list;
+            ep->rearm_list = entry;
+            entry->rearm_pending = true;
+        }
+    }
+
+    uint32_t events = 0;
+    entry->io->ops->wait_end(entry->io, packet->signal.observed, &events);
+    events &= (entry->events & EPOLL_EVENT_MASK) | EPOLLERR | EPOLLHUP;
+    if (events == 0) {
+        return false;
+    }
+    event->events = events;
+    event->data = entry->data;
+    return true;
+}
+
+__EXPORT
+int epoll_pwait(int epfd, struct epoll_event* events, int maxevents, int timeout,
+                const sigset_t* sigmask) {
+    if (sigmask) {
+        return ERRNO(ENOSYS);
+    }
+    if (maxevents <= 0) {
+        return ERRNO(EINVAL);
+    }
+    fdio_epoll_t* ep = fd_to_epoll(epfd);
+    if (ep == NULL) {
+        return ERRNO(EBADF);
+    }
+
+    zx_time_t deadline = timeout < 0 ? ZX_TIME_INFINITE : zx_deadline_after(ZX_MSEC(timeout));
+    // Re-arm the level-triggered entries reported last time, so that those
+    // which are still ready are reported again.
+    mtx_lock(&ep->lock);
+    while (ep->rearm_list != NULL) {
+        epoll_entry_t* entry = ep->rearm_list;
+        ep->rearm_list = entry->rearm_next;
+        entry->rearm_pending = false;
+        epoll_arm(ep, entry);
+    }
+    mtx_unlock(&ep->lock);
+
+    zx_status_t status = ZX_OK;
+    int n = 0;
+    while (n == 0) {
+        // Block for the first packet, then take whatever else is queued
+        // without blocking.  Stale packets are skipped, so keep going until
+        // something is reported or the deadline passes.
+        zx_port_packet_t packet;
+        status = zx_port_wait(ep->port, deadline, &packet);
+        if (status != ZX_OK) {
+            break;
+        }
+
+        mtx_lock(&ep->lock);
+        for (;;) {
+            if (epoll_deliver(ep, &packet, &events[n])) {
+                n++;
+            }
+            if (n == maxevents ||
+                zx_port_wait(ep->port, ZX_TIME_INFINITE_PAST, &packet) != ZX_OK) {
+                break;
+            }
+        }
+        mtx_unlock(&ep->lock);
+    }
+
+    fdio_release(&ep->io);
+    if (status != ZX_OK && status != ZX_ERR_TIMED_OUT) {
+        return ERROR(status);
+    }
+    return n;
+}
+
+__EXPORT
+int epoll_wait(int epfd, struct epoll_event* events, int maxevents, int timeout) {
+    return epoll_pwait(epfd, events, maxevents, timeout, NULL);
+}
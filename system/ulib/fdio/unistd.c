@@ -29,6 +29,7 @@
 #include <zircon/process.h>
 #include <zircon/processargs.h>
 #include <zircon/syscalls.h>
+#include <zircon/syscalls/port.h>
 #include <zircon/time.h>
 
 #include <fuchsia/io/c/fidl.h>
@@ -2007,6 +2008,42 @@ void __fdio_release(fdio_t* io) {
 // TODO: getrlimit(RLIMIT_NOFILE, ...)
 #define MAX_POLL_NFDS 1024
 
+// Waits for any of |items| to be signaled, like zx_object_wait_many().
+// That is limited to ZX_WAIT_MANY_MAX_ITEMS, so larger sets are waited on
+// through a port instead.  Only the items that are ready get their pending
+// signals filled in that case.
+static zx_status_t fdio_wait_many(zx_wait_item_t* items, size_t count, zx_time_t deadline) {
+    if (count <= ZX_WAIT_MANY_MAX_ITEMS) {
+        return zx_object_wait_many(items, count, deadline);
+    }
+
+    zx_handle_t port;
+    zx_status_t r = zx_port_create(0, &port);
+    if (r != ZX_OK) {
+        return r;
+    }
+    for (size_t i = 0; i < count; i++) {
+        r = zx_object_wait_async(items[i].handle, port, i, items[i].waitfor,
+                                 ZX_WAIT_ASYNC_ONCE);
+        if (r != ZX_OK) {
+            zx_handle_close(port);
+            return r;
+        }
+    }
+
+    // Block for the first packet, then collect any others already queued.
+    zx_port_packet_t packet;
+    r = zx_port_wait(port, deadline, &packet);
+    if (r == ZX_OK) {
+        do {
+            items[packet.key].pending = packet.signal.observed;
+        } while (zx_port_wait(port, ZX_TIME_INFINITE_PAST, &packet) == ZX_OK);
+    }
+    // Closing the port cancels the waits that didn't fire.
+    zx_handle_close(port);
+    return r;
+}
+
 __EXPORT
 int ppoll(struct pollfd* fds, nfds_t n,
           const struct timespec* timeout_ts, const sigset_t* sigmask) {
@@ -2070,7 +2107,7 @@ int ppoll(struct pollfd* fds, nfds_t n,
                 tmo = zx_deadline_after(duration);
             }
         }
-        r = zx_object_wait_many(items, nvalid, tmo);
+        r = fdio_wait_many(items, nvalid, tmo);
         // pending signals could be reported on ZX_ERR_TIMED_OUT case as well
         if (r == ZX_OK || r == ZX_ERR_TIMED_OUT) {
             nfds_t j = 0; // j counts up on a valid entry
@@ -2167,7 +2204,7 @@ int select(int n, fd_set* restrict rfds, fd_set* restrict wfds, fd_set* restrict
     if (r == ZX_OK && nvalid > 0) {
         zx_time_t tmo = (tv == NULL) ? ZX_TIME_INFINITE :
             zx_deadline_after(zx_duration_add_duration(ZX_SEC(tv->tv_sec), ZX_USEC(tv->tv_usec)));
-        r = zx_object_wait_many(items, nvalid, tmo);
+        r = fdio_wait_many(items, nvalid, tmo);
         // pending signals could be reported on ZX_ERR_TIMED_OUT case as well
         if (r == ZX_OK || r == ZX_ERR_TIMED_OUT) {
             int j = 0; // j counts up on a valid entry
@@ -11,6 +11,7 @@
 #include <string.h>
 #include <sys/stat.h>
 
+#include <fbl/auto_lock.h>
 #include <fs/trace.h>
 #include <fs/vnode.h>
 #include <fuchsia/io/c/fidl.h>
@@ -228,6 +229,7 @@ Connection::~Connection() {
 }
 
 void Connection::AsyncTeardown() {
+    fbl::AutoLock lock(&channel_lock_);
     if (channel_) {
         ZX_ASSERT(channel_.signal(0, kLocalTeardownSignal) == ZX_OK);
     }
@@ -294,7 +296,10 @@ zx_status_t Connection::CallHandler() {
 }
 
 void Connection::CallClose() {
-    channel_.reset();
+    {
+        fbl::AutoLock lock(&channel_lock_);
+        channel_.reset();
+    }
     CallHandler();
     set_closed();
 }
@@ -718,7 +723,12 @@ zx_status_t Connection::DirectoryAdminUnmount(fidl_txn_t* txn) {
     vfs_->UninstallAll(ZX_TIME_INFINITE);
 
     // Unmount is fatal to the requesting connections.
-    Vfs::ShutdownCallback closure([ch = fbl::move(channel_),
+    zx::channel channel;
+    {
+        fbl::AutoLock lock(&channel_lock_);
+        channel = fbl::move(channel_);
+    }
+    Vfs::ShutdownCallback closure([ch = fbl::move(channel),
                                    ctxn = zxfidl_txn_copy(txn)]
                                   (zx_status_t status) mutable {
         fuchsia_io_DirectoryAdminUnmount_reply(&ctxn.txn, status);
@@ -54,6 +54,25 @@ public:
     // Issues a group of requests to the underlying device and waits
     // for them to complete.
     virtual zx_status_t Transaction(block_fifo_request_t* requests, size_t count) = 0;
+
+    // Issues a group of requests to the underlying device without waiting
+    // for them to complete, so that the device may work on them while the
+    // caller prepares more.  Unlike |Transaction|, no barriers are added.
+    //
+    // |WaitTransaction| must be called for the group of the requests before
+    // the group is used again.
+    //
+    // Handlers which cannot keep a transaction in flight return
+    // ZX_ERR_NOT_SUPPORTED, and callers fall back to |Transaction|.
+    virtual zx_status_t BeginTransaction(block_fifo_request_t* requests, size_t count) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
+
+    // Waits for the requests last issued on |group| by |BeginTransaction|
+    // to complete.
+    virtual zx_status_t WaitTransaction(groupid_t group) {
+        return ZX_ERR_NOT_SUPPORTED;
+    }
 #else
     // Reads block |bno| from the device into the buffer provided by |data|.
     virtual zx_status_t Readblk(uint32_t bno, void* data) = 0;
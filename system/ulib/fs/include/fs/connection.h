@@ -11,6 +11,7 @@
 #include <stdint.h>
 
 #include <fbl/intrusive_double_list.h>
+#include <fbl/mutex.h>
 #include <fbl/unique_ptr.h>
 #include <fs/vfs.h>
 #include <fs/vnode.h>
@@ -156,6 +157,11 @@ private:
     fbl::RefPtr<fs::Vnode> vnode_;
 
     // Channel on which the connection is being served.
+    //
+    // Only the thread handling a message on the connection modifies the
+    // channel; |channel_lock_| keeps |AsyncTeardown| from observing it while
+    // it is being closed.
+    fbl::Mutex channel_lock_;
     zx::channel channel_;
 
     // Asynchronous wait for incoming messages.
@@ -243,7 +243,8 @@ protected:
     mtx_t vfs_lock_{};
 
     // Starts tracking the lifetime of the connection.
-    virtual void RegisterConnection(fbl::unique_ptr<Connection> connection) = 0;
+    // Returns ZX_ERR_BAD_STATE, dropping the connection, if the VFS is shutting down.
+    virtual zx_status_t RegisterConnection(fbl::unique_ptr<Connection> connection) = 0;
 
     // Stops tracking the lifetime of the connection.
     virtual void UnregisterConnection(Connection* connection) = 0;
@@ -6,6 +6,7 @@
 
 #include <lib/async/cpp/task.h>
 #include <fbl/atomic.h>
+#include <fbl/auto_lock.h>
 #include <fbl/unique_ptr.h>
 #include <lib/sync/completion.h>
 
@@ -16,23 +17,25 @@ ManagedVfs::ManagedVfs() : is_shutting_down_(false) {}
 ManagedVfs::ManagedVfs(async_dispatcher_t* dispatcher) : Vfs(dispatcher), is_shutting_down_(false) {}
 
 ManagedVfs::~ManagedVfs() {
+    fbl::AutoLock lock(&lock_);
     ZX_DEBUG_ASSERT(connections_.is_empty());
 }
 
 bool ManagedVfs::IsTerminated() const {
-    return is_shutting_down_ && connections_.is_empty();
+    return is_shutting_down_ && connections_.is_empty() && closing_connections_ == 0;
 }
 
 // Asynchronously drop all connections.
 void ManagedVfs::Shutdown(ShutdownCallback handler) {
     ZX_DEBUG_ASSERT(handler);
     zx_status_t status = async::PostTask(dispatcher(), [this, closure = fbl::move(handler)]() mutable {
+        UninstallAll(ZX_TIME_INFINITE);
+
+        fbl::AutoLock lock(&lock_);
         ZX_DEBUG_ASSERT(!shutdown_handler_);
         shutdown_handler_ = fbl::move(closure);
         is_shutting_down_ = true;
 
-        UninstallAll(ZX_TIME_INFINITE);
-
         // Signal the teardown on channels in a way that doesn't potentially
         // pull them out from underneath async callbacks.
         for (auto& c : connections_) {
@@ -52,28 +55,48 @@ void ManagedVfs::CheckForShutdownComplete() {
 }
 
 void ManagedVfs::OnShutdownComplete(async_dispatcher_t*, async::TaskBase*, zx_status_t status) {
-    ZX_ASSERT_MSG(IsTerminated(),
-                  "Failed to complete VFS shutdown: dispatcher status = %d\n", status);
-    ZX_DEBUG_ASSERT(shutdown_handler_);
+    ShutdownCallback handler;
+    {
+        fbl::AutoLock lock(&lock_);
+        ZX_ASSERT_MSG(IsTerminated(),
+                      "Failed to complete VFS shutdown: dispatcher status = %d\n", status);
+        ZX_DEBUG_ASSERT(shutdown_handler_);
+        handler = fbl::move(shutdown_handler_);
+    }
 
-    auto handler = fbl::move(shutdown_handler_);
+    // The handler may destroy this object.
     handler(status);
 }
 
-void ManagedVfs::RegisterConnection(fbl::unique_ptr<Connection> connection) {
-    ZX_DEBUG_ASSERT(!is_shutting_down_);
+zx_status_t ManagedVfs::RegisterConnection(fbl::unique_ptr<Connection> connection) {
+    fbl::AutoLock lock(&lock_);
+    if (is_shutting_down_) {
+        return ZX_ERR_BAD_STATE;
+    }
     connections_.push_back(fbl::move(connection));
+    return ZX_OK;
 }
 
 void ManagedVfs::UnregisterConnection(Connection* connection) {
-    // We drop the result of |erase| on the floor, effectively destroying the
-    // connection when all other references (like async callbacks) have
-    // completed.
-    connections_.erase(*connection);
+    fbl::unique_ptr<Connection> removed;
+    {
+        fbl::AutoLock lock(&lock_);
+        removed = connections_.erase(*connection);
+        closing_connections_++;
+    }
+
+    // Destroy the connection, now that all other references (like async
+    // callbacks) have completed. This may release its vnode, so it must not
+    // happen under |lock_|.
+    removed.reset();
+
+    fbl::AutoLock lock(&lock_);
+    closing_connections_--;
     CheckForShutdownComplete();
 }
 
 bool ManagedVfs::IsTerminating() const {
+    fbl::AutoLock lock(&lock_);
     return is_shutting_down_;
 }
 
@@ -35,9 +35,12 @@ void SynchronousVfs::Shutdown(ShutdownCallback handler) {
     }
 }
 
-void SynchronousVfs::RegisterConnection(fbl::unique_ptr<Connection> connection) {
-    ZX_DEBUG_ASSERT(!is_shutting_down_);
+zx_status_t SynchronousVfs::RegisterConnection(fbl::unique_ptr<Connection> connection) {
+    if (is_shutting_down_) {
+        return ZX_ERR_BAD_STATE;
+    }
     connections_.push_back(fbl::move(connection));
+    return ZX_OK;
 }
 
 void SynchronousVfs::UnregisterConnection(Connection* connection) {
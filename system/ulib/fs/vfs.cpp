@@ -404,9 +404,16 @@ zx_status_t Vfs::Link(zx::event token, fbl::RefPtr<Vnode> oldparent,
 zx_status_t Vfs::ServeConnection(fbl::unique_ptr<Connection> connection) {
     ZX_DEBUG_ASSERT(connection);
 
-    zx_status_t status = connection->Serve();
-    if (status == ZX_OK) {
-        RegisterConnection(fbl::move(connection));
+    // Track the connection before its first message can be dispatched, since
+    // another dispatcher thread may close it as soon as it is served.
+    Connection* c = connection.get();
+    zx_status_t status = RegisterConnection(fbl::move(connection));
+    if (status != ZX_OK) {
+        return status;
+    }
+    status = c->Serve();
+    if (status != ZX_OK) {
+        UnregisterConnection(c);
     }
     return status;
 }
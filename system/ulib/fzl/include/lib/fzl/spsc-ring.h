@@ -0,0 +1,102 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#pragma once
+
+#include <fbl/macros.h>
+#include <lib/fzl/vmo-mapper.h>
+#include <lib/zx/eventpair.h>
+#include <lib/zx/time.h>
+#include <lib/zx/vmo.h>
+#include <zircon/types.h>
+
+namespace fzl {
+
+// Asserted on the consumer's event by the producer when the ring goes from
+// empty to non-empty.
+constexpr zx_signals_t kSpscRingReadable = ZX_USER_SIGNAL_0;
+
+// Asserted on the producer's event by the consumer when the ring goes from
+// full to non-full.
+constexpr zx_signals_t kSpscRingWritable = ZX_USER_SIGNAL_1;
+
+// A single-producer, single-consumer ring of fixed size elements, kept in a
+// VMO mapped by both ends.
+//
+// Unlike zx::fifo, elements never pass through the kernel: the producer and
+// consumer copy them in and out of the shared mapping and publish their
+// positions with atomic operations.  The kernel is only involved through an
+// eventpair, which the producer signals when the ring stops being empty and
+// the consumer signals when it stops being full.  As long as neither side
+// has to wait for the other, reads and writes make no syscalls.
+//
+// The two ends may live in different processes.  Neither end trusts the
+// positions published by the other, so a misbehaving peer can corrupt the
+// data in the ring but not cause accesses outside of it.
+//
+// This class is not thread safe; each end must be used by one thread at a
+// time.
+class SpscRing {
+public:
+    enum class Role {
+        kProducer,
+        kConsumer,
+    };
+
+    SpscRing() = default;
+    ~SpscRing() = default;
+    DISALLOW_COPY_ASSIGN_AND_MOVE(SpscRing);
+
+    // Creates the VMO for a ring of |elem_count| elements of |elem_size|
+    // bytes, along with the events for the producer and consumer ends.
+    // |elem_count| must be a power of two.  Each end is set up by passing
+    // (a duplicate of) |vmo_out| and its event to Init().
+    static zx_status_t Create(uint32_t elem_size, uint32_t elem_count,
+                              zx::vmo* vmo_out,
+                              zx::eventpair* producer_event_out,
+                              zx::eventpair* consumer_event_out);
+
+    // Maps the ring in |vmo| and sets this up as its |role| end.  |vmo| must
+    // not be resizable.
+    zx_status_t Init(Role role, const zx::vmo& vmo, zx::eventpair event);
+
+    // Copies up to |count| elements from |elems| into the ring, returning
+    // the number copied in |actual|.  Returns ZX_ERR_SHOULD_WAIT if the ring
+    // is full.  Only valid on the producer end.  |actual| is 0 on error.
+    zx_status_t Write(const void* elems, size_t count, size_t* actual);
+
+    // Copies up to |count| elements out of the ring into |elems|, returning
+    // the number copied in |actual|.  Returns ZX_ERR_SHOULD_WAIT if the ring
+    // is empty.  Only valid on the consumer end.  |actual| is 0 on error.
+    zx_status_t Read(void* elems, size_t count, size_t* actual);
+
+    // Waits until Write() (on the producer end) or Read() (on the consumer
+    // end) can make progress.  Returns ZX_ERR_PEER_CLOSED if the other end's
+    // event has been closed and, for the consumer, the ring is empty.
+    zx_status_t Wait(zx::time deadline);
+
+    uint32_t elem_size() const { return elem_size_; }
+    uint32_t elem_count() const { return elem_count_; }
+
+private:
+    struct Header;
+
+    // Returns the number of elements in the ring, or ZX_ERR_IO_DATA_INTEGRITY
+    // if the peer has published an impossible position.
+    zx_status_t Used(size_t* used) const;
+
+    VmoMapper mapping_;
+    zx::eventpair event_;
+    Header* header_ = nullptr;
+    uint8_t* data_ = nullptr;
+    Role role_ = Role::kProducer;
+    uint32_t elem_size_ = 0;
+    uint32_t elem_count_ = 0;
+
+    // This end's position, which only this end may advance.  The copy in
+    // the shared header is written but never read back.
+    uint64_t position_ = 0;
+};
+
+} // namespace fzl
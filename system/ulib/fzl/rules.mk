@@ -14,6 +14,7 @@ MODULE_SRCS += \
     $(LOCAL_DIR)/mapped-vmo.cpp \
     $(LOCAL_DIR)/memory-probe.cpp \
     $(LOCAL_DIR)/pinned-vmo.cpp \
+    $(LOCAL_DIR)/spsc-ring.cpp \
     $(LOCAL_DIR)/time.cpp \
     $(LOCAL_DIR)/vmar-manager.cpp \
     $(LOCAL_DIR)/vmo-mapper.cpp \
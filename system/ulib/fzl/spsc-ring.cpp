@@ -0,0 +1,275 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <lib/fzl/spsc-ring.h>
+
+#include <string.h>
+
+#include <fbl/algorithm.h>
+#include <zircon/assert.h>
+
+namespace fzl {
+
+namespace {
+
+constexpr uint32_t kSpscRingMagic = 0x52435053; // 'SPCR'
+
+// Keep the two positions on separate cache lines so that the producer and
+// consumer don't bounce a line between them on every update.
+constexpr size_t kCacheLineSize = 64;
+
+// Where the elements start: after the header's three cache lines.
+constexpr size_t kDataOffset = 3 * kCacheLineSize;
+
+} // namespace
+
+// The layout of the start of the ring's VMO.  The elements follow at
+// kDataOffset.
+struct SpscRing::Header {
+    uint32_t magic;
+    uint32_t elem_size;
+    uint32_t elem_count;
+    uint32_t reserved;
+
+    // Number of elements ever written, advanced by the producer.
+    alignas(kCacheLineSize) uint64_t head;
+
+    // Number of elements ever read, advanced by the consumer.
+    alignas(kCacheLineSize) uint64_t tail;
+};
+
+zx_status_t SpscRing::Create(uint32_t elem_size, uint32_t elem_count,
+                             zx::vmo* vmo_out,
+                             zx::eventpair* producer_event_out,
+                             zx::eventpair* consumer_event_out) {
+    static_assert(sizeof(Header) <= kDataOffset, "");
+
+    if (elem_size == 0 || elem_count == 0 || (elem_count & (elem_count - 1)) != 0) {
+        return ZX_ERR_INVALID_ARGS;
+    }
+    const uint64_t size = kDataOffset + static_cast<uint64_t>(elem_size) * elem_count;
+
+    // The ring is mapped by both ends, so it must not be possible to shrink
+    // it out from under either of them.
+    zx::vmo vmo;
+    zx_status_t status = zx::vmo::create(size, ZX_VMO_NON_RESIZABLE, &vmo);
+    if (status != ZX_OK) {
+        return status;
+    }
+    const Header header = {kSpscRingMagic, elem_size, elem_count, 0, 0, 0};
+    status = vmo.write(&header, 0, sizeof(header));
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    zx::eventpair producer_event, consumer_event;
+    status = zx::eventpair::create(0, &producer_event, &consumer_event);
+    if (status != ZX_OK) {
+        return status;
+    }
+    // The ring starts out empty, so the producer may write.
+    status = producer_event.signal(0, kSpscRingWritable);
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    *vmo_out = fbl::move(vmo);
+    *producer_event_out = fbl::move(producer_event);
+    *consumer_event_out = fbl::move(consumer_event);
+    return ZX_OK;
+}
+
+zx_status_t SpscRing::Init(Role role, const zx::vmo& vmo, zx::eventpair event) {
+    if (header_ != nullptr) {
+        return ZX_ERR_BAD_STATE;
+    }
+
+    uint64_t size;
+    zx_status_t status = vmo.get_size(&size);
+    if (status != ZX_OK) {
+        return status;
+    }
+    if (size < kDataOffset) {
+        return ZX_ERR_INVALID_ARGS;
+    }
+
+    // Validate the geometry before trusting it.  The copies taken here are
+    // the ones used from now on, so the peer can't change them later.
+    Header header;
+    status = vmo.read(&header, 0, sizeof(header));
+    if (status != ZX_OK) {
+        return status;
+    }
+    if (header.magic != kSpscRingMagic || header.elem_size == 0 || header.elem_count == 0 ||
+        (header.elem_count & (header.elem_count - 1)) != 0 ||
+        static_cast<uint64_t>(header.elem_size) * header.elem_count > size - kDataOffset) {
+        return ZX_ERR_INVALID_ARGS;
+    }
+
+    // Refuse a VMO the peer could resize: accesses past a shrunk end would
+    // fault.
+    status = mapping_.Map(vmo, 0, size,
+                          ZX_VM_PERM_READ | ZX_VM_PERM_WRITE | ZX_VM_REQUIRE_NON_RESIZABLE);
+    if (status != ZX_OK) {
+        return status;
+    }
+
+    header_ = static_cast<Header*>(mapping_.start());
+    data_ = static_cast<uint8_t*>(mapping_.start()) + kDataOffset;
+    event_ = fbl::move(event);
+    role_ = role;
+    elem_size_ = header.elem_size;
+    elem_count_ = header.elem_count;
+    position_ = role == Role::kProducer ? __atomic_load_n(&header_->head, __ATOMIC_RELAXED)
+                                        : __atomic_load_n(&header_->tail, __ATOMIC_RELAXED);
+    return ZX_OK;
+}
+
+zx_status_t SpscRing::Used(size_t* used) const {
+    uint64_t head, tail;
+    if (role_ == Role::kProducer) {
+        head = position_;
+        tail = __atomic_load_n(&header_->tail, __ATOMIC_ACQUIRE);
+    } else {
+        head = __atomic_load_n(&header_->head, __ATOMIC_ACQUIRE);
+        tail = position_;
+    }
+    const uint64_t n = head - tail;
+    if (n > elem_count_) {
+        return ZX_ERR_IO_DATA_INTEGRITY;
+    }
+    *used = static_cast<size_t>(n);
+    return ZX_OK;
+}
+
+zx_status_t SpscRing::Write(const void* elems, size_t count, size_t* actual) {
+    if (actual != nullptr) {
+        *actual = 0;
+    }
+    if (header_ == nullptr || role_ != Role::kProducer) {
+        return ZX_ERR_BAD_STATE;
+    }
+
+    size_t used;
+    zx_status_t status = Used(&used);
+    if (status != ZX_OK) {
+        return status;
+    }
+    const size_t n = fbl::min(count, elem_count_ - used);
+    if (n == 0) {
+        return ZX_ERR_SHOULD_WAIT;
+    }
+
+    // Copy in two pieces if the write wraps around the end of the ring.
+    const size_t start = position_ & (elem_count_ - 1);
+    const size_t first = fbl::min(n, elem_count_ - start);
+    memcpy(data_ + start * elem_size_, elems, first * elem_size_);
+    memcpy(data_, static_cast<const uint8_t*>(elems) + first * elem_size_,
+           (n - first) * elem_size_);
+
+    // Publish the elements, then see whether the consumer had already read
+    // everything before them.  If so it may be waiting for them.  Pairs with
+    // the same sequence in Read(): at least one side is guaranteed to see the
+    // other's update, so a wakeup can't be lost.
+    const uint64_t old_position = position_;
+    position_ += n;
+    __atomic_store_n(&header_->head, position_, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&header_->tail, __ATOMIC_RELAXED) == old_position) {
+        status = event_.signal_peer(0, kSpscRingReadable);
+        if (status != ZX_OK && status != ZX_ERR_PEER_CLOSED) {
+            return status;
+        }
+    }
+
+    if (actual != nullptr) {
+        *actual = n;
+    }
+    return ZX_OK;
+}
+
+zx_status_t SpscRing::Read(void* elems, size_t count, size_t* actual) {
+    if (actual != nullptr) {
+        *actual = 0;
+    }
+    if (header_ == nullptr || role_ != Role::kConsumer) {
+        return ZX_ERR_BAD_STATE;
+    }
+
+    size_t used;
+    zx_status_t status = Used(&used);
+    if (status != ZX_OK) {
+        return status;
+    }
+    const size_t n = fbl::min(count, used);
+    if (n == 0) {
+        return ZX_ERR_SHOULD_WAIT;
+    }
+
+    const size_t start = position_ & (elem_count_ - 1);
+    const size_t first = fbl::min(n, elem_count_ - start);
+    memcpy(elems, data_ + start * elem_size_, first * elem_size_);
+    memcpy(static_cast<uint8_t*>(elems) + first * elem_size_, data_,
+           (n - first) * elem_size_);
+
+    // Release the slots, then see whether the ring was full before this read.
+    // If so the producer may be waiting for space.
+    const uint64_t old_position = position_;
+    position_ += n;
+    __atomic_store_n(&header_->tail, position_, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&header_->head, __ATOMIC_RELAXED) - old_position >= elem_count_) {
+        status = event_.signal_peer(0, kSpscRingWritable);
+        if (status != ZX_OK && status != ZX_ERR_PEER_CLOSED) {
+            return status;
+        }
+    }
+
+    if (actual != nullptr) {
+        *actual = n;
+    }
+    return ZX_OK;
+}
+
+zx_status_t SpscRing::Wait(zx::time deadline) {
+    if (header_ == nullptr) {
+        return ZX_ERR_BAD_STATE;
+    }
+    const bool producer = role_ == Role::kProducer;
+    const zx_signals_t signal = producer ? kSpscRingWritable : kSpscRingReadable;
+
+    for (;;) {
+        // Clear the signal before checking the ring, so that a signal sent
+        // after the check is not lost.
+        zx_status_t status = event_.signal(signal, 0);
+        if (status != ZX_OK) {
+            return status;
+        }
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        size_t used;
+        status = Used(&used);
+        if (status != ZX_OK) {
+            return status;
+        }
+        if (producer ? used < elem_count_ : used > 0) {
+            return ZX_OK;
+        }
+
+        zx_signals_t pending;
+        status = event_.wait_one(signal | ZX_EVENTPAIR_PEER_CLOSED, deadline, &pending);
+        if (status != ZX_OK) {
+            return status;
+        }
+        if (!(pending & signal) && (pending & ZX_EVENTPAIR_PEER_CLOSED)) {
+            // The consumer may still drain what the producer left behind.
+            if (!producer && Used(&used) == ZX_OK && used > 0) {
+                return ZX_OK;
+            }
+            return ZX_ERR_PEER_CLOSED;
+        }
+    }
+}
+
+} // namespace fzl
@@ -31,6 +31,15 @@ namespace lockdep {
 #define LOCK_DEP_ENABLE_VALIDATION 0
 #endif
 
+// Configures whether lock contention profiling is enabled or not. Defaults to
+// disabled. When enabled Guard measures how long each acquisition waited for
+// the lock and how long the lock was held, and reports both to the system
+// through SystemLockProfileRecord(). Profiling is independent of validation,
+// but requires lock classes, which are created when either is enabled.
+#ifndef LOCK_DEP_ENABLE_PROFILING
+#define LOCK_DEP_ENABLE_PROFILING 0
+#endif
+
 // Id type used to identify each lock class.
 using LockClassId = uintptr_t;
 
@@ -75,6 +84,13 @@ static_assert(kMaxLockDependencies != 0, "LOCK_DEP_MAX_DEPENDENCIES too large!")
 // Whether or not lock validation is globally enabled.
 constexpr bool kLockValidationEnabled = static_cast<bool>(LOCK_DEP_ENABLE_VALIDATION);
 
+// Whether or not lock profiling is globally enabled.
+constexpr bool kLockProfilingEnabled = static_cast<bool>(LOCK_DEP_ENABLE_PROFILING);
+
+// Whether or not lock classes are tracked. Both validation and profiling
+// operate on lock classes.
+constexpr bool kLockClassesEnabled = kLockValidationEnabled || kLockProfilingEnabled;
+
 // Utility template alias to simplify selecting different types based whether
 // lock validation is enabled or disabled.
 template <typename EnabledType, typename DisabledType>
@@ -82,6 +98,20 @@ using IfLockValidationEnabled = typename fbl::conditional<kLockValidationEnabled
                                                           EnabledType,
                                                           DisabledType>::type;
 
+// Utility template alias to simplify selecting different types based whether
+// lock profiling is enabled or disabled.
+template <typename EnabledType, typename DisabledType>
+using IfLockProfilingEnabled = typename fbl::conditional<kLockProfilingEnabled,
+                                                         EnabledType,
+                                                         DisabledType>::type;
+
+// Utility template alias to simplify selecting different types based whether
+// lock classes are tracked.
+template <typename EnabledType, typename DisabledType>
+using IfLockClassesEnabled = typename fbl::conditional<kLockClassesEnabled,
+                                                       EnabledType,
+                                                       DisabledType>::type;
+
 // Result type that represents whether a lock attempt was successful, or if not
 // which check failed.
 enum class LockResult : uint8_t {
@@ -78,7 +78,7 @@ public:
               typename = internal::EnableIfNotNestable<Lockable, LockType>>
     Guard(Lockable* lock, Args&&... state_args)
         __TA_ACQUIRE(lock) __TA_ACQUIRE(lock->capability())
-        : validator_{lock->id()}, lock_{&lock->lock()},
+        : validator_{lock->id()}, profiler_{lock->id()}, lock_{&lock->lock()},
           state_{fbl::forward<Args>(state_args)...} { ValidateAndAcquire(); }
 
     // Acquires the given lock. This constructor participates in overload
@@ -100,6 +100,7 @@ public:
         if (lock_ != nullptr) {
             LockPolicy<LockType, Option>::Release(lock_, &state_,
                                                   fbl::forward<Args>(args)...);
+            profiler_.Released();
             validator_.ValidateRelease();
             lock_ = nullptr;
         }
@@ -135,7 +136,8 @@ public:
     //  Guard<fbl::Mutex> guard{AdoptLock, fbl::move(rvalue_arugment)};
     //
     Guard(AdoptLockTag, Guard&& other) __TA_ACQUIRE(other.lock_)
-        : validator_{fbl::move(other.validator_)}, lock_{other.lock_},
+        : validator_{fbl::move(other.validator_)},
+          profiler_{fbl::move(other.profiler_)}, lock_{other.lock_},
           state_{fbl::move(other.state_)} { other.lock_ = nullptr; }
 
     // Temporarily releases and un-tracks the guarded lock before executing the
@@ -160,6 +162,7 @@ public:
 
         LockPolicy<LockType, Option>::Release(
             lock_, &state_, fbl::forward<ReleaseArgs>(release_args)...);
+        profiler_.Released();
         validator_.ValidateRelease();
 
         fbl::forward<Op>(op)();
@@ -179,9 +182,12 @@ private:
     // body.
     void ValidateAndAcquire() __TA_NO_THREAD_SAFETY_ANALYSIS {
         validator_.ValidateAcquire();
+        profiler_.BeginAcquire();
         if (!LockPolicy<LockType, Option>::Acquire(lock_, &state_)) {
             lock_ = nullptr;
             validator_.ValidateRelease();
+        } else {
+            profiler_.EndAcquire();
         }
     }
 
@@ -191,7 +197,7 @@ private:
     Guard(OrderedLockTag, Lockable* lock,
           uintptr_t order, Args&&... state_args)
         __TA_ACQUIRE(lock) __TA_ACQUIRE(lock->capability())
-        : validator_{lock->id(), order}, lock_{&lock->lock()},
+        : validator_{lock->id(), order}, profiler_{lock->id()}, lock_{&lock->lock()},
           state_{fbl::forward<Args>(state_args)...} { ValidateAndAcquire(); }
 
     // Validator type used when lock validation is enabled. Provides the
@@ -221,9 +227,43 @@ private:
     // Alias of the configured validator.
     using Validator = IfLockValidationEnabled<LockValidator, DummyValidator>;
 
+    // Profiler type used when lock profiling is enabled. Measures the time
+    // spent acquiring and holding the lock and reports it to the system when
+    // the lock is released. Failed try-lock attempts are not reported.
+    struct LockProfiler {
+        LockProfiler(LockClassId id)
+            : id{id} {}
+
+        void BeginAcquire() { begin = SystemLockProfileTimestamp(); }
+        void EndAcquire() { acquired = SystemLockProfileTimestamp(); }
+        void Released() {
+            const uint64_t released = SystemLockProfileTimestamp();
+            SystemLockProfileRecord(LockClassState::Get(id),
+                                    acquired - begin, released - acquired);
+        }
+
+        LockClassId id;
+        uint64_t begin{0};
+        uint64_t acquired{0};
+    };
+
+    // Profiler type used when lock profiling is disabled.
+    struct DummyProfiler {
+        DummyProfiler(LockClassId) {}
+        void BeginAcquire() {}
+        void EndAcquire() {}
+        void Released() {}
+    };
+
+    // Alias of the configured profiler.
+    using Profiler = IfLockProfilingEnabled<LockProfiler, DummyProfiler>;
+
     // The validator to use when acquiring and releasing the lock.
     Validator validator_;
 
+    // The profiler to use when acquiring and releasing the lock.
+    Profiler profiler_;
+
     // Pointer to the acquired lock.
     LockType* lock_;
 
@@ -43,7 +43,8 @@ struct LockTraits<T, fbl::void_t<LookupLockTraits<T>>> {
 // represents an independent, unique lock class. This type maintains a global
 // dependency set that tracks which other lock classes have been observed
 // being held prior to acquisitions of this lock class. This type is only used
-// when lock validation is enabled, otherwise DummyLockClass takes its place.
+// when lock validation or profiling is enabled, otherwise DummyLockClass takes
+// its place.
 template <typename Class, typename LockType, size_t Index, LockFlags Flags>
 class LockClass {
 public:
@@ -89,22 +90,22 @@ LockClassState LockClass<Class, LockType, Index, Flags>::lock_class_state_ = {
 template <typename Class, typename LockType, size_t Index, LockFlags Flags>
 LockDependencySet LockClass<Class, LockType, Index, Flags>::dependency_set_;
 
-// Dummy type used in place of LockClass when validation is disabled. This type
+// Dummy type used in place of LockClass when lock classes are disabled. This type
 // does not create static dependency tracking structures that LockClass does.
 struct DummyLockClass {
     static LockClassId Id() { return kInvalidLockClassId; }
 };
 
 // Alias that selects LockClass<Class, LockType, Index, Flags> when validation
-// is enabled or DummyLockClass when validation is disabled.
+// or profiling is enabled or DummyLockClass when both are disabled.
 template <typename Class, typename LockType, size_t Index, LockFlags Flags>
-using ConditionalLockClass = IfLockValidationEnabled<
+using ConditionalLockClass = IfLockClassesEnabled<
     LockClass<Class, LockType, Index, Flags>, DummyLockClass>;
 
 // Base lock wrapper type that provides the essential interface required by
 // Guard<LockType, Option> to perform locking and validation. This type wraps
 // an instance of LockType that is used to perform the actual synchronization.
-// When lock validation is enabled this type also stores the LockClassId for
+// When lock validation or profiling is enabled this type also stores the LockClassId for
 // the lock class this lock belongs to.
 //
 // The "lock class" that each lock belongs to is created by each unique
@@ -200,23 +201,23 @@ private:
     // Returns the LockClassId of the lock class this lock belongs to.
     LockClassId id() const { return id_.value(); }
 
-    // Value type that stores the LockClassId for this lock when validation is
-    // enabled.
+    // Value type that stores the LockClassId for this lock when lock classes
+    // are enabled.
     struct Value {
         LockClassId value_;
         LockClassId value() const { return value_; }
     };
 
-    // Dummy type that stores nothing when validation is disabled.
+    // Dummy type that stores nothing when lock classes are disabled.
     struct Dummy {
         Dummy(LockClassId) {}
         LockClassId value() const { return kInvalidLockClassId; }
     };
 
-    // Selects between Value or Dummy based on whether validation is enabled.
-    using IdValue = IfLockValidationEnabled<Value, Dummy>;
+    // Selects between Value or Dummy based on whether lock classes are enabled.
+    using IdValue = IfLockClassesEnabled<Value, Dummy>;
 
-    // Stores the lock class id of this lock when validation is enabled.
+    // Stores the lock class id of this lock when lock classes are enabled.
     IdValue id_;
 
     // The underlying lock managed by this dependency tracking wrapper.
@@ -261,9 +262,9 @@ private:
         LockClassId value() const { return kInvalidLockClassId; }
     };
 
-    using IdValue = IfLockValidationEnabled<Value, Dummy>;
+    using IdValue = IfLockClassesEnabled<Value, Dummy>;
 
-    // Stores the lock class id of this lock when validation is enabled.
+    // Stores the lock class id of this lock when lock classes are enabled.
     IdValue id_;
 };
 
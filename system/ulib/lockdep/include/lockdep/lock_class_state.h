@@ -117,6 +117,13 @@ public:
     // Returns an iterator for the init-time linked list of state instances.
     static Iterator Iter() { return {}; }
 
+    // Returns the number of lock classes. Lock classes are numbered densely
+    // from zero, see ordinal().
+    static size_t Count() {
+        LockClassState* head = *Head();
+        return head != nullptr ? head->ordinal_ + 1 : 0;
+    }
+
     // Returns the lock class id for this instance. The id is the address of the
     // instance.
     LockClassId id() const { return reinterpret_cast<LockClassId>(this); }
@@ -124,6 +131,10 @@ public:
     // Returns the name of this lock class.
     const char* name() const { return name_; }
 
+    // Returns the ordinal of this lock class, in the range [0, Count()). This
+    // is suitable for indexing per-lock class tables maintained by the system.
+    size_t ordinal() const { return ordinal_; }
+
     // Return the flags of this lock class.
     LockFlags flags() const { return flags_; }
 
@@ -166,6 +177,10 @@ private:
     // list of lock classes.
     LockClassState* next_{InitNext(this)};
 
+    // The ordinal of this lock class. This depends on next_, which is
+    // initialized first, and is one more than that of the previous head.
+    const size_t ordinal_{next_ != nullptr ? next_->ordinal_ + 1 : 0};
+
     // Returns a pointer to the head pointer of the state linked list.
     static LockClassState** Head() {
         static LockClassState* head{nullptr};
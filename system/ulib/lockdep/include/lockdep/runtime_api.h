@@ -46,6 +46,19 @@ extern ThreadLockState* SystemGetThreadLockState();
 // System-defined hook that initializes the ThreadLockState for the current thread.
 extern void SystemInitThreadLockState(ThreadLockState* state);
 
+// System-defined hook that returns the current time in an arbitrary,
+// monotonically increasing unit. Only used when lock profiling is enabled.
+extern uint64_t SystemLockProfileTimestamp();
+
+// System-defined hook to record a single acquisition of a lock of the given
+// lock class, as measured by SystemLockProfileTimestamp(): |wait_time| is the
+// time spent acquiring the lock and |hold_time| is the time the lock was held.
+// This is called after the lock is released, possibly with interrupts
+// disabled or other locks held, and must not acquire any instrumented locks.
+// Only used when lock profiling is enabled.
+extern void SystemLockProfileRecord(LockClassState* lock_class,
+                                    uint64_t wait_time, uint64_t hold_time);
+
 // System-defined hook that triggers a loop detection pass. In response to this
 // event the implementation must trigger a call lockdep::LoopDetectionPass() on
 // a separate, dedicated or non-reentrant worker thread. Non-reentrancy is a
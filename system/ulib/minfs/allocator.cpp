@@ -32,7 +32,14 @@ size_t AllocatorPromise::Allocate(WriteTxn* txn) {
     ZX_DEBUG_ASSERT(allocator_ != nullptr);
     ZX_DEBUG_ASSERT(reserved_ > 0);
     reserved_--;
-    return allocator_->Allocate(txn);
+    return allocator_->Allocate(txn, 0, 1);
+}
+
+size_t AllocatorPromise::AllocateNear(WriteTxn* txn, size_t goal, size_t run) {
+    ZX_DEBUG_ASSERT(allocator_ != nullptr);
+    ZX_DEBUG_ASSERT(reserved_ > 0);
+    reserved_--;
+    return allocator_->Allocate(txn, goal, run);
 }
 
 AllocatorFvmMetadata::AllocatorFvmMetadata() = default;
@@ -131,11 +138,15 @@ void Allocator::Unreserve(size_t count) {
     reserved_ -= count;
 }
 
-size_t Allocator::Allocate(WriteTxn* txn) {
+size_t Allocator::Allocate(WriteTxn* txn, size_t goal, size_t run) {
     ZX_DEBUG_ASSERT(reserved_ > 0);
     size_t bitoff_start;
-    if (map_.Find(false, hint_, map_.size(), 1, &bitoff_start) != ZX_OK) {
-        ZX_ASSERT(map_.Find(false, 0, hint_, 1, &bitoff_start) == ZX_OK);
+    if (goal != 0 && goal < map_.size() && !map_.Get(goal, goal + 1)) {
+        bitoff_start = goal;
+    } else if (run <= 1 || map_.Find(false, hint_, map_.size(), run, &bitoff_start) != ZX_OK) {
+        if (map_.Find(false, hint_, map_.size(), 1, &bitoff_start) != ZX_OK) {
+            ZX_ASSERT(map_.Find(false, 0, hint_, 1, &bitoff_start) == ZX_OK);
+        }
     }
 
     ZX_ASSERT(map_.Set(bitoff_start, bitoff_start + 1) == ZX_OK);
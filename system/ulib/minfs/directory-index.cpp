@@ -0,0 +1,184 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdint.h>
+
+#include <fbl/alloc_checker.h>
+#include <lib/zircon-internal/fnv1hash.h>
+#include <zircon/assert.h>
+
+#include <minfs/directory-index.h>
+
+namespace minfs {
+namespace {
+
+constexpr size_t kInitialSlots = 64;
+
+} // namespace
+
+DirectoryIndex::DirectoryIndex() = default;
+DirectoryIndex::~DirectoryIndex() = default;
+
+uint32_t DirectoryIndex::Hash(const char* name, size_t len) {
+    return fnv1a32(name, len);
+}
+
+zx_status_t DirectoryIndex::Insert(const Dirent* de, size_t off) {
+    uint32_t reclen = MinfsReclen(de, off);
+    uint32_t size = reclen;
+    if (de->ino != 0) {
+        zx_status_t status = InsertName(Hash(de->name, de->namelen), off);
+        if (status != ZX_OK) {
+            return status;
+        }
+        size = reclen - DirentSize(de->namelen);
+    }
+    if (de->ino == 0 || size > 0) {
+        fbl::AllocChecker ac;
+        spaces_.insert(LowerBound(off),
+                       Space{static_cast<uint32_t>(off), size, de->ino == 0}, &ac);
+        if (!ac.check()) {
+            return ZX_ERR_NO_MEMORY;
+        }
+    }
+    return ZX_OK;
+}
+
+void DirectoryIndex::Erase(const Dirent* de, size_t off) {
+    if (de->ino != 0) {
+        EraseName(Hash(de->name, de->namelen), off);
+    }
+    size_t i = LowerBound(off);
+    if (i < spaces_.size() && spaces_[i].off == off) {
+        spaces_.erase(i);
+    }
+}
+
+bool DirectoryIndex::NextNamed(fbl::StringPiece name, size_t* cursor, size_t* off) const {
+    if (names_ == 0) {
+        return false;
+    }
+    uint32_t hash = Hash(name.data(), name.length());
+    size_t mask = slots_.size() - 1;
+    while (*cursor < slots_.size()) {
+        const Slot& slot = slots_[(hash + *cursor) & mask];
+        ++*cursor;
+        if (slot.off_plus_one == 0) {
+            return false;
+        } else if (slot.hash == hash) {
+            *off = slot.off_plus_one - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DirectoryIndex::FindSpace(uint32_t reclen, size_t* off) const {
+    for (size_t i = 0; i < spaces_.size(); i++) {
+        if (spaces_[i].size >= reclen) {
+            *off = spaces_[i].off;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DirectoryIndex::EmptyBefore(size_t end, size_t* off) const {
+    size_t i = LowerBound(end);
+    if (i == 0) {
+        return false;
+    }
+    const Space& space = spaces_[i - 1];
+    if (!space.empty || space.off + space.size != end) {
+        return false;
+    }
+    *off = space.off;
+    return true;
+}
+
+size_t DirectoryIndex::LowerBound(size_t off) const {
+    size_t lo = 0;
+    size_t hi = spaces_.size();
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (spaces_[mid].off < off) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+zx_status_t DirectoryIndex::InsertName(uint32_t hash, size_t off) {
+    // Keep the table at most three quarters full, so probes stay short.
+    if ((names_ + 1) * 4 > slots_.size() * 3) {
+        zx_status_t status = Grow();
+        if (status != ZX_OK) {
+            return status;
+        }
+    }
+    size_t mask = slots_.size() - 1;
+    size_t i = hash & mask;
+    while (slots_[i].off_plus_one != 0) {
+        i = (i + 1) & mask;
+    }
+    slots_[i].hash = hash;
+    slots_[i].off_plus_one = static_cast<uint32_t>(off + 1);
+    names_++;
+    return ZX_OK;
+}
+
+void DirectoryIndex::EraseName(uint32_t hash, size_t off) {
+    if (names_ == 0) {
+        return;
+    }
+    size_t mask = slots_.size() - 1;
+    size_t i = hash & mask;
+    while (slots_[i].off_plus_one != off + 1) {
+        if (slots_[i].off_plus_one == 0) {
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+    names_--;
+
+    // Shift back the entries which follow in the same run, so that no probe
+    // sequence is cut short by the hole.
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; slots_[j].off_plus_one != 0; j = (j + 1) & mask) {
+        size_t home = slots_[j].hash & mask;
+        // Move the entry at |j| unless its home lies cyclically in (hole, j].
+        bool stays = (hole <= j) ? (hole < home && home <= j) : (hole < home || home <= j);
+        if (!stays) {
+            slots_[hole] = slots_[j];
+            hole = j;
+        }
+    }
+    slots_[hole].off_plus_one = 0;
+}
+
+zx_status_t DirectoryIndex::Grow() {
+    size_t count = slots_.size() == 0 ? kInitialSlots : slots_.size() * 2;
+    fbl::AllocChecker ac;
+    fbl::Array<Slot> slots(new (&ac) Slot[count](), count);
+    if (!ac.check()) {
+        return ZX_ERR_NO_MEMORY;
+    }
+    size_t mask = count - 1;
+    for (size_t i = 0; i < slots_.size(); i++) {
+        if (slots_[i].off_plus_one == 0) {
+            continue;
+        }
+        size_t j = slots_[i].hash & mask;
+        while (slots[j].off_plus_one != 0) {
+            j = (j + 1) & mask;
+        }
+        slots[j] = slots_[i];
+    }
+    slots_.swap(slots);
+    return ZX_OK;
+}
+
+} // namespace minfs
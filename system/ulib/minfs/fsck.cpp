@@ -51,6 +51,8 @@ private:
                                ino_t parent, uint32_t flags);
     const char* CheckDataBlock(blk_t bno);
     zx_status_t CheckFile(Inode* inode, ino_t ino);
+    // Like CheckFile, for inodes with kMinfsInodeFlagExtents.
+    void CheckFileExtents(Inode* inode, ino_t ino);
 
     fbl::unique_ptr<Minfs> fs_;
     RawBitmap checked_inodes_;
@@ -294,7 +296,58 @@ const char* MinfsChecker::CheckDataBlock(blk_t bno) {
     return nullptr;
 }
 
+void MinfsChecker::CheckFileExtents(Inode* inode, ino_t ino) {
+    if (inode->magic != kMinfsMagicFile || fs_->Info().version < kMinfsExtentVersion) {
+        FS_TRACE_WARN("check: ino#%u: unexpected extents\n", ino);
+        conforming_ = false;
+    }
+    if (inode->extent_count > kMinfsInlineExtents) {
+        FS_TRACE_WARN("check: ino#%u: too many extents (%u)\n", ino, inode->extent_count);
+        conforming_ = false;
+        return;
+    }
+
+    const Extent* extents = InodeExtents(inode);
+    uint32_t block_count = 0;
+    // The file block following the last extent seen.
+    blk_t next_blk = 0;
+    for (uint32_t e = 0; e < inode->extent_count; e++) {
+        xprintf("Extent %u: %u @%u +%u\n", e, extents[e].start, extents[e].bno,
+                extents[e].length);
+        if (extents[e].length == 0 || extents[e].start < next_blk) {
+            FS_TRACE_WARN("check: ino#%u: extent %u is empty or out of order\n", ino, e);
+            conforming_ = false;
+        }
+        for (blk_t n = 0; n < extents[e].length; n++) {
+            const char* msg;
+            if ((msg = CheckDataBlock(extents[e].bno + n)) != nullptr) {
+                FS_TRACE_WARN("check: ino#%u: block %u(@%u): %s\n", ino, extents[e].start + n,
+                              extents[e].bno + n, msg);
+                conforming_ = false;
+            }
+            block_count++;
+        }
+        next_blk = extents[e].start + extents[e].length;
+    }
+
+    unsigned max_blocks = fbl::round_up(inode->size, kMinfsBlockSize) / kMinfsBlockSize;
+    if (next_blk > max_blocks) {
+        FS_TRACE_WARN("check: ino#%u: filesize too small\n", ino);
+        conforming_ = false;
+    }
+    if (block_count != inode->block_count) {
+        FS_TRACE_WARN("check: ino#%u: block count %u, actual blocks %u\n",
+             ino, inode->block_count, block_count);
+        conforming_ = false;
+    }
+}
+
 zx_status_t MinfsChecker::CheckFile(Inode* inode, ino_t ino) {
+    if (inode->flags & kMinfsInodeFlagExtents) {
+        CheckFileExtents(inode, ino);
+        return ZX_OK;
+    }
+
     xprintf("Direct blocks: \n");
     for (unsigned n = 0; n < kMinfsDirect; n++) {
         xprintf(" %d,", inode->dnum[n]);
@@ -412,6 +465,19 @@ void MinfsChecker::CheckReserved() {
         FS_TRACE_WARN("check: reserved block#0: not marked in-use\n");
         conforming_ = false;
     }
+
+    // Check the blocks reserved for the journal.
+    const blk_t jnl_start = fs_->Info().jnl_block;
+    const blk_t jnl_end = jnl_start + fs_->Info().jnl_blocks;
+    for (blk_t bno = jnl_start; bno < jnl_end; bno++) {
+        if (fs_->block_allocator_->map_.Get(bno, bno + 1)) {
+            checked_blocks_.Set(bno, bno + 1);
+            alloc_blocks_++;
+        } else {
+            FS_TRACE_WARN("check: journal block#%u: not marked in-use\n", bno);
+            conforming_ = false;
+        }
+    }
 }
 
 zx_status_t MinfsChecker::CheckInode(ino_t ino, ino_t parent, bool dot_or_dotdot) {
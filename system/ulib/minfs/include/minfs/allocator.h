@@ -40,6 +40,13 @@ public:
 
     // Allocate a new item in allocator_. Return the index of the newly allocated item.
     size_t Allocate(WriteTxn* txn);
+
+    // Allocate a new item in allocator_, preferring the free item at |goal|, and otherwise the
+    // first of |run| consecutive free items. Return the index of the newly allocated item.
+    size_t AllocateNear(WriteTxn* txn, size_t goal, size_t run);
+
+    // The number of items which may still be allocated.
+    size_t GetReserved() const { return reserved_; }
 private:
     friend class Allocator;
 
@@ -213,7 +220,8 @@ private:
     zx_status_t Extend(WriteTxn* txn);
 
     // Allocate an element and return the newly allocated index.
-    size_t Allocate(WriteTxn* txn);
+    // See AllocatorPromise::AllocateNear for |goal| and |run|.
+    size_t Allocate(WriteTxn* txn, size_t goal, size_t run);
 
     // Write back the allocation of the following items to disk.
     void Persist(WriteTxn* txn, size_t index, size_t count);
@@ -50,6 +50,18 @@ public:
         return group_;
     }
 
+    // Reserves a group beyond the one of the calling thread, for a
+    // transaction which stays in flight while the thread issues others.
+    // Returns ZX_ERR_NO_RESOURCES once every group is taken.
+    zx_status_t ReserveBlockGroupID(groupid_t* out) {
+        groupid_t group = next_group_.fetch_add(1);
+        if (group >= MAX_TXN_GROUP_COUNT) {
+            return ZX_ERR_NO_RESOURCES;
+        }
+        *out = group;
+        return ZX_OK;
+    }
+
     // Return the block size of the underlying block device.
     uint32_t DeviceBlockSize() const final {
         return info_.block_size;
@@ -58,6 +70,14 @@ public:
     zx_status_t Transaction(block_fifo_request_t* requests, size_t count) final {
         return fifo_client_.Transaction(requests, count);
     }
+
+    zx_status_t BeginTransaction(block_fifo_request_t* requests, size_t count) final {
+        return fifo_client_.BeginTransaction(requests, count);
+    }
+
+    zx_status_t WaitTransaction(groupid_t group) final {
+        return fifo_client_.WaitTransaction(group);
+    }
 #endif // __Fuchsia__
     // Raw block read functions.
     // These do not track blocks (or attempt to access the block cache)
@@ -21,6 +21,8 @@ struct WriteRequest {
     size_t vmo_offset;
     size_t dev_offset;
     size_t length;
+    // Set for everything but file data; these blocks are journaled.
+    bool metadata;
 };
 
 // A transaction consisting of enqueued VMOs to be written
@@ -38,7 +40,10 @@ public:
     }
 
     // Identify that a block should be written to disk at a later point in time.
-    void Enqueue(zx_handle_t vmo, uint64_t vmo_offset, uint64_t dev_offset, uint64_t nblocks);
+    //
+    // |metadata| should only be cleared for the contents of files.
+    void Enqueue(zx_handle_t vmo, uint64_t vmo_offset, uint64_t dev_offset, uint64_t nblocks,
+                 bool metadata = true);
 
     fbl::Vector<WriteRequest>& Requests() { return requests_; }
 
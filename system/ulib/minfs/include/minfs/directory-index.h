@@ -0,0 +1,92 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file describes the in-memory index of large minfs directories.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <fbl/array.h>
+#include <fbl/macros.h>
+#include <fbl/string_piece.h>
+#include <fbl/vector.h>
+#include <zircon/types.h>
+
+#include <minfs/format.h>
+
+namespace minfs {
+
+// Directories smaller than this are scanned rather than indexed.
+constexpr size_t kMinfsDirectoryIndexMinSize = kMinfsBlockSize;
+
+// DirectoryIndex remembers where the dirents of a directory live, so that
+// finding a name, or room for a new dirent, does not require reading every
+// dirent of the directory.
+//
+// The index only exists in memory.  It is built from the dirents the first
+// time a large directory is searched, and kept in step with every dirent
+// written afterwards; the on-disk format of directories is unchanged.
+//
+// Names are hashed into an open-addressed table of offsets.  Different names
+// may share a hash, so callers must compare the name of each dirent the index
+// yields.  Dirents with room for another dirent are kept in offset order, so
+// that new dirents land where a scan of the directory would have put them.
+//
+// This class is thread-compatible.
+class DirectoryIndex {
+public:
+    DISALLOW_COPY_ASSIGN_AND_MOVE(DirectoryIndex);
+
+    DirectoryIndex();
+    ~DirectoryIndex();
+
+    // Records the dirent |de|, which was read from offset |off|.
+    zx_status_t Insert(const Dirent* de, size_t off);
+
+    // Forgets the dirent |de| at offset |off|, as recorded by |Insert|.
+    void Erase(const Dirent* de, size_t off);
+
+    // Iterates over the offsets of in-use dirents which may be named |name|.
+    // |*cursor| must be zero on the first call, and is updated by each call.
+    // Returns false once there are no more candidates.
+    bool NextNamed(fbl::StringPiece name, size_t* cursor, size_t* off) const;
+
+    // Sets |*off| to the lowest offset of a dirent which has room for
+    // |reclen| more bytes, either because it is empty or by shrinking it.
+    bool FindSpace(uint32_t reclen, size_t* off) const;
+
+    // Sets |*off| to the offset of the empty dirent which ends where the
+    // dirent at |end| begins, if there is one.
+    bool EmptyBefore(size_t end, size_t* off) const;
+
+private:
+    struct Slot {
+        uint32_t hash;
+        // Offset of the dirent, plus one; zero marks an unused slot.
+        uint32_t off_plus_one;
+    };
+
+    struct Space {
+        uint32_t off;
+        uint32_t size;
+        bool empty;
+    };
+
+    static uint32_t Hash(const char* name, size_t len);
+
+    // Returns the index of the first Space at or after |off|.
+    size_t LowerBound(size_t off) const;
+
+    zx_status_t InsertName(uint32_t hash, size_t off);
+    void EraseName(uint32_t hash, size_t off);
+    zx_status_t Grow();
+
+    fbl::Array<Slot> slots_;
+    size_t names_ = 0;
+    fbl::Vector<Space> spaces_;
+};
+
+} // namespace minfs
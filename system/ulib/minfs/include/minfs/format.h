@@ -16,6 +16,7 @@
 
 #include <assert.h>
 #include <limits.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -33,7 +34,13 @@ typedef uint32_t ino_t;
 
 constexpr uint64_t kMinfsMagic0         = (0x002153466e694d21ULL);
 constexpr uint64_t kMinfsMagic1         = (0x385000d3d3d3d304ULL);
-constexpr uint32_t kMinfsVersion        = 0x00000005;
+constexpr uint32_t kMinfsVersion        = 0x00000007;
+// Older volumes may still be mounted.  Volumes older than kMinfsJournalVersion
+// have no journal, and volumes older than kMinfsExtentVersion never hold
+// extent-mapped inodes.
+constexpr uint32_t kMinfsMinVersion     = 0x00000005;
+constexpr uint32_t kMinfsJournalVersion = 0x00000006;
+constexpr uint32_t kMinfsExtentVersion  = 0x00000007;
 
 constexpr ino_t    kMinfsRootIno        = 1;
 constexpr uint32_t kMinfsFlagClean      = 0x00000001; // Currently unused
@@ -68,6 +75,8 @@ constexpr uint32_t kMinfsMagicDir  = MinfsMagic(kMinfsTypeDir);
 constexpr uint32_t kMinfsMagicFile = MinfsMagic(kMinfsTypeFile);
 constexpr uint32_t MinfsMagicType(uint32_t n) { return n & 0xFF; }
 
+constexpr uint32_t kMinfsInodeFlagExtents = 0x00000001; // Blocks are mapped by extents
+
 constexpr size_t kFVMBlockInodeBmStart = 0x10000;
 constexpr size_t kFVMBlockDataBmStart  = 0x20000;
 constexpr size_t kFVMBlockInodeStart   = 0x30000;
@@ -101,9 +110,13 @@ struct Superblock {
     uint32_t abm_slices;    // Slices allocated to block bitmap
     uint32_t ino_slices;    // Slices allocated to inode table
     uint32_t dat_slices;    // Slices allocated to file data section
+    blk_t jnl_block;        // first data block of the metadata journal
+    uint32_t jnl_blocks;    // number of blocks in the journal (0 = no journal)
 };
 
 // Notes:
+// - the metadata journal lives in reserved, allocated data blocks, so it
+//   moves with the data region when an image is converted to FVM
 // - the ibm, abm, ino, and dat regions must be in that order
 //   and may not overlap
 // - the abm has an entry for every block on the volume, including
@@ -116,6 +129,10 @@ struct Superblock {
 //     ino_block + ino / kMinfsInodesPerBlock
 //   at offset: ino % kMinfsInodesPerBlock
 // - inode 0 is never used, should be marked allocated but ignored
+// - inodes with kMinfsInodeFlagExtents set hold up to kMinfsInlineExtents
+//   extents, sorted by file block and not overlapping, in place of their
+//   block tables; only files on volumes of kMinfsExtentVersion or later
+//   may be extent-mapped
 
 struct Inode {
     uint32_t magic;
@@ -127,7 +144,9 @@ struct Inode {
     uint32_t seq_num;               // bumped when modified
     uint32_t gen_num;               // bumped when deleted
     uint32_t dirent_count;          // for directories
-    uint32_t rsvd[5];
+    uint32_t flags;                 // kMinfsInodeFlag*
+    uint32_t extent_count;          // for extent-mapped files
+    uint32_t rsvd[3];
     blk_t dnum[kMinfsDirect];    // direct blocks
     blk_t inum[kMinfsIndirect];  // indirect blocks
     blk_t dinum[kMinfsDoublyIndirect]; // doubly indirect blocks
@@ -136,6 +155,31 @@ struct Inode {
 static_assert(sizeof(Inode) == kMinfsInodeSize,
               "minfs inode size is wrong");
 
+// A run of |length| blocks of a file, starting at file block |start|, which
+// live in the consecutive data blocks starting at |bno|.
+struct Extent {
+    blk_t start;
+    blk_t bno;
+    uint32_t length;
+};
+
+// The extents of an extent-mapped inode take the place of its direct,
+// indirect and doubly indirect blocks.
+constexpr uint32_t kMinfsInlineExtents =
+    (sizeof(blk_t) * (kMinfsDirect + kMinfsIndirect + kMinfsDoublyIndirect)) / sizeof(Extent);
+
+static_assert(offsetof(Inode, dinum) + sizeof(blk_t) * kMinfsDoublyIndirect -
+              offsetof(Inode, dnum) >= kMinfsInlineExtents * sizeof(Extent),
+              "minfs extents do not fit in the inode");
+
+inline Extent* InodeExtents(Inode* inode) {
+    return reinterpret_cast<Extent*>(inode->dnum);
+}
+
+inline const Extent* InodeExtents(const Inode* inode) {
+    return reinterpret_cast<const Extent*>(inode->dnum);
+}
+
 struct Dirent {
     ino_t ino;                      // inode number
     uint32_t reclen;                // Low 28 bits: Length of record
@@ -164,7 +208,7 @@ static_assert(kMinfsMaxNameSize >= NAME_MAX,
 constexpr uint32_t kMinfsReclenMask = 0x0FFFFFFF;
 constexpr uint32_t kMinfsReclenLast = 0x80000000;
 
-constexpr uint32_t MinfsReclen(Dirent* de, size_t off) {
+constexpr uint32_t MinfsReclen(const Dirent* de, size_t off) {
     return (de->reclen & kMinfsReclenLast) ?
            kMinfsMaxDirectorySize - static_cast<uint32_t>(off) :
            de->reclen & kMinfsReclenMask;
@@ -190,6 +234,65 @@ static_assert(kMinfsMaxDirectorySize <= kMinfsReclenMask,
 //  4GB ->  512K blocks ->  64K bitmap (8K qword)
 // 32GB -> 4096K blocks -> 512K bitmap (64K qwords)
 
+// The metadata journal is a ring of |jnl_blocks| data blocks.  Its first
+// block holds a JournalInfo; each entry in the rest of the ring is a
+// JournalHeader block, the blocks it lists, then a JournalCommit block.  An
+// entry never wraps around the end of the ring: it starts over at journal
+// block 1 instead, and the JournalInfo is rewritten to point there.
+//
+// Entries are written with consecutive sequence numbers, and each entry is
+// written back in place and flushed before the next one is written.  So
+// recovery only ever replays the last entry it finds by walking the ring
+// from JournalInfo::start.
+//
+// The journal is never smaller than kJournalMinBlocks, so that an entry can
+// hold the metadata of any operation but the very largest writes and
+// truncations (ordinary operations touch ten blocks or fewer).  Those are
+// written in place without journaling.
+
+constexpr uint64_t kJournalMagic       = (0x6c6e726a73666e6dULL); // "mnfsjrnl"
+constexpr uint64_t kJournalEntryMagic  = (0x7972746e65736a6dULL); // "mjsentry"
+constexpr uint64_t kJournalCommitMagic = (0x74696d6d6f636a6dULL); // "mjcommit"
+
+constexpr blk_t    kJournalStartBlock  = 2;   // After the null block and the root directory
+constexpr uint32_t kJournalMinBlocks   = 64;
+constexpr uint32_t kJournalMaxBlocks   = 256;
+
+struct JournalInfo {
+    uint64_t magic;
+    uint64_t seq;           // sequence number of the entry at |start|
+    blk_t start;            // journal block where replay starts looking
+    uint32_t reserved;
+};
+
+struct JournalHeader {
+    uint64_t magic;
+    uint64_t seq;
+    uint32_t count;         // number of blocks in the entry
+    uint32_t reserved;
+    blk_t blocks[];         // where each block of the entry belongs on disk
+};
+
+struct JournalCommit {
+    uint64_t magic;
+    uint64_t seq;
+    uint32_t checksum;      // crc32 of the header block and the entry blocks
+    uint32_t reserved;
+};
+
+// The most blocks a single journal entry may hold.
+constexpr uint32_t kJournalEntryMaxBlocks =
+    (kMinfsBlockSize - sizeof(JournalHeader)) / sizeof(blk_t);
+
+// The size of the journal made by mkfs for a volume with |block_count| data
+// blocks: 1/16th of the volume, within bounds, or 0 if the volume is too small
+// to spare an eighth of itself for the smallest journal.
+constexpr uint32_t JournalBlocks(uint32_t block_count) {
+    return (block_count / 8 < kJournalMinBlocks) ? 0 :
+           (block_count / 16 < kJournalMinBlocks) ? kJournalMinBlocks :
+           (block_count / 16 > kJournalMaxBlocks) ? kJournalMaxBlocks : block_count / 16;
+}
+
 // Block Cache (bcache.c)
 constexpr uint32_t kMinfsHashBits = (8);
 
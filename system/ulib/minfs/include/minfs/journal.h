@@ -0,0 +1,146 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file describes the journal which makes updates to minfs metadata
+// atomic.
+
+#pragma once
+
+#include <fbl/macros.h>
+#include <fbl/unique_ptr.h>
+#include <fbl/vector.h>
+
+#ifdef __Fuchsia__
+#include <lib/fzl/mapped-vmo.h>
+#endif
+
+#include <minfs/bcache.h>
+#include <minfs/format.h>
+
+namespace minfs {
+
+class WritebackWork;
+
+// Where the next journal entry goes.
+struct JournalPosition {
+    blk_t block;
+    uint64_t seq;
+};
+
+// Writes an empty journal for the volume described by |info|.
+zx_status_t InitializeJournal(Bcache* bc, const Superblock& info);
+
+// Writes the last committed entry of the journal back in place, so that the
+// metadata on disk reflects every transaction which completed before the
+// volume was last used.  This must run before any metadata is read.
+//
+// |out| is set to where the next entry may be written.
+zx_status_t ReplayJournal(Bcache* bc, const Superblock& info, JournalPosition* out);
+
+#ifdef __Fuchsia__
+
+// Journal commits groups of WritebackWork to disk.
+//
+// The metadata blocks of a group are written as a single journal entry along
+// with the file data of the group, and flushed; only then are the works
+// signalled as complete, and the metadata written to its home location.
+// Journaling many transactions at once turns their small scattered metadata
+// writes into one sequential write and one flush.
+//
+// Writing the metadata of an entry back in place is left in flight while the
+// next group is gathered; it is only waited for, and flushed, when the next
+// group is committed.  If it fails, the entry stays the last one in the ring,
+// so it is still replayed on the next mount; it is written back again before
+// the next group, which fails without writing an entry if that fails too.
+//
+// This class is thread-compatible; it is only used by the writeback thread.
+class Journal {
+public:
+    DISALLOW_COPY_ASSIGN_AND_MOVE(Journal);
+
+    static zx_status_t Create(Bcache* bc, const Superblock& info, const JournalPosition& pos,
+                              fbl::unique_ptr<Journal>* out);
+    ~Journal();
+
+    // Returns the number of metadata blocks |work| adds to a journal entry, at
+    // most.
+    static size_t MetadataBlocks(WritebackWork* work);
+
+    // The most metadata blocks which may be committed as one entry.
+    size_t Capacity() const { return capacity_; }
+
+    // Writes out the |count| works in |works|, whose requests have been
+    // copied into |buffer| (attached to the block device as |buffer_vmoid|),
+    // and signals each of them as complete.
+    //
+    // Works with more than |Capacity()| metadata blocks may only be committed
+    // one at a time; they are written in place without journaling.
+    void Commit(fbl::unique_ptr<WritebackWork>* works, size_t count, const void* buffer,
+                vmoid_t buffer_vmoid);
+
+private:
+    // A block of a group, as it should end up on disk.
+    struct BlockWrite {
+        uint64_t dev;      // Destination, in Minfs blocks
+        uint64_t src;      // Offset in the writeback buffer, in Minfs blocks
+        uint32_t order;    // Position within the group; later writes win
+        bool metadata;
+    };
+
+    Journal(Bcache* bc, blk_t start, uint32_t blocks, const JournalPosition& pos,
+            fbl::unique_ptr<fzl::MappedVmo> staging);
+
+    // Adds a write of |length| blocks from |vmoid| to the pending requests.
+    void Write(vmoid_t vmoid, uint64_t vmo_offset, uint64_t dev_offset, uint64_t length);
+
+    // Sends the pending requests to disk, followed by a flush if |flush| is
+    // set.  Clears the pending requests.
+    zx_status_t Transact(bool flush);
+
+    // Adds writes of the metadata of the entry in the staging buffer back to
+    // its home location to the pending requests.
+    void QueueWriteBack();
+
+    // Issues the pending requests, which write an entry back in place,
+    // without waiting for them.  Clears the pending requests.
+    zx_status_t BeginWriteBack();
+
+    // Waits for the entry being written back in place, if any, and flushes
+    // it, so that it is durable before another entry may be written.  If an
+    // earlier write back failed, tries it again.  Returns an error if the
+    // last entry is still not in place.
+    zx_status_t SettleWriteBack();
+
+    // Fills in the staging block at |staging_block| with a JournalInfo
+    // which points at the next entry.
+    void StageInfo(uint64_t staging_block);
+
+    Bcache* bc_;
+    // The first block of the journal on disk, and its size.
+    const blk_t start_;
+    const uint32_t blocks_;
+    const size_t capacity_;
+    JournalPosition next_;
+
+    // Holds the entry being written, and the JournalInfo.
+    fbl::unique_ptr<fzl::MappedVmo> staging_;
+    vmoid_t staging_vmoid_ = VMOID_INVALID;
+
+    // The group on which entries are written back in place, if one could be
+    // reserved; otherwise they are written back synchronously.
+    groupid_t writeback_group_ = 0;
+    bool has_writeback_group_ = false;
+    bool writeback_pending_ = false;
+    // Set from when an entry is committed until it is written back in place;
+    // until then the staging buffer must keep it.
+    bool writeback_needed_ = false;
+
+    // Scratch space, kept across groups to avoid reallocating it.
+    fbl::Vector<BlockWrite> writes_;
+    fbl::Vector<block_fifo_request_t> requests_;
+};
+
+#endif // __Fuchsia__
+
+} // namespace minfs
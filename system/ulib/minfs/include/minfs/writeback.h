@@ -28,6 +28,7 @@
 
 namespace minfs {
 
+class Journal;
 class VnodeMinfs;
 
 // A wrapper around a WriteTxn, holding references to the underlying Vnodes
@@ -60,6 +61,13 @@ public:
     // Only one closure may be set for each WritebackWork unit.
     using SyncCallback = fs::Vnode::SyncCallback;
     void SetClosure(SyncCallback closure);
+
+    bool HasClosure() const { return static_cast<bool>(closure_); }
+
+    // Signals the closure with |status| once the enqueued work has been
+    // written out by someone else (the journal), drops the requests, and
+    // resets the WritebackWork to its initial state.
+    void Finish(zx_status_t status);
 #else
     // Flushes any pending transactions.
     void Complete();
@@ -101,6 +109,17 @@ public:
         return block_promise_->Allocate(work_.get());
     }
 
+    // Allocates a block at |goal| if it is free, or else at the start of
+    // |run| free blocks if there are any.
+    size_t AllocateBlockNear(size_t goal, size_t run) {
+        ZX_DEBUG_ASSERT(block_promise_ != nullptr);
+        return block_promise_->AllocateNear(work_.get(), goal, run);
+    }
+
+    size_t BlocksReserved() const {
+        return block_promise_ == nullptr ? 0 : block_promise_->GetReserved();
+    }
+
     void SetWork(fbl::unique_ptr<WritebackWork> work) {
         work_ = fbl::move(work);
     }
@@ -128,7 +147,11 @@ private:
 class WritebackBuffer {
 public:
     // Calls constructor, return an error if anything goes wrong.
+    //
+    // |journal| may be null, in which case each unit of work is written in
+    // place on its own, without a journal.
     static zx_status_t Create(Bcache* bc, fbl::unique_ptr<fzl::MappedVmo> buffer,
+                              fbl::unique_ptr<Journal> journal,
                               fbl::unique_ptr<WritebackBuffer>* out);
     ~WritebackBuffer();
 
@@ -143,7 +166,8 @@ public:
     void Enqueue(fbl::unique_ptr<WritebackWork> work) __TA_EXCLUDES(writeback_lock_);
 
 private:
-    WritebackBuffer(Bcache* bc, fbl::unique_ptr<fzl::MappedVmo> buffer);
+    WritebackBuffer(Bcache* bc, fbl::unique_ptr<fzl::MappedVmo> buffer,
+                    fbl::unique_ptr<Journal> journal);
 
     // Blocks until |blocks| blocks of data are free for the caller.
     // Returns |ZX_OK| with the lock still held in this case.
@@ -193,6 +217,8 @@ private:
     bool unmounting_ __TA_GUARDED(writeback_lock_){false};
     fbl::unique_ptr<fzl::MappedVmo> buffer_{};
     vmoid_t buffer_vmoid_ = VMOID_INVALID;
+    // Only used by the writeback thread.
+    fbl::unique_ptr<Journal> journal_;
     // The units of all the following are "MinFS blocks".
     size_t start_ __TA_GUARDED(writeback_lock_){};
     size_t len_ __TA_GUARDED(writeback_lock_){};
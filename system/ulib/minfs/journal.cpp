@@ -0,0 +1,454 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __Fuchsia__
+#include <lib/fzl/mapped-vmo.h>
+#include <trace/event.h>
+#endif
+
+#include <fbl/algorithm.h>
+#include <fbl/unique_ptr.h>
+#include <fs/trace.h>
+#include <lib/cksum.h>
+
+#include <minfs/journal.h>
+#include <minfs/writeback.h>
+
+#include "minfs-private.h"
+
+namespace minfs {
+namespace {
+
+// Reads the entry at journal block |pos| into |header|, and checks that it
+// is a whole entry with sequence number |seq|.
+zx_status_t ReadEntry(Bcache* bc, const Superblock& info, blk_t pos, uint64_t seq,
+                      uint8_t* header) {
+    const blk_t start = info.dat_block + info.jnl_block;
+    if (bc->Readblk(start + pos, header) != ZX_OK) {
+        return ZX_ERR_IO;
+    }
+    const JournalHeader* hdr = reinterpret_cast<const JournalHeader*>(header);
+    if (hdr->magic != kJournalEntryMagic || hdr->seq != seq || hdr->count == 0 ||
+        hdr->count > kJournalEntryMaxBlocks || pos + hdr->count + 2 > info.jnl_blocks) {
+        return ZX_ERR_NOT_FOUND;
+    }
+
+    uint8_t blk[kMinfsBlockSize];
+    uint32_t checksum = crc32(0, header, kMinfsBlockSize);
+    for (uint32_t i = 0; i < hdr->count; i++) {
+        if (bc->Readblk(start + pos + 1 + i, blk) != ZX_OK) {
+            return ZX_ERR_IO;
+        }
+        checksum = crc32(checksum, blk, kMinfsBlockSize);
+    }
+    if (bc->Readblk(start + pos + 1 + hdr->count, blk) != ZX_OK) {
+        return ZX_ERR_IO;
+    }
+    const JournalCommit* commit = reinterpret_cast<const JournalCommit*>(blk);
+    if (commit->magic != kJournalCommitMagic || commit->seq != seq ||
+        commit->checksum != checksum) {
+        return ZX_ERR_NOT_FOUND;
+    }
+    return ZX_OK;
+}
+
+} // namespace
+
+zx_status_t InitializeJournal(Bcache* bc, const Superblock& info) {
+    if (info.jnl_blocks == 0) {
+        return ZX_OK;
+    }
+    uint8_t blk[kMinfsBlockSize];
+    memset(blk, 0, sizeof(blk));
+    // Make sure nothing which happens to be on the disk looks like an entry.
+    zx_status_t status;
+    if ((status = bc->Writeblk(info.dat_block + info.jnl_block + 1, blk)) != ZX_OK) {
+        return status;
+    }
+    JournalInfo* jinfo = reinterpret_cast<JournalInfo*>(blk);
+    jinfo->magic = kJournalMagic;
+    jinfo->seq = 1;
+    jinfo->start = 1;
+    return bc->Writeblk(info.dat_block + info.jnl_block, blk);
+}
+
+zx_status_t ReplayJournal(Bcache* bc, const Superblock& info, JournalPosition* out) {
+    // This runs before the superblock is checked.
+    if (info.jnl_block == 0 || info.jnl_blocks < kJournalMinBlocks ||
+        info.jnl_blocks > kJournalMaxBlocks ||
+        info.jnl_block + info.jnl_blocks > info.block_count) {
+        FS_TRACE_ERROR("minfs: bad journal location\n");
+        return ZX_ERR_INVALID_ARGS;
+    }
+    const blk_t start = info.dat_block + info.jnl_block;
+    uint8_t blk[kMinfsBlockSize];
+    zx_status_t status;
+    if ((status = bc->Readblk(start, blk)) != ZX_OK) {
+        return status;
+    }
+    JournalInfo jinfo;
+    memcpy(&jinfo, blk, sizeof(jinfo));
+    if (jinfo.magic != kJournalMagic || jinfo.start == 0 || jinfo.start >= info.jnl_blocks) {
+        FS_TRACE_ERROR("minfs: bad journal info\n");
+        return ZX_ERR_IO_DATA_INTEGRITY;
+    }
+
+    // Every entry but the last has already been written back in place.
+    JournalPosition pos = {jinfo.start, jinfo.seq};
+    blk_t last = 0;
+    uint8_t header[kMinfsBlockSize];
+    while ((status = ReadEntry(bc, info, pos.block, pos.seq, header)) == ZX_OK) {
+        last = pos.block;
+        pos.block += reinterpret_cast<const JournalHeader*>(header)->count + 2;
+        pos.seq++;
+    }
+    if (status != ZX_ERR_NOT_FOUND) {
+        return status;
+    }
+
+    if (last != 0) {
+        if ((status = ReadEntry(bc, info, last, pos.seq - 1, header)) != ZX_OK) {
+            return status;
+        }
+        const JournalHeader* hdr = reinterpret_cast<const JournalHeader*>(header);
+        FS_TRACE_WARN("minfs: replaying %u blocks from journal entry %" PRIu64 "\n",
+                      hdr->count, hdr->seq);
+        for (uint32_t i = 0; i < hdr->count; i++) {
+            const blk_t bno = hdr->blocks[i];
+            if (bno >= info.dat_block + info.block_count ||
+                (bno >= start && bno < start + info.jnl_blocks)) {
+                FS_TRACE_ERROR("minfs: journal entry writes to bad block %u\n", bno);
+                return ZX_ERR_IO_DATA_INTEGRITY;
+            }
+            if ((status = bc->Readblk(start + last + 1 + i, blk)) != ZX_OK ||
+                (status = bc->Writeblk(bno, blk)) != ZX_OK) {
+                return status;
+            }
+        }
+        if ((status = bc->Sync()) != ZX_OK) {
+            return status;
+        }
+
+        // Point past the replayed entry, so that it is not replayed again
+        // over whatever is written after this mount.
+        memset(blk, 0, sizeof(blk));
+        JournalInfo* next = reinterpret_cast<JournalInfo*>(blk);
+        next->magic = kJournalMagic;
+        next->seq = pos.seq;
+        next->start = pos.block;
+        if ((status = bc->Writeblk(start, blk)) != ZX_OK ||
+            (status = bc->Sync()) != ZX_OK) {
+            return status;
+        }
+    }
+
+    *out = pos;
+    return ZX_OK;
+}
+
+#ifdef __Fuchsia__
+
+zx_status_t Journal::Create(Bcache* bc, const Superblock& info, const JournalPosition& pos,
+                            fbl::unique_ptr<Journal>* out) {
+    // One block more than the largest entry, for the JournalInfo.
+    fbl::unique_ptr<fzl::MappedVmo> staging;
+    zx_status_t status = fzl::MappedVmo::Create(info.jnl_blocks * kMinfsBlockSize,
+                                                "minfs-journal", &staging);
+    if (status != ZX_OK) {
+        return status;
+    }
+    fbl::unique_ptr<Journal> journal(new Journal(bc, info.dat_block + info.jnl_block,
+                                                 info.jnl_blocks, pos, fbl::move(staging)));
+    if ((status = bc->AttachVmo(journal->staging_->GetVmo(),
+                                &journal->staging_vmoid_)) != ZX_OK) {
+        return status;
+    }
+    journal->has_writeback_group_ = bc->ReserveBlockGroupID(&journal->writeback_group_) == ZX_OK;
+    *out = fbl::move(journal);
+    return ZX_OK;
+}
+
+Journal::Journal(Bcache* bc, blk_t start, uint32_t blocks, const JournalPosition& pos,
+                 fbl::unique_ptr<fzl::MappedVmo> staging)
+    : bc_(bc), start_(start), blocks_(blocks),
+      capacity_(fbl::min(blocks - 3, kJournalEntryMaxBlocks)), next_(pos),
+      staging_(fbl::move(staging)) {}
+
+Journal::~Journal() {
+    if (SettleWriteBack() != ZX_OK) {
+        FS_TRACE_ERROR("minfs: journal entry %" PRIu64 " left to replay\n", next_.seq - 1);
+    }
+    if (staging_vmoid_ != VMOID_INVALID) {
+        block_fifo_request_t request;
+        request.group = bc_->BlockGroupID();
+        request.vmoid = staging_vmoid_;
+        request.opcode = BLOCKIO_CLOSE_VMO;
+        bc_->Transaction(&request, 1);
+    }
+}
+
+size_t Journal::MetadataBlocks(WritebackWork* work) {
+    size_t blocks = 0;
+    auto& reqs = work->Requests();
+    for (size_t i = 0; i < reqs.size(); i++) {
+        if (reqs[i].metadata) {
+            blocks += reqs[i].length;
+        }
+    }
+    return blocks;
+}
+
+void Journal::Write(vmoid_t vmoid, uint64_t vmo_offset, uint64_t dev_offset, uint64_t length) {
+    const uint32_t kDiskBlocksPerMinfsBlock = kMinfsBlockSize / bc_->DeviceBlockSize();
+    block_fifo_request_t request;
+    request.group = bc_->BlockGroupID();
+    request.vmoid = vmoid;
+    request.opcode = BLOCKIO_WRITE;
+    request.vmo_offset = vmo_offset * kDiskBlocksPerMinfsBlock;
+    request.dev_offset = dev_offset * kDiskBlocksPerMinfsBlock;
+    // TODO(ZX-2253): Remove this assertion.
+    length *= kDiskBlocksPerMinfsBlock;
+    ZX_ASSERT_MSG(length < UINT32_MAX, "Too many blocks");
+    request.length = static_cast<uint32_t>(length);
+    requests_.push_back(request);
+}
+
+zx_status_t Journal::Transact(bool flush) {
+    zx_status_t status = ZX_OK;
+    if (requests_.size() > 0) {
+        status = bc_->Transaction(requests_.get(), requests_.size());
+        requests_.reset();
+    }
+    if (status == ZX_OK && flush) {
+        // The writes above have completed, so the flush makes them durable.
+        block_fifo_request_t request;
+        request.group = bc_->BlockGroupID();
+        request.vmoid = VMOID_INVALID;
+        request.opcode = BLOCKIO_FLUSH;
+        request.length = 0;
+        request.vmo_offset = 0;
+        request.dev_offset = 0;
+        status = bc_->Transaction(&request, 1);
+    }
+    return status;
+}
+
+void Journal::QueueWriteBack() {
+    // The blocks of the entry are listed in disk order.
+    const JournalHeader* header = static_cast<const JournalHeader*>(staging_->GetData());
+    for (uint32_t i = 0; i < header->count;) {
+        const blk_t dev = header->blocks[i];
+        uint32_t run = 1;
+        while (i + run < header->count && header->blocks[i + run] == dev + run) {
+            run++;
+        }
+        Write(staging_vmoid_, 1 + i, dev, run);
+        i += run;
+    }
+}
+
+zx_status_t Journal::BeginWriteBack() {
+    for (size_t i = 0; i < requests_.size(); i++) {
+        requests_[i].group = writeback_group_;
+    }
+    zx_status_t status = bc_->BeginTransaction(requests_.get(), requests_.size());
+    requests_.reset();
+    writeback_pending_ = status == ZX_OK;
+    return status;
+}
+
+zx_status_t Journal::SettleWriteBack() {
+    ZX_DEBUG_ASSERT(requests_.is_empty());
+    zx_status_t status = ZX_OK;
+    if (writeback_pending_) {
+        writeback_pending_ = false;
+        status = bc_->WaitTransaction(writeback_group_);
+        if (status == ZX_OK) {
+            status = Transact(true);
+        }
+        if (status == ZX_OK) {
+            writeback_needed_ = false;
+            return ZX_OK;
+        }
+        FS_TRACE_ERROR("minfs: failed to write back journal entry: %d\n", status);
+    }
+    if (!writeback_needed_) {
+        return ZX_OK;
+    }
+
+    // The entry is still the last one in the ring, and still in the staging
+    // buffer; try again.
+    QueueWriteBack();
+    if ((status = Transact(true)) != ZX_OK) {
+        FS_TRACE_ERROR("minfs: failed to write back journal entry again: %d\n", status);
+        return status;
+    }
+    writeback_needed_ = false;
+    return ZX_OK;
+}
+
+void Journal::StageInfo(uint64_t staging_block) {
+    uint8_t* blk = static_cast<uint8_t*>(staging_->GetData()) + staging_block * kMinfsBlockSize;
+    memset(blk, 0, kMinfsBlockSize);
+    JournalInfo* jinfo = reinterpret_cast<JournalInfo*>(blk);
+    jinfo->magic = kJournalMagic;
+    jinfo->seq = next_.seq;
+    jinfo->start = next_.block;
+}
+
+void Journal::Commit(fbl::unique_ptr<WritebackWork>* works, size_t count, const void* buffer,
+                     vmoid_t buffer_vmoid) {
+    TRACE_DURATION("minfs", "Journal::Commit");
+
+    // The staging buffer still holds the previous entry until it is in place.
+    // Until it is, no entry may be written after it, since only the last entry
+    // is replayed.
+    zx_status_t status = SettleWriteBack();
+    if (status != ZX_OK) {
+        for (size_t i = 0; i < count; i++) {
+            works[i]->Finish(status);
+        }
+        return;
+    }
+
+    // Break the group into single blocks, so that a block written more than
+    // once is only written out in its final state.
+    writes_.reset();
+    uint32_t order = 0;
+    bool signal = false;
+    for (size_t i = 0; i < count; i++) {
+        auto& reqs = works[i]->Requests();
+        for (size_t r = 0; r < reqs.size(); r++) {
+            for (size_t b = 0; b < reqs[r].length; b++) {
+                writes_.push_back({reqs[r].dev_offset + b, reqs[r].vmo_offset + b, order++,
+                                   reqs[r].metadata});
+            }
+        }
+        signal |= works[i]->HasClosure();
+    }
+    qsort(writes_.get(), writes_.size(), sizeof(BlockWrite), [](const void* a, const void* b) {
+        const BlockWrite* wa = static_cast<const BlockWrite*>(a);
+        const BlockWrite* wb = static_cast<const BlockWrite*>(b);
+        if (wa->dev != wb->dev) {
+            return wa->dev < wb->dev ? -1 : 1;
+        }
+        return wa->order < wb->order ? -1 : 1;
+    });
+    size_t unique = 0;
+    size_t metadata = 0;
+    for (size_t i = 0; i < writes_.size(); i++) {
+        if (i + 1 < writes_.size() && writes_[i + 1].dev == writes_[i].dev) {
+            continue;
+        }
+        writes_[unique++] = writes_[i];
+        metadata += writes_[unique - 1].metadata ? 1 : 0;
+    }
+
+    // File data goes straight to its home location.  It is written before
+    // the metadata which refers to it is committed.
+    for (size_t i = 0; i < unique; i++) {
+        const BlockWrite& w = writes_[i];
+        if (w.metadata && metadata <= capacity_) {
+            continue;
+        }
+        size_t run = 1;
+        while (i + run < unique && writes_[i + run].metadata == w.metadata &&
+               writes_[i + run].dev == w.dev + run && writes_[i + run].src == w.src + run) {
+            run++;
+        }
+        Write(buffer_vmoid, w.src, w.dev, run);
+        i += run - 1;
+    }
+
+    if (metadata == 0) {
+        status = Transact(signal);
+    } else if (metadata > capacity_) {
+        // Too big to be atomic.  Write everything in place, as minfs did
+        // before it had a journal, after making sure the last entry is never
+        // replayed over it.
+        ZX_DEBUG_ASSERT(count == 1);
+        FS_TRACE_WARN("minfs: %zu metadata blocks do not fit in the journal\n", metadata);
+        StageInfo(0);
+        fbl::Vector<block_fifo_request_t> in_place = fbl::move(requests_);
+        Write(staging_vmoid_, 0, start_, 1);
+        status = Transact(true);
+        requests_ = fbl::move(in_place);
+        if (status == ZX_OK) {
+            status = Transact(true);
+        }
+    } else {
+        // Lay out the entry: a header, the metadata in disk order, then the
+        // commit block.
+        uint8_t* staging = static_cast<uint8_t*>(staging_->GetData());
+        const size_t entry_blocks = metadata + 2;
+        if (next_.block + entry_blocks > blocks_) {
+            next_.block = 1;
+        }
+        memset(staging, 0, kMinfsBlockSize);
+        JournalHeader* header = reinterpret_cast<JournalHeader*>(staging);
+        header->magic = kJournalEntryMagic;
+        header->seq = next_.seq;
+        header->count = static_cast<uint32_t>(metadata);
+        size_t n = 0;
+        for (size_t i = 0; i < unique; i++) {
+            if (writes_[i].metadata) {
+                header->blocks[n++] = static_cast<blk_t>(writes_[i].dev);
+                memcpy(staging + n * kMinfsBlockSize,
+                       static_cast<const uint8_t*>(buffer) + writes_[i].src * kMinfsBlockSize,
+                       kMinfsBlockSize);
+            }
+        }
+        uint32_t checksum = crc32(0, staging, entry_blocks * kMinfsBlockSize - kMinfsBlockSize);
+        uint8_t* commit_blk = staging + (metadata + 1) * kMinfsBlockSize;
+        memset(commit_blk, 0, kMinfsBlockSize);
+        JournalCommit* commit = reinterpret_cast<JournalCommit*>(commit_blk);
+        commit->magic = kJournalCommitMagic;
+        commit->seq = next_.seq;
+        commit->checksum = checksum;
+
+        Write(staging_vmoid_, 0, start_ + next_.block, entry_blocks);
+        if (next_.block == 1) {
+            // The ring wrapped around; replay must start looking here now.
+            StageInfo(entry_blocks);
+            Write(staging_vmoid_, entry_blocks, start_, 1);
+        }
+        status = Transact(true);
+        if (status == ZX_OK) {
+            next_.block += static_cast<blk_t>(entry_blocks);
+            next_.seq++;
+            writeback_needed_ = true;
+        }
+    }
+
+    // The group is durable, or has failed; either way it is done.
+    for (size_t i = 0; i < count; i++) {
+        works[i]->Finish(status);
+    }
+
+    requests_.reset();
+    if (writeback_needed_) {
+        // Write the metadata back in place, and flush it before the next
+        // entry may be written.  With a group of its own, the write is left
+        // in flight, and settled by the next commit; otherwise a failure is
+        // retried by the next commit.
+        QueueWriteBack();
+        if (has_writeback_group_) {
+            status = BeginWriteBack();
+        } else if ((status = Transact(true)) == ZX_OK) {
+            writeback_needed_ = false;
+        }
+        if (status != ZX_OK) {
+            FS_TRACE_ERROR("minfs: failed to write back journal entry: %d\n", status);
+        }
+        requests_.reset();
+    }
+}
+
+#endif // __Fuchsia__
+
+} // namespace minfs
@@ -22,6 +22,7 @@
 #endif
 
 #include <fbl/algorithm.h>
+#include <fbl/atomic.h>
 #include <fbl/function.h>
 #include <fbl/intrusive_hash_table.h>
 #include <fbl/intrusive_single_list.h>
@@ -36,8 +37,10 @@
 #include <fs/vnode.h>
 #include <lib/zircon-internal/fnv1hash.h>
 #include <minfs/allocator.h>
+#include <minfs/directory-index.h>
 #include <minfs/format.h>
 #include <minfs/inode-manager.h>
+#include <minfs/journal.h>
 #include <minfs/superblock.h>
 #include <minfs/writeback.h>
 
@@ -148,6 +151,10 @@ public:
     // Allocate a new data block.
     void BlockNew(Transaction* state, blk_t* out_bno);
 
+    // Allocate a new data block, at |goal| if it is free, or else at the start of |run| free
+    // blocks if there are any.
+    void BlockNewNear(Transaction* state, blk_t goal, blk_t run, blk_t* out_bno);
+
     // Free a data block.
     void BlockFree(WriteTxn* txn, blk_t bno);
 
@@ -205,8 +212,8 @@ public:
     // functions is preferred.
     zx_status_t ReadDat(blk_t bno, void* data);
 
-    void SetMetrics(bool enable) { collecting_metrics_ = enable; }
-    fs::Ticker StartTicker() { return fs::Ticker(collecting_metrics_); }
+    void SetMetrics(bool enable) { collecting_metrics_.store(enable); }
+    fs::Ticker StartTicker() { return fs::Ticker(collecting_metrics_.load()); }
 
     // Update aggregate information about VMO initialization.
     void UpdateInitMetrics(uint32_t dnum_count, uint32_t inum_count,
@@ -232,7 +239,8 @@ public:
 #ifdef __Fuchsia__
     // Acquire a copy of the collected metrics.
     zx_status_t GetMetrics(fuchsia_minfs_Metrics* out) const {
-        if (collecting_metrics_) {
+        if (collecting_metrics_.load()) {
+            fbl::AutoLock lock(&metrics_lock_);
             memcpy(out, &metrics_, sizeof(metrics_));
             return ZX_OK;
         }
@@ -251,6 +259,8 @@ public:
 private:
     // Fsck can introspect Minfs
     friend class MinfsChecker;
+    // Vnodes take |txn_lock_| before changing the filesystem.
+    friend class VnodeMinfs;
     using HashTable = fbl::HashTable<ino_t, VnodeMinfs*>;
 
 #ifdef __Fuchsia__
@@ -291,10 +301,19 @@ private:
 #endif
     HashTable vnode_hash_ FS_TA_GUARDED(hash_lock_){};
 
-    bool collecting_metrics_ = false;
+#ifdef __Fuchsia__
+    // Serializes changes to the filesystem. Every operation which begins a
+    // transaction holds this lock from before it examines the vnodes it will
+    // change until the transaction is committed, so allocations and metadata
+    // updates are never interleaved. It is acquired before any vnode lock.
+    fbl::Mutex txn_lock_;
+#endif
+
+    fbl::atomic<bool> collecting_metrics_{false};
 #ifdef __Fuchsia__
     fbl::Closure on_unmount_{};
-    fuchsia_minfs_Metrics metrics_ = {};
+    mutable fbl::Mutex metrics_lock_;
+    fuchsia_minfs_Metrics metrics_ FS_TA_GUARDED(metrics_lock_) = {};
     fbl::unique_ptr<WritebackBuffer> writeback_;
     uint64_t fs_id_{};
 #else
@@ -408,6 +427,8 @@ private:
     zx_status_t WriteExactInternal(Transaction* state, const void* data, size_t len,
                                    size_t off);
     zx_status_t TruncateInternal(Transaction* state, size_t len);
+    // Write and Append, once the vnode is locked for writing.
+    zx_status_t WriteLocked(const void* data, size_t len, size_t offset, size_t* out_actual);
     // Lookup which can traverse '..'
     zx_status_t LookupInternal(fbl::RefPtr<fs::Vnode>* out, fbl::StringPiece name);
 
@@ -420,6 +441,26 @@ private:
     // Enumerates directories.
     zx_status_t ForEachDirent(DirArgs* args, const DirentCallback func);
 
+    // Like |ForEachDirent|, but only visits the dirents which may be named |args->name|, when
+    // the directory is large enough to be indexed. |func| must not skip dirents by name alone.
+    zx_status_t ForEachDirentNamed(DirArgs* args, const DirentCallback func);
+
+    // Like |ForEachDirent|, but only visits the dirents which have room for |args->reclen| more
+    // bytes, when the directory is large enough to be indexed.
+    zx_status_t ForEachDirentWithSpace(DirArgs* args, const DirentCallback func);
+
+    // Passes the dirent at |args->offs.off| to |func|, and reacts to its return code as
+    // |ForEachDirent| does. Returns kDirIteratorNext if |func| asked for the next dirent.
+    zx_status_t VisitDirent(DirArgs* args, const DirentCallback func);
+
+    // Returns the index of this directory, building it first if the directory is large enough
+    // to need one. Returns nullptr if the directory is scanned instead.
+    DirectoryIndex* GetDirectoryIndex();
+
+    // Keep |dir_index_|, if there is one, in step with the dirent |de| at |off|.
+    void IndexDirent(const Dirent* de, size_t off);
+    void UnindexDirent(const Dirent* de, size_t off);
+
     // Directory callback functions.
     //
     // The following functions are passable to |ForEachDirent|, which reads the parent directory,
@@ -434,6 +475,7 @@ private:
     static zx_status_t DirentCallbackUpdateInode(fbl::RefPtr<VnodeMinfs>, Dirent*,
                                                  DirArgs*);
     static zx_status_t DirentCallbackFindSpace(fbl::RefPtr<VnodeMinfs>, Dirent*, DirArgs*);
+    static zx_status_t DirentCallbackIndex(fbl::RefPtr<VnodeMinfs>, Dirent*, DirArgs*);
 
     // Appends a new directory at the specified offset within |args|. This requires a prior call to
     // DirentCallbackFindSpace to find an offset where there is space for the direntry. It takes
@@ -475,6 +517,7 @@ private:
         kRead,
         kWrite,
         kDelete,
+        kAssign,
     };
 
     struct BlockOpArgs {
@@ -499,6 +542,11 @@ private:
 
         BlockOp GetOp() const { return op_; }
         blk_t GetBno(blk_t index) const { return array_[index]; }
+        // The bno which kAssign maps at |index|, as given by the caller.
+        blk_t GetAssignedBno(blk_t index) const {
+            ZX_DEBUG_ASSERT(bnos_ != nullptr);
+            return bnos_[index];
+        }
         void SetBno(blk_t index, blk_t value) {
             ZX_DEBUG_ASSERT(index < GetCount());
 
@@ -594,14 +642,37 @@ private:
 
     // Get the disk block 'bno' corresponding to the 'n' block
     // If 'txn' is non-null, new blocks are allocated for all un-allocated bnos.
+    // 'run' is the number of blocks, starting at 'n', which the caller is about to get; extent
+    // mapped vnodes use it to keep them together on disk.
     // This can be extended to retrieve multiple contiguous blocks in one call
-    zx_status_t BlockGet(Transaction* state, blk_t n, blk_t* bno);
+    zx_status_t BlockGet(Transaction* state, blk_t n, blk_t* bno, blk_t run = 1);
     // Deletes all blocks (relative to a file) from "start" (inclusive) to the end
     // of the file. Does not update mtime/atime.
     // This can be extended to return indices of deleted bnos, or to delete a specific number of
     // bnos
     zx_status_t BlocksShrink(Transaction* state, blk_t start);
 
+    // Returns true if the blocks of this vnode are mapped by extents rather than block tables.
+    bool UsesExtents() const { return (inode_.flags & kMinfsInodeFlagExtents) != 0; }
+
+    // |BlockGet| and |BlocksShrink| for extent-mapped vnodes.
+    zx_status_t ExtentBlockGet(Transaction* state, blk_t n, blk_t run, blk_t* bno);
+    zx_status_t ExtentsShrink(Transaction* state, blk_t start);
+
+    // Moves the blocks of this vnode from its extents into block tables, for when it needs more
+    // extents than fit in the inode.
+    zx_status_t ConvertExtentsToBlockMap(Transaction* state);
+
+    // Maps the |count| blocks starting at |n| to the consecutive disk blocks starting at |bno|,
+    // in the block tables.
+    zx_status_t AssignBlocks(Transaction* state, blk_t n, blk_t count, blk_t bno);
+
+    // Like GetRequiredBlockCount, for a write to this vnode: extent-mapped vnodes need no
+    // indirect blocks unless the write may leave them block-mapped. |num_min_blocks| is the
+    // number of blocks needed if it does not; such a write stops early if it runs out of extents.
+    zx_status_t GetRequiredWriteBlockCount(size_t offset, size_t length, blk_t* num_req_blocks,
+                                           blk_t* num_min_blocks) const;
+
     // Update the vnode's inode and write it to disk.
     void InodeSync(WritebackWork* wb, uint32_t flags);
 
@@ -620,6 +691,9 @@ private:
     zx_status_t InitVmo();
     zx_status_t InitIndirectVmo();
 
+    // Initializes the indirect VMO, and grows it to hold the indirect blocks of block |n|.
+    zx_status_t EnsureIndirectVmo(blk_t n);
+
     // Loads indirect blocks up to and including the doubly indirect block at |index|.
     zx_status_t LoadIndirectWithinDoublyIndirect(uint32_t index);
 
@@ -673,11 +747,20 @@ private:
 
     fs::RemoteContainer remoter_{};
     fs::WatcherContainer watcher_{};
+
+    // Guards the inode, contents and open count of this vnode against the
+    // dispatch threads. Readers hold only this lock. Writers also hold the
+    // filesystem's |txn_lock_|, which they must acquire first; a writer may
+    // therefore lock several vnodes without risk of deadlock.
+    fbl::Mutex lock_;
 #endif
 
     ino_t ino_{};
     Inode inode_{};
 
+    // Locates the dirents of large directories; see |GetDirectoryIndex|.
+    fbl::unique_ptr<DirectoryIndex> dir_index_;
+
     // This field tracks the current number of file descriptors with
     // an open reference to this Vnode. Notably, this is distinct from the
     // VnodeMinfs's own refcount, since there may still be filesystem
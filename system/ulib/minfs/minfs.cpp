@@ -83,6 +83,7 @@ void DumpInfo(const Superblock* info) {
     xprintf("minfs: alloc bitmap @ %10u\n", info->abm_block);
     xprintf("minfs: inode table  @ %10u\n", info->ino_block);
     xprintf("minfs: data blocks  @ %10u\n", info->dat_block);
+    xprintf("minfs: journal      @ %10u (%u blocks)\n", info->jnl_block, info->jnl_blocks);
     xprintf("minfs: FVM-aware: %s\n", (info->flags & kMinfsFlagFVM) ? "YES" : "NO");
 }
 
@@ -91,6 +92,13 @@ void DumpInode(const Inode* inode, ino_t ino) {
     xprintf("inode[%u]: size:   %10u\n", ino, inode->size);
     xprintf("inode[%u]: blocks: %10u\n", ino, inode->block_count);
     xprintf("inode[%u]: links:  %10u\n", ino, inode->link_count);
+    if (inode->flags & kMinfsInodeFlagExtents) {
+        for (uint32_t i = 0; i < inode->extent_count; i++) {
+            const Extent& extent = InodeExtents(inode)[i];
+            xprintf("inode[%u]: extent: %10u @%u +%u\n", ino, extent.start, extent.bno,
+                    extent.length);
+        }
+    }
 }
 
 zx_status_t CheckSuperblock(const Superblock* info, Bcache* bc) {
@@ -101,15 +109,26 @@ zx_status_t CheckSuperblock(const Superblock* info, Bcache* bc) {
         FS_TRACE_ERROR("minfs: bad magic\n");
         return ZX_ERR_INVALID_ARGS;
     }
-    if (info->version != kMinfsVersion) {
-        FS_TRACE_ERROR("minfs: FS Version: %08x. Driver version: %08x\n", info->version,
-                       kMinfsVersion);
+    if (info->version < kMinfsMinVersion || info->version > kMinfsVersion) {
+        FS_TRACE_ERROR("minfs: FS Version: %08x. Driver versions: %08x to %08x\n", info->version,
+                       kMinfsMinVersion, kMinfsVersion);
+        return ZX_ERR_INVALID_ARGS;
+    }
+    // mkfs zero-filled the rest of the superblock before there was a journal,
+    // so older volumes read as having none.
+    if (info->version < kMinfsJournalVersion && (info->jnl_block != 0 || info->jnl_blocks != 0)) {
+        FS_TRACE_ERROR("minfs: journal on a version %u volume\n", info->version);
         return ZX_ERR_INVALID_ARGS;
     }
     if ((info->block_size != kMinfsBlockSize) || (info->inode_size != kMinfsInodeSize)) {
         FS_TRACE_ERROR("minfs: bsz/isz %u/%u unsupported\n", info->block_size, info->inode_size);
         return ZX_ERR_INVALID_ARGS;
     }
+    if (info->jnl_blocks != 0 && (info->jnl_block == 0 || info->jnl_blocks < kJournalMinBlocks ||
+                                  info->jnl_block + info->jnl_blocks > info->block_count)) {
+        FS_TRACE_ERROR("minfs: bad journal location\n");
+        return ZX_ERR_INVALID_ARGS;
+    }
     if ((info->flags & kMinfsFlagFVM) == 0) {
         if (info->dat_block + info->block_count > max) {
             FS_TRACE_ERROR("minfs: too large for device\n");
@@ -280,6 +299,7 @@ zx_status_t Minfs::BeginTransaction(size_t reserve_inodes, size_t reserve_blocks
 
 #ifdef __Fuchsia__
 void Minfs::Sync(SyncCallback closure) {
+    fbl::AutoLock lock(&txn_lock_);
     fbl::unique_ptr<Transaction> state;
     ZX_ASSERT(BeginTransaction(0, 0, &state) == ZX_OK);
     state->GetWork()->SetClosure(fbl::move(closure));
@@ -322,6 +342,20 @@ zx_status_t Minfs::InoFree(VnodeMinfs* vn, WritebackWork* wb) {
     inodes_->Free(wb, vn->ino_);
     uint32_t block_count = vn->inode_.block_count;
 
+    if (vn->UsesExtents()) {
+        const Extent* extents = InodeExtents(&vn->inode_);
+        for (uint32_t e = 0; e < vn->inode_.extent_count; e++) {
+            for (blk_t n = 0; n < extents[e].length; n++) {
+                ValidateBno(extents[e].bno + n);
+                block_count--;
+                block_allocator_->Free(wb, extents[e].bno + n);
+            }
+        }
+        ZX_DEBUG_ASSERT(block_count == 0);
+        ZX_DEBUG_ASSERT(vn->IsUnlinked());
+        return ZX_OK;
+    }
+
     // release all direct blocks
     for (unsigned n = 0; n < kMinfsDirect; n++) {
         if (vn->inode_.dnum[n] == 0) {
@@ -550,6 +584,11 @@ void Minfs::BlockNew(Transaction* state, blk_t* out_bno) {
     *out_bno = static_cast<blk_t>(allocated_bno);
 }
 
+void Minfs::BlockNewNear(Transaction* state, blk_t goal, blk_t run, blk_t* out_bno) {
+    size_t allocated_bno = state->AllocateBlockNear(goal, run);
+    *out_bno = static_cast<blk_t>(allocated_bno);
+}
+
 void Minfs::BlockFree(WriteTxn* txn, blk_t bno) {
     block_allocator_->Free(txn, bno);
 }
@@ -587,6 +626,29 @@ zx_status_t Minfs::Create(fbl::unique_ptr<Bcache> bc, const Superblock* info,
     fbl::unique_ptr<SuperblockManager> sb;
     zx_status_t status;
 
+    // Bring the metadata up to date before reading any of it.  Sparse host
+    // images are laid out differently from the disk the journal was written
+    // for, but they are only ever written by the host tools, which do not
+    // journal.
+    uint8_t blk[kMinfsBlockSize];
+    JournalPosition journal_pos = {};
+#ifdef __Fuchsia__
+    const bool replay = info->jnl_blocks != 0;
+#else
+    const bool replay = info->jnl_blocks != 0 && bc->extent_lengths_.size() == 0;
+#endif
+    if (replay && info->version >= kMinfsJournalVersion && info->version <= kMinfsVersion) {
+        if ((status = ReplayJournal(bc.get(), *info, &journal_pos)) != ZX_OK) {
+            FS_TRACE_ERROR("Minfs::Create failed to replay journal: %d\n", status);
+            return status;
+        }
+        if ((status = bc->Readblk(0, blk)) != ZX_OK) {
+            FS_TRACE_ERROR("Minfs::Create failed to reread superblock: %d\n", status);
+            return status;
+        }
+        info = reinterpret_cast<const Superblock*>(blk);
+    }
+
     if ((status = SuperblockManager::Create(bc.get(), info, &sb)) != ZX_OK) {
         FS_TRACE_ERROR("Minfs::Create failed to initialize superblock: %d\n", status);
         return status;
@@ -654,8 +716,16 @@ zx_status_t Minfs::Create(fbl::unique_ptr<Bcache> bc, const Superblock* info,
         return status;
     }
 
+    fbl::unique_ptr<Journal> journal;
+    if (info->jnl_blocks != 0 &&
+        (status = Journal::Create(bc.get(), *info, journal_pos, &journal)) != ZX_OK) {
+        FS_TRACE_ERROR("Minfs::Create failed to initialize journal: %d\n", status);
+        return status;
+    }
+
     fbl::unique_ptr<WritebackBuffer> writeback;
-    if ((status = WritebackBuffer::Create(bc.get(), fbl::move(buffer), &writeback)) != ZX_OK) {
+    if ((status = WritebackBuffer::Create(bc.get(), fbl::move(buffer), fbl::move(journal),
+                                          &writeback)) != ZX_OK) {
         return status;
     }
 
@@ -951,6 +1021,18 @@ zx_status_t Mkfs(const MountOptions& options, fbl::unique_ptr<Bcache> bc) {
     abm.Set(0, 2);
     info.alloc_block_count += 2;
 
+    // Reserve the blocks after those for the journal
+    info.jnl_blocks = JournalBlocks(info.block_count);
+    if (info.jnl_blocks != 0) {
+        info.jnl_block = kJournalStartBlock;
+        abm.Set(info.jnl_block, info.jnl_block + info.jnl_blocks);
+        info.alloc_block_count += info.jnl_blocks;
+        if ((status = InitializeJournal(bc.get(), info)) != ZX_OK) {
+            FS_TRACE_ERROR("mkfs: Failed to write journal\n");
+            return status;
+        }
+    }
+
     // write allocation bitmap
     for (uint32_t n = 0; n < abmblks; n++) {
         void* bmdata = fs::GetBlock(kMinfsBlockSize, abm.StorageUnsafe()->GetData(), n);
@@ -1051,7 +1133,8 @@ zx_status_t SparseFsck(fbl::unique_fd fd, off_t start, off_t end,
 void Minfs::UpdateInitMetrics(uint32_t dnum_count, uint32_t inum_count, uint32_t dinum_count,
                               uint64_t user_data_size, const fs::Duration& duration) {
 #ifdef FS_WITH_METRICS
-    if (collecting_metrics_) {
+    if (collecting_metrics_.load()) {
+        fbl::AutoLock lock(&metrics_lock_);
         metrics_.initialized_vmos++;
         metrics_.init_user_data_size += user_data_size;
         metrics_.init_user_data_ticks += duration.get();
@@ -1064,7 +1147,8 @@ void Minfs::UpdateInitMetrics(uint32_t dnum_count, uint32_t inum_count, uint32_t
 
 void Minfs::UpdateLookupMetrics(bool success, const fs::Duration& duration) {
 #ifdef FS_WITH_METRICS
-    if (collecting_metrics_) {
+    if (collecting_metrics_.load()) {
+        fbl::AutoLock lock(&metrics_lock_);
         metrics_.lookup_calls++;
         metrics_.lookup_calls_success += success ? 1 : 0;
         metrics_.lookup_ticks += duration.get();
@@ -1074,7 +1158,8 @@ void Minfs::UpdateLookupMetrics(bool success, const fs::Duration& duration) {
 
 void Minfs::UpdateCreateMetrics(bool success, const fs::Duration& duration) {
 #ifdef FS_WITH_METRICS
-    if (collecting_metrics_) {
+    if (collecting_metrics_.load()) {
+        fbl::AutoLock lock(&metrics_lock_);
         metrics_.create_calls++;
         metrics_.create_calls_success += success ? 1 : 0;
         metrics_.create_ticks += duration.get();
@@ -1084,7 +1169,8 @@ void Minfs::UpdateCreateMetrics(bool success, const fs::Duration& duration) {
 
 void Minfs::UpdateReadMetrics(uint64_t size, const fs::Duration& duration) {
 #ifdef FS_WITH_METRICS
-    if (collecting_metrics_) {
+    if (collecting_metrics_.load()) {
+        fbl::AutoLock lock(&metrics_lock_);
         metrics_.read_calls++;
         metrics_.read_size += size;
         metrics_.read_ticks += duration.get();
@@ -1094,7 +1180,8 @@ void Minfs::UpdateReadMetrics(uint64_t size, const fs::Duration& duration) {
 
 void Minfs::UpdateWriteMetrics(uint64_t size, const fs::Duration& duration) {
 #ifdef FS_WITH_METRICS
-    if (collecting_metrics_) {
+    if (collecting_metrics_.load()) {
+        fbl::AutoLock lock(&metrics_lock_);
         metrics_.write_calls++;
         metrics_.write_size += size;
         metrics_.write_ticks += duration.get();
@@ -1104,7 +1191,8 @@ void Minfs::UpdateWriteMetrics(uint64_t size, const fs::Duration& duration) {
 
 void Minfs::UpdateTruncateMetrics(const fs::Duration& duration) {
 #ifdef FS_WITH_METRICS
-    if (collecting_metrics_) {
+    if (collecting_metrics_.load()) {
+        fbl::AutoLock lock(&metrics_lock_);
         metrics_.truncate_calls++;
         metrics_.truncate_ticks += duration.get();
     }
@@ -1113,7 +1201,8 @@ void Minfs::UpdateTruncateMetrics(const fs::Duration& duration) {
 
 void Minfs::UpdateUnlinkMetrics(bool success, const fs::Duration& duration) {
 #ifdef FS_WITH_METRICS
-    if (collecting_metrics_) {
+    if (collecting_metrics_.load()) {
+        fbl::AutoLock lock(&metrics_lock_);
         metrics_.unlink_calls++;
         metrics_.unlink_calls_success += success ? 1 : 0;
         metrics_.unlink_ticks += duration.get();
@@ -1123,7 +1212,8 @@ void Minfs::UpdateUnlinkMetrics(bool success, const fs::Duration& duration) {
 
 void Minfs::UpdateRenameMetrics(bool success, const fs::Duration& duration) {
 #ifdef FS_WITH_METRICS
-    if (collecting_metrics_) {
+    if (collecting_metrics_.load()) {
+        fbl::AutoLock lock(&metrics_lock_);
         metrics_.rename_calls++;
         metrics_.rename_calls_success += success ? 1 : 0;
         metrics_.rename_ticks += duration.get();
@@ -1133,7 +1223,8 @@ void Minfs::UpdateRenameMetrics(bool success, const fs::Duration& duration) {
 
 void Minfs::UpdateOpenMetrics(bool cache_hit, const fs::Duration& duration) {
 #ifdef FS_WITH_METRICS
-    if (collecting_metrics_) {
+    if (collecting_metrics_.load()) {
+        fbl::AutoLock lock(&metrics_lock_);
         metrics_.vnodes_opened++;
         metrics_.vnodes_opened_cache_hit += cache_hit ? 1 : 0;
         metrics_.vnode_open_ticks += duration.get();
@@ -43,6 +43,10 @@ constexpr zx_status_t kDirIteratorNext = 1;
 // Identify that the direntry record was modified. Stop iterating.
 constexpr zx_status_t kDirIteratorSaveSync = 2;
 
+// The most blocks of a write which extent-mapped vnodes try to place together, so that large
+// writes to a fragmented volume still find room.
+constexpr blk_t kMaxAllocationRun = 256;
+
 zx_time_t GetTimeUTC() {
     struct timespec ts;
     clock_gettime(CLOCK_REALTIME, &ts);
@@ -102,6 +106,9 @@ void VnodeMinfs::InodeSync(WritebackWork* wb, uint32_t flags) {
 // the file. Does not update mtime/atime.
 zx_status_t VnodeMinfs::BlocksShrink(Transaction* state, blk_t start) {
     ZX_DEBUG_ASSERT(state != nullptr);
+    if (UsesExtents()) {
+        return ExtentsShrink(state, start);
+    }
     BlockOpArgs op_args(start, static_cast<blk_t>(kMinfsMaxFileBlock - start), nullptr);
     zx_status_t status;
     if ((status = ApplyOperation(state, BlockOp::kDelete, &op_args)) != ZX_OK) {
@@ -178,7 +185,8 @@ zx_status_t VnodeMinfs::LoadIndirectWithinDoublyIndirect(uint32_t dindex) {
 }
 
 zx_status_t VnodeMinfs::InitIndirectVmo() {
-    if (vmo_indirect_ != nullptr) {
+    if (vmo_indirect_ != nullptr || UsesExtents()) {
+        // Extent-mapped vnodes have no indirect blocks.
         return ZX_OK;
     }
 
@@ -245,6 +253,21 @@ zx_status_t VnodeMinfs::InitVmo() {
                                ticker.End());
     });
 
+    if (UsesExtents()) {
+        // Read each extent with a single request.
+        const Extent* extents = InodeExtents(&inode_);
+        for (uint32_t e = 0; e < inode_.extent_count; e++) {
+            fs_->ValidateBno(extents[e].bno);
+            fs_->ValidateBno(extents[e].bno + extents[e].length - 1);
+            dnum_count += extents[e].length;
+            txn.Enqueue(vmoid_, extents[e].start, extents[e].bno + fs_->Info().dat_block,
+                        extents[e].length);
+        }
+        status = txn.Transact();
+        ValidateVmoTail();
+        return status;
+    }
+
     // Initialize all direct blocks
     blk_t bno;
     for (uint32_t d = 0; d < kMinfsDirect; d++) {
@@ -379,6 +402,14 @@ zx_status_t VnodeMinfs::BlockOpDirect(Transaction* state, DirectArgs* params) {
                 params->SetBno(i, bno);
                 break;
             }
+            case BlockOp::kAssign: {
+                ZX_DEBUG_ASSERT(state != nullptr);
+                ZX_DEBUG_ASSERT(bno == 0);
+                bno = params->GetAssignedBno(i);
+                fs_->ValidateBno(bno);
+                params->SetBno(i, bno);
+                break;
+            }
             default: {
                 return ZX_ERR_NOT_SUPPORTED;
             }
@@ -393,7 +424,8 @@ zx_status_t VnodeMinfs::BlockOpIndirect(Transaction* state, IndirectArgs* params
     zx_status_t status;
 
 #ifdef __Fuchsia__
-    if (params->GetOp() == BlockOp::kRead || params->GetOp() == BlockOp::kWrite) {
+    if (params->GetOp() == BlockOp::kRead || params->GetOp() == BlockOp::kWrite ||
+        params->GetOp() == BlockOp::kAssign) {
         ValidateVmoSize(vmo_indirect_->GetVmo(), params->GetOffset() + params->GetCount());
     }
 #endif
@@ -407,6 +439,7 @@ zx_status_t VnodeMinfs::BlockOpIndirect(Transaction* state, IndirectArgs* params
             case BlockOp::kRead:
                 return ZX_OK;
             case BlockOp::kWrite:
+            case BlockOp::kAssign:
                 AllocateIndirect(state, i, params);
                 break;
             default:
@@ -456,7 +489,8 @@ zx_status_t VnodeMinfs::BlockOpDindirect(Transaction* state, DindirectArgs* para
     zx_status_t status;
 
 #ifdef __Fuchsia__
-    if (params->GetOp() == BlockOp::kRead || params->GetOp() == BlockOp::kWrite) {
+    if (params->GetOp() == BlockOp::kRead || params->GetOp() == BlockOp::kWrite ||
+        params->GetOp() == BlockOp::kAssign) {
         ValidateVmoSize(vmo_indirect_->GetVmo(), params->GetOffset() + params->GetCount());
     }
 #endif
@@ -471,6 +505,7 @@ zx_status_t VnodeMinfs::BlockOpDindirect(Transaction* state, DindirectArgs* para
             case BlockOp::kRead:
                 return ZX_OK;
             case BlockOp::kWrite:
+            case BlockOp::kAssign:
                 AllocateIndirect(state, i, params);
                 break;
             default:
@@ -646,36 +681,214 @@ zx_status_t VnodeMinfs::ApplyOperation(Transaction* state, BlockOp op, BlockOpAr
     return found == op_args->count ? ZX_OK : ZX_ERR_OUT_OF_RANGE;
 }
 
-zx_status_t VnodeMinfs::BlockGet(Transaction* state, blk_t n, blk_t* bno) {
 #ifdef __Fuchsia__
-    if (n >= kMinfsDirect) {
-        zx_status_t status;
-        // If the vmo_indirect_ vmo has not been created, make it now.
-        if ((status = InitIndirectVmo()) != ZX_OK) {
-            return status;
-        }
+zx_status_t VnodeMinfs::EnsureIndirectVmo(blk_t n) {
+    if (n < kMinfsDirect) {
+        return ZX_OK;
+    }
 
-        // Number of blocks prior to dindirect blocks
-        blk_t pre_dindirect = kMinfsDirect + kMinfsDirectPerIndirect * kMinfsIndirect;
-        if (n >= pre_dindirect) {
-            // Index of last doubly indirect block
-            blk_t dibindex = (n - pre_dindirect) / kMinfsDirectPerDindirect;
-            ZX_DEBUG_ASSERT(dibindex < kMinfsDoublyIndirect);
-            uint64_t vmo_size = GetVmoSizeForIndirect(dibindex);
-            // Grow VMO if we need more space to fit doubly indirect blocks
-            if (vmo_indirect_->GetSize() < vmo_size) {
-                if ((status = vmo_indirect_->Grow(vmo_size)) != ZX_OK) {
-                    return status;
-                }
+    zx_status_t status;
+    // If the vmo_indirect_ vmo has not been created, make it now.
+    if ((status = InitIndirectVmo()) != ZX_OK) {
+        return status;
+    }
+
+    // Number of blocks prior to dindirect blocks
+    blk_t pre_dindirect = kMinfsDirect + kMinfsDirectPerIndirect * kMinfsIndirect;
+    if (n >= pre_dindirect) {
+        // Index of last doubly indirect block
+        blk_t dibindex = (n - pre_dindirect) / kMinfsDirectPerDindirect;
+        ZX_DEBUG_ASSERT(dibindex < kMinfsDoublyIndirect);
+        uint64_t vmo_size = GetVmoSizeForIndirect(dibindex);
+        // Grow VMO if we need more space to fit doubly indirect blocks
+        if (vmo_indirect_->GetSize() < vmo_size) {
+            if ((status = vmo_indirect_->Grow(vmo_size)) != ZX_OK) {
+                return status;
             }
         }
     }
+    return ZX_OK;
+}
+#endif
+
+zx_status_t VnodeMinfs::BlockGet(Transaction* state, blk_t n, blk_t* bno, blk_t run) {
+    if (UsesExtents()) {
+        return ExtentBlockGet(state, n, run, bno);
+    }
+
+#ifdef __Fuchsia__
+    zx_status_t status;
+    if ((status = EnsureIndirectVmo(n)) != ZX_OK) {
+        return status;
+    }
 #endif
 
     BlockOpArgs op_args(n, 1, bno);
     return ApplyOperation(state, state ? BlockOp::kWrite : BlockOp::kRead, &op_args);
 }
 
+zx_status_t VnodeMinfs::ExtentBlockGet(Transaction* state, blk_t n, blk_t run, blk_t* bno) {
+    Extent* extents = InodeExtents(&inode_);
+    const uint32_t count = inode_.extent_count;
+
+    // Find the first extent which starts after |n|; the one before it may hold |n|.
+    uint32_t next = 0;
+    while (next < count && extents[next].start <= n) {
+        next++;
+    }
+    Extent* prev = (next > 0) ? &extents[next - 1] : nullptr;
+    if (prev != nullptr && n - prev->start < prev->length) {
+        *bno = prev->bno + (n - prev->start);
+        return ZX_OK;
+    } else if (state == nullptr) {
+        *bno = 0;
+        return ZX_OK;
+    }
+
+    // Ask for the block which would let an extent grow to cover |n|, or else for room to keep
+    // the rest of the caller's blocks together.
+    blk_t goal = 0;
+    if (prev != nullptr) {
+        goal = prev->bno + (n - prev->start);
+    } else if (next < count && extents[next].start == n + 1) {
+        goal = extents[next].bno - 1;
+    }
+    fs_->BlockNewNear(state, goal, fbl::min(run, kMaxAllocationRun), bno);
+    fs_->ValidateBno(*bno);
+    inode_.block_count++;
+
+    const bool joins_prev = prev != nullptr && prev->start + prev->length == n &&
+                            prev->bno + prev->length == *bno;
+    const bool joins_next = next < count && extents[next].start == n + 1 &&
+                            extents[next].bno == *bno + 1;
+    if (joins_prev && joins_next) {
+        prev->length += 1 + extents[next].length;
+        memmove(&extents[next], &extents[next + 1], (count - next - 1) * sizeof(Extent));
+        memset(&extents[count - 1], 0, sizeof(Extent));
+        inode_.extent_count--;
+    } else if (joins_prev) {
+        prev->length++;
+    } else if (joins_next) {
+        extents[next].start--;
+        extents[next].bno--;
+        extents[next].length++;
+    } else if (count < kMinfsInlineExtents) {
+        memmove(&extents[next + 1], &extents[next], (count - next) * sizeof(Extent));
+        extents[next].start = n;
+        extents[next].bno = *bno;
+        extents[next].length = 1;
+        inode_.extent_count++;
+    } else {
+        // Out of extents: move every block of the file into block tables, if the caller could
+        // reserve enough blocks for them.
+        const Extent& last = extents[count - 1];
+        blk_t end = fbl::max(n + 1, last.start + last.length);
+        blk_t table_blocks;
+        zx_status_t status = GetRequiredBlockCount(0, static_cast<size_t>(end) * kMinfsBlockSize,
+                                                   &table_blocks);
+        if (status == ZX_OK && state->BlocksReserved() < table_blocks - end) {
+            status = ZX_ERR_NO_SPACE;
+        }
+        if (status != ZX_OK) {
+            fs_->BlockFree(state->GetWork(), *bno);
+            inode_.block_count--;
+            *bno = 0;
+            return status;
+        }
+        if ((status = ConvertExtentsToBlockMap(state)) != ZX_OK) {
+            return status;
+        }
+        return AssignBlocks(state, n, 1, *bno);
+    }
+
+    InodeSync(state->GetWork(), kMxFsSyncDefault);
+    return ZX_OK;
+}
+
+zx_status_t VnodeMinfs::ExtentsShrink(Transaction* state, blk_t start) {
+    Extent* extents = InodeExtents(&inode_);
+    bool dirty = false;
+    while (inode_.extent_count > 0) {
+        Extent* extent = &extents[inode_.extent_count - 1];
+        if (extent->start + extent->length <= start) {
+            break;
+        }
+
+        // Keep the part of the extent before |start|, if any.
+        blk_t keep = (extent->start < start) ? start - extent->start : 0;
+        for (blk_t i = keep; i < extent->length; i++) {
+            fs_->ValidateBno(extent->bno + i);
+            fs_->BlockFree(state->GetWork(), extent->bno + i);
+        }
+        inode_.block_count -= extent->length - keep;
+        dirty = true;
+
+        if (keep > 0) {
+            extent->length = keep;
+            break;
+        }
+        memset(extent, 0, sizeof(Extent));
+        inode_.extent_count--;
+    }
+
+    if (dirty) {
+        InodeSync(state->GetWork(), kMxFsSyncDefault);
+    }
+    return ZX_OK;
+}
+
+zx_status_t VnodeMinfs::ConvertExtentsToBlockMap(Transaction* state) {
+    Extent extents[kMinfsInlineExtents];
+    const uint32_t count = inode_.extent_count;
+    memcpy(extents, InodeExtents(&inode_), count * sizeof(Extent));
+
+    inode_.flags &= ~kMinfsInodeFlagExtents;
+    inode_.extent_count = 0;
+    memset(inode_.dnum, 0, sizeof(inode_.dnum));
+    memset(inode_.inum, 0, sizeof(inode_.inum));
+    memset(inode_.dinum, 0, sizeof(inode_.dinum));
+
+    for (uint32_t i = 0; i < count; i++) {
+        zx_status_t status;
+        if ((status = AssignBlocks(state, extents[i].start, extents[i].length,
+                                   extents[i].bno)) != ZX_OK) {
+            return status;
+        }
+    }
+
+    InodeSync(state->GetWork(), kMxFsSyncDefault);
+    return ZX_OK;
+}
+
+zx_status_t VnodeMinfs::AssignBlocks(Transaction* state, blk_t n, blk_t count, blk_t bno) {
+    zx_status_t status;
+#ifdef __Fuchsia__
+    if ((status = EnsureIndirectVmo(n + count - 1)) != ZX_OK) {
+        return status;
+    }
+#endif
+
+    blk_t bnos[kMinfsDirectPerIndirect];
+    while (count > 0) {
+        // Stop at the end of each indirect block, so that each operation fits in |bnos|.
+        blk_t chunk = (n < kMinfsDirect) ? kMinfsDirect - n :
+                kMinfsDirectPerIndirect - (n - kMinfsDirect) % kMinfsDirectPerIndirect;
+        chunk = fbl::min(chunk, count);
+
+        BlockOpArgs op_args(n, chunk, bnos);
+        for (blk_t i = 0; i < chunk; i++) {
+            bnos[i] = bno + i;
+        }
+        if ((status = ApplyOperation(state, BlockOp::kAssign, &op_args)) != ZX_OK) {
+            return status;
+        }
+        n += chunk;
+        count -= chunk;
+        bno += chunk;
+    }
+    return ZX_OK;
+}
+
 zx_status_t VnodeMinfs::ReadExactInternal(void* data, size_t len, size_t off) {
     size_t actual;
     zx_status_t status = ReadInternal(data, len, off, &actual);
@@ -741,6 +954,7 @@ zx_status_t VnodeMinfs::UnlinkChild(Transaction* state,
     // Read the direntries we're considering merging with.
     // Verify they are free and small enough to merge.
     size_t coalesced_size = MinfsReclen(de, off);
+    bool merged_next = false;
     // Coalesce with "next" first, so the kMinfsReclenLast bit can easily flow
     // back to "de" and "de_prev".
     if (!(de->reclen & kMinfsReclenLast)) {
@@ -753,6 +967,7 @@ zx_status_t VnodeMinfs::UnlinkChild(Transaction* state,
             return status;
         }
         if (de_next.ino == 0) {
+            merged_next = true;
             coalesced_size += MinfsReclen(&de_next, off_next);
             // If the next entry *was* last, then 'de' is now last.
             de->reclen |= (de_next.reclen & kMinfsReclenLast);
@@ -778,13 +993,23 @@ zx_status_t VnodeMinfs::UnlinkChild(Transaction* state,
         FS_TRACE_ERROR("unlink: Corrupted direntry with impossibly large size\n");
         return ZX_ERR_IO;
     }
+    UnindexDirent(de, offs->off);
     de->ino = 0;
     de->reclen = static_cast<uint32_t>(coalesced_size & kMinfsReclenMask) |
         (de->reclen & kMinfsReclenLast);
     // Erase dirent (replace with 'empty' dirent)
     if ((status = WriteExactInternal(state, de, MINFS_DIRENT_SIZE, off)) != ZX_OK) {
+        // The index no longer describes the directory; it is rebuilt when next needed.
+        dir_index_.reset();
         return status;
     }
+    if (merged_next) {
+        UnindexDirent(&de_next, off_next);
+    }
+    if (off != offs->off) {
+        UnindexDirent(&de_prev, off);
+    }
+    IndexDirent(de, off);
 
     if (de->reclen & kMinfsReclenLast) {
         // Truncating the directory merely removed unused space; if it fails,
@@ -805,6 +1030,9 @@ zx_status_t VnodeMinfs::UnlinkChild(Transaction* state,
 }
 
 void VnodeMinfs::RemoveInodeLink(WritebackWork* wb) {
+#ifdef __Fuchsia__
+    fbl::AutoLock lock(&lock_);
+#endif
     // This effectively 'unlinks' the target node without deleting the direntry
     inode_.link_count--;
     if (MinfsMagicType(inode_.magic) == kMinfsTypeDir) {
@@ -986,20 +1214,28 @@ zx_status_t VnodeMinfs::AppendDirent(DirArgs* args) {
                                          args->offs.off)) != ZX_OK) {
             return status;
         }
+        // The shrunk dirent keeps its name, but no longer has room to spare.
+        UnindexDirent(de, args->offs.off);
+        IndexDirent(de, args->offs.off);
 
         args->offs.off += size;
         // Overwrite dirent data to reflect the new dirent.
         de->reclen = extra | (was_last_record ? kMinfsReclenLast : 0);
     }
 
+    if (de->ino == 0) {
+        UnindexDirent(de, args->offs.off);
+    }
     de->ino = args->ino;
     de->type = static_cast<uint8_t>(args->type);
     de->namelen = static_cast<uint8_t>(args->name.length());
     memcpy(de->name, args->name.data(), de->namelen);
     if ((status = WriteExactInternal(args->state, de, DirentSize(de->namelen),
                                      args->offs.off)) != ZX_OK) {
+        dir_index_.reset();
         return status;
     }
+    IndexDirent(de, args->offs.off);
 
     if (args->type == kMinfsTypeDir) {
         // Child directory has '..' which will point to parent directory
@@ -1026,30 +1262,35 @@ zx_status_t VnodeMinfs::AppendDirent(DirArgs* args) {
 //          Since 'func' may create / remove surrounding dirents, it is responsible for
 //          updating the offset information to access the next dirent.
 zx_status_t VnodeMinfs::ForEachDirent(DirArgs* args, const DirentCallback func) {
-    char data[kMinfsMaxDirentSize];
-    Dirent* de = (Dirent*) data;
     args->offs.off = 0;
     args->offs.off_prev = 0;
     while (args->offs.off + MINFS_DIRENT_SIZE < kMinfsMaxDirectorySize) {
-        xprintf("Reading dirent at offset %zd\n", args->offs.off);
-        size_t r;
-        zx_status_t status = ReadInternal(data, kMinfsMaxDirentSize, args->offs.off, &r);
-        if (status != ZX_OK) {
-            return status;
-        } else if ((status = ValidateDirent(de, r, args->offs.off)) != ZX_OK) {
+        zx_status_t status = VisitDirent(args, func);
+        if (status != kDirIteratorNext) {
             return status;
         }
+    }
 
-        switch ((status = func(fbl::RefPtr<VnodeMinfs>(this), de, args))) {
-        case kDirIteratorNext:
-            break;
-        case kDirIteratorSaveSync:
-            inode_.seq_num++;
-            InodeSync(args->state->GetWork(), kMxFsSyncMtime);
-            args->state->GetWork()->PinVnode(fbl::move(fbl::WrapRefPtr(this)));
-            return ZX_OK;
-        case kDirIteratorDone:
-        default:
+    return ZX_ERR_NOT_FOUND;
+}
+
+zx_status_t VnodeMinfs::ForEachDirentNamed(DirArgs* args, const DirentCallback func) {
+    DirectoryIndex* index = GetDirectoryIndex();
+    if (index == nullptr) {
+        return ForEachDirent(args, func);
+    }
+
+    size_t cursor = 0;
+    size_t off;
+    while (index->NextNamed(args->name, &cursor, &off)) {
+        // The only previous dirent which matters is an empty one, which
+        // UnlinkChild coalesces with the dirent being removed.
+        args->offs.off = off;
+        if (!index->EmptyBefore(off, &args->offs.off_prev)) {
+            args->offs.off_prev = off;
+        }
+        zx_status_t status = VisitDirent(args, func);
+        if (status != kDirIteratorNext) {
             return status;
         }
     }
@@ -1057,6 +1298,93 @@ zx_status_t VnodeMinfs::ForEachDirent(DirArgs* args, const DirentCallback func)
     return ZX_ERR_NOT_FOUND;
 }
 
+zx_status_t VnodeMinfs::ForEachDirentWithSpace(DirArgs* args, const DirentCallback func) {
+    DirectoryIndex* index = GetDirectoryIndex();
+    if (index == nullptr) {
+        return ForEachDirent(args, func);
+    }
+
+    size_t off;
+    if (!index->FindSpace(args->reclen, &off)) {
+        return ZX_ERR_NOT_FOUND;
+    }
+    args->offs.off = off;
+    args->offs.off_prev = off;
+    zx_status_t status = VisitDirent(args, func);
+    if (status == kDirIteratorNext) {
+        // The index disagrees with the dirents; fall back to reading all of them.
+        FS_TRACE_ERROR("minfs: Stale directory index at offset %zu\n", off);
+        dir_index_.reset();
+        return ForEachDirent(args, func);
+    }
+    return status;
+}
+
+zx_status_t VnodeMinfs::VisitDirent(DirArgs* args, const DirentCallback func) {
+    char data[kMinfsMaxDirentSize];
+    Dirent* de = (Dirent*) data;
+    xprintf("Reading dirent at offset %zd\n", args->offs.off);
+    size_t r;
+    zx_status_t status = ReadInternal(data, kMinfsMaxDirentSize, args->offs.off, &r);
+    if (status != ZX_OK) {
+        return status;
+    } else if ((status = ValidateDirent(de, r, args->offs.off)) != ZX_OK) {
+        return status;
+    }
+
+    switch ((status = func(fbl::RefPtr<VnodeMinfs>(this), de, args))) {
+    case kDirIteratorNext:
+        return kDirIteratorNext;
+    case kDirIteratorSaveSync:
+        inode_.seq_num++;
+        InodeSync(args->state->GetWork(), kMxFsSyncMtime);
+        args->state->GetWork()->PinVnode(fbl::move(fbl::WrapRefPtr(this)));
+        return ZX_OK;
+    case kDirIteratorDone:
+    default:
+        return status;
+    }
+}
+
+zx_status_t VnodeMinfs::DirentCallbackIndex(fbl::RefPtr<VnodeMinfs> vndir, Dirent* de,
+                                            DirArgs* args) {
+    zx_status_t status = vndir->dir_index_->Insert(de, args->offs.off);
+    if (status != ZX_OK) {
+        return status;
+    }
+    return NextDirent(de, &args->offs);
+}
+
+DirectoryIndex* VnodeMinfs::GetDirectoryIndex() {
+    if (dir_index_ != nullptr || inode_.size < kMinfsDirectoryIndexMinSize) {
+        return dir_index_.get();
+    }
+
+    fbl::AllocChecker ac;
+    dir_index_.reset(new (&ac) DirectoryIndex());
+    if (!ac.check()) {
+        return nullptr;
+    }
+    DirArgs args = DirArgs();
+    if (ForEachDirent(&args, DirentCallbackIndex) != ZX_ERR_NOT_FOUND) {
+        // Without a complete index, searches read every dirent instead.
+        dir_index_.reset();
+    }
+    return dir_index_.get();
+}
+
+void VnodeMinfs::IndexDirent(const Dirent* de, size_t off) {
+    if (dir_index_ != nullptr && dir_index_->Insert(de, off) != ZX_OK) {
+        dir_index_.reset();
+    }
+}
+
+void VnodeMinfs::UnindexDirent(const Dirent* de, size_t off) {
+    if (dir_index_ != nullptr) {
+        dir_index_->Erase(de, off);
+    }
+}
+
 void VnodeMinfs::fbl_recycle() {
     ZX_DEBUG_ASSERT(fd_count_ == 0);
     if (!IsUnlinked()) {
@@ -1154,6 +1482,9 @@ zx_status_t VnodeMinfs::Serve(fs::Vfs* vfs, zx::channel channel, uint32_t flags)
 #endif
 
 zx_status_t VnodeMinfs::Open(uint32_t flags, fbl::RefPtr<Vnode>* out_redirect) {
+#ifdef __Fuchsia__
+    fbl::AutoLock lock(&lock_);
+#endif
     fd_count_++;
     return ZX_OK;
 }
@@ -1175,6 +1506,20 @@ void VnodeMinfs::Purge(WritebackWork* wb) {
 }
 
 zx_status_t VnodeMinfs::Close() {
+#ifdef __Fuchsia__
+    {
+        // Purging needs |txn_lock_|, which must be acquired before |lock_|;
+        // only the last close of an unlinked vnode pays for it.
+        fbl::AutoLock lock(&lock_);
+        ZX_DEBUG_ASSERT_MSG(fd_count_ > 0, "Closing ino with no fds open");
+        if (fd_count_ > 1 || !IsUnlinked()) {
+            fd_count_--;
+            return ZX_OK;
+        }
+    }
+    fbl::AutoLock txn_lock(&fs_->txn_lock_);
+    fbl::AutoLock lock(&lock_);
+#endif
     ZX_DEBUG_ASSERT_MSG(fd_count_ > 0, "Closing ino with no fds open");
     fd_count_--;
 
@@ -1189,6 +1534,9 @@ zx_status_t VnodeMinfs::Close() {
 
 zx_status_t VnodeMinfs::Read(void* data, size_t len, size_t off, size_t* out_actual) {
     TRACE_DURATION("minfs", "VnodeMinfs::Read", "ino", ino_, "len", len, "off", off);
+#ifdef __Fuchsia__
+    fbl::AutoLock lock(&lock_);
+#endif
     ZX_DEBUG_ASSERT_MSG(fd_count_ > 0, "Reading from ino with no fds open");
     xprintf("minfs_read() vn=%p(#%u) len=%zd off=%zd\n", this, ino_, len, off);
     if (IsDirectory()) {
@@ -1266,8 +1614,58 @@ zx_status_t VnodeMinfs::ReadInternal(void* data, size_t len, size_t off, size_t*
     return ZX_OK;
 }
 
+zx_status_t VnodeMinfs::GetRequiredWriteBlockCount(size_t offset, size_t length,
+                                                   blk_t* num_req_blocks,
+                                                   blk_t* num_min_blocks) const {
+    zx_status_t status;
+    if ((status = GetRequiredBlockCount(offset, length, num_req_blocks)) != ZX_OK ||
+        !UsesExtents() || length == 0) {
+        *num_min_blocks = *num_req_blocks;
+        return status;
+    }
+
+    // Each block written may need an extent of its own.
+    blk_t data_blocks = static_cast<blk_t>((offset + length - 1) / kMinfsBlockSize -
+                                           offset / kMinfsBlockSize + 1);
+    *num_min_blocks = data_blocks;
+    if (inode_.extent_count + data_blocks <= kMinfsInlineExtents) {
+        *num_req_blocks = data_blocks;
+        return ZX_OK;
+    }
+
+    // Otherwise the write may move every block of the file into block tables.
+    size_t end = fbl::max(offset + length, static_cast<size_t>(inode_.size));
+    blk_t table_blocks;
+    if ((status = GetRequiredBlockCount(0, end, &table_blocks)) != ZX_OK) {
+        return status;
+    }
+    table_blocks -= static_cast<blk_t>(fbl::round_up(end, kMinfsBlockSize) / kMinfsBlockSize);
+    *num_req_blocks = data_blocks + table_blocks;
+    return ZX_OK;
+}
+
 zx_status_t VnodeMinfs::Write(const void* data, size_t len, size_t offset,
                               size_t* out_actual) {
+#ifdef __Fuchsia__
+    fbl::AutoLock txn_lock(&fs_->txn_lock_);
+    fbl::AutoLock lock(&lock_);
+#endif
+    return WriteLocked(data, len, offset, out_actual);
+}
+
+zx_status_t VnodeMinfs::Append(const void* data, size_t len, size_t* out_end,
+                               size_t* out_actual) {
+#ifdef __Fuchsia__
+    fbl::AutoLock txn_lock(&fs_->txn_lock_);
+    fbl::AutoLock lock(&lock_);
+#endif
+    zx_status_t status = WriteLocked(data, len, inode_.size, out_actual);
+    *out_end = inode_.size;
+    return status;
+}
+
+zx_status_t VnodeMinfs::WriteLocked(const void* data, size_t len, size_t offset,
+                                    size_t* out_actual) {
     TRACE_DURATION("minfs", "VnodeMinfs::Write", "ino", ino_, "len", len, "off", offset);
     ZX_DEBUG_ASSERT_MSG(fd_count_ > 0, "Writing to ino with no fds open");
     xprintf("minfs_write() vn=%p(#%u) len=%zd off=%zd\n", this, ino_, len, offset);
@@ -1282,13 +1680,19 @@ zx_status_t VnodeMinfs::Write(const void* data, size_t len, size_t offset,
     });
 
     blk_t reserve_blocks;
+    blk_t min_blocks;
     // Calculate maximum number of blocks to reserve for this write operation.
-    zx_status_t status = GetRequiredBlockCount(offset, len, &reserve_blocks);
+    zx_status_t status = GetRequiredWriteBlockCount(offset, len, &reserve_blocks, &min_blocks);
     if (status != ZX_OK) {
         return status;
     }
     fbl::unique_ptr<Transaction> state;
-    if ((status = fs_->BeginTransaction(0, reserve_blocks, &state)) != ZX_OK) {
+    if ((status = fs_->BeginTransaction(0, reserve_blocks, &state)) == ZX_ERR_NO_SPACE &&
+        min_blocks < reserve_blocks) {
+        // Near a full volume, write as much as fits in the extents of the inode.
+        status = fs_->BeginTransaction(0, min_blocks, &state);
+    }
+    if (status != ZX_OK) {
         return status;
     }
 
@@ -1304,13 +1708,6 @@ zx_status_t VnodeMinfs::Write(const void* data, size_t len, size_t offset,
     return ZX_OK;
 }
 
-zx_status_t VnodeMinfs::Append(const void* data, size_t len, size_t* out_end,
-                               size_t* out_actual) {
-    zx_status_t status = Write(data, len, inode_.size, out_actual);
-    *out_end = inode_.size;
-    return status;
-}
-
 // Internal write. Usable on directories.
 zx_status_t VnodeMinfs::WriteInternal(Transaction* state, const void* data,
                                       size_t len, size_t off, size_t* actual) {
@@ -1338,6 +1735,8 @@ zx_status_t VnodeMinfs::WriteInternal(Transaction* state, const void* data,
         } else {
             xfer = len;
         }
+        // Blocks left to write, including this one.
+        blk_t run = static_cast<blk_t>((adjust + len + kMinfsBlockSize - 1) / kMinfsBlockSize);
 
 #ifdef __Fuchsia__
         size_t xfer_off = n * kMinfsBlockSize + adjust;
@@ -1357,14 +1756,14 @@ zx_status_t VnodeMinfs::WriteInternal(Transaction* state, const void* data,
 
         // Update this block on-disk
         blk_t bno;
-        if ((status = BlockGet(state, n, &bno))) {
+        if ((status = BlockGet(state, n, &bno, run))) {
             goto done;
         }
         ZX_DEBUG_ASSERT(bno != 0);
-        state->GetWork()->Enqueue(vmo_.get(), n, bno + fs_->Info().dat_block, 1);
+        state->GetWork()->Enqueue(vmo_.get(), n, bno + fs_->Info().dat_block, 1, IsDirectory());
 #else
         blk_t bno;
-        if ((status = BlockGet(state, n, &bno))) {
+        if ((status = BlockGet(state, n, &bno, run))) {
             goto done;
         }
         ZX_DEBUG_ASSERT(bno != 0);
@@ -1411,6 +1810,9 @@ done:
 zx_status_t VnodeMinfs::Lookup(fbl::RefPtr<fs::Vnode>* out, fbl::StringPiece name) {
     TRACE_DURATION("minfs", "VnodeMinfs::Lookup", "name", name);
     ZX_DEBUG_ASSERT(fs::vfs_valid_name(name));
+#ifdef __Fuchsia__
+    fbl::AutoLock lock(&lock_);
+#endif
 
     if (!IsDirectory()) {
         FS_TRACE_ERROR("not directory\n");
@@ -1429,7 +1831,7 @@ zx_status_t VnodeMinfs::LookupInternal(fbl::RefPtr<fs::Vnode>* out, fbl::StringP
     auto get_metrics = fbl::MakeAutoCall([&ticker, &success, this]() {
         fs_->UpdateLookupMetrics(success, ticker.End());
     });
-    if ((status = ForEachDirent(&args, DirentCallbackFind)) < 0) {
+    if ((status = ForEachDirentNamed(&args, DirentCallbackFind)) < 0) {
         return status;
     }
     fbl::RefPtr<VnodeMinfs> vn;
@@ -1443,6 +1845,9 @@ zx_status_t VnodeMinfs::LookupInternal(fbl::RefPtr<fs::Vnode>* out, fbl::StringP
 
 zx_status_t VnodeMinfs::Getattr(vnattr_t* a) {
     xprintf("minfs_getattr() vn=%p(#%u)\n", this, ino_);
+#ifdef __Fuchsia__
+    fbl::AutoLock lock(&lock_);
+#endif
     a->mode = DTYPE_TO_VTYPE(MinfsMagicType(inode_.magic)) |
             V_IRUSR | V_IWUSR | V_IRGRP | V_IROTH;
     a->inode = ino_;
@@ -1458,6 +1863,10 @@ zx_status_t VnodeMinfs::Getattr(vnattr_t* a) {
 zx_status_t VnodeMinfs::Setattr(const vnattr_t* a) {
     int dirty = 0;
     xprintf("minfs_setattr() vn=%p(#%u)\n", this, ino_);
+#ifdef __Fuchsia__
+    fbl::AutoLock txn_lock(&fs_->txn_lock_);
+    fbl::AutoLock lock(&lock_);
+#endif
     if ((a->valid & ~(ATTR_CTIME|ATTR_MTIME)) != 0) {
         return ZX_ERR_NOT_SUPPORTED;
     }
@@ -1493,6 +1902,9 @@ zx_status_t VnodeMinfs::Readdir(fs::vdircookie_t* cookie, void* dirents, size_t
                                 size_t* out_actual) {
     TRACE_DURATION("minfs", "VnodeMinfs::Readdir");
     xprintf("minfs_readdir() vn=%p(#%u) cookie=%p len=%zd\n", this, ino_, cookie, len);
+#ifdef __Fuchsia__
+    fbl::AutoLock lock(&lock_);
+#endif
     DirCookie* dc = reinterpret_cast<DirCookie*>(cookie);
     fs::DirentFiller df(dirents, len);
 
@@ -1584,6 +1996,9 @@ void VnodeMinfs::Allocate(Minfs* fs, uint32_t type, fbl::RefPtr<VnodeMinfs>* out
     (*out)->inode_.magic = MinfsMagic(type);
     (*out)->inode_.create_time = (*out)->inode_.modify_time = GetTimeUTC();
     (*out)->inode_.link_count = (type == kMinfsTypeDir ? 2 : 1);
+    if (type == kMinfsTypeFile && fs->Info().version >= kMinfsExtentVersion) {
+        (*out)->inode_.flags = kMinfsInodeFlagExtents;
+    }
 }
 
 zx_status_t VnodeMinfs::Recreate(Minfs* fs, ino_t ino, fbl::RefPtr<VnodeMinfs>* out) {
@@ -1606,6 +2021,10 @@ zx_status_t VnodeMinfs::Create(fbl::RefPtr<fs::Vnode>* out, fbl::StringPiece nam
     auto get_metrics = fbl::MakeAutoCall([&ticker, &success, this]() {
         fs_->UpdateCreateMetrics(success, ticker.End());
     });
+#ifdef __Fuchsia__
+    fbl::AutoLock txn_lock(&fs_->txn_lock_);
+    fbl::AutoLock lock(&lock_);
+#endif
 
     if (!IsDirectory()) {
         return ZX_ERR_NOT_SUPPORTED;
@@ -1618,7 +2037,7 @@ zx_status_t VnodeMinfs::Create(fbl::RefPtr<fs::Vnode>* out, fbl::StringPiece nam
     args.name = name;
     // ensure file does not exist
     zx_status_t status;
-    if ((status = ForEachDirent(&args, DirentCallbackFind)) != ZX_ERR_NOT_FOUND) {
+    if ((status = ForEachDirentNamed(&args, DirentCallbackFind)) != ZX_ERR_NOT_FOUND) {
         return ZX_ERR_ALREADY_EXISTS;
     }
 
@@ -1629,7 +2048,7 @@ zx_status_t VnodeMinfs::Create(fbl::RefPtr<fs::Vnode>* out, fbl::StringPiece nam
     // before updating any other metadata.
     args.type = type;
     args.reclen = static_cast<uint32_t>(DirentSize(static_cast<uint8_t>(name.length())));
-    status = ForEachDirent(&args, DirentCallbackFindSpace);
+    status = ForEachDirentWithSpace(&args, DirentCallbackFindSpace);
     if (status == ZX_ERR_NOT_FOUND) {
         return ZX_ERR_NO_SPACE;
     } else if (status != ZX_OK) {
@@ -1700,10 +2119,15 @@ zx_status_t VnodeMinfs::QueryFilesystem(fuchsia_io_FilesystemInfo* info) {
     info->max_filename_size = kMinfsMaxNameSize;
     info->fs_type = VFS_TYPE_MINFS;
     info->fs_id = fs_->GetFsId();
-    info->total_bytes = fs_->Info().block_count * fs_->Info().block_size;
-    info->used_bytes = fs_->Info().alloc_block_count * fs_->Info().block_size;
-    info->total_nodes = fs_->Info().inode_count;
-    info->used_nodes = fs_->Info().alloc_inode_count;
+    {
+        // Connections may be served on several threads, and the counts are
+        // updated by transactions running on the others.
+        fbl::AutoLock txn_lock(&fs_->txn_lock_);
+        info->total_bytes = fs_->Info().block_count * fs_->Info().block_size;
+        info->used_bytes = fs_->Info().alloc_block_count * fs_->Info().block_size;
+        info->total_nodes = fs_->Info().inode_count;
+        info->used_nodes = fs_->Info().alloc_inode_count;
+    }
 
     fvm_info_t fvm_info;
     if (fs_->FVMQuery(&fvm_info) == ZX_OK) {
@@ -1740,6 +2164,10 @@ zx_status_t VnodeMinfs::Unlink(fbl::StringPiece name, bool must_be_dir) {
     auto get_metrics = fbl::MakeAutoCall([&ticker, &success, this]() {
         fs_->UpdateUnlinkMetrics(success, ticker.End());
     });
+#ifdef __Fuchsia__
+    fbl::AutoLock txn_lock(&fs_->txn_lock_);
+    fbl::AutoLock lock(&lock_);
+#endif
 
     if (!IsDirectory()) {
         return ZX_ERR_NOT_SUPPORTED;
@@ -1751,7 +2179,7 @@ zx_status_t VnodeMinfs::Unlink(fbl::StringPiece name, bool must_be_dir) {
     args.name = name;
     args.type = must_be_dir ? kMinfsTypeDir : 0;
     args.state = state.get();
-    status = ForEachDirent(&args, DirentCallbackUnlink);
+    status = ForEachDirentNamed(&args, DirentCallbackUnlink);
     if (status == ZX_OK) {
         state->GetWork()->PinVnode(fbl::move(fbl::WrapRefPtr(this)));
         fs_->CommitTransaction(fbl::move(state));
@@ -1770,6 +2198,10 @@ zx_status_t VnodeMinfs::Truncate(size_t len) {
     auto get_metrics = fbl::MakeAutoCall([&ticker, this] {
         fs_->UpdateTruncateMetrics(ticker.End());
     });
+#ifdef __Fuchsia__
+    fbl::AutoLock txn_lock(&fs_->txn_lock_);
+    fbl::AutoLock lock(&lock_);
+#endif
 
     fbl::unique_ptr<Transaction> state;
     // Since we will only edit existing blocks, no new blocks are required.
@@ -1843,7 +2275,8 @@ zx_status_t VnodeMinfs::TruncateInternal(Transaction* state, size_t len) {
                     FS_TRACE_ERROR("minfs: Truncate failed to write last block: %d\n", r);
                     return ZX_ERR_IO;
                 }
-                state->GetWork()->Enqueue(vmo_.get(), rel_bno, bno + fs_->Info().dat_block, 1);
+                state->GetWork()->Enqueue(vmo_.get(), rel_bno, bno + fs_->Info().dat_block, 1,
+                                          IsDirectory());
 #else
                 if (fs_->bc_->Readblk(bno + fs_->Info().dat_block, bdata)) {
                     return ZX_ERR_IO;
@@ -1908,6 +2341,20 @@ zx_status_t VnodeMinfs::Rename(fbl::RefPtr<fs::Vnode> _newdir, fbl::StringPiece
     auto newdir = fbl::RefPtr<VnodeMinfs>::Downcast(_newdir);
     ZX_DEBUG_ASSERT(fs::vfs_valid_name(oldname));
     ZX_DEBUG_ASSERT(fs::vfs_valid_name(newname));
+#ifdef __Fuchsia__
+    fbl::AutoLock txn_lock(&fs_->txn_lock_);
+    fbl::AutoLock lock(&lock_);
+    // |newdir| is also locked, unless it is this directory.
+    bool lock_newdir = newdir.get() != this;
+    if (lock_newdir) {
+        newdir->lock_.Acquire();
+    }
+    auto unlock_newdir = fbl::MakeAutoCall([&newdir, lock_newdir]() {
+        if (lock_newdir) {
+            newdir->lock_.Release();
+        }
+    });
+#endif
 
     // ensure that the vnodes containing oldname and newname are directories
     if (!(IsDirectory() && newdir->IsDirectory())) {
@@ -1919,7 +2366,7 @@ zx_status_t VnodeMinfs::Rename(fbl::RefPtr<fs::Vnode> _newdir, fbl::StringPiece
     // acquire the 'oldname' node (it must exist)
     DirArgs args = DirArgs();
     args.name = oldname;
-    if ((status = ForEachDirent(&args, DirentCallbackFind)) < 0) {
+    if ((status = ForEachDirentNamed(&args, DirentCallbackFind)) < 0) {
         return status;
     } else if ((status = fs_->VnodeGet(&oldvn, args.ino)) < 0) {
         return status;
@@ -1942,7 +2389,7 @@ zx_status_t VnodeMinfs::Rename(fbl::RefPtr<fs::Vnode> _newdir, fbl::StringPiece
     args.type = oldvn->IsDirectory() ? kMinfsTypeDir : kMinfsTypeFile;
     args.reclen = static_cast<uint32_t>(DirentSize(static_cast<uint8_t>(newname.length())));
 
-    status = newdir->ForEachDirent(&args, DirentCallbackFindSpace);
+    status = newdir->ForEachDirentWithSpace(&args, DirentCallbackFindSpace);
     if (status == ZX_ERR_NOT_FOUND) {
         return ZX_ERR_NO_SPACE;
     } else if (status != ZX_OK) {
@@ -1968,7 +2415,7 @@ zx_status_t VnodeMinfs::Rename(fbl::RefPtr<fs::Vnode> _newdir, fbl::StringPiece
     args.state = state.get();
     args.name = newname;
     args.ino = oldvn->ino_;
-    status = newdir->ForEachDirent(&args, DirentCallbackAttemptRename);
+    status = newdir->ForEachDirentNamed(&args, DirentCallbackAttemptRename);
     if (status == ZX_ERR_NOT_FOUND) {
         // if 'newname' does not exist, create it
         args.offs = append_offs;
@@ -1981,26 +2428,26 @@ zx_status_t VnodeMinfs::Rename(fbl::RefPtr<fs::Vnode> _newdir, fbl::StringPiece
 
     // update the oldvn's entry for '..' if (1) it was a directory, and (2) it
     // moved to a new directory
-    if ((args.type == kMinfsTypeDir) && (ino_ != newdir->ino_)) {
-        fbl::RefPtr<fs::Vnode> vn_fs;
-        if ((status = newdir->Lookup(&vn_fs, newname)) < 0) {
-            return status;
-        }
-        auto vn = fbl::RefPtr<VnodeMinfs>::Downcast(vn_fs);
-        args.name = "..";
-        args.ino = newdir->ino_;
-        if ((status = vn->ForEachDirent(&args, DirentCallbackUpdateInode)) < 0) {
-            return status;
+    {
+#ifdef __Fuchsia__
+        fbl::AutoLock oldvn_lock(&oldvn->lock_);
+#endif
+        if ((args.type == kMinfsTypeDir) && (ino_ != newdir->ino_)) {
+            args.name = "..";
+            args.ino = newdir->ino_;
+            if ((status = oldvn->ForEachDirentNamed(&args, DirentCallbackUpdateInode)) < 0) {
+                return status;
+            }
         }
-    }
 
-    // at this point, the oldvn exists with multiple names (or the same name in
-    // different directories)
-    oldvn->inode_.link_count++;
+        // at this point, the oldvn exists with multiple names (or the same name in
+        // different directories)
+        oldvn->inode_.link_count++;
+    }
 
     // finally, remove oldname from its original position
     args.name = oldname;
-    if ((status = ForEachDirent(&args, DirentCallbackForceUnlink)) != ZX_OK) {
+    if ((status = ForEachDirentNamed(&args, DirentCallbackForceUnlink)) != ZX_OK) {
         return status;
     }
     state->GetWork()->PinVnode(oldvn);
@@ -2013,6 +2460,10 @@ zx_status_t VnodeMinfs::Rename(fbl::RefPtr<fs::Vnode> _newdir, fbl::StringPiece
 zx_status_t VnodeMinfs::Link(fbl::StringPiece name, fbl::RefPtr<fs::Vnode> _target) {
     TRACE_DURATION("minfs", "VnodeMinfs::Link", "name", name);
     ZX_DEBUG_ASSERT(fs::vfs_valid_name(name));
+#ifdef __Fuchsia__
+    fbl::AutoLock txn_lock(&fs_->txn_lock_);
+    fbl::AutoLock lock(&lock_);
+#endif
 
     if (!IsDirectory()) {
         return ZX_ERR_NOT_SUPPORTED;
@@ -2030,7 +2481,7 @@ zx_status_t VnodeMinfs::Link(fbl::StringPiece name, fbl::RefPtr<fs::Vnode> _targ
     DirArgs args = DirArgs();
     args.name = name;
     zx_status_t status;
-    if ((status = ForEachDirent(&args, DirentCallbackFind)) != ZX_ERR_NOT_FOUND) {
+    if ((status = ForEachDirentNamed(&args, DirentCallbackFind)) != ZX_ERR_NOT_FOUND) {
         return (status == ZX_OK) ? ZX_ERR_ALREADY_EXISTS : status;
     }
 
@@ -2038,7 +2489,7 @@ zx_status_t VnodeMinfs::Link(fbl::StringPiece name, fbl::RefPtr<fs::Vnode> _targ
     // before updating any other metadata.
     args.type = kMinfsTypeFile; // We can't hard link directories
     args.reclen = static_cast<uint32_t>(DirentSize(static_cast<uint8_t>(name.length())));
-    status = ForEachDirent(&args, DirentCallbackFindSpace);
+    status = ForEachDirentWithSpace(&args, DirentCallbackFindSpace);
     if (status == ZX_ERR_NOT_FOUND) {
         return ZX_ERR_NO_SPACE;
     } else if (status != ZX_OK) {
@@ -2064,8 +2515,13 @@ zx_status_t VnodeMinfs::Link(fbl::StringPiece name, fbl::RefPtr<fs::Vnode> _targ
     }
 
     // We have successfully added the vn to a new location. Increment the link count.
-    target->inode_.link_count++;
-    target->InodeSync(state->GetWork(), kMxFsSyncDefault);
+    {
+#ifdef __Fuchsia__
+        fbl::AutoLock target_lock(&target->lock_);
+#endif
+        target->inode_.link_count++;
+        target->InodeSync(state->GetWork(), kMxFsSyncDefault);
+    }
     state->GetWork()->PinVnode(fbl::move(fbl::WrapRefPtr(this)));
     state->GetWork()->PinVnode(target);
     fs_->CommitTransaction(fbl::move(state));
@@ -2086,7 +2542,8 @@ zx_status_t VnodeMinfs::GetHandles(uint32_t flags, zx_handle_t* hnd, uint32_t* t
 void VnodeMinfs::Sync(SyncCallback closure) {
     TRACE_DURATION("minfs", "VnodeMinfs::Sync");
     fs_->Sync([this, cb = fbl::move(closure)](zx_status_t status) {
-        if (status != ZX_OK) {
+        if (status != ZX_OK || fs_->Info().jnl_blocks != 0) {
+            // With a journal, the writeback thread has already flushed.
             cb(status);
             return;
         }
@@ -22,6 +22,7 @@
 #include <fs/vfs.h>
 
 #include "minfs-private.h"
+#include <minfs/journal.h>
 #include <minfs/writeback.h>
 
 namespace minfs {
@@ -29,10 +30,10 @@ namespace minfs {
 #ifdef __Fuchsia__
 
 void WriteTxn::Enqueue(zx_handle_t vmo, uint64_t vmo_offset, uint64_t dev_offset,
-                       uint64_t nblocks) {
+                       uint64_t nblocks, bool metadata) {
     ValidateVmoSize(vmo, static_cast<blk_t>(vmo_offset));
     for (size_t i = 0; i < requests_.size(); i++) {
-        if (requests_[i].vmo != vmo) {
+        if (requests_[i].vmo != vmo || requests_[i].metadata != metadata) {
             continue;
         }
 
@@ -57,6 +58,7 @@ void WriteTxn::Enqueue(zx_handle_t vmo, uint64_t vmo_offset, uint64_t dev_offset
     request.vmo_offset = vmo_offset;
     request.dev_offset = dev_offset;
     request.length = nblocks;
+    request.metadata = metadata;
     requests_.push_back(fbl::move(request));
 }
 
@@ -126,6 +128,14 @@ size_t WritebackWork::Complete(zx_handle_t vmo, vmoid_t vmoid) {
     return blk_count;
 }
 
+void WritebackWork::Finish(zx_status_t status) {
+    Requests().reset();
+    if (closure_) {
+        closure_(status);
+    }
+    Reset();
+}
+
 void WritebackWork::SetClosure(SyncCallback closure) {
     ZX_DEBUG_ASSERT(!closure_);
     closure_ = fbl::move(closure);
@@ -153,8 +163,10 @@ void WritebackWork::PinVnode(fbl::RefPtr<VnodeMinfs> vn) {
 #ifdef __Fuchsia__
 
 zx_status_t WritebackBuffer::Create(Bcache* bc, fbl::unique_ptr<fzl::MappedVmo> buffer,
+                                    fbl::unique_ptr<Journal> journal,
                                     fbl::unique_ptr<WritebackBuffer>* out) {
-    fbl::unique_ptr<WritebackBuffer> wb(new WritebackBuffer(bc, fbl::move(buffer)));
+    fbl::unique_ptr<WritebackBuffer> wb(new WritebackBuffer(bc, fbl::move(buffer),
+                                                            fbl::move(journal)));
     if (wb->buffer_->GetSize() % kMinfsBlockSize != 0) {
         return ZX_ERR_INVALID_ARGS;
     } else if (cnd_init(&wb->consumer_cvar_) != thrd_success) {
@@ -175,8 +187,9 @@ zx_status_t WritebackBuffer::Create(Bcache* bc, fbl::unique_ptr<fzl::MappedVmo>
     return ZX_OK;
 }
 
-WritebackBuffer::WritebackBuffer(Bcache* bc, fbl::unique_ptr<fzl::MappedVmo> buffer) :
-    bc_(bc), unmounting_(false), buffer_(fbl::move(buffer)),
+WritebackBuffer::WritebackBuffer(Bcache* bc, fbl::unique_ptr<fzl::MappedVmo> buffer,
+                                 fbl::unique_ptr<Journal> journal) :
+    bc_(bc), unmounting_(false), buffer_(fbl::move(buffer)), journal_(fbl::move(journal)),
     cap_(buffer_->GetSize() / kMinfsBlockSize) {}
 
 WritebackBuffer::~WritebackBuffer() {
@@ -270,6 +283,7 @@ void WritebackBuffer::CopyToBufferLocked(WriteTxn* txn) {
             request.vmo_offset = 0;
             request.dev_offset = dev_offset;
             request.length = wb_len;
+            request.metadata = reqs[i].metadata;
             i++;
             reqs.insert(i, request);
         }
@@ -315,6 +329,38 @@ int WritebackBuffer::WritebackThread(void* arg) {
 
     b->writeback_lock_.Acquire();
     while (true) {
+        while (b->journal_ != nullptr && !b->work_queue_.is_empty()) {
+            // Commit everything which is waiting, up to what fits in one
+            // journal entry, as a group.
+            fbl::Vector<fbl::unique_ptr<WritebackWork>> group;
+            size_t metadata = 0;
+            size_t blks_consumed = 0;
+            do {
+                size_t blocks = Journal::MetadataBlocks(&b->work_queue_.front());
+                if (group.size() > 0 && metadata + blocks > b->journal_->Capacity()) {
+                    break;
+                }
+                metadata += blocks;
+                blks_consumed += b->work_queue_.front().BlkCount();
+                group.push_back(b->work_queue_.pop());
+            } while (!b->work_queue_.is_empty());
+            TRACE_DURATION("minfs", "WritebackBuffer::WritebackThread");
+
+            b->writeback_lock_.Release();
+            b->journal_->Commit(group.get(), group.size(), b->buffer_->GetData(),
+                                b->buffer_vmoid_);
+            for (size_t i = 0; i < group.size(); i++) {
+                TRACE_FLOW_END("minfs", "writeback",
+                               reinterpret_cast<trace_flow_id_t>(group[i].get()));
+            }
+            group.reset();
+
+            b->writeback_lock_.Acquire();
+            b->start_ = (b->start_ + blks_consumed) % b->cap_;
+            b->len_ -= blks_consumed;
+            cnd_signal(&b->producer_cvar_);
+        }
+
         while (!b->work_queue_.is_empty()) {
             auto work = b->work_queue_.pop();
             TRACE_DURATION("minfs", "WritebackBuffer::WritebackThread");
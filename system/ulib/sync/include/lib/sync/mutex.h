@@ -0,0 +1,49 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef LIB_SYNC_MUTEX_H_
+#define LIB_SYNC_MUTEX_H_
+
+#include <zircon/compiler.h>
+#include <zircon/types.h>
+
+__BEGIN_CDECLS;
+
+// A priority inheriting mutex.
+//
+// The futex holds 0 when the mutex is unlocked, and the owning thread's
+// handle otherwise, so that contending threads can name the owner to the
+// kernel with zx_futex_wait_pi().  The owner then runs at no less than the
+// priority of the highest priority waiter until it unlocks.
+typedef struct sync_mutex {
+    zx_futex_t futex;
+
+#ifdef __cplusplus
+    sync_mutex()
+        : futex(0) {}
+#endif
+} sync_mutex_t;
+
+#if !defined(__cplusplus)
+#define SYNC_MUTEX_INIT ((sync_mutex_t){0})
+#endif
+
+// Blocks until the mutex is acquired.
+void sync_mutex_lock(sync_mutex_t* mutex);
+
+// Returns ZX_OK if the mutex was acquired, and ZX_ERR_BAD_STATE if it is
+// held by another thread.
+zx_status_t sync_mutex_trylock(sync_mutex_t* mutex);
+
+// Returns ZX_OK if the mutex was acquired, and ZX_ERR_TIMED_OUT if
+// |deadline| passed first.
+zx_status_t sync_mutex_timedlock(sync_mutex_t* mutex, zx_time_t deadline);
+
+// Releases the mutex, handing it and any inherited priority to the next
+// waiter.  The calling thread must hold the mutex.
+void sync_mutex_unlock(sync_mutex_t* mutex);
+
+__END_CDECLS;
+
+#endif // LIB_SYNC_MUTEX_H_
@@ -0,0 +1,88 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <lib/sync/mutex.h>
+
+#include <stdatomic.h>
+#include <zircon/process.h>
+#include <zircon/syscalls.h>
+
+// Handle values never have their top bit set, so it is free to mark that
+// other threads may be waiting in the kernel for the mutex.
+#define UNLOCKED 0
+#define CONTESTED ((int)0x80000000u)
+
+static inline zx_handle_t owner_of(int value) {
+    return (zx_handle_t)(value & ~CONTESTED);
+}
+
+zx_status_t sync_mutex_trylock(sync_mutex_t* mutex) {
+    int expected = UNLOCKED;
+    if (atomic_compare_exchange_strong(&mutex->futex, &expected,
+                                       (int)zx_thread_self())) {
+        return ZX_OK;
+    }
+    return ZX_ERR_BAD_STATE;
+}
+
+zx_status_t sync_mutex_timedlock(sync_mutex_t* mutex, zx_time_t deadline) {
+    const int self = (int)zx_thread_self();
+
+    int old_value = UNLOCKED;
+    if (atomic_compare_exchange_strong(&mutex->futex, &old_value, self)) {
+        return ZX_OK;
+    }
+
+    for (;;) {
+        if (old_value == UNLOCKED) {
+            // Other threads may still be waiting behind us, so keep the
+            // mutex marked as contested when we claim it.
+            if (atomic_compare_exchange_strong(&mutex->futex, &old_value,
+                                               self | CONTESTED)) {
+                return ZX_OK;
+            }
+            continue;
+        }
+
+        // Make sure the owner knows to wake us when it unlocks.
+        int contested_value = old_value | CONTESTED;
+        if (old_value != contested_value &&
+            !atomic_compare_exchange_strong(&mutex->futex, &old_value,
+                                            contested_value)) {
+            continue;
+        }
+
+        switch (zx_futex_wait_pi(&mutex->futex, contested_value,
+                                 owner_of(contested_value), deadline)) {
+        case ZX_OK:
+        case ZX_ERR_BAD_STATE:
+            // Either we were woken or the owner changed under us; look
+            // at the mutex again.
+            break;
+        case ZX_ERR_TIMED_OUT:
+            return ZX_ERR_TIMED_OUT;
+        default:
+            // The owner named in the futex is not a thread of this
+            // process, so the mutex is corrupt.
+            __builtin_trap();
+        }
+        old_value = atomic_load(&mutex->futex);
+    }
+}
+
+void sync_mutex_lock(sync_mutex_t* mutex) {
+    zx_status_t status = sync_mutex_timedlock(mutex, ZX_TIME_INFINITE);
+    if (status != ZX_OK) {
+        __builtin_trap();
+    }
+}
+
+void sync_mutex_unlock(sync_mutex_t* mutex) {
+    int old_value = atomic_exchange(&mutex->futex, UNLOCKED);
+    if (old_value & CONTESTED) {
+        // Hands the kernel's notion of ownership, and the inherited
+        // priority of the remaining waiters, to the thread we wake.
+        zx_futex_wake_pi(&mutex->futex);
+    }
+}
@@ -11,6 +11,7 @@ MODULE_COMPILEFLAGS += -fvisibility=hidden
 
 MODULE_SRCS += \
     $(LOCAL_DIR)/completion.c \
+    $(LOCAL_DIR)/mutex.c \
 
 MODULE_LIBS := \
     system/ulib/zircon \
@@ -18,7 +18,7 @@
 __BEGIN_CDECLS
 
 // API version number (useful when doing incompatible upgrades)
-#define CPUPERF_API_VERSION 3
+#define CPUPERF_API_VERSION 4
 
 // Buffer format version
 #define CPUPERF_BUFFER_VERSION 0
@@ -67,8 +67,10 @@ typedef enum {
   CPUPERF_RECORD_VALUE = 4,
   // The record is a |cpuperf_pc_record_t|.
   CPUPERF_RECORD_PC = 5,
+  // The record is a |cpuperf_stack_record_t|.
+  CPUPERF_RECORD_STACK = 6,
   // non-ABI
-  CPUPERF_NUM_RECORD_TYPES = 6,
+  CPUPERF_NUM_RECORD_TYPES = 7,
 } cpuperf_record_type_t;
 
 // Trace buffer space is expensive, we want to keep records small.
@@ -174,6 +176,41 @@ typedef struct {
     uint64_t pc;
 } __PACKED cpuperf_pc_record_t;
 
+// The maximum number of frames in a |cpuperf_stack_record_t|.
+#define CPUPERF_MAX_STACK_FRAMES 30u
+
+// Record the aspace+pc values, the current thread, and the kernel call
+// stack at the time of the sample.
+// If the event id is not NONE, then like |cpuperf_pc_record_t| this record
+// also indicates that the event reached its tick point. If the event id is
+// NONE then the sample was taken by the timer configured with
+// |cpuperf_config_t.timer_period|.
+// It is expected that this record follows a TIME record.
+// This record is variable length: only the first |num_frames| entries of
+// |frames| are present, see CPUPERF_STACK_RECORD_SIZE.
+typedef struct {
+    cpuperf_record_header_t header;
+    // The number of entries in |frames|.
+    uint32_t num_frames;
+    // The koid of the thread that was interrupted, or zero for kernel threads.
+    uint64_t tid;
+    // The aspace id at the time data was collected.
+    // The meaning of the value is architecture-specific.
+    // In the case of x86 this is the cr3 value.
+    uint64_t aspace;
+    uint64_t pc;
+    // Return addresses of the kernel call stack, innermost first.
+    // This is empty if |pc| is a userspace address.
+    uint64_t frames[CPUPERF_MAX_STACK_FRAMES];
+} __PACKED cpuperf_stack_record_t;
+
+// Bits in |cpuperf_stack_record_t.header.reserved_flags|.
+// |pc| is a userspace address.
+#define CPUPERF_STACK_FLAG_USER (1u << 0)
+
+#define CPUPERF_STACK_RECORD_SIZE(num_frames) \
+    (offsetof(cpuperf_stack_record_t, frames) + (num_frames) * sizeof(uint64_t))
+
 // The properties of this system.
 typedef struct {
     // S/W API version = CPUPERF_API_VERSION.
@@ -221,7 +258,7 @@ typedef struct {
     // TODO(dje): hypervisor, host/guest os/user
     uint32_t flags[CPUPERF_MAX_EVENTS];
 // Valid bits in |flags|.
-#define CPUPERF_CONFIG_FLAG_MASK      0xf
+#define CPUPERF_CONFIG_FLAG_MASK      0x1f
 // Collect os data.
 #define CPUPERF_CONFIG_FLAG_OS        (1u << 0)
 // Collect userspace data.
@@ -234,6 +271,17 @@ typedef struct {
 // record (depending on what the event is).
 // It is an error to have this bit set for an event and have rate[0] be zero.
 #define CPUPERF_CONFIG_FLAG_TIMEBASE0 (1u << 3)
+// Collect aspace+pc values and the kernel call stack.
+// The record emitted is a CPUPERF_RECORD_STACK record.
+#define CPUPERF_CONFIG_FLAG_STACK     (1u << 4)
+
+    // If non-zero then, in addition to any events, every |timer_period|
+    // nanoseconds each cpu takes a sample from a timer interrupt and emits a
+    // CPUPERF_RECORD_STACK record with event id CPUPERF_EVENT_ID_NONE.
+    // This does not need a h/w performance monitor, so it also works where
+    // one is not available (e.g., QEMU without PMU passthrough), in which
+    // case |events| must be empty.
+    zx_duration_t timer_period;
 } cpuperf_config_t;
 
 ///////////////////////////////////////////////////////////////////////////////
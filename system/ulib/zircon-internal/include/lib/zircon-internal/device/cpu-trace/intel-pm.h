@@ -331,7 +331,7 @@ typedef struct {
     uint32_t programmable_flags[IPM_MAX_PROGRAMMABLE_COUNTERS];
     uint32_t misc_flags[IPM_MAX_MISC_EVENTS];
 // Both of IPM_CONFIG_FLAG_{PC,TIMEBASE} cannot be set.
-#define IPM_CONFIG_FLAG_MASK     0x3
+#define IPM_CONFIG_FLAG_MASK     0x7
 // Collect aspace+pc values.
 // Cannot be set with IPM_CONFIG_FLAG_TIMEBASE unless the counter is
 // |timebase_id|.
@@ -339,9 +339,17 @@ typedef struct {
 // Collect this event's value when |timebase_id| counter's data is collected.
 // While redundant, it is ok to set this for the |timebase_id| counter.
 #define IPM_CONFIG_FLAG_TIMEBASE (1u << 1)
+// Collect aspace+pc values and the kernel call stack.
+// Requires IPM_CONFIG_FLAG_PC.
+#define IPM_CONFIG_FLAG_STACK    (1u << 2)
 
     // IA32_PERFEVTSEL_*
     uint64_t programmable_events[IPM_MAX_PROGRAMMABLE_COUNTERS];
+
+    // If non-zero, take a pc+stack sample on each cpu every |timer_period|
+    // nanoseconds from a timer interrupt. This is the only kind of data
+    // that can be collected without a h/w performance monitor.
+    zx_duration_t timer_period;
 } zx_x86_ipm_config_t;
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -10,6 +10,7 @@
 
 KTRACE_DEF(0x000,32B,VERSION,META) // version
 KTRACE_DEF(0x001,32B,TICKS_PER_MS,META) // lo32, hi32
+KTRACE_DEF(0x002,16B,PAD,META) // no payload; size varies, see KTRACE_LEN()
 
 KTRACE_DEF(0x020,NAME,KTHREAD_NAME,META) // ktid, 0, name[]
 KTRACE_DEF(0x021,NAME,THREAD_NAME,META) // tid, pid, name[]
@@ -63,6 +64,7 @@ KTRACE_DEF(0x170,32B,VCPU_ENTER,TASKS)
 KTRACE_DEF(0x171,32B,VCPU_EXIT,TASKS) // meta, exit_address_hi, exit_address_lo
 KTRACE_DEF(0x172,32B,VCPU_BLOCK,TASKS) // meta
 KTRACE_DEF(0x173,32B,VCPU_UNBLOCK,TASKS) // meta
+KTRACE_DEF(0x174,32B,VCPU_EXIT_COUNT,TASKS) // meta, count_lo, count_hi
 
 // events from 0x200-0x2ff are for arch-specific needs
 
@@ -88,5 +88,18 @@ enum {
 #define KTRACE_ACTION_STOP      2 // options ignored
 #define KTRACE_ACTION_REWIND    3 // options ignored
 #define KTRACE_ACTION_NEW_PROBE 4 // options ignored, ptr = name
+#define KTRACE_ACTION_SET_MODE  5 // options = KTRACE_MODE_* flags, tracing must be stopped
+
+// Buffering modes for KTRACE_ACTION_SET_MODE
+//
+// With neither flag set, records are appended to the buffer in order and
+// tracing stops when it fills.  KTRACE_MODE_CIRCULAR keeps the most recent
+// records instead of stopping.  KTRACE_MODE_PER_CPU gives each CPU its own
+// part of the buffer, so records are only ordered by timestamp within a CPU.
+// In either mode name records are kept in a separate part of the buffer
+// that is never overwritten.
+#define KTRACE_MODE_CIRCULAR    0x1
+#define KTRACE_MODE_PER_CPU     0x2
+#define KTRACE_MODE_ALL         (KTRACE_MODE_CIRCULAR | KTRACE_MODE_PER_CPU)
 
 __END_CDECLS
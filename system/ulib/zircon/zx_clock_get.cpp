@@ -0,0 +1,101 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <zircon/syscalls.h>
+
+#include "private.h"
+
+namespace {
+
+uint64_t mul_u32_u32(uint32_t a, uint32_t b) {
+    return static_cast<uint64_t>(a) * b;
+}
+
+// This must compute exactly what u64_mul_u64_fp32_64() in
+// kernel/lib/fixed_point does, so that the times read here agree with the
+// kernel's current_time() to the nanosecond.
+uint64_t ticks_to_mono(uint64_t ticks, uint32_t l0, uint32_t l32, uint32_t l64) {
+    uint32_t a_r32 = static_cast<uint32_t>(ticks >> 32);
+    uint32_t a_0 = static_cast<uint32_t>(ticks);
+    uint64_t res_0;
+    uint64_t res_l32;
+    uint64_t tmp;
+
+    res_0 = mul_u32_u32(a_r32, l0) << 32;
+    res_0 += mul_u32_u32(a_0, l0);
+    res_0 += mul_u32_u32(a_r32, l32);
+    tmp = mul_u32_u32(a_0, l32);
+    res_0 += tmp >> 32;
+    res_l32 = static_cast<uint32_t>(tmp);
+    tmp = mul_u32_u32(a_r32, l64);
+    res_0 += tmp >> 32;
+    res_l32 += static_cast<uint32_t>(tmp);
+    res_l32 += mul_u32_u32(a_0, l64) >> 32;
+    res_0 += res_l32 >> 32;
+    return res_0 + (static_cast<uint32_t>(res_l32) >> 31);
+}
+
+// Reads ZX_CLOCK_MONOTONIC, or ZX_CLOCK_UTC if |utc| is true, from the
+// time data the kernel publishes.  Returns false if the kernel has not
+// published a tick conversion, in which case the caller must ask the
+// kernel instead.
+bool read_clock(bool utc, zx_time_t* time) {
+    for (;;) {
+        uint32_t seq = __atomic_load_n(&DATA_TIME.seq, __ATOMIC_ACQUIRE);
+        if (unlikely(seq & 1))
+            continue;
+
+        if (!__atomic_load_n(&DATA_TIME.ticks_to_mono_valid, __ATOMIC_RELAXED))
+            return false;
+        uint32_t l0 = __atomic_load_n(&DATA_TIME.ns_per_tick_l0, __ATOMIC_RELAXED);
+        uint32_t l32 = __atomic_load_n(&DATA_TIME.ns_per_tick_l32, __ATOMIC_RELAXED);
+        uint32_t l64 = __atomic_load_n(&DATA_TIME.ns_per_tick_l64, __ATOMIC_RELAXED);
+        int64_t offset = utc ? __atomic_load_n(&DATA_TIME.utc_offset, __ATOMIC_RELAXED) : 0;
+        zx_ticks_t ticks = VDSO_zx_ticks_get();
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (likely(__atomic_load_n(&DATA_TIME.seq, __ATOMIC_RELAXED) == seq)) {
+            *time = static_cast<zx_time_t>(ticks_to_mono(ticks, l0, l32, l64)) + offset;
+            return true;
+        }
+    }
+}
+
+} // anonymous namespace
+
+zx_time_t _zx_clock_get_monotonic(void) {
+    zx_time_t time;
+    if (likely(read_clock(false, &time)))
+        return time;
+    return SYSCALL_zx_clock_get_monotonic_via_kernel();
+}
+
+VDSO_INTERFACE_FUNCTION(zx_clock_get_monotonic);
+
+zx_time_t _zx_clock_get(zx_clock_t clock_id) {
+    zx_time_t time;
+    switch (clock_id) {
+    case ZX_CLOCK_MONOTONIC:
+    case ZX_CLOCK_UTC:
+        if (likely(read_clock(clock_id == ZX_CLOCK_UTC, &time)))
+            return time;
+        break;
+    }
+    return SYSCALL_zx_clock_get_via_kernel(clock_id);
+}
+
+VDSO_INTERFACE_FUNCTION(zx_clock_get);
+
+zx_status_t _zx_clock_get_new(zx_clock_t clock_id, zx_time_t* out) {
+    switch (clock_id) {
+    case ZX_CLOCK_MONOTONIC:
+    case ZX_CLOCK_UTC:
+        if (likely(read_clock(clock_id == ZX_CLOCK_UTC, out)))
+            return ZX_OK;
+        break;
+    }
+    return SYSCALL_zx_clock_get_new_via_kernel(clock_id, out);
+}
+
+VDSO_INTERFACE_FUNCTION(zx_clock_get_new);
@@ -113,8 +113,16 @@ fbl::String GetNameForOrder(ReadOrder order) {
     return "";
 }
 
+// Kinds of blob contents.
+enum class BlobData {
+    // Random bytes, which blobfs stores uncompressed.
+    kRandom,
+    // Runs of repeated bytes, which blobfs stores compressed.
+    kCompressible,
+};
+
 // Creates a an in memory blob.
-bool MakeBlob(fbl::String fs_path, size_t blob_size, unsigned int* seed,
+bool MakeBlob(fbl::String fs_path, size_t blob_size, BlobData contents, unsigned int* seed,
               fbl::unique_ptr<BlobInfo>* out) {
     BEGIN_HELPER;
     // Generate a Blob of random data
@@ -128,8 +136,17 @@ bool MakeBlob(fbl::String fs_path, size_t blob_size, unsigned int* seed,
     // sequence for each byte. We did hit this issue, which translates into
     // test failures.
     unsigned int initial_seed = rand_r(seed);
-    for (size_t i = 0; i < blob_size; i++) {
-        info->data[i] = static_cast<char>(rand_r(&initial_seed));
+    if (contents == BlobData::kCompressible) {
+        size_t i = 0;
+        while (i < blob_size) {
+            size_t run = fbl::min<size_t>(rand_r(&initial_seed) % 64 + 1, blob_size - i);
+            memset(&info->data[i], rand_r(&initial_seed), run);
+            i += run;
+        }
+    } else {
+        for (size_t i = 0; i < blob_size; i++) {
+            info->data[i] = static_cast<char>(rand_r(&initial_seed));
+        }
     }
     info->size_data = blob_size;
 
@@ -181,7 +198,8 @@ public:
         fbl::unique_ptr<BlobInfo> new_blob;
 
         for (int64_t curr = 0; curr < info_.blob_count; ++curr) {
-            MakeBlob(fixture->fs_path(), info_.blob_size, fixture->mutable_seed(), &new_blob);
+            MakeBlob(fixture->fs_path(), info_.blob_size, BlobData::kRandom,
+                     fixture->mutable_seed(), &new_blob);
             fbl::unique_fd fd(open(new_blob->path.c_str(), O_CREAT | O_RDWR));
             ASSERT_TRUE(fd, strerror(errno));
             ASSERT_EQ(ftruncate(fd.get(), info_.blob_size), 0, strerror(errno));
@@ -209,7 +227,8 @@ public:
         // At this specific state, measure how much time in average it takes to perform each of the
         // operations declared.
         while (state->KeepRunning()) {
-            MakeBlob(fixture->fs_path(), info_.blob_size, fixture->mutable_seed(), &new_blob);
+            MakeBlob(fixture->fs_path(), info_.blob_size, BlobData::kRandom,
+                     fixture->mutable_seed(), &new_blob);
             state->NextStep();
 
             fbl::unique_fd fd(open(new_blob->path.c_str(), O_CREAT | O_RDWR));
@@ -308,6 +327,59 @@ private:
     BlobfsInfo info_;
 };
 
+// Measures small reads at random offsets of large compressed blobs, each from
+// a freshly opened blob, which only has to decompress the chunks holding the
+// data being read.
+class CompressedReadTest {
+public:
+    CompressedReadTest(size_t blob_count, size_t blob_size)
+        : blob_count_(blob_count), blob_size_(blob_size) {}
+
+    bool RandomReadTest(perftest::RepeatState* state, Fixture* fixture) {
+        BEGIN_HELPER;
+        constexpr size_t kReadSize = 4096;
+        if (paths_.is_empty()) {
+            fbl::unique_ptr<BlobInfo> new_blob;
+            for (size_t curr = 0; curr < blob_count_; ++curr) {
+                ASSERT_TRUE(MakeBlob(fixture->fs_path(), blob_size_, BlobData::kCompressible,
+                                     fixture->mutable_seed(), &new_blob));
+                fbl::unique_fd fd(open(new_blob->path.c_str(), O_CREAT | O_RDWR));
+                ASSERT_TRUE(fd, strerror(errno));
+                ASSERT_EQ(ftruncate(fd.get(), blob_size_), 0, strerror(errno));
+                ASSERT_EQ(StreamAll(write, fd.get(), new_blob->data.get(), new_blob->size_data),
+                          0, strerror(errno));
+                paths_.push_back(new_blob->path);
+            }
+        }
+
+        state->DeclareStep("open");
+        state->DeclareStep("read");
+        state->DeclareStep("close");
+
+        char buffer[kReadSize];
+        const size_t reads_per_blob = blob_size_ / kReadSize;
+        while (state->KeepRunning()) {
+            const auto& path = paths_[rand_r(fixture->mutable_seed()) % paths_.size()];
+            off_t offset = (rand_r(fixture->mutable_seed()) % reads_per_blob) * kReadSize;
+            fbl::unique_fd fd(open(path.c_str(), O_RDONLY));
+            ASSERT_TRUE(fd);
+            state->NextStep();
+
+            ASSERT_EQ(pread(fd.get(), buffer, kReadSize, offset),
+                      static_cast<ssize_t>(kReadSize));
+            state->NextStep();
+
+            ASSERT_EQ(close(fd.release()), 0);
+        }
+        END_HELPER;
+    }
+
+private:
+    size_t blob_count_;
+    size_t blob_size_;
+    fbl::Vector<fbl::StringBuffer<fs_test_utils::kPathSize>> paths_;
+};
+
 bool RunBenchmark(int argc, char** argv) {
     FixtureOptions f_opts = FixtureOptions::Default(DISK_FORMAT_BLOBFS);
     PerformanceTestOptions p_opts;
@@ -384,6 +456,37 @@ bool RunBenchmark(int argc, char** argv) {
         }
     }
 
+    const size_t compressed_blob_sizes[] = {
+        8 * 1024 * 1024,  // 8 MB
+        32 * 1024 * 1024, // 32 MB
+    };
+    constexpr size_t kCompressedBlobCount = 4;
+    fbl::Vector<CompressedReadTest> compressed_tests;
+    compressed_tests.reserve(fbl::count_of(compressed_blob_sizes));
+    for (auto blob_size : compressed_blob_sizes) {
+        size_t blob_count = (p_opts.is_unittest) ? 1 : kCompressedBlobCount;
+        size_t index = compressed_tests.size();
+        compressed_tests.push_back(CompressedReadTest(blob_count, blob_size));
+        TestCaseInfo testcase;
+        testcase.teardown = false;
+        testcase.sample_count = kSampleCount;
+
+        TestInfo read_test;
+        read_test.name = fbl::StringPrintf("%s/%s/Compressed/RandomRead4K",
+                                           disk_format_string_[f_opts.fs_type],
+                                           GetNameForSize(blob_size).c_str());
+        read_test.test_fn = [index, &compressed_tests](perftest::RepeatState* state,
+                                                       fs_test_utils::Fixture* fixture) {
+            return compressed_tests[index].RandomReadTest(state, fixture);
+        };
+        // The blobs compress well, but leave room for them to be stored
+        // uncompressed.
+        read_test.required_disk_space =
+            blob_count * (blob_size + 2 * MerkleTree::kNodeSize + blobfs::kBlobfsInodeSize);
+        testcase.tests.push_back(fbl::move(read_test));
+        testcases.push_back(fbl::move(testcase));
+    }
+
     return fs_test_utils::RunTestCases(f_opts, p_opts, testcases);
 }
 
@@ -103,13 +103,14 @@ public:
 
     // Returns the current total transaction block count from the underlying ramdisk.
     bool GetRamdiskCount(uint64_t* blk_count) const;
+
+    // Mounts the blobfs partition, e.g. after a test unmounted it to use the
+    // partition directly.
+    bool Mount();
 private:
     // Checks info of mounted blobfs.
     bool CheckInfo(const char* mount_path);
 
-    // Mounts the blobfs partition.
-    bool Mount();
-
     FsTestType type_;
     FsTestState state_ = FsTestState::kInit;
     uint64_t blk_size_ = 512;
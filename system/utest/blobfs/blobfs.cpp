@@ -12,10 +12,13 @@
 #include <threads.h>
 #include <utime.h>
 
+#include <blobfs/blobfs.h>
 #include <blobfs/format.h>
 #include <blobfs/lz4.h>
+#include <blobfs/workers.h>
 #include <digest/digest.h>
 #include <digest/merkle-tree.h>
+#include <fbl/algorithm.h>
 #include <fbl/alloc_checker.h>
 #include <fbl/atomic.h>
 #include <fbl/auto_call.h>
@@ -800,6 +803,115 @@ static bool TestMmapUseAfterClose(BlobfsTest* blobfsTest) {
     END_HELPER;
 }
 
+static bool TestReopenClosedBlobs(BlobfsTest* blobfsTest) {
+    BEGIN_HELPER;
+    // Closed blobs may keep their data in memory; reopening them, whether
+    // or not they still do, should read the same data.
+    constexpr size_t kBlobCount = 8;
+    fbl::unique_ptr<blob_info_t> info[kBlobCount];
+    for (size_t i = 0; i < kBlobCount; i++) {
+        ASSERT_TRUE(GenerateRandomBlob(1 << (12 + i), &info[i]));
+        fbl::unique_fd fd;
+        ASSERT_TRUE(MakeBlob(info[i].get(), &fd));
+        ASSERT_EQ(close(fd.release()), 0);
+    }
+
+    for (size_t round = 0; round < 2; round++) {
+        for (size_t i = 0; i < kBlobCount; i++) {
+            fbl::unique_fd fd(open(info[i]->path, O_RDONLY));
+            ASSERT_TRUE(fd, "Failed to re-open blob");
+            ASSERT_TRUE(VerifyContents(fd.get(), info[i]->data.get(), info[i]->size_data));
+            ASSERT_EQ(close(fd.release()), 0);
+        }
+    }
+
+    for (size_t i = 0; i < kBlobCount; i++) {
+        ASSERT_EQ(unlink(info[i]->path), 0);
+    }
+    END_HELPER;
+}
+
+// Reads all of |info|'s blob through |fs| without going through a mount
+// point, and drops the reference to it again.
+static bool ReadBlobDirectly(blobfs::Blobfs* fs, const blob_info_t* info) {
+    BEGIN_HELPER;
+    const char* name = info->path + strlen(MOUNT_PATH "/");
+    Digest digest;
+    ASSERT_EQ(digest.Parse(name, strlen(name)), ZX_OK);
+    fbl::RefPtr<blobfs::VnodeBlob> blob;
+    ASSERT_EQ(fs->LookupBlob(digest, &blob), ZX_OK);
+    fbl::RefPtr<fs::Vnode> vn = fbl::move(blob);
+
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<char[]> buf(new (&ac) char[info->size_data]);
+    ASSERT_TRUE(ac.check());
+    size_t actual;
+    ASSERT_EQ(vn->Read(buf.get(), info->size_data, 0, &actual), ZX_OK);
+    ASSERT_EQ(actual, info->size_data);
+    ASSERT_EQ(memcmp(buf.get(), info->data.get(), info->size_data), 0);
+    END_HELPER;
+}
+
+static bool TestCacheEviction(BlobfsTest* blobfsTest) {
+    BEGIN_HELPER;
+    constexpr size_t kBlobCount = 4;
+    constexpr size_t kBlobSize = 1 << 17;
+    fbl::unique_ptr<blob_info_t> info[kBlobCount];
+    for (size_t i = 0; i < kBlobCount; i++) {
+        ASSERT_TRUE(GenerateRandomBlob(kBlobSize, &info[i]));
+        fbl::unique_fd fd;
+        ASSERT_TRUE(MakeBlob(info[i].get(), &fd));
+        ASSERT_EQ(close(fd.release()), 0);
+    }
+
+    // Use the partition directly, with room in the cache for two of the
+    // blobs (with their Merkle trees), so that which blobs it keeps can be
+    // seen in the metrics.
+    ASSERT_EQ(umount(MOUNT_PATH), ZX_OK);
+    {
+        fbl::unique_fd fd(blobfsTest->GetFd());
+        ASSERT_TRUE(fd, "Could not open ramdisk");
+        blobfs::MountOptions options;
+        options.metrics = true;
+        options.cache_size = kBlobSize * 5 / 2;
+        fbl::unique_ptr<blobfs::Blobfs> fs;
+        ASSERT_EQ(blobfs::Initialize(fbl::move(fd), options, &fs), ZX_OK);
+
+        // The blob read at each step, whether it should still have been in
+        // memory, and the number of blobs evicted once it is closed again.
+        // The least recently closed blob is the one evicted.
+        struct {
+            size_t blob;
+            bool hit;
+            uint64_t evictions;
+        } kSteps[] = {
+            {0, false, 0},
+            {1, false, 0},
+            {2, false, 1}, // Evicts 0.
+            {1, true, 1},
+            {3, false, 2}, // Evicts 2.
+            {1, true, 2},
+            {0, false, 3}, // Evicts 3.
+            {2, false, 4}, // Evicts 1.
+            {0, true, 4},
+        };
+        for (const auto& step : kSteps) {
+            blobfs::BlobfsMetrics before = fs->GetMetrics();
+            ASSERT_TRUE(ReadBlobDirectly(fs.get(), info[step.blob].get()));
+            blobfs::BlobfsMetrics after = fs->GetMetrics();
+            EXPECT_EQ(after.cache_hits - before.cache_hits, step.hit ? 1u : 0u);
+            EXPECT_EQ(after.cache_misses - before.cache_misses, step.hit ? 0u : 1u);
+            EXPECT_EQ(after.cache_evictions, step.evictions);
+        }
+    }
+    ASSERT_TRUE(blobfsTest->Mount());
+
+    for (size_t i = 0; i < kBlobCount; i++) {
+        ASSERT_EQ(unlink(info[i]->path), 0);
+    }
+    END_HELPER;
+}
+
 static bool TestReaddir(BlobfsTest* blobfsTest) {
     BEGIN_HELPER;
     constexpr size_t kMaxEntries = 50;
@@ -1264,6 +1376,66 @@ static bool CreateUmountRemountSmall(BlobfsTest* blobfsTest) {
     END_HELPER;
 }
 
+// Reads scattered pieces of a large blob before the rest of it, which
+// only loads and verifies the blocks (or chunks, for compressed blobs)
+// covering those pieces.
+static bool ReadPartially(BlobfsTest* blobfsTest, blob_info_t* info) {
+    BEGIN_HELPER;
+    fbl::unique_fd fd;
+    ASSERT_TRUE(MakeBlob(info, &fd));
+    ASSERT_EQ(close(fd.release()), 0);
+    ASSERT_TRUE(blobfsTest->Remount(), "Could not re-mount blobfs");
+
+    fd.reset(open(info->path, O_RDONLY));
+    ASSERT_TRUE(fd, "Failed to open blob");
+    const size_t kOffsets[] = {
+        info->size_data - 100,
+        0,
+        info->size_data / 2 - 1,
+        blobfs::kBlobfsBlockSize * 100 + 7,
+    };
+    char buf[blobfs::kBlobfsBlockSize * 2];
+    for (size_t off : kOffsets) {
+        size_t len = fbl::min(sizeof(buf), info->size_data - off);
+        ASSERT_EQ(pread(fd.get(), buf, len, off), static_cast<ssize_t>(len));
+        ASSERT_EQ(memcmp(buf, &info->data[off], len), 0, "Read data, but it was bad");
+    }
+
+    // Mapping the blob loads whatever has not been read yet.
+    void* addr = mmap(NULL, info->size_data, PROT_READ, MAP_PRIVATE, fd.get(), 0);
+    ASSERT_NE(addr, MAP_FAILED, "Could not mmap blob");
+    ASSERT_EQ(memcmp(addr, info->data.get(), info->size_data), 0, "Mmap data invalid");
+    ASSERT_EQ(munmap(addr, info->size_data), 0, "Could not unmap blob");
+    ASSERT_TRUE(VerifyContents(fd.get(), info->data.get(), info->size_data));
+    ASSERT_EQ(close(fd.release()), 0);
+    ASSERT_EQ(unlink(info->path), 0);
+    END_HELPER;
+}
+
+static bool TestPartialRead(BlobfsTest* blobfsTest) {
+    BEGIN_HELPER;
+    fbl::unique_ptr<blob_info_t> info;
+    ASSERT_TRUE(GenerateRandomBlob(1 << 22, &info));
+    ASSERT_TRUE(ReadPartially(blobfsTest, info.get()));
+    END_HELPER;
+}
+
+static bool TestPartialReadCompressible(BlobfsTest* blobfsTest) {
+    BEGIN_HELPER;
+    fbl::unique_ptr<blob_info_t> info;
+    ASSERT_TRUE(GenerateBlob([](char* data, size_t length) {
+        size_t i = 0;
+        while (i < length) {
+            size_t j = fbl::min<size_t>(rand() % 300 + 1, length - i);
+            memset(data, (char) rand(), j);
+            data += j;
+            i += j;
+        }
+    }, 1 << 22, &info));
+    ASSERT_TRUE(ReadPartially(blobfsTest, info.get()));
+    END_HELPER;
+}
+
 static bool check_not_readable(int fd) {
     BEGIN_HELPER;
     struct pollfd fds;
@@ -2210,6 +2382,63 @@ static bool CorruptAtMount(BlobfsTest* blobfsTest) {
     END_HELPER;
 }
 
+// Sets the version in the superblock of the unmounted filesystem, returning
+// the version it had before in |old_version|.
+static bool SetVersion(BlobfsTest* blobfsTest, uint32_t version, uint32_t* old_version) {
+    BEGIN_HELPER;
+    fbl::unique_fd fd(blobfsTest->GetFd());
+    ASSERT_TRUE(fd, "Could not open ramdisk");
+    char block[blobfs::kBlobfsBlockSize];
+    ASSERT_EQ(pread(fd.get(), block, sizeof(block), 0), sizeof(block));
+    blobfs::Superblock* info = reinterpret_cast<blobfs::Superblock*>(block);
+    *old_version = info->version;
+    info->version = version;
+    ASSERT_EQ(pwrite(fd.get(), block, sizeof(block), 0), sizeof(block));
+    END_HELPER;
+}
+
+// Images of the oldest supported version still mount, and blobs written to
+// them are not compressed in chunks, so that the image stays at that version.
+static bool TestOldVersion(BlobfsTest* blobfsTest) {
+    BEGIN_HELPER;
+    uint32_t version;
+    ASSERT_EQ(umount(MOUNT_PATH), ZX_OK);
+    ASSERT_TRUE(SetVersion(blobfsTest, blobfs::kBlobfsMinVersion - 1, &version));
+    ASSERT_EQ(version, blobfs::kBlobfsVersion);
+    fbl::unique_fd fd(blobfsTest->GetFd());
+    ASSERT_TRUE(fd, "Could not open ramdisk");
+    ASSERT_NE(mount(fd.release(), MOUNT_PATH, DISK_FORMAT_BLOBFS, &default_mount_options,
+                    launch_stdio_async), ZX_OK);
+
+    ASSERT_TRUE(SetVersion(blobfsTest, blobfs::kBlobfsMinVersion, &version));
+    ASSERT_TRUE(blobfsTest->ForceRemount());
+
+    fbl::unique_ptr<blob_info_t> blob;
+    ASSERT_TRUE(GenerateBlob([](char* data, size_t length) {
+        memset(data, 'a', length);
+    }, 1 << 20, &blob));
+    ASSERT_TRUE(MakeBlob(blob.get(), &fd));
+    ASSERT_EQ(close(fd.release()), 0);
+
+    ASSERT_TRUE(blobfsTest->Remount());
+    fd.reset(open(blob->path, O_RDONLY));
+    ASSERT_TRUE(fd, "Failed to-reopen blob");
+    ASSERT_TRUE(VerifyContents(fd.get(), blob->data.get(), blob->size_data));
+    ASSERT_EQ(close(fd.release()), 0);
+
+    ASSERT_EQ(umount(MOUNT_PATH), ZX_OK);
+    ASSERT_TRUE(SetVersion(blobfsTest, blobfs::kBlobfsMinVersion, &version));
+    ASSERT_EQ(version, blobfs::kBlobfsMinVersion);
+    ASSERT_TRUE(blobfsTest->ForceRemount());
+    ASSERT_EQ(unlink(blob->path), 0);
+
+    // Reset the ramdisk counts so we don't attempt to run ramdisk failure tests, which would
+    // fail the direct superblock writes rather than blobfs.
+    ASSERT_TRUE(blobfsTest->ToggleSleep());
+    ASSERT_TRUE(blobfsTest->ToggleSleep());
+    END_HELPER;
+}
+
 typedef struct reopen_data {
     char path[PATH_MAX];
     fbl::atomic_bool complete;
@@ -2306,12 +2535,81 @@ static bool TestCompressorBufferTooSmall(void) {
     END_TEST;
 }
 
+// Ensure each chunk written by ChunkedCompressor can be decompressed on its own.
+static bool TestChunkedCompressor(void) {
+    BEGIN_TEST;
+    blobfs::ChunkedCompressor c;
+    const size_t data_size = blobfs::kBlobfsChunkSize * 3 + 100;
+    const size_t buf_size = c.BufferMax(data_size);
+    fbl::AllocChecker ac;
+    fbl::unique_ptr<char[]> buf(new (&ac) char[buf_size]);
+    ASSERT_TRUE(ac.check());
+    fbl::unique_ptr<char[]> data(new (&ac) char[data_size]);
+    ASSERT_TRUE(ac.check());
+    for (size_t i = 0; i < data_size; i++) {
+        data[i] = static_cast<char>(i / 100);
+    }
+
+    ASSERT_EQ(c.Initialize(buf.get(), buf_size, data_size), ZX_OK);
+    // Feed the compressor pieces which straddle the chunks.
+    size_t written = 0;
+    while (written < data_size) {
+        size_t len = fbl::min<size_t>(data_size - written, 50000);
+        ASSERT_EQ(c.Update(&data[written], len), ZX_OK);
+        written += len;
+    }
+    ASSERT_EQ(c.End(), ZX_OK);
+    ASSERT_LT(c.Size(), data_size);
+    ASSERT_EQ(blobfs::ChunkedDecompressor::ValidateTable(buf.get(), data_size, c.Size()), ZX_OK);
+
+    fbl::unique_ptr<char[]> chunk(new (&ac) char[blobfs::kBlobfsChunkSize]);
+    ASSERT_TRUE(ac.check());
+    for (uint64_t i = 3; i != UINT64_MAX; i--) {
+        size_t offset = i * blobfs::kBlobfsChunkSize;
+        size_t len = fbl::min<size_t>(blobfs::kBlobfsChunkSize, data_size - offset);
+        ASSERT_EQ(blobfs::ChunkedDecompressor::DecompressChunk(chunk.get(), len, buf.get(), i),
+                  ZX_OK);
+        ASSERT_EQ(memcmp(chunk.get(), &data[offset], len), 0);
+    }
+
+    // Compressed data which is shorter than the table claims is rejected.
+    ASSERT_EQ(blobfs::ChunkedDecompressor::ValidateTable(buf.get(), data_size,
+                                                         c.Size() - 1),
+              ZX_ERR_IO_DATA_INTEGRITY);
+    END_TEST;
+}
+
+// Ensure WorkerPool calls the function once for every index, and reports failures.
+static bool TestWorkerPool(void) {
+    BEGIN_TEST;
+    fbl::unique_ptr<blobfs::WorkerPool> pool;
+    ASSERT_EQ(blobfs::WorkerPool::Create(3, &pool), ZX_OK);
+
+    constexpr size_t kCount = 1000;
+    fbl::atomic<uint32_t> calls[kCount] = {};
+    ASSERT_EQ(pool->Run(kCount, [&calls](size_t index) {
+        calls[index].fetch_add(1);
+        return ZX_OK;
+    }), ZX_OK);
+    for (size_t i = 0; i < kCount; i++) {
+        ASSERT_EQ(calls[i].load(), 1);
+    }
+
+    ASSERT_EQ(pool->Run(0, [](size_t index) { return ZX_ERR_INTERNAL; }), ZX_OK);
+    ASSERT_EQ(pool->Run(kCount, [](size_t index) {
+        return index == kCount / 2 ? ZX_ERR_IO_DATA_INTEGRITY : ZX_OK;
+    }), ZX_ERR_IO_DATA_INTEGRITY);
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(blobfs_tests)
 RUN_TESTS(MEDIUM, TestBasic)
 RUN_TESTS(MEDIUM, TestNullBlob)
 RUN_TESTS(MEDIUM, TestCompressibleBlob)
 RUN_TESTS(MEDIUM, TestMmap)
 RUN_TESTS(MEDIUM, TestMmapUseAfterClose)
+RUN_TESTS(MEDIUM, TestReopenClosedBlobs)
+RUN_TESTS(MEDIUM, TestCacheEviction)
 RUN_TESTS(MEDIUM, TestReaddir)
 RUN_TESTS(MEDIUM, TestDiskTooSmall)
 RUN_TEST_FVM(MEDIUM, TestQueryInfo)
@@ -2327,6 +2625,8 @@ RUN_TESTS(MEDIUM, UmountWithOpenFile)
 RUN_TESTS(MEDIUM, UmountWithMappedFile)
 RUN_TESTS(MEDIUM, UmountWithOpenMappedFile)
 RUN_TESTS(MEDIUM, CreateUmountRemountSmall)
+RUN_TESTS(MEDIUM, TestPartialRead)
+RUN_TESTS(MEDIUM, TestPartialReadCompressible)
 RUN_TESTS(MEDIUM, EarlyRead)
 RUN_TESTS(MEDIUM, WaitForRead)
 RUN_TESTS(MEDIUM, WriteSeekIgnored)
@@ -2345,8 +2645,11 @@ RUN_TESTS(MEDIUM, QueryDevicePath)
 RUN_TESTS(MEDIUM, TestReadOnly)
 RUN_TEST_FVM(MEDIUM, ResizePartition)
 RUN_TEST_FVM(MEDIUM, CorruptAtMount)
+RUN_TESTS(MEDIUM, TestOldVersion)
 RUN_TESTS(LARGE, CreateWriteReopen)
 RUN_TEST(TestCompressorBufferTooSmall);
+RUN_TEST(TestChunkedCompressor);
+RUN_TEST(TestWorkerPool);
 END_TEST_CASE(blobfs_tests)
 
 static void print_test_help(FILE* f) {
@@ -32,8 +32,31 @@ static bool clock_monotonic_test(void) {
     END_TEST;
 }
 
+// The vDSO reads the monotonic clock without entering the kernel when it
+// can.  The times it returns must agree with the kernel's clock, which
+// decides when a sleep is over.
+static bool clock_agrees_with_kernel_test(void) {
+    BEGIN_TEST;
+
+    for (int idx = 0; idx < 100; ++idx) {
+        zx_time_t deadline = zx_time_add_duration(zx_clock_get_monotonic(), 1000u);
+        ASSERT_EQ(zx_nanosleep(deadline), ZX_OK, "");
+
+        ASSERT_GE(zx_clock_get_monotonic(), deadline,
+                  "zx_clock_get_monotonic should not lag the kernel's clock");
+        ASSERT_GE(zx_clock_get(ZX_CLOCK_MONOTONIC), deadline,
+                  "zx_clock_get should not lag the kernel's clock");
+        zx_time_t current;
+        ASSERT_EQ(zx_clock_get_new(ZX_CLOCK_MONOTONIC, &current), ZX_OK, "");
+        ASSERT_GE(current, deadline, "zx_clock_get_new should not lag the kernel's clock");
+    }
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(clock_tests)
 RUN_TEST(clock_monotonic_test)
+RUN_TEST(clock_agrees_with_kernel_test)
 END_TEST_CASE(clock_tests)
 
 #ifndef BUILD_COMBINED_TESTS
@@ -12,6 +12,7 @@
 #include <time.h>
 #include <unistd.h>
 #include <unittest/unittest.h>
+#include <zircon/process.h>
 #include <zircon/syscalls.h>
 #include <zircon/threads.h>
 #include <zircon/time.h>
@@ -82,10 +83,14 @@ static bool wait_until_blocked_on_some_futex(zx_handle_t thread) {
 // operations and then test whether or not this thread has been woken up.
 class TestThread {
 public:
+    // If |pi_owner| is valid, the thread waits with zx_futex_wait_pi()
+    // naming it as the owner of the futex.
     TestThread(volatile int32_t* futex_addr,
-               zx_duration_t timeout_in_us = ZX_TIME_INFINITE)
+               zx_duration_t timeout_in_us = ZX_TIME_INFINITE,
+               zx_handle_t pi_owner = ZX_HANDLE_INVALID)
         : futex_addr_(futex_addr),
-          timeout_in_ns_(timeout_in_us) {
+          timeout_in_ns_(timeout_in_us),
+          pi_owner_(pi_owner) {
         auto ret = thrd_create_with_name(&thread_, wakeup_test_thread, this, "wakeup_test_thread");
         EXPECT_EQ(ret, thrd_success, "Error during thread creation");
         while (state_ == STATE_STARTED) {
@@ -161,8 +166,14 @@ private:
         thread->state_ = STATE_ABOUT_TO_WAIT;
         zx_time_t deadline = thread->timeout_in_ns_ == ZX_TIME_INFINITE ? ZX_TIME_INFINITE :
                 zx_deadline_after(thread->timeout_in_ns_);
-        zx_status_t rc = zx_futex_wait(const_cast<int32_t*>(thread->futex_addr_),
-                                       *thread->futex_addr_, deadline);
+        zx_status_t rc;
+        if (thread->pi_owner_ != ZX_HANDLE_INVALID) {
+            rc = zx_futex_wait_pi(const_cast<int32_t*>(thread->futex_addr_),
+                                  *thread->futex_addr_, thread->pi_owner_, deadline);
+        } else {
+            rc = zx_futex_wait(const_cast<int32_t*>(thread->futex_addr_),
+                               *thread->futex_addr_, deadline);
+        }
         if (thread->timeout_in_ns_ == ZX_TIME_INFINITE) {
             EXPECT_EQ(rc, ZX_OK, "Error while wait");
         } else {
@@ -175,6 +186,7 @@ private:
     thrd_t thread_;
     volatile int32_t* futex_addr_;
     zx_duration_t timeout_in_ns_;
+    zx_handle_t pi_owner_;
     zx_handle_t handle_ = ZX_HANDLE_INVALID;
     volatile enum {
         STATE_STARTED = 100,
@@ -539,6 +551,108 @@ static bool test_event_signaling() {
     END_TEST;
 }
 
+bool test_futex_wait_pi_bad_owner() {
+    BEGIN_TEST;
+    int32_t futex_value = 1;
+    zx_handle_t event;
+    ASSERT_EQ(zx_event_create(0, &event), ZX_OK);
+    EXPECT_EQ(zx_futex_wait_pi(&futex_value, futex_value, event, 0), ZX_ERR_WRONG_TYPE,
+              "owner must be a thread");
+    EXPECT_EQ(zx_handle_close(event), ZX_OK);
+    EXPECT_EQ(zx_futex_wait_pi(&futex_value, futex_value, event, 0), ZX_ERR_BAD_HANDLE,
+              "owner must be a valid handle");
+    EXPECT_EQ(zx_futex_wait_pi(&futex_value, futex_value, zx_thread_self(), 0),
+              ZX_ERR_INVALID_ARGS, "a thread cannot own a futex it waits on");
+    EXPECT_EQ(zx_futex_wait_pi(&futex_value, futex_value + 1, ZX_HANDLE_INVALID, 0),
+              ZX_ERR_BAD_STATE, "value mismatch should be checked");
+    EXPECT_EQ(zx_futex_wait_pi(&futex_value, futex_value, ZX_HANDLE_INVALID, 0),
+              ZX_ERR_TIMED_OUT, "ownerless wait should time out");
+    END_TEST;
+}
+
+// Test that futex_wake_pi() hands the futex to exactly one waiter.
+bool test_futex_wake_pi() {
+    BEGIN_TEST;
+    volatile int32_t futex_value = 1;
+    TestThread thread1(&futex_value, ZX_TIME_INFINITE, zx_thread_self());
+    TestThread thread2(&futex_value, ZX_TIME_INFINITE, zx_thread_self());
+
+    ASSERT_EQ(zx_futex_wake_pi(const_cast<int32_t*>(&futex_value)), ZX_OK);
+    thread1.assert_thread_woken();
+    thread2.assert_thread_not_woken();
+
+    ASSERT_EQ(zx_futex_wake_pi(const_cast<int32_t*>(&futex_value)), ZX_OK);
+    thread2.assert_thread_woken();
+
+    // Waking a futex without waiters is not an error.
+    EXPECT_EQ(zx_futex_wake_pi(const_cast<int32_t*>(&futex_value)), ZX_OK);
+    END_TEST;
+}
+
+// Test that plain futex operations still work on a futex that has an owner.
+bool test_futex_wake_pi_waiters() {
+    BEGIN_TEST;
+    volatile int32_t futex_value = 1;
+    TestThread thread1(&futex_value, ZX_TIME_INFINITE, zx_thread_self());
+    TestThread thread2(&futex_value, ZX_MSEC(200), zx_thread_self());
+    TestThread thread3(&futex_value, ZX_TIME_INFINITE, zx_thread_self());
+    ASSERT_TRUE(thread2.wait_for_timeout());
+
+    check_futex_wake(&futex_value, INT_MAX);
+    thread1.assert_thread_woken();
+    thread3.assert_thread_woken();
+    END_TEST;
+}
+
+// Test that futex_requeue_pi() moves waiters onto an owned futex.
+bool test_futex_requeue_pi() {
+    BEGIN_TEST;
+    volatile int32_t futex_value1 = 100;
+    volatile int32_t futex_value2 = 200;
+    TestThread thread1(&futex_value1);
+    TestThread thread2(&futex_value1);
+    TestThread thread3(&futex_value1);
+
+    zx_status_t rc = zx_futex_requeue_pi(
+        const_cast<int32_t*>(&futex_value1), 1, futex_value1,
+        const_cast<int32_t*>(&futex_value2), 2, zx_thread_self());
+    ASSERT_EQ(rc, ZX_OK, "Error in requeue");
+    thread1.assert_thread_woken();
+    thread2.assert_thread_not_woken();
+    thread3.assert_thread_not_woken();
+
+    ASSERT_EQ(zx_futex_wake_pi(const_cast<int32_t*>(&futex_value2)), ZX_OK);
+    thread2.assert_thread_woken();
+    thread3.assert_thread_not_woken();
+
+    ASSERT_EQ(zx_futex_wake_pi(const_cast<int32_t*>(&futex_value2)), ZX_OK);
+    thread3.assert_thread_woken();
+    END_TEST;
+}
+
+// Test that a thread can own several futexes at once, and that waiters
+// leaving one of them, by timing out or being killed, leave the owner with
+// the others.
+bool test_futex_pi_several_owned() {
+    BEGIN_TEST;
+    volatile int32_t futex_value1 = 1;
+    volatile int32_t futex_value2 = 2;
+    TestThread thread1(&futex_value1, ZX_TIME_INFINITE, zx_thread_self());
+    TestThread thread2(&futex_value2, ZX_MSEC(200), zx_thread_self());
+    TestThread thread3(&futex_value2, ZX_TIME_INFINITE, zx_thread_self());
+    ASSERT_TRUE(thread2.wait_for_timeout());
+    thread3.kill_thread();
+
+    // Nobody (other than perhaps the dying thread) waits on the second
+    // futex any more.
+    EXPECT_EQ(zx_futex_wake_pi(const_cast<int32_t*>(&futex_value2)), ZX_OK);
+    thread1.assert_thread_not_woken();
+
+    ASSERT_EQ(zx_futex_wake_pi(const_cast<int32_t*>(&futex_value1)), ZX_OK);
+    thread1.assert_thread_woken();
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(futex_tests)
 RUN_TEST(test_futex_wait_value_mismatch);
 RUN_TEST(test_futex_wait_timeout);
@@ -557,6 +671,11 @@ RUN_TEST(test_futex_requeue_unqueued_on_timeout);
 RUN_TEST(test_futex_thread_killed);
 RUN_TEST(test_futex_thread_suspended);
 RUN_TEST(test_futex_misaligned);
+RUN_TEST(test_futex_wait_pi_bad_owner);
+RUN_TEST(test_futex_wake_pi);
+RUN_TEST(test_futex_wake_pi_waiters);
+RUN_TEST(test_futex_requeue_pi);
+RUN_TEST(test_futex_pi_several_owned);
 RUN_TEST(test_event_signaling);
 END_TEST_CASE(futex_tests)
 
@@ -14,8 +14,10 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <fbl/algorithm.h>
+#include <fbl/unique_ptr.h>
 
 #define LOCAL_TRACE 0
 #define LTRACEF(str, x...)                                  \
@@ -947,6 +949,131 @@ bool handle_stats_control() {
     RUN_TEST((short_buffer_succeeds<topic, entry_type, get_handle>)); \
     RUN_TEST((partially_unmapped_buffer_fails<topic, entry_type, get_handle>))
 
+// Compares what identifies an entry; counts like committed_pages may change
+// between reads.
+bool same_entry(const zx_info_maps_t& a, const zx_info_maps_t& b) {
+    return strcmp(a.name, b.name) == 0 && a.base == b.base && a.size == b.size &&
+           a.depth == b.depth && a.type == b.type;
+}
+
+bool same_entry(const zx_info_vmo_t& a, const zx_info_vmo_t& b) {
+    return a.koid == b.koid && strcmp(a.name, b.name) == 0 &&
+           a.size_bytes == b.size_bytes && a.flags == b.flags;
+}
+
+// Reads every entry of |topic| with zx_object_get_info_paged(), |page|
+// entries at a time, and checks that they match what zx_object_get_info()
+// returns in one go. The paged walk goes through the handle table in the
+// opposite order, so only ZX_INFO_PROCESS_MAPS entries are compared in order.
+template <uint32_t topic, typename EntryType>
+bool paged_matches_unpaged(zx_handle_t handle, size_t page) {
+    BEGIN_HELPER;
+
+    constexpr size_t kMaxEntries = 256;
+    fbl::unique_ptr<EntryType[]> expected(new EntryType[kMaxEntries]);
+    fbl::unique_ptr<EntryType[]> paged(new EntryType[kMaxEntries]);
+    size_t expected_count, avail;
+    ASSERT_EQ(zx_object_get_info(handle, topic, expected.get(),
+                                 kMaxEntries * sizeof(EntryType),
+                                 &expected_count, &avail),
+              ZX_OK);
+    ASSERT_EQ(expected_count, avail);
+
+    size_t count = 0;
+    uint64_t cursor = 0;
+    do {
+        ASSERT_LE(count + page, kMaxEntries);
+        size_t actual;
+        ASSERT_EQ(zx_object_get_info_paged(handle, topic, cursor, paged.get() + count,
+                                           page * sizeof(EntryType), &actual, &cursor),
+                  ZX_OK);
+        ASSERT_LE(actual, page);
+        count += actual;
+    } while (cursor != 0);
+
+    ASSERT_EQ(count, expected_count);
+    if (topic == ZX_INFO_PROCESS_MAPS) {
+        for (size_t i = 0; i < count; i++) {
+            EXPECT_TRUE(same_entry(paged[i], expected[i]));
+        }
+    } else {
+        bool matched[kMaxEntries] = {};
+        for (size_t i = 0; i < count; i++) {
+            bool found = false;
+            for (size_t j = 0; j < count && !found; j++) {
+                if (!matched[j] && same_entry(paged[j], expected[i])) {
+                    matched[j] = found = true;
+                }
+            }
+            EXPECT_TRUE(found);
+        }
+    }
+
+    END_HELPER;
+}
+
+bool process_maps_paged() {
+    BEGIN_TEST;
+    zx_handle_t process = get_test_process();
+    ASSERT_NE(process, ZX_HANDLE_INVALID);
+    EXPECT_TRUE((paged_matches_unpaged<ZX_INFO_PROCESS_MAPS, zx_info_maps_t>(process, 1)));
+    EXPECT_TRUE((paged_matches_unpaged<ZX_INFO_PROCESS_MAPS, zx_info_maps_t>(process, 3)));
+    EXPECT_TRUE((paged_matches_unpaged<ZX_INFO_PROCESS_MAPS, zx_info_maps_t>(process, 256)));
+    END_TEST;
+}
+
+bool process_vmos_paged() {
+    BEGIN_TEST;
+    zx_handle_t process = get_test_process();
+    ASSERT_NE(process, ZX_HANDLE_INVALID);
+    EXPECT_TRUE((paged_matches_unpaged<ZX_INFO_PROCESS_VMOS, zx_info_vmo_t>(process, 1)));
+    EXPECT_TRUE((paged_matches_unpaged<ZX_INFO_PROCESS_VMOS, zx_info_vmo_t>(process, 3)));
+    EXPECT_TRUE((paged_matches_unpaged<ZX_INFO_PROCESS_VMOS, zx_info_vmo_t>(process, 256)));
+    END_TEST;
+}
+
+bool paged_self_succeeds() {
+    BEGIN_TEST;
+
+    // The paged calls don't touch the buffer with the process's locks held,
+    // so a process can look at itself.
+    zx_info_maps_t maps[4];
+    size_t actual;
+    uint64_t cursor;
+    EXPECT_EQ(zx_object_get_info_paged(zx_process_self(), ZX_INFO_PROCESS_MAPS, 0,
+                                       maps, sizeof(maps), &actual, &cursor),
+              ZX_OK);
+    EXPECT_GT(actual, 0u);
+    EXPECT_EQ(maps[0].type, ZX_INFO_MAPS_TYPE_ASPACE);
+
+    zx_info_vmo_t vmos[4];
+    EXPECT_EQ(zx_object_get_info_paged(zx_process_self(), ZX_INFO_PROCESS_VMOS, 0,
+                                       vmos, sizeof(vmos), &actual, &cursor),
+              ZX_OK);
+    EXPECT_GT(actual, 0u);
+
+    END_TEST;
+}
+
+bool paged_bad_args_fail() {
+    BEGIN_TEST;
+
+    zx_info_maps_t maps[4];
+    size_t actual;
+    uint64_t cursor;
+    EXPECT_EQ(zx_object_get_info_paged(zx_process_self(), ZX_INFO_PROCESS_MAPS, 0,
+                                       maps, 0, &actual, &cursor),
+              ZX_ERR_BUFFER_TOO_SMALL);
+    EXPECT_EQ(zx_object_get_info_paged(zx_process_self(), ZX_INFO_PROCESS_THREADS, 0,
+                                       maps, sizeof(maps), &actual, &cursor),
+              ZX_ERR_NOT_SUPPORTED);
+    EXPECT_EQ(zx_object_get_info_paged(get_test_job(), ZX_INFO_PROCESS_MAPS, 0,
+                                       maps, sizeof(maps), &actual, &cursor),
+              ZX_ERR_WRONG_TYPE);
+
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(object_info_tests)
 
 // ZX_INFO_HANDLE_VALID is an oddball that doesn't care about its buffer,
@@ -1040,6 +1167,11 @@ RUN_TEST(handle_count_valid);
 
 RUN_TEST(handle_stats_control);
 
+RUN_TEST(process_maps_paged);
+RUN_TEST(process_vmos_paged);
+RUN_TEST(paged_self_succeeds);
+RUN_TEST(paged_bad_args_fail);
+
 END_TEST_CASE(object_info_tests)
 
 #ifndef BUILD_COMBINED_TESTS
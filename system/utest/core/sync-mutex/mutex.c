@@ -0,0 +1,94 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <lib/sync/mutex.h>
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <unittest/unittest.h>
+#include <zircon/syscalls.h>
+#include <zircon/types.h>
+
+static sync_mutex_t mutex = SYNC_MUTEX_INIT;
+static int counter;
+
+#define ITERATIONS 1000
+#define NUM_THREADS 8
+
+static int sync_mutex_thread(void* arg) {
+    for (int iteration = 0; iteration < ITERATIONS; iteration++) {
+        sync_mutex_lock(&mutex);
+        int value = counter;
+        if (iteration % 16 == 0)
+            zx_nanosleep(zx_deadline_after(ZX_USEC(10)));
+        counter = value + 1;
+        sync_mutex_unlock(&mutex);
+    }
+    return 0;
+}
+
+static bool test_initializer(void) {
+    BEGIN_TEST;
+    // Let's not accidentally break .bss'd mutexes
+    static sync_mutex_t static_mutex;
+    sync_mutex_t mutex = SYNC_MUTEX_INIT;
+    int status = memcmp(&static_mutex, &mutex, sizeof(sync_mutex_t));
+    EXPECT_EQ(status, 0, "mutex's initializer is not all zeroes");
+    END_TEST;
+}
+
+static bool test_contention(void) {
+    BEGIN_TEST;
+    thrd_t threads[NUM_THREADS];
+    counter = 0;
+
+    for (int idx = 0; idx < NUM_THREADS; idx++)
+        thrd_create_with_name(threads + idx, sync_mutex_thread, NULL, "sync mutex");
+    for (int idx = 0; idx < NUM_THREADS; idx++)
+        thrd_join(threads[idx], NULL);
+
+    EXPECT_EQ(counter, NUM_THREADS * ITERATIONS, "mutex did not exclude");
+    END_TEST;
+}
+
+static bool test_trylock(void) {
+    BEGIN_TEST;
+    sync_mutex_t mutex = SYNC_MUTEX_INIT;
+    EXPECT_EQ(sync_mutex_trylock(&mutex), ZX_OK, "trylock of free mutex failed");
+    EXPECT_EQ(sync_mutex_trylock(&mutex), ZX_ERR_BAD_STATE, "trylock of held mutex succeeded");
+    sync_mutex_unlock(&mutex);
+    EXPECT_EQ(sync_mutex_trylock(&mutex), ZX_OK, "trylock after unlock failed");
+    sync_mutex_unlock(&mutex);
+    END_TEST;
+}
+
+static int sync_mutex_timedlock_thread(void* arg) {
+    sync_mutex_t* mutex = arg;
+    return sync_mutex_timedlock(mutex, zx_deadline_after(ZX_MSEC(10)));
+}
+
+static bool test_timeout(void) {
+    BEGIN_TEST;
+    sync_mutex_t mutex = SYNC_MUTEX_INIT;
+    sync_mutex_lock(&mutex);
+
+    thrd_t thread;
+    int result;
+    thrd_create_with_name(&thread, sync_mutex_timedlock_thread, &mutex, "sync mutex timeout");
+    thrd_join(thread, &result);
+    EXPECT_EQ(result, ZX_ERR_TIMED_OUT, "timedlock of held mutex succeeded");
+
+    sync_mutex_unlock(&mutex);
+    END_TEST;
+}
+
+BEGIN_TEST_CASE(sync_mutex_tests)
+RUN_TEST(test_initializer)
+RUN_TEST(test_contention)
+RUN_TEST(test_trylock)
+RUN_TEST(test_timeout)
+END_TEST_CASE(sync_mutex_tests)
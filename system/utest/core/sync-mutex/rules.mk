@@ -0,0 +1,22 @@
+# Copyright 2018 The Fuchsia Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+MODULE := $(LOCAL_DIR)
+
+MODULE_TYPE := usertest
+
+MODULE_USERTEST_GROUP := core
+
+MODULE_SRCS += \
+    $(LOCAL_DIR)/main.c \
+    $(LOCAL_DIR)/mutex.c \
+
+MODULE_NAME := sync-mutex-test
+
+MODULE_STATIC_LIBS := system/ulib/sync
+MODULE_LIBS := system/ulib/unittest system/ulib/fdio system/ulib/zircon system/ulib/c
+
+include make/module.mk
@@ -2,8 +2,12 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <inttypes.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <threads.h>
 #include <time.h>
 
 #include <zircon/syscalls.h>
@@ -42,8 +46,79 @@ bool cprng_test_add_entropy_buf_too_large(void) {
     END_TEST;
 }
 
+#define DRAW_THREADS_MAX 32
+#define DRAWS_PER_THREAD 4096
+
+typedef struct draw_thread_arg {
+    atomic_int* start;
+    int num_zeros;
+} draw_thread_arg_t;
+
+static int draw_thread(void* arg) {
+    draw_thread_arg_t* thread_arg = arg;
+    uint8_t buf[ZX_CPRNG_DRAW_MAX_LEN];
+
+    while (atomic_load(thread_arg->start) == 0) {
+        zx_nanosleep(zx_deadline_after(ZX_USEC(100)));
+    }
+
+    for (int i = 0; i < DRAWS_PER_THREAD; ++i) {
+        memset(buf, 0, sizeof(buf));
+        zx_cprng_draw(buf, sizeof(buf));
+    }
+
+    // Sanity check the final draw the same way cprng_test_draw_success does.
+    for (unsigned int i = 0; i < sizeof(buf); ++i) {
+        if (buf[i] == 0) {
+            thread_arg->num_zeros++;
+        }
+    }
+    return 0;
+}
+
+// Draws from every CPU concurrently and reports the aggregate throughput.
+// Draws on different CPUs are served by separate kernel PRNG instances, so
+// this should scale with the number of CPUs rather than serializing.
+bool cprng_test_draw_multithreaded(void) {
+    BEGIN_TEST;
+
+    uint32_t num_threads = zx_system_get_num_cpus();
+    if (num_threads > DRAW_THREADS_MAX) {
+        num_threads = DRAW_THREADS_MAX;
+    }
+
+    atomic_int start = 0;
+    thrd_t threads[DRAW_THREADS_MAX];
+    draw_thread_arg_t args[DRAW_THREADS_MAX];
+    for (uint32_t i = 0; i < num_threads; ++i) {
+        args[i].start = &start;
+        args[i].num_zeros = 0;
+        ASSERT_EQ(thrd_create(&threads[i], draw_thread, &args[i]), thrd_success, "");
+    }
+
+    zx_time_t begin = zx_clock_get_monotonic();
+    atomic_store(&start, 1);
+    for (uint32_t i = 0; i < num_threads; ++i) {
+        ASSERT_EQ(thrd_join(threads[i], NULL), thrd_success, "");
+    }
+    zx_duration_t elapsed = zx_clock_get_monotonic() - begin;
+
+    for (uint32_t i = 0; i < num_threads; ++i) {
+        EXPECT_LE(args[i].num_zeros, 16, "buffer wasn't written to");
+    }
+
+    uint64_t total = (uint64_t)num_threads * DRAWS_PER_THREAD * ZX_CPRNG_DRAW_MAX_LEN;
+    if (elapsed > 0) {
+        unittest_printf("%u threads drew %" PRIu64 " bytes in %" PRId64 " ns (%" PRIu64
+                        " MB/s)\n", num_threads, total, elapsed,
+                        total * ZX_SEC(1) / (uint64_t)elapsed / (1024 * 1024));
+    }
+    END_TEST;
+}
+
 BEGIN_TEST_CASE(cprng_tests)
 RUN_TEST(cprng_test_draw_success)
+RUN_TEST(cprng_test_draw_multithreaded)
 RUN_TEST(cprng_test_add_entropy_buf_too_large)
 RUN_TEST(cprng_test_add_entropy_bad_buf)
 END_TEST_CASE(cprng_tests)
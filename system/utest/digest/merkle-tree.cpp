@@ -626,6 +626,25 @@ bool VerifyBadLeaves(void) {
     END_TEST;
 }
 
+bool VerifyBadLeafInEveryNode(void) {
+    BEGIN_TEST_WITH_RC;
+    // Several nodes may be hashed at once; make sure a bad leaf is caught
+    // wherever it falls among them, including in the final partial node.
+    size_t tree_len = MerkleTree::GetTreeLength(kUnalignedLarge);
+    Digest digest;
+    ASSERT_OK(MerkleTree::Create(gData, kUnalignedLarge, gTree, tree_len, &digest));
+    for (size_t offset = 0; offset < kUnalignedLarge; offset += kNodeSize) {
+        gData[offset] ^= 1;
+        ASSERT_ERR(ZX_ERR_IO_DATA_INTEGRITY,
+                   MerkleTree::Verify(gData, kUnalignedLarge, gTree, tree_len, 0,
+                                      kUnalignedLarge, digest));
+        gData[offset] ^= 1;
+    }
+    ASSERT_OK(MerkleTree::Verify(gData, kUnalignedLarge, gTree, tree_len, 0,
+                                 kUnalignedLarge, digest));
+    END_TEST;
+}
+
 bool CreateAndVerifyHugePRNGData(void) {
     BEGIN_TEST_WITH_RC;
     Digest digest;
@@ -739,5 +758,6 @@ RUN_TEST(VerifyGoodPartOfBadTree)
 RUN_TEST(VerifyBadTree)
 RUN_TEST(VerifyGoodPartOfBadLeaves)
 RUN_TEST(VerifyBadLeaves)
+RUN_TEST(VerifyBadLeafInEveryNode)
 RUN_TEST(CreateAndVerifyHugePRNGData)
 END_TEST_CASE(MerkleTreeTests)
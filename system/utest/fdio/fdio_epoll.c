@@ -0,0 +1,188 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <errno.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/select.h>
+#include <unistd.h>
+
+#include <zircon/types.h>
+
+#include <unittest/unittest.h>
+
+bool epoll_level_triggered_test(void) {
+    BEGIN_TEST;
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    ASSERT_GE(epfd, 0, "epoll_create1 failed");
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0, "pipe failed");
+
+    struct epoll_event event = {.events = EPOLLIN, .data.u64 = 1234};
+    ASSERT_EQ(epoll_ctl(epfd, EPOLL_CTL_ADD, fds[0], &event), 0, "");
+    EXPECT_EQ(epoll_ctl(epfd, EPOLL_CTL_ADD, fds[0], &event), -1, "");
+    EXPECT_EQ(errno, EEXIST, "");
+
+    struct epoll_event events[4];
+    EXPECT_EQ(epoll_wait(epfd, events, 4, 0), 0, "pipe should not be readable yet");
+
+    ASSERT_EQ(write(fds[1], "x", 1), 1, "");
+    ASSERT_EQ(epoll_wait(epfd, events, 4, -1), 1, "");
+    EXPECT_EQ(events[0].events, (uint32_t)EPOLLIN, "");
+    EXPECT_EQ(events[0].data.u64, 1234u, "");
+
+    // Still readable, so reported again.
+    ASSERT_EQ(epoll_wait(epfd, events, 4, 0), 1, "");
+
+    char c;
+    ASSERT_EQ(read(fds[0], &c, 1), 1, "");
+    EXPECT_EQ(epoll_wait(epfd, events, 4, 0), 0, "pipe should have been drained");
+
+    ASSERT_EQ(epoll_ctl(epfd, EPOLL_CTL_DEL, fds[0], NULL), 0, "");
+    EXPECT_EQ(epoll_ctl(epfd, EPOLL_CTL_DEL, fds[0], NULL), -1, "");
+    EXPECT_EQ(errno, ENOENT, "");
+    ASSERT_EQ(write(fds[1], "x", 1), 1, "");
+    EXPECT_EQ(epoll_wait(epfd, events, 4, 0), 0, "removed fds are not reported");
+
+    close(fds[0]);
+    close(fds[1]);
+    close(epfd);
+
+    END_TEST;
+}
+
+bool epoll_edge_triggered_test(void) {
+    BEGIN_TEST;
+
+    int epfd = epoll_create1(0);
+    ASSERT_GE(epfd, 0, "epoll_create1 failed");
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0, "pipe failed");
+
+    struct epoll_event event = {.events = EPOLLIN | EPOLLET, .data.fd = fds[0]};
+    ASSERT_EQ(epoll_ctl(epfd, EPOLL_CTL_ADD, fds[0], &event), 0, "");
+
+    ASSERT_EQ(write(fds[1], "x", 1), 1, "");
+    struct epoll_event events[4];
+    ASSERT_EQ(epoll_wait(epfd, events, 4, -1), 1, "");
+    EXPECT_EQ(events[0].data.fd, fds[0], "");
+
+    // Only reported once until the pipe becomes readable again.
+    EXPECT_EQ(epoll_wait(epfd, events, 4, 0), 0, "");
+
+    char c;
+    ASSERT_EQ(read(fds[0], &c, 1), 1, "");
+    ASSERT_EQ(write(fds[1], "x", 1), 1, "");
+    EXPECT_EQ(epoll_wait(epfd, events, 4, -1), 1, "");
+
+    close(fds[0]);
+    close(fds[1]);
+    close(epfd);
+
+    END_TEST;
+}
+
+// Registers more pipes than zx_object_wait_many() can handle and checks
+// that only the ready ones are reported, across several calls.
+#define NUM_PIPES 64
+
+bool epoll_many_test(void) {
+    BEGIN_TEST;
+
+    int epfd = epoll_create1(0);
+    ASSERT_GE(epfd, 0, "epoll_create1 failed");
+    int fds[NUM_PIPES][2];
+    for (int i = 0; i < NUM_PIPES; i++) {
+        ASSERT_EQ(pipe(fds[i]), 0, "pipe failed");
+        struct epoll_event event = {.events = EPOLLIN, .data.u32 = i};
+        ASSERT_EQ(epoll_ctl(epfd, EPOLL_CTL_ADD, fds[i][0], &event), 0, "");
+    }
+
+    for (int i = 0; i < NUM_PIPES; i += 3) {
+        ASSERT_EQ(write(fds[i][1], "x", 1), 1, "");
+    }
+    const int expected = (NUM_PIPES + 2) / 3;
+
+    // Collect them a few at a time.
+    bool seen[NUM_PIPES] = {};
+    int total = 0;
+    while (total < expected) {
+        struct epoll_event events[5];
+        int n = epoll_wait(epfd, events, 5, -1);
+        ASSERT_GT(n, 0, "");
+        for (int j = 0; j < n; j++) {
+            uint32_t i = events[j].data.u32;
+            ASSERT_LT(i, (uint32_t)NUM_PIPES, "");
+            EXPECT_EQ(i % 3, 0u, "pipe without data reported");
+            char c;
+            ASSERT_EQ(read(fds[i][0], &c, 1), 1, "");
+            if (!seen[i]) {
+                seen[i] = true;
+                total++;
+            }
+        }
+    }
+
+    struct epoll_event event;
+    EXPECT_EQ(epoll_wait(epfd, &event, 1, 0), 0, "");
+
+    for (int i = 0; i < NUM_PIPES; i++) {
+        close(fds[i][0]);
+        close(fds[i][1]);
+    }
+    close(epfd);
+
+    END_TEST;
+}
+
+bool poll_many_test(void) {
+    BEGIN_TEST;
+
+    int fds[NUM_PIPES][2];
+    struct pollfd pfds[NUM_PIPES];
+    for (int i = 0; i < NUM_PIPES; i++) {
+        ASSERT_EQ(pipe(fds[i]), 0, "pipe failed");
+        pfds[i].fd = fds[i][0];
+        pfds[i].events = POLLIN;
+    }
+    EXPECT_EQ(poll(pfds, NUM_PIPES, 0), 0, "");
+
+    ASSERT_EQ(write(fds[NUM_PIPES - 1][1], "x", 1), 1, "");
+    ASSERT_EQ(write(fds[7][1], "x", 1), 1, "");
+    ASSERT_EQ(poll(pfds, NUM_PIPES, -1), 2, "");
+    for (int i = 0; i < NUM_PIPES; i++) {
+        bool ready = i == 7 || i == NUM_PIPES - 1;
+        EXPECT_EQ(pfds[i].revents, ready ? POLLIN : 0, "");
+    }
+
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    int max_fd = 0;
+    for (int i = 0; i < NUM_PIPES; i++) {
+        FD_SET(fds[i][0], &rfds);
+        if (fds[i][0] > max_fd) {
+            max_fd = fds[i][0];
+        }
+    }
+    struct timeval tv = {};
+    ASSERT_EQ(select(max_fd + 1, &rfds, NULL, NULL, &tv), 2, "");
+    EXPECT_TRUE(FD_ISSET(fds[7][0], &rfds), "");
+    EXPECT_TRUE(FD_ISSET(fds[NUM_PIPES - 1][0], &rfds), "");
+    EXPECT_FALSE(FD_ISSET(fds[0][0], &rfds), "");
+
+    for (int i = 0; i < NUM_PIPES; i++) {
+        close(fds[i][0]);
+        close(fds[i][1]);
+    }
+
+    END_TEST;
+}
+
+BEGIN_TEST_CASE(fdio_epoll_test)
+RUN_TEST(epoll_level_triggered_test);
+RUN_TEST(epoll_edge_triggered_test);
+RUN_TEST(epoll_many_test);
+RUN_TEST(poll_many_test);
+END_TEST_CASE(fdio_epoll_test)
@@ -6,12 +6,15 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <threads.h>
+#include <unistd.h>
 
 #include <fbl/function.h>
 #include <fbl/string.h>
 #include <fbl/string_buffer.h>
 #include <fbl/string_printf.h>
 #include <fbl/unique_fd.h>
+#include <fbl/unique_ptr.h>
 #include <fs-management/mount.h>
 #include <fs-test-utils/fixture.h>
 #include <fs-test-utils/perftest.h>
@@ -29,6 +32,9 @@ using fs_test_utils::TestInfo;
 
 constexpr int kWriteReadCycles = 3;
 
+// The size of each operation of the sequential large file tests.
+constexpr ssize_t kLargeOpSize = 1 << 20;
+
 fbl::String GetBigFilePath(const Fixture& fixture) {
     fbl::String path = fbl::StringPrintf("%s/bigfile.txt", fixture.fs_path().c_str());
     return path;
@@ -40,12 +46,12 @@ bool WriteBigFile(ssize_t data_size, perftest::RepeatState* state, Fixture* fixt
     fbl::unique_fd fd(open(GetBigFilePath(*fixture).c_str(), O_CREAT | O_WRONLY));
     ASSERT_TRUE(fd);
     state->DeclareStep("write");
-    uint8_t data[data_size];
+    fbl::unique_ptr<uint8_t[]> data(new uint8_t[data_size]);
     uint8_t pattern = static_cast<uint8_t>(rand_r(fixture->mutable_seed()) % (1 << 8));
-    memset(data, pattern, data_size);
+    memset(data.get(), pattern, data_size);
 
     while (state->KeepRunning()) {
-        ASSERT_EQ(write(fd.get(), data, data_size), data_size);
+        ASSERT_EQ(write(fd.get(), data.get(), data_size), data_size);
     }
 
     END_HELPER;
@@ -58,10 +64,10 @@ bool ReadBigFile(ssize_t data_size, perftest::RepeatState* state, Fixture* fixtu
     uint8_t pattern = static_cast<uint8_t>(rand_r(fixture->mutable_seed()) % (1 << 8));
     ASSERT_TRUE(fd);
     state->DeclareStep("read");
-    uint8_t data[data_size];
+    fbl::unique_ptr<uint8_t[]> data(new uint8_t[data_size]);
 
     while (state->KeepRunning()) {
-        ASSERT_EQ(read(fd.get(), data, data_size), data_size);
+        ASSERT_EQ(read(fd.get(), data.get(), data_size), data_size);
         ASSERT_EQ(data[0], pattern);
     }
 
@@ -156,6 +162,143 @@ private:
     fbl::StringBuffer<fs_test_utils::kPathSize> path_;
 };
 
+// Visits |count| entries of a single directory, applying |op| to one entry
+// per step.  The entries are visited in a scattered order, so that no step
+// benefits from working next to the entry of the previous one; every op
+// visits them in the same order.
+bool LargeDirectoryWalk(const fbl::Function<int(const char*)>& op, uint32_t count,
+                        perftest::RepeatState* state, Fixture* fixture) {
+    BEGIN_HELPER;
+    // A prime, so that each entry is visited once for any count it does not divide.
+    constexpr uint32_t kStride = 7919;
+    uint32_t i = 0;
+    while (state->KeepRunning()) {
+        fbl::String path = fbl::StringPrintf("%s/entry-%08u", fixture->fs_path().c_str(),
+                                             (i * kStride) % count);
+        ASSERT_EQ(op(path.c_str()), 0, path.c_str());
+        ++i;
+    }
+    END_HELPER;
+}
+
+bool LargeDirectoryCreate(uint32_t count, perftest::RepeatState* state, Fixture* fixture) {
+    return LargeDirectoryWalk(
+        [](const char* path) {
+            int fd = open(path, O_CREAT | O_EXCL | O_RDWR, 0644);
+            return fd < 0 ? fd : close(fd);
+        },
+        count, state, fixture);
+}
+
+bool LargeDirectoryStat(uint32_t count, perftest::RepeatState* state, Fixture* fixture) {
+    return LargeDirectoryWalk(
+        [](const char* path) {
+            struct stat buff;
+            return stat(path, &buff);
+        },
+        count, state, fixture);
+}
+
+bool LargeDirectoryUnlink(uint32_t count, perftest::RepeatState* state, Fixture* fixture) {
+    return LargeDirectoryWalk(unlink, count, state, fixture);
+}
+
+// The size of the data written to each file of the small file tests.
+constexpr ssize_t kSmallFileSize = 4 * (1 << 10);
+
+// Creates a new file per step, named after |prefix|, and writes
+// |kSmallFileSize| bytes to it. When |sync| is set, the file is fsync'd before
+// it is closed, so that each step pays for committing its own metadata.
+bool SmallFileCreate(const char* prefix, bool sync, perftest::RepeatState* state,
+                     Fixture* fixture) {
+    BEGIN_HELPER;
+    fbl::unique_ptr<uint8_t[]> data(new uint8_t[kSmallFileSize]);
+    uint8_t pattern = static_cast<uint8_t>(rand_r(fixture->mutable_seed()) % (1 << 8));
+    memset(data.get(), pattern, kSmallFileSize);
+    state->DeclareStep(sync ? "create_write_fsync" : "create_write");
+
+    uint32_t i = 0;
+    while (state->KeepRunning()) {
+        fbl::String path = fbl::StringPrintf("%s/%s-%08u", fixture->fs_path().c_str(), prefix, i);
+        fbl::unique_fd fd(open(path.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644));
+        ASSERT_TRUE(fd, path.c_str());
+        ASSERT_EQ(write(fd.get(), data.get(), kSmallFileSize), kSmallFileSize);
+        if (sync) {
+            ASSERT_EQ(fsync(fd.get()), 0, path.c_str());
+        }
+        ++i;
+    }
+    END_HELPER;
+}
+
+// The number of clients, and the size and number of the operations each of
+// them issues per step, of the concurrent client tests.
+constexpr int kConcurrentClients = 4;
+constexpr int kConcurrentOpsPerStep = 16;
+constexpr ssize_t kConcurrentOpSize = 16 * (1 << 10);
+
+struct ConcurrentClient {
+    int fd;
+    uint8_t pattern;
+    bool ok;
+};
+
+// Writes |kConcurrentOpsPerStep| operations to the file of a client, and reads
+// them back.
+int ConcurrentClientStep(void* arg) {
+    ConcurrentClient* client = static_cast<ConcurrentClient*>(arg);
+    fbl::unique_ptr<uint8_t[]> data(new uint8_t[kConcurrentOpSize]);
+    client->ok = false;
+    memset(data.get(), client->pattern, kConcurrentOpSize);
+    for (int i = 0; i < kConcurrentOpsPerStep; i++) {
+        if (pwrite(client->fd, data.get(), kConcurrentOpSize, i * kConcurrentOpSize) !=
+            kConcurrentOpSize) {
+            return -1;
+        }
+    }
+    for (int i = 0; i < kConcurrentOpsPerStep; i++) {
+        memset(data.get(), 0, kConcurrentOpSize);
+        if (pread(client->fd, data.get(), kConcurrentOpSize, i * kConcurrentOpSize) !=
+                kConcurrentOpSize ||
+            data[0] != client->pattern || data[kConcurrentOpSize - 1] != client->pattern) {
+            return -1;
+        }
+    }
+    client->ok = true;
+    return 0;
+}
+
+// Runs |kConcurrentClients| clients at once, each on its own file, so that the
+// throughput reflects how many requests the filesystem serves in parallel.
+bool ConcurrentClients(perftest::RepeatState* state, Fixture* fixture) {
+    BEGIN_HELPER;
+    fbl::unique_fd fds[kConcurrentClients];
+    ConcurrentClient clients[kConcurrentClients];
+    for (int i = 0; i < kConcurrentClients; i++) {
+        fbl::String path = fbl::StringPrintf("%s/client-%d", fixture->fs_path().c_str(), i);
+        fds[i].reset(open(path.c_str(), O_CREAT | O_RDWR, 0644));
+        ASSERT_TRUE(fds[i], path.c_str());
+        clients[i].fd = fds[i].get();
+        clients[i].pattern = static_cast<uint8_t>(rand_r(fixture->mutable_seed()) % (1 << 8));
+    }
+    state->DeclareStep("write_read");
+
+    while (state->KeepRunning()) {
+        thrd_t threads[kConcurrentClients];
+        for (int i = 0; i < kConcurrentClients; i++) {
+            ASSERT_EQ(thrd_create(&threads[i], ConcurrentClientStep, &clients[i]),
+                      thrd_success);
+        }
+        for (int i = 0; i < kConcurrentClients; i++) {
+            ASSERT_EQ(thrd_join(threads[i], nullptr), thrd_success);
+        }
+        for (int i = 0; i < kConcurrentClients; i++) {
+            ASSERT_TRUE(clients[i].ok);
+        }
+    }
+    END_HELPER;
+}
+
 } // namespace
 
 bool RunBenchmark(int argc, char** argv) {
@@ -204,6 +347,36 @@ bool RunBenchmark(int argc, char** argv) {
         testcases.push_back(fbl::move(testcase));
     }
 
+    // Sequential large file tests, which mostly measure how well file data is laid out.
+    const int large_rw_test_sample_counts[] = {
+        32,
+        128,
+    };
+
+    for (int test_sample_count : large_rw_test_sample_counts) {
+        TestCaseInfo testcase;
+        testcase.sample_count = test_sample_count;
+        testcase.name = fbl::StringPrintf("%s/Bigfile/1Mbytes/%d-Ops",
+                                          disk_format_string_[f_opts.fs_type], test_sample_count);
+        testcase.teardown = false;
+
+        TestInfo write_test, read_test;
+        write_test.name = fbl::StringPrintf("%s/Write", testcase.name.c_str());
+        write_test.test_fn = [](perftest::RepeatState* state, Fixture* fixture) {
+            return WriteBigFile(kLargeOpSize, state, fixture);
+        };
+        write_test.required_disk_space = test_sample_count * kLargeOpSize;
+        testcase.tests.push_back(fbl::move(write_test));
+
+        read_test.name = fbl::StringPrintf("%s/Read", testcase.name.c_str());
+        read_test.test_fn = [](perftest::RepeatState* state, Fixture* fixture) {
+            return ReadBigFile(kLargeOpSize, state, fixture);
+        };
+        read_test.required_disk_space = test_sample_count * kLargeOpSize;
+        testcase.tests.push_back(fbl::move(read_test));
+        testcases.push_back(fbl::move(testcase));
+    }
+
     // Path walk tests.
     const int path_walk_sample_counts[] = {
         125,
@@ -238,6 +411,98 @@ bool RunBenchmark(int argc, char** argv) {
         testcases.push_back(fbl::move(testcase));
     }
 
+    // Large directory tests.
+    const int large_directory_sample_counts[] = {
+        1000,
+        4000,
+        16000,
+    };
+
+    for (int test_sample_count : large_directory_sample_counts) {
+        TestCaseInfo testcase;
+        testcase.name = fbl::StringPrintf("%s/LargeDirectory/%d-Entries",
+                                          disk_format_string_[f_opts.fs_type], test_sample_count);
+        testcase.sample_count = test_sample_count;
+        testcase.teardown = false;
+        uint32_t count = static_cast<uint32_t>(test_sample_count);
+
+        TestInfo create_test;
+        create_test.name = fbl::StringPrintf("%s/Create", testcase.name.c_str());
+        create_test.test_fn = [count](perftest::RepeatState* state, Fixture* fixture) {
+            return LargeDirectoryCreate(count, state, fixture);
+        };
+        testcase.tests.push_back(fbl::move(create_test));
+
+        TestInfo stat_test;
+        stat_test.name = fbl::StringPrintf("%s/Stat", testcase.name.c_str());
+        stat_test.test_fn = [count](perftest::RepeatState* state, Fixture* fixture) {
+            return LargeDirectoryStat(count, state, fixture);
+        };
+        testcase.tests.push_back(fbl::move(stat_test));
+
+        TestInfo unlink_test;
+        unlink_test.name = fbl::StringPrintf("%s/Unlink", testcase.name.c_str());
+        unlink_test.test_fn = [count](perftest::RepeatState* state, Fixture* fixture) {
+            return LargeDirectoryUnlink(count, state, fixture);
+        };
+        testcase.tests.push_back(fbl::move(unlink_test));
+        testcases.push_back(fbl::move(testcase));
+    }
+
+    // Small file tests, which mostly measure the metadata cost of each new file.
+    const int small_file_sample_counts[] = {
+        256,
+        1024,
+    };
+
+    for (int test_sample_count : small_file_sample_counts) {
+        TestCaseInfo testcase;
+        testcase.name = fbl::StringPrintf("%s/SmallFile/4Kbytes/%d-Files",
+                                          disk_format_string_[f_opts.fs_type], test_sample_count);
+        testcase.sample_count = test_sample_count;
+        testcase.teardown = false;
+
+        TestInfo create_test;
+        create_test.name = fbl::StringPrintf("%s/Create", testcase.name.c_str());
+        create_test.test_fn = [](perftest::RepeatState* state, Fixture* fixture) {
+            return SmallFileCreate("create", false, state, fixture);
+        };
+        create_test.required_disk_space = test_sample_count * kSmallFileSize;
+        testcase.tests.push_back(fbl::move(create_test));
+
+        TestInfo fsync_test;
+        fsync_test.name = fbl::StringPrintf("%s/CreateFsync", testcase.name.c_str());
+        fsync_test.test_fn = [](perftest::RepeatState* state, Fixture* fixture) {
+            return SmallFileCreate("fsync", true, state, fixture);
+        };
+        fsync_test.required_disk_space = 2 * test_sample_count * kSmallFileSize;
+        testcase.tests.push_back(fbl::move(fsync_test));
+        testcases.push_back(fbl::move(testcase));
+    }
+
+    // Concurrent client tests.
+    const int concurrent_sample_counts[] = {
+        16,
+        64,
+    };
+
+    for (int test_sample_count : concurrent_sample_counts) {
+        TestCaseInfo testcase;
+        testcase.name = fbl::StringPrintf("%s/Concurrent/%d-Clients/%d-Steps",
+                                          disk_format_string_[f_opts.fs_type],
+                                          kConcurrentClients, test_sample_count);
+        testcase.sample_count = test_sample_count;
+        testcase.teardown = false;
+
+        TestInfo rw_test;
+        rw_test.name = fbl::StringPrintf("%s/WriteRead", testcase.name.c_str());
+        rw_test.test_fn = ConcurrentClients;
+        rw_test.required_disk_space =
+            kConcurrentClients * kConcurrentOpsPerStep * kConcurrentOpSize;
+        testcase.tests.push_back(fbl::move(rw_test));
+        testcases.push_back(fbl::move(testcase));
+    }
+
     return fs_test_utils::RunTestCases(f_opts, p_opts, testcases);
 }
 } // namespace fs_bench
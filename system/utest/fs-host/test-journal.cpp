@@ -0,0 +1,333 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Tests for replaying the minfs metadata journal, using hand-written entries,
+// and for mounting volumes made before there was a journal.
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fbl/unique_fd.h>
+#include <fbl/unique_ptr.h>
+#include <lib/cksum.h>
+#include <minfs/bcache.h>
+#include <minfs/format.h>
+#include <minfs/fsck.h>
+#include <minfs/host.h>
+#include <minfs/journal.h>
+#include <minfs/minfs.h>
+#include <unittest/unittest.h>
+
+namespace {
+
+constexpr char kImagePath[] = "/tmp/zircon-fs-journal-test";
+constexpr uint32_t kImageBlocks = 8192;
+
+// Formats a fresh image, and opens it for the test to write journal entries
+// to directly.
+bool CreateImage(fbl::unique_ptr<minfs::Bcache>* out, minfs::Superblock* info) {
+    BEGIN_HELPER;
+    unlink(kImagePath);
+    fbl::unique_fd fd(open(kImagePath, O_RDWR | O_CREAT | O_EXCL, 0644));
+    ASSERT_TRUE(fd);
+    ASSERT_EQ(ftruncate(fd.get(), static_cast<off_t>(kImageBlocks) * minfs::kMinfsBlockSize), 0);
+    fbl::unique_ptr<minfs::Bcache> bc;
+    ASSERT_EQ(minfs::Bcache::Create(&bc, fbl::move(fd), kImageBlocks), ZX_OK);
+    ASSERT_EQ(minfs::Mkfs(fbl::move(bc)), ZX_OK);
+
+    fd.reset(open(kImagePath, O_RDWR));
+    ASSERT_TRUE(fd);
+    ASSERT_EQ(minfs::Bcache::Create(&bc, fbl::move(fd), kImageBlocks), ZX_OK);
+    uint8_t blk[minfs::kMinfsBlockSize];
+    ASSERT_EQ(bc->Readblk(0, blk), ZX_OK);
+    memcpy(info, blk, sizeof(*info));
+    ASSERT_GE(info->jnl_blocks, minfs::kJournalMinBlocks);
+    *out = fbl::move(bc);
+    END_HELPER;
+}
+
+// Returns the |n|th data block after the journal, which is free on a fresh
+// image.
+minfs::blk_t FreeBlock(const minfs::Superblock& info, uint32_t n) {
+    return info.dat_block + info.jnl_block + info.jnl_blocks + n;
+}
+
+// Writes an entry with sequence number |seq| at journal block |pos|, which
+// writes |count| blocks filled with |fill| to the blocks from |target| on.
+// If |checksum_ok| is false, the commit block does not match the entry.
+bool WriteEntry(minfs::Bcache* bc, const minfs::Superblock& info, minfs::blk_t pos,
+                uint64_t seq, minfs::blk_t target, uint32_t count, uint8_t fill,
+                bool checksum_ok = true) {
+    BEGIN_HELPER;
+    const minfs::blk_t start = info.dat_block + info.jnl_block;
+    uint8_t blk[minfs::kMinfsBlockSize];
+    memset(blk, 0, sizeof(blk));
+    auto header = reinterpret_cast<minfs::JournalHeader*>(blk);
+    header->magic = minfs::kJournalEntryMagic;
+    header->seq = seq;
+    header->count = count;
+    for (uint32_t i = 0; i < count; i++) {
+        header->blocks[i] = target + i;
+    }
+    uint32_t checksum = crc32(0, blk, sizeof(blk));
+    ASSERT_EQ(bc->Writeblk(start + pos, blk), ZX_OK);
+
+    memset(blk, fill, sizeof(blk));
+    for (uint32_t i = 0; i < count; i++) {
+        checksum = crc32(checksum, blk, sizeof(blk));
+        ASSERT_EQ(bc->Writeblk(start + pos + 1 + i, blk), ZX_OK);
+    }
+
+    memset(blk, 0, sizeof(blk));
+    auto commit = reinterpret_cast<minfs::JournalCommit*>(blk);
+    commit->magic = minfs::kJournalCommitMagic;
+    commit->seq = seq;
+    commit->checksum = checksum_ok ? checksum : ~checksum;
+    ASSERT_EQ(bc->Writeblk(start + pos + 1 + count, blk), ZX_OK);
+    END_HELPER;
+}
+
+// Points the JournalInfo at journal block |pos|, which holds entry |seq|.
+bool WriteInfo(minfs::Bcache* bc, const minfs::Superblock& info, minfs::blk_t pos,
+               uint64_t seq) {
+    BEGIN_HELPER;
+    uint8_t blk[minfs::kMinfsBlockSize];
+    memset(blk, 0, sizeof(blk));
+    auto jinfo = reinterpret_cast<minfs::JournalInfo*>(blk);
+    jinfo->magic = minfs::kJournalMagic;
+    jinfo->seq = seq;
+    jinfo->start = pos;
+    ASSERT_EQ(bc->Writeblk(info.dat_block + info.jnl_block, blk), ZX_OK);
+    END_HELPER;
+}
+
+// Checks that the |count| blocks from |bno| on are all filled with |fill|.
+bool CheckBlocks(minfs::Bcache* bc, minfs::blk_t bno, uint32_t count, uint8_t fill) {
+    BEGIN_HELPER;
+    uint8_t blk[minfs::kMinfsBlockSize];
+    uint8_t expected[minfs::kMinfsBlockSize];
+    memset(expected, fill, sizeof(expected));
+    for (uint32_t i = 0; i < count; i++) {
+        ASSERT_EQ(bc->Readblk(bno + i, blk), ZX_OK);
+        ASSERT_EQ(memcmp(blk, expected, sizeof(blk)), 0, "Unexpected block contents");
+    }
+    END_HELPER;
+}
+
+bool test_journal_replay_clean(void) {
+    BEGIN_TEST;
+    fbl::unique_ptr<minfs::Bcache> bc;
+    minfs::Superblock info;
+    ASSERT_TRUE(CreateImage(&bc, &info));
+
+    // A fresh journal replays nothing.
+    minfs::JournalPosition pos;
+    ASSERT_EQ(minfs::ReplayJournal(bc.get(), info, &pos), ZX_OK);
+    ASSERT_EQ(pos.block, 1u);
+    ASSERT_EQ(pos.seq, 1u);
+
+    // The last entry is written in place, and the next entry goes after it.
+    const minfs::blk_t target = FreeBlock(info, 0);
+    ASSERT_TRUE(WriteEntry(bc.get(), info, 1, 1, target, 3, 0xa1));
+    ASSERT_EQ(minfs::ReplayJournal(bc.get(), info, &pos), ZX_OK);
+    ASSERT_TRUE(CheckBlocks(bc.get(), target, 3, 0xa1));
+    ASSERT_EQ(pos.block, 1u + 3 + 2);
+    ASSERT_EQ(pos.seq, 2u);
+
+    // Once replayed, the entry is not replayed again.
+    uint8_t blk[minfs::kMinfsBlockSize];
+    memset(blk, 0, sizeof(blk));
+    ASSERT_EQ(bc->Writeblk(target, blk), ZX_OK);
+    ASSERT_EQ(minfs::ReplayJournal(bc.get(), info, &pos), ZX_OK);
+    ASSERT_TRUE(CheckBlocks(bc.get(), target, 1, 0));
+    ASSERT_EQ(pos.block, 1u + 3 + 2);
+    ASSERT_EQ(pos.seq, 2u);
+
+    unlink(kImagePath);
+    END_TEST;
+}
+
+bool test_journal_replay_torn(void) {
+    BEGIN_TEST;
+    fbl::unique_ptr<minfs::Bcache> bc;
+    minfs::Superblock info;
+    ASSERT_TRUE(CreateImage(&bc, &info));
+
+    // The entry after the first one does not match its checksum, so the
+    // first is the last whole entry, and the one replayed.
+    const minfs::blk_t first = FreeBlock(info, 0);
+    const minfs::blk_t second = FreeBlock(info, 10);
+    ASSERT_TRUE(WriteEntry(bc.get(), info, 1, 1, first, 2, 0xb1));
+    ASSERT_TRUE(WriteEntry(bc.get(), info, 1 + 2 + 2, 2, second, 2, 0xb2, false));
+    minfs::JournalPosition pos;
+    ASSERT_EQ(minfs::ReplayJournal(bc.get(), info, &pos), ZX_OK);
+    ASSERT_TRUE(CheckBlocks(bc.get(), first, 2, 0xb1));
+    ASSERT_TRUE(CheckBlocks(bc.get(), second, 2, 0));
+    ASSERT_EQ(pos.block, 1u + 2 + 2);
+    ASSERT_EQ(pos.seq, 2u);
+
+    // An entry whose commit block never made it to disk is not replayed
+    // either.
+    ASSERT_TRUE(CreateImage(&bc, &info));
+    ASSERT_TRUE(WriteEntry(bc.get(), info, 1, 1, first, 2, 0xb1));
+    uint8_t blk[minfs::kMinfsBlockSize];
+    memset(blk, 0, sizeof(blk));
+    ASSERT_EQ(bc->Writeblk(info.dat_block + info.jnl_block + 1 + 2 + 1, blk), ZX_OK);
+    ASSERT_EQ(minfs::ReplayJournal(bc.get(), info, &pos), ZX_OK);
+    ASSERT_TRUE(CheckBlocks(bc.get(), first, 2, 0));
+    ASSERT_EQ(pos.block, 1u);
+    ASSERT_EQ(pos.seq, 1u);
+
+    unlink(kImagePath);
+    END_TEST;
+}
+
+bool test_journal_replay_wraparound(void) {
+    BEGIN_TEST;
+    fbl::unique_ptr<minfs::Bcache> bc;
+    minfs::Superblock info;
+    ASSERT_TRUE(CreateImage(&bc, &info));
+
+    // Entry 8 was the last to fit at the end of the ring.  Entry 9 did not
+    // fit after it, so it was written at the start of the ring, and the
+    // JournalInfo was pointed at it.  Behind it are stale entries from the
+    // previous pass around the ring, which must not be replayed.
+    const minfs::blk_t end_target = FreeBlock(info, 0);
+    const minfs::blk_t wrapped_target = FreeBlock(info, 10);
+    const minfs::blk_t stale_target = FreeBlock(info, 20);
+    ASSERT_TRUE(WriteEntry(bc.get(), info, info.jnl_blocks - 3, 8, end_target, 1, 0xc8));
+    ASSERT_TRUE(WriteEntry(bc.get(), info, 1, 9, wrapped_target, 2, 0xc9));
+    ASSERT_TRUE(WriteEntry(bc.get(), info, 1 + 2 + 2, 3, stale_target, 1, 0xc3));
+    ASSERT_TRUE(WriteInfo(bc.get(), info, 1, 9));
+
+    minfs::JournalPosition pos;
+    ASSERT_EQ(minfs::ReplayJournal(bc.get(), info, &pos), ZX_OK);
+    ASSERT_TRUE(CheckBlocks(bc.get(), wrapped_target, 2, 0xc9));
+    ASSERT_TRUE(CheckBlocks(bc.get(), end_target, 1, 0));
+    ASSERT_TRUE(CheckBlocks(bc.get(), stale_target, 1, 0));
+    ASSERT_EQ(pos.block, 1u + 2 + 2);
+    ASSERT_EQ(pos.seq, 10u);
+
+    // An entry which would run past the end of the ring is never whole.
+    // (Its commit block lands on the first block after the journal.)
+    ASSERT_TRUE(CreateImage(&bc, &info));
+    const minfs::blk_t overrun_target = FreeBlock(info, 30);
+    ASSERT_TRUE(WriteEntry(bc.get(), info, info.jnl_blocks - 3, 1, overrun_target, 2, 0xc1));
+    ASSERT_TRUE(WriteInfo(bc.get(), info, info.jnl_blocks - 3, 1));
+    ASSERT_EQ(minfs::ReplayJournal(bc.get(), info, &pos), ZX_OK);
+    ASSERT_TRUE(CheckBlocks(bc.get(), overrun_target, 2, 0));
+    ASSERT_EQ(pos.block, info.jnl_blocks - 3);
+    ASSERT_EQ(pos.seq, 1u);
+
+    unlink(kImagePath);
+    END_TEST;
+}
+
+bool test_journal_replay_after_fallback(void) {
+    BEGIN_TEST;
+    fbl::unique_ptr<minfs::Bcache> bc;
+    minfs::Superblock info;
+    ASSERT_TRUE(CreateImage(&bc, &info));
+
+    // A transaction too large for the journal is written in place, after the
+    // JournalInfo is moved past the last entry; the entry must then not be
+    // replayed over the blocks written in place.
+    const minfs::blk_t target = FreeBlock(info, 0);
+    ASSERT_TRUE(WriteEntry(bc.get(), info, 1, 1, target, 2, 0xd1));
+    ASSERT_TRUE(WriteInfo(bc.get(), info, 1 + 2 + 2, 2));
+    uint8_t blk[minfs::kMinfsBlockSize];
+    memset(blk, 0xdd, sizeof(blk));
+    ASSERT_EQ(bc->Writeblk(target, blk), ZX_OK);
+    ASSERT_EQ(bc->Writeblk(target + 1, blk), ZX_OK);
+
+    minfs::JournalPosition pos;
+    ASSERT_EQ(minfs::ReplayJournal(bc.get(), info, &pos), ZX_OK);
+    ASSERT_TRUE(CheckBlocks(bc.get(), target, 2, 0xdd));
+    ASSERT_EQ(pos.block, 1u + 2 + 2);
+    ASSERT_EQ(pos.seq, 2u);
+
+    unlink(kImagePath);
+    END_TEST;
+}
+
+// Turns a fresh image into one made by the mkfs of version 5, which reserved
+// no journal and zero-filled the rest of the superblock.
+bool DowngradeToVersion5(minfs::Bcache* bc, minfs::Superblock* info) {
+    BEGIN_HELPER;
+    uint8_t blk[minfs::kMinfsBlockSize];
+    ASSERT_EQ(bc->Readblk(info->abm_block, blk), ZX_OK);
+    for (minfs::blk_t bno = info->jnl_block; bno < info->jnl_block + info->jnl_blocks; bno++) {
+        blk[bno / 8] &= static_cast<uint8_t>(~(1 << (bno % 8)));
+    }
+    ASSERT_EQ(bc->Writeblk(info->abm_block, blk), ZX_OK);
+
+    info->version = 5;
+    info->alloc_block_count -= info->jnl_blocks;
+    info->jnl_block = 0;
+    info->jnl_blocks = 0;
+    memset(blk, 0, sizeof(blk));
+    memcpy(blk, info, sizeof(*info));
+    ASSERT_EQ(bc->Writeblk(0, blk), ZX_OK);
+    END_HELPER;
+}
+
+bool test_mount_version5(void) {
+    BEGIN_TEST;
+    fbl::unique_ptr<minfs::Bcache> bc;
+    minfs::Superblock info;
+    ASSERT_TRUE(CreateImage(&bc, &info));
+    ASSERT_TRUE(DowngradeToVersion5(bc.get(), &info));
+    bc.reset();
+
+    // The volume mounts without a journal, and new files on it are block
+    // mapped.
+    ASSERT_EQ(emu_mount(kImagePath), 0);
+    uint8_t data[3 * minfs::kMinfsBlockSize + 100];
+    memset(data, 0x5a, sizeof(data));
+    ASSERT_EQ(emu_mkdir("::dir", 0755), 0);
+    int fd = emu_open("::dir/file", O_RDWR | O_CREAT, 0644);
+    ASSERT_GT(fd, 0);
+    ASSERT_EQ(emu_write(fd, data, sizeof(data)), static_cast<ssize_t>(sizeof(data)));
+    uint8_t buf[sizeof(data)];
+    ASSERT_EQ(emu_pread(fd, buf, sizeof(buf), 0), static_cast<ssize_t>(sizeof(buf)));
+    ASSERT_EQ(memcmp(buf, data, sizeof(data)), 0);
+    ASSERT_EQ(emu_close(fd), 0);
+    struct stat s;
+    ASSERT_EQ(emu_stat("::dir/file", &s), 0);
+
+    fbl::unique_fd disk(open(kImagePath, O_RDWR));
+    ASSERT_TRUE(disk);
+    ASSERT_EQ(minfs::Bcache::Create(&bc, fbl::move(disk), kImageBlocks), ZX_OK);
+    uint8_t blk[minfs::kMinfsBlockSize];
+    ASSERT_EQ(bc->Readblk(0, blk), ZX_OK);
+    memcpy(&info, blk, sizeof(info));
+    ASSERT_EQ(info.version, 5u);
+    ASSERT_EQ(info.jnl_blocks, 0u);
+
+    ASSERT_EQ(bc->Readblk(info.ino_block + static_cast<minfs::blk_t>(s.st_ino) /
+                                               minfs::kMinfsInodesPerBlock, blk), ZX_OK);
+    auto inode = reinterpret_cast<minfs::Inode*>(blk) + s.st_ino % minfs::kMinfsInodesPerBlock;
+    ASSERT_EQ(inode->flags, 0u);
+    ASSERT_EQ(inode->extent_count, 0u);
+    ASSERT_NE(inode->dnum[0], 0u);
+    ASSERT_EQ(minfs::Fsck(fbl::move(bc)), ZX_OK);
+
+    unlink(kImagePath);
+    END_TEST;
+}
+
+}  // namespace
+
+BEGIN_TEST_CASE(minfs_journal_tests)
+RUN_TEST_MEDIUM(test_journal_replay_clean)
+RUN_TEST_MEDIUM(test_journal_replay_torn)
+RUN_TEST_MEDIUM(test_journal_replay_wraparound)
+RUN_TEST_MEDIUM(test_journal_replay_after_fallback)
+END_TEST_CASE(minfs_journal_tests)
+
+BEGIN_TEST_CASE(minfs_version_tests)
+RUN_TEST_MEDIUM(test_mount_version5)
+END_TEST_CASE(minfs_version_tests)
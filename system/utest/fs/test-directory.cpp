@@ -80,6 +80,52 @@ bool test_directory_large(void) {
     END_TEST;
 }
 
+// Large directories may be searched through an index rather than by reading
+// every entry; make sure names stay findable as entries come and go.
+bool test_directory_large_churn(void) {
+    BEGIN_TEST;
+
+    ASSERT_EQ(mkdir("::churn", 0755), 0);
+    const int num_files = 512;
+    char path[PATH_MAX + 1];
+    char other[PATH_MAX + 1];
+    for (int i = 0; i < num_files; i++) {
+        snprintf(path, sizeof(path), "::churn/%0*d", i % 64 + 1, i);
+        int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+        ASSERT_GT(fd, 0);
+        ASSERT_EQ(close(fd), 0);
+    }
+
+    // Punch holes in the directory, then fill some of them with new names.
+    for (int i = 0; i < num_files; i += 2) {
+        snprintf(path, sizeof(path), "::churn/%0*d", i % 64 + 1, i);
+        ASSERT_EQ(unlink(path), 0);
+    }
+    for (int i = 1; i < num_files; i += 4) {
+        snprintf(path, sizeof(path), "::churn/%0*d", i % 64 + 1, i);
+        snprintf(other, sizeof(other), "::churn/renamed-%d", i);
+        ASSERT_EQ(rename(path, other), 0);
+    }
+
+    struct stat s;
+    for (int i = 0; i < num_files; i++) {
+        snprintf(path, sizeof(path), "::churn/%0*d", i % 64 + 1, i);
+        snprintf(other, sizeof(other), "::churn/renamed-%d", i);
+        bool renamed = (i % 4 == 1);
+        bool exists = (i % 2 == 1) && !renamed;
+        ASSERT_EQ(stat(path, &s), exists ? 0 : -1, path);
+        ASSERT_EQ(stat(other, &s), renamed ? 0 : -1, other);
+        if (exists) {
+            ASSERT_EQ(unlink(path), 0);
+        } else if (renamed) {
+            ASSERT_EQ(unlink(other), 0);
+        }
+    }
+    ASSERT_EQ(rmdir("::churn"), 0);
+
+    END_TEST;
+}
+
 bool test_directory_max(void) {
     BEGIN_TEST;
 
@@ -463,6 +509,7 @@ RUN_FOR_ALL_FILESYSTEMS(directory_tests,
     RUN_TEST_MEDIUM(test_directory_coalesce_large_record)
     RUN_TEST_MEDIUM(test_directory_filename_max)
     RUN_TEST_LARGE(test_directory_large)
+    RUN_TEST_LARGE(test_directory_large_churn)
     RUN_TEST_MEDIUM(test_directory_trailing_slash)
     RUN_TEST_MEDIUM(test_directory_readdir)
     RUN_TEST_LARGE(test_directory_readdir_rm_all)
@@ -13,6 +13,7 @@
 
 #include <fbl/algorithm.h>
 #include <fbl/unique_fd.h>
+#include <fbl/unique_ptr.h>
 #include <fuchsia/io/c/fidl.h>
 #include <fuchsia/minfs/c/fidl.h>
 #include <fvm/fvm.h>
@@ -86,7 +87,9 @@ bool TestQueryInfo() {
     ExpectedQueryInfo expected_info = {};
     expected_info.total_bytes = kSliceSize;
     // TODO(ZX-1372): Adjust this once minfs accounting on truncate is fixed.
-    expected_info.used_bytes = 2 * minfs::kMinfsBlockSize;
+    // The null block, the root directory, and the journal are in use.
+    const uint32_t kDataBlocks = static_cast<uint32_t>(kSliceSize / minfs::kMinfsBlockSize);
+    expected_info.used_bytes = (2 + minfs::JournalBlocks(kDataBlocks)) * minfs::kMinfsBlockSize;
     // The inode table's implementation is currently a flat array on disk.
     expected_info.total_nodes = kSliceSize / sizeof(minfs::Inode);
     // The "zero-th" inode is reserved, as well as the root directory.
@@ -290,12 +293,15 @@ bool TestFullOperations() {
     ASSERT_TRUE(GetUsedBlocks(&free_blocks));
     ASSERT_EQ(free_blocks, 1);
 
-    // We should now have exactly 1 free block remaining. Attempt to write into the indirect
-    // section of the file so we ensure that at least 2 blocks are required.
+    // We should now have exactly 1 free block remaining. Attempt to write two blocks into the
+    // indirect section of the file so we ensure that at least 2 blocks are required, whether the
+    // file is mapped by extents or by block tables.
     // This is expected to fail.
+    char data2[2 * minfs::kMinfsBlockSize];
+    memset(data2, 0xaa, sizeof(data2));
     ASSERT_EQ(lseek(med_fd.get(), minfs::kMinfsBlockSize * minfs::kMinfsDirect, SEEK_SET),
               minfs::kMinfsBlockSize * minfs::kMinfsDirect);
-    ASSERT_LT(write(med_fd.get(), data, sizeof(data)), 0);
+    ASSERT_LT(write(med_fd.get(), data2, sizeof(data2)), 0);
 
     // Since the last operation failed, we should still have 1 free block remaining. Writing to the
     // beginning of the second file should only require 1 (direct) block, and therefore pass.
@@ -423,6 +429,104 @@ bool TestFullOperations() {
     END_TEST;
 }
 
+// Fill |data| with a pattern unique to block |n| of file |file|.
+void FillBlock(char* data, int file, uint32_t n) {
+    for (size_t i = 0; i < minfs::kMinfsBlockSize; i++) {
+        data[i] = static_cast<char>(file * 31 + n * 7 + i);
+    }
+}
+
+bool VerifyBlocks(int fd, int file, uint32_t count) {
+    BEGIN_HELPER;
+    char expected[minfs::kMinfsBlockSize];
+    char actual[minfs::kMinfsBlockSize];
+    for (uint32_t n = 0; n < count; n++) {
+        FillBlock(expected, file, n);
+        ASSERT_EQ(pread(fd, actual, sizeof(actual), n * minfs::kMinfsBlockSize), sizeof(actual));
+        ASSERT_EQ(memcmp(expected, actual, sizeof(actual)), 0);
+    }
+    END_HELPER;
+}
+
+// Test that files keep their contents as they are written in many separate pieces, and that
+// sequentially written files need no blocks beyond their data.
+bool TestFragmentedFiles() {
+    BEGIN_TEST;
+
+    fbl::unique_fd mnt_fd(open(kMountPath, O_RDONLY));
+    ASSERT_TRUE(mnt_fd);
+
+    // Appending to two files in turn interleaves their blocks on disk, so that each block of
+    // a file starts a new extent.
+    constexpr int kFiles = 2;
+    const char* paths[kFiles] = {"fragmented_a", "fragmented_b"};
+    const uint32_t kBlocks = minfs::kMinfsInlineExtents * 2 + minfs::kMinfsDirect;
+    fbl::unique_fd fds[kFiles];
+    for (int f = 0; f < kFiles; f++) {
+        fds[f].reset(openat(mnt_fd.get(), paths[f], O_CREAT | O_RDWR));
+        ASSERT_TRUE(fds[f]);
+    }
+    char data[minfs::kMinfsBlockSize];
+    for (uint32_t n = 0; n < kBlocks; n++) {
+        for (int f = 0; f < kFiles; f++) {
+            FillBlock(data, f, n);
+            ASSERT_EQ(write(fds[f].get(), data, sizeof(data)), sizeof(data));
+        }
+    }
+    for (int f = 0; f < kFiles; f++) {
+        ASSERT_TRUE(VerifyBlocks(fds[f].get(), f, kBlocks));
+    }
+
+    // A file written in one go fits in a single extent.
+    const uint32_t kContiguousBlocks = minfs::kMinfsDirect * 4;
+    fbl::unique_fd contiguous_fd(openat(mnt_fd.get(), "contiguous", O_CREAT | O_RDWR));
+    ASSERT_TRUE(contiguous_fd);
+    fbl::unique_ptr<char[]> contiguous(new char[kContiguousBlocks * minfs::kMinfsBlockSize]);
+    for (uint32_t n = 0; n < kContiguousBlocks; n++) {
+        FillBlock(&contiguous[n * minfs::kMinfsBlockSize], kFiles, n);
+    }
+    ASSERT_EQ(write(contiguous_fd.get(), contiguous.get(),
+                    kContiguousBlocks * minfs::kMinfsBlockSize),
+              kContiguousBlocks * minfs::kMinfsBlockSize);
+    uint64_t blocks;
+    ASSERT_TRUE(GetFileBlocks(contiguous_fd.get(), &blocks));
+    ASSERT_EQ(blocks, kContiguousBlocks);
+
+    for (int f = 0; f < kFiles; f++) {
+        fds[f].reset();
+    }
+    contiguous_fd.reset();
+    mnt_fd.reset();
+    ASSERT_TRUE(check_remount());
+
+    mnt_fd.reset(open(kMountPath, O_RDONLY));
+    ASSERT_TRUE(mnt_fd);
+    for (int f = 0; f < kFiles; f++) {
+        fds[f].reset(openat(mnt_fd.get(), paths[f], O_RDWR));
+        ASSERT_TRUE(fds[f]);
+        ASSERT_TRUE(VerifyBlocks(fds[f].get(), f, kBlocks));
+
+        // Shrink the files back to a few blocks, and grow them again.
+        ASSERT_EQ(ftruncate(fds[f].get(), 3 * minfs::kMinfsBlockSize), 0);
+        ASSERT_TRUE(VerifyBlocks(fds[f].get(), f, 3));
+        ASSERT_EQ(lseek(fds[f].get(), 0, SEEK_END), 3 * minfs::kMinfsBlockSize);
+        for (uint32_t n = 3; n < kBlocks; n++) {
+            FillBlock(data, f, n);
+            ASSERT_EQ(write(fds[f].get(), data, sizeof(data)), sizeof(data));
+        }
+        ASSERT_TRUE(VerifyBlocks(fds[f].get(), f, kBlocks));
+    }
+    contiguous_fd.reset(openat(mnt_fd.get(), "contiguous", O_RDONLY));
+    ASSERT_TRUE(contiguous_fd);
+    ASSERT_TRUE(VerifyBlocks(contiguous_fd.get(), kFiles, kContiguousBlocks));
+
+    for (int f = 0; f < kFiles; f++) {
+        ASSERT_EQ(unlinkat(mnt_fd.get(), paths[f], 0), 0);
+    }
+    ASSERT_EQ(unlinkat(mnt_fd.get(), "contiguous", 0), 0);
+    END_TEST;
+}
+
 }  // namespace
 
 #define RUN_MINFS_TESTS_NORMAL(name, CASE_TESTS) \
@@ -433,6 +537,7 @@ bool TestFullOperations() {
 
 RUN_MINFS_TESTS_NORMAL(FsMinfsTests,
     RUN_TEST_LARGE(TestFullOperations)
+    RUN_TEST_MEDIUM(TestFragmentedFiles)
 )
 
 RUN_MINFS_TESTS_FVM(FsMinfsFvmTests,
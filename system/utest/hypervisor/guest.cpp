@@ -59,6 +59,8 @@ extern const char vcpu_vmcall_start[];
 extern const char vcpu_vmcall_end[];
 extern const char guest_set_trap_start[];
 extern const char guest_set_trap_end[];
+extern const char guest_set_trap_coalesced_start[];
+extern const char guest_set_trap_coalesced_end[];
 extern const char guest_set_trap_with_io_start[];
 extern const char guest_set_trap_with_io_end[];
 
@@ -643,6 +645,42 @@ static bool guest_set_trap_with_bell() {
     END_TEST;
 }
 
+static bool guest_set_trap_with_bell_coalesced() {
+    BEGIN_TEST;
+
+    test_t test;
+    ASSERT_TRUE(setup(&test, guest_set_trap_coalesced_start, guest_set_trap_coalesced_end));
+    if (!test.supported) {
+        // The hypervisor isn't supported, so don't run the test.
+        return true;
+    }
+
+    zx::port port;
+    ASSERT_EQ(zx::port::create(0, &port), ZX_OK);
+
+    // Trap on access of TRAP_ADDR.
+    ASSERT_EQ(test.guest.set_trap(ZX_GUEST_TRAP_BELL_COALESCED, TRAP_ADDR, PAGE_SIZE, port,
+                                  kTrapKey),
+              ZX_OK);
+
+    // The guest rings the bell several times before exiting.
+    zx_port_packet_t packet = {};
+    ASSERT_EQ(test.vcpu.resume(&packet), ZX_OK);
+    EXPECT_EQ(packet.type, ZX_PKT_TYPE_GUEST_MEM);
+    EXPECT_EQ(packet.guest_mem.addr, EXIT_TEST_ADDR);
+
+    // Only one packet was queued.
+    ASSERT_EQ(port.wait(zx::time::infinite(), &packet), ZX_OK);
+    EXPECT_EQ(packet.key, kTrapKey);
+    EXPECT_EQ(packet.type, ZX_PKT_TYPE_GUEST_BELL);
+    EXPECT_EQ(packet.guest_bell.addr, TRAP_ADDR);
+    EXPECT_EQ(port.wait(zx::time::infinite_past(), &packet), ZX_ERR_TIMED_OUT);
+
+    ASSERT_TRUE(teardown(&test));
+
+    END_TEST;
+}
+
 static bool guest_set_trap_with_io() {
     BEGIN_TEST;
 
@@ -675,6 +713,7 @@ RUN_TEST(vcpu_read_write_state)
 RUN_TEST(vcpu_interrupt)
 RUN_TEST(guest_set_trap_with_mem)
 RUN_TEST(guest_set_trap_with_bell)
+RUN_TEST(guest_set_trap_with_bell_coalesced)
 #if __aarch64__
 RUN_TEST(vcpu_wfi)
 RUN_TEST(vcpu_wfi_aarch32)
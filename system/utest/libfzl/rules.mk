@@ -12,6 +12,7 @@ MODULE_SRCS += \
     $(LOCAL_DIR)/main.c \
     $(LOCAL_DIR)/fzl-test.cpp \
     $(LOCAL_DIR)/mapped-vmo.cpp \
+    $(LOCAL_DIR)/spsc-ring-tests.cpp \
     $(LOCAL_DIR)/vmo-pool-tests.cpp \
     $(LOCAL_DIR)/vmo-probe.cpp \
     $(LOCAL_DIR)/vmo-vmar-tests.cpp \
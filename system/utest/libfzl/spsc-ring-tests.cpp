@@ -0,0 +1,232 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <lib/fzl/spsc-ring.h>
+
+#include <threads.h>
+
+#include <fbl/algorithm.h>
+#include <lib/zx/eventpair.h>
+#include <lib/zx/vmo.h>
+#include <unittest/unittest.h>
+
+namespace {
+
+constexpr uint32_t kElemCount = 16;
+
+bool CreateRing(fzl::SpscRing* producer, fzl::SpscRing* consumer,
+                uint32_t elem_count = kElemCount) {
+    BEGIN_HELPER;
+    zx::vmo vmo, vmo_dup;
+    zx::eventpair producer_event, consumer_event;
+    ASSERT_EQ(fzl::SpscRing::Create(sizeof(uint64_t), elem_count, &vmo,
+                                    &producer_event, &consumer_event),
+              ZX_OK);
+    ASSERT_EQ(vmo.duplicate(ZX_RIGHT_SAME_RIGHTS, &vmo_dup), ZX_OK);
+    ASSERT_EQ(producer->Init(fzl::SpscRing::Role::kProducer, vmo, fbl::move(producer_event)),
+              ZX_OK);
+    ASSERT_EQ(consumer->Init(fzl::SpscRing::Role::kConsumer, vmo_dup, fbl::move(consumer_event)),
+              ZX_OK);
+    END_HELPER;
+}
+
+bool spsc_ring_bad_args_test() {
+    BEGIN_TEST;
+
+    zx::vmo vmo;
+    zx::eventpair producer_event, consumer_event;
+    EXPECT_EQ(fzl::SpscRing::Create(0, kElemCount, &vmo, &producer_event, &consumer_event),
+              ZX_ERR_INVALID_ARGS);
+    EXPECT_EQ(fzl::SpscRing::Create(8, 0, &vmo, &producer_event, &consumer_event),
+              ZX_ERR_INVALID_ARGS);
+    EXPECT_EQ(fzl::SpscRing::Create(8, 3, &vmo, &producer_event, &consumer_event),
+              ZX_ERR_INVALID_ARGS);
+
+    // A VMO that was not set up by Create() is rejected.
+    ASSERT_EQ(zx::vmo::create(ZX_PAGE_SIZE, 0, &vmo), ZX_OK);
+    ASSERT_EQ(zx::eventpair::create(0, &producer_event, &consumer_event), ZX_OK);
+    fzl::SpscRing ring;
+    EXPECT_EQ(ring.Init(fzl::SpscRing::Role::kProducer, vmo, fbl::move(producer_event)),
+              ZX_ERR_INVALID_ARGS);
+
+    // So is a resizable VMO, even with a valid ring in it.
+    zx::vmo ring_vmo, resizable_vmo;
+    ASSERT_EQ(fzl::SpscRing::Create(8, kElemCount, &ring_vmo, &producer_event, &consumer_event),
+              ZX_OK);
+    uint64_t size;
+    ASSERT_EQ(ring_vmo.get_size(&size), ZX_OK);
+    EXPECT_EQ(ring_vmo.set_size(size * 2), ZX_ERR_UNAVAILABLE);
+    ASSERT_EQ(zx::vmo::create(size, 0, &resizable_vmo), ZX_OK);
+    uint8_t buf[ZX_PAGE_SIZE];
+    ASSERT_EQ(ring_vmo.read(buf, 0, sizeof(buf)), ZX_OK);
+    ASSERT_EQ(resizable_vmo.write(buf, 0, sizeof(buf)), ZX_OK);
+    EXPECT_EQ(ring.Init(fzl::SpscRing::Role::kProducer, resizable_vmo,
+                        fbl::move(producer_event)),
+              ZX_ERR_NOT_SUPPORTED);
+
+    END_TEST;
+}
+
+bool spsc_ring_read_write_test() {
+    BEGIN_TEST;
+
+    fzl::SpscRing producer, consumer;
+    ASSERT_TRUE(CreateRing(&producer, &consumer));
+
+    // Each end may only be used in its own direction.
+    uint64_t elems[kElemCount + 1];
+    EXPECT_EQ(producer.Read(elems, 1, nullptr), ZX_ERR_BAD_STATE);
+    EXPECT_EQ(consumer.Write(elems, 1, nullptr), ZX_ERR_BAD_STATE);
+
+    size_t actual = 1;
+    EXPECT_EQ(consumer.Read(elems, 1, &actual), ZX_ERR_SHOULD_WAIT);
+    EXPECT_EQ(actual, 0u);
+
+    // Write and read back enough to wrap around the end of the ring a few
+    // times, with batches that don't divide its size.
+    uint64_t next_write = 0;
+    uint64_t next_read = 0;
+    for (int i = 0; i < 10; i++) {
+        for (size_t j = 0; j < 5; j++) {
+            elems[j] = next_write + j;
+        }
+        ASSERT_EQ(producer.Write(elems, 5, &actual), ZX_OK);
+        ASSERT_EQ(actual, 5u);
+        next_write += 5;
+
+        ASSERT_EQ(consumer.Read(elems, kElemCount, &actual), ZX_OK);
+        ASSERT_EQ(actual, 5u);
+        for (size_t j = 0; j < actual; j++) {
+            EXPECT_EQ(elems[j], next_read++);
+        }
+    }
+
+    // Writes are short once the ring fills up.
+    for (size_t j = 0; j < kElemCount + 1; j++) {
+        elems[j] = next_write + j;
+    }
+    ASSERT_EQ(producer.Write(elems, kElemCount + 1, &actual), ZX_OK);
+    EXPECT_EQ(actual, kElemCount);
+    actual = 1;
+    EXPECT_EQ(producer.Write(elems, 1, &actual), ZX_ERR_SHOULD_WAIT);
+    EXPECT_EQ(actual, 0u);
+
+    ASSERT_EQ(consumer.Read(elems, kElemCount + 1, &actual), ZX_OK);
+    ASSERT_EQ(actual, kElemCount);
+    for (size_t j = 0; j < actual; j++) {
+        EXPECT_EQ(elems[j], next_read++);
+    }
+
+    END_TEST;
+}
+
+bool spsc_ring_signals_test() {
+    BEGIN_TEST;
+
+    fzl::SpscRing producer, consumer;
+    ASSERT_TRUE(CreateRing(&producer, &consumer));
+
+    // An empty ring is writable but not readable.
+    EXPECT_EQ(producer.Wait(zx::time::infinite_past()), ZX_OK);
+    EXPECT_EQ(consumer.Wait(zx::time::infinite_past()), ZX_ERR_TIMED_OUT);
+
+    uint64_t elems[kElemCount] = {};
+    ASSERT_EQ(producer.Write(elems, kElemCount, nullptr), ZX_OK);
+    EXPECT_EQ(consumer.Wait(zx::time::infinite_past()), ZX_OK);
+    EXPECT_EQ(producer.Wait(zx::time::infinite_past()), ZX_ERR_TIMED_OUT);
+
+    ASSERT_EQ(consumer.Read(elems, 1, nullptr), ZX_OK);
+    EXPECT_EQ(producer.Wait(zx::time::infinite_past()), ZX_OK);
+
+    END_TEST;
+}
+
+bool spsc_ring_peer_closed_test() {
+    BEGIN_TEST;
+
+    fzl::SpscRing consumer;
+    {
+        fzl::SpscRing producer;
+        ASSERT_TRUE(CreateRing(&producer, &consumer));
+        uint64_t elem = 42;
+        ASSERT_EQ(producer.Write(&elem, 1, nullptr), ZX_OK);
+    }
+
+    // What the producer wrote can still be read after it's gone.
+    EXPECT_EQ(consumer.Wait(zx::time::infinite()), ZX_OK);
+    uint64_t elem;
+    ASSERT_EQ(consumer.Read(&elem, 1, nullptr), ZX_OK);
+    EXPECT_EQ(elem, 42u);
+    EXPECT_EQ(consumer.Wait(zx::time::infinite()), ZX_ERR_PEER_CLOSED);
+
+    END_TEST;
+}
+
+constexpr uint64_t kThreadedCount = 100000;
+
+int ProducerThread(void* arg) {
+    auto producer = static_cast<fzl::SpscRing*>(arg);
+    uint64_t next = 0;
+    while (next < kThreadedCount) {
+        uint64_t elems[3] = {next, next + 1, next + 2};
+        size_t count = static_cast<size_t>(fbl::min<uint64_t>(3, kThreadedCount - next));
+        size_t actual;
+        zx_status_t status = producer->Write(elems, count, &actual);
+        if (status == ZX_ERR_SHOULD_WAIT) {
+            status = producer->Wait(zx::time::infinite());
+            if (status != ZX_OK) {
+                return status;
+            }
+            continue;
+        }
+        if (status != ZX_OK) {
+            return status;
+        }
+        next += actual;
+    }
+    return ZX_OK;
+}
+
+// Checks that neither end misses a wakeup when they run concurrently and
+// the ring keeps going empty and full.
+bool spsc_ring_threaded_test() {
+    BEGIN_TEST;
+
+    fzl::SpscRing producer, consumer;
+    ASSERT_TRUE(CreateRing(&producer, &consumer, 4));
+
+    thrd_t thread;
+    ASSERT_EQ(thrd_create(&thread, ProducerThread, &producer), thrd_success);
+
+    uint64_t next = 0;
+    while (next < kThreadedCount) {
+        uint64_t elems[2];
+        size_t actual;
+        zx_status_t status = consumer.Read(elems, 2, &actual);
+        if (status == ZX_ERR_SHOULD_WAIT) {
+            ASSERT_EQ(consumer.Wait(zx::time::infinite()), ZX_OK);
+            continue;
+        }
+        ASSERT_EQ(status, ZX_OK);
+        for (size_t i = 0; i < actual; i++) {
+            ASSERT_EQ(elems[i], next++);
+        }
+    }
+
+    int result;
+    ASSERT_EQ(thrd_join(thread, &result), thrd_success);
+    EXPECT_EQ(result, ZX_OK);
+
+    END_TEST;
+}
+
+} // namespace
+
+BEGIN_TEST_CASE(spsc_ring_tests)
+RUN_NAMED_TEST("spsc_ring_bad_args", spsc_ring_bad_args_test)
+RUN_NAMED_TEST("spsc_ring_read_write", spsc_ring_read_write_test)
+RUN_NAMED_TEST("spsc_ring_signals", spsc_ring_signals_test)
+RUN_NAMED_TEST("spsc_ring_peer_closed", spsc_ring_peer_closed_test)
+RUN_NAMED_TEST("spsc_ring_threaded", spsc_ring_threaded_test)
+END_TEST_CASE(spsc_ring_tests)
@@ -3,6 +3,7 @@
 // found in the LICENSE file.
 
 #include <perftest/perftest.h>
+#include <zircon/assert.h>
 #include <zircon/syscalls.h>
 
 namespace {
@@ -11,16 +12,38 @@ namespace {
 // testing because it is a very commonly called syscall.  The kernel's
 // implementation of the syscall is non-trivial and can be rather slow on
 // some machines/VMs.
+//
+// The vDSO normally answers the monotonic and UTC clocks without entering
+// the kernel.  ClockGetMonotonicViaKernel always takes the syscall path, so
+// that the two can be compared in one run; so does ClockGetThread.  Booting
+// with vdso.soft_ticks=true makes all of these tests enter the kernel.
 bool ClockGetMonotonicTest() {
     zx_clock_get_monotonic();
     return true;
 }
 
+bool ClockGetMonotonicViaKernelTest() {
+    zx_clock_get_monotonic_via_kernel();
+    return true;
+}
+
 bool ClockGetUtcTest() {
     zx_clock_get(ZX_CLOCK_UTC);
     return true;
 }
 
+bool ClockGetNewMonotonicTest() {
+    zx_time_t time;
+    ZX_ASSERT(zx_clock_get_new(ZX_CLOCK_MONOTONIC, &time) == ZX_OK);
+    return true;
+}
+
+bool ClockGetNewUtcTest() {
+    zx_time_t time;
+    ZX_ASSERT(zx_clock_get_new(ZX_CLOCK_UTC, &time) == ZX_OK);
+    return true;
+}
+
 bool ClockGetThreadTest() {
     zx_clock_get(ZX_CLOCK_THREAD);
     return true;
@@ -33,7 +56,10 @@ bool TicksGetTest() {
 
 void RegisterTests() {
     perftest::RegisterSimpleTest<ClockGetMonotonicTest>("ClockGetMonotonic");
+    perftest::RegisterSimpleTest<ClockGetMonotonicViaKernelTest>("ClockGetMonotonicViaKernel");
     perftest::RegisterSimpleTest<ClockGetUtcTest>("ClockGetUtc");
+    perftest::RegisterSimpleTest<ClockGetNewMonotonicTest>("ClockGetNewMonotonic");
+    perftest::RegisterSimpleTest<ClockGetNewUtcTest>("ClockGetNewUtc");
     perftest::RegisterSimpleTest<ClockGetThreadTest>("ClockGetThread");
     perftest::RegisterSimpleTest<TicksGetTest>("TicksGet");
 }
@@ -0,0 +1,107 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <digest/digest.h>
+#include <digest/merkle-tree.h>
+#include <fbl/string_printf.h>
+#include <fbl/unique_ptr.h>
+#include <perftest/perftest.h>
+
+namespace {
+
+using digest::Digest;
+using digest::MerkleTree;
+
+fbl::unique_ptr<uint8_t[]> RandomData(size_t size) {
+    fbl::unique_ptr<uint8_t[]> data(new uint8_t[size]);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<uint8_t>(rand());
+    }
+    return data;
+}
+
+// Measure the time taken to build the Merkle tree of a blob of the given
+// size.  This hashes several leaves at once when the CPU allows it.
+bool MerkleTreeCreateTest(perftest::RepeatState* state, size_t size) {
+    state->SetBytesProcessedPerRun(size);
+
+    fbl::unique_ptr<uint8_t[]> data = RandomData(size);
+    size_t tree_len = MerkleTree::GetTreeLength(size);
+    fbl::unique_ptr<uint8_t[]> tree(new uint8_t[tree_len]);
+    Digest root;
+
+    while (state->KeepRunning()) {
+        if (MerkleTree::Create(data.get(), size, tree.get(), tree_len, &root) != ZX_OK) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Measure the time taken to verify all of a blob of the given size against
+// its Merkle tree.
+bool MerkleTreeVerifyTest(perftest::RepeatState* state, size_t size) {
+    state->SetBytesProcessedPerRun(size);
+
+    fbl::unique_ptr<uint8_t[]> data = RandomData(size);
+    size_t tree_len = MerkleTree::GetTreeLength(size);
+    fbl::unique_ptr<uint8_t[]> tree(new uint8_t[tree_len]);
+    Digest root;
+    if (MerkleTree::Create(data.get(), size, tree.get(), tree_len, &root) != ZX_OK) {
+        return false;
+    }
+
+    while (state->KeepRunning()) {
+        if (MerkleTree::Verify(data.get(), size, tree.get(), tree_len, 0, size, root) != ZX_OK) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Measure the time taken to hash the leaves of a blob of the given size one
+// at a time.  This is the baseline for the tests above: it is how the
+// Merkle tree hashed every node before it could hash several at once.
+bool MerkleTreeScalarLeavesTest(perftest::RepeatState* state, size_t size) {
+    state->SetBytesProcessedPerRun(size);
+
+    fbl::unique_ptr<uint8_t[]> data = RandomData(size);
+    Digest digest;
+
+    while (state->KeepRunning()) {
+        for (size_t offset = 0; offset < size; offset += MerkleTree::kNodeSize) {
+            if (digest.Init() != ZX_OK) {
+                return false;
+            }
+            uint64_t locality = offset;
+            uint32_t length = static_cast<uint32_t>(MerkleTree::kNodeSize);
+            digest.Update(&locality, sizeof(locality));
+            digest.Update(&length, sizeof(length));
+            digest.Update(&data[offset], MerkleTree::kNodeSize);
+            digest.Final();
+        }
+    }
+    return true;
+}
+
+void RegisterTests() {
+    static const size_t kSizesBytes[] = {
+        128 * 1024,
+        1024 * 1024,
+    };
+    for (auto size : kSizesBytes) {
+        auto name = fbl::StringPrintf("MerkleTree/Create/%zubytes", size);
+        perftest::RegisterTest(name.c_str(), MerkleTreeCreateTest, size);
+        name = fbl::StringPrintf("MerkleTree/Verify/%zubytes", size);
+        perftest::RegisterTest(name.c_str(), MerkleTreeVerifyTest, size);
+        name = fbl::StringPrintf("MerkleTree/ScalarLeaves/%zubytes", size);
+        perftest::RegisterTest(name.c_str(), MerkleTreeScalarLeavesTest, size);
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+}  // namespace
@@ -13,12 +13,15 @@ MODULE_SRCS += \
     $(LOCAL_DIR)/handle-creation-test.cpp \
     $(LOCAL_DIR)/malloc-test.cpp \
     $(LOCAL_DIR)/memcpy-test.cpp \
+    $(LOCAL_DIR)/merkle-tree-test.cpp \
     $(LOCAL_DIR)/mutex-test.cpp \
     $(LOCAL_DIR)/null-test.cpp \
     $(LOCAL_DIR)/process-test.cpp \
     $(LOCAL_DIR)/results-test.cpp \
     $(LOCAL_DIR)/runner-test.cpp \
     $(LOCAL_DIR)/sleep-test.cpp \
+    $(LOCAL_DIR)/socket-test.cpp \
+    $(LOCAL_DIR)/spsc-ring-test.cpp \
     $(LOCAL_DIR)/syscalls-test.cpp \
 
 MODULE_NAME := perf-test
@@ -28,12 +31,15 @@ MODULE_STATIC_LIBS := \
     system/ulib/async-loop \
     system/ulib/async-loop.cpp \
     system/ulib/async.cpp \
+    system/ulib/digest \
     system/ulib/fbl \
+    system/ulib/fzl \
     system/ulib/perftest \
     system/ulib/trace \
     system/ulib/trace-provider \
     system/ulib/zx \
     system/ulib/zxcpp \
+    third_party/ulib/uboringssl \
 
 MODULE_LIBS := \
     system/ulib/async.default \
@@ -0,0 +1,72 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <limits.h>
+#include <string.h>
+
+#include <fbl/algorithm.h>
+#include <fbl/string_printf.h>
+#include <fbl/unique_ptr.h>
+#include <lib/zx/socket.h>
+#include <perftest/perftest.h>
+#include <zircon/assert.h>
+
+namespace {
+
+// Test the throughput of a stream socket by writing |size| bytes into it and
+// reading them back out on the same thread.  Transfers bigger than the
+// socket's buffer are done in several pieces.
+bool SocketWriteReadTest(perftest::RepeatState* state, size_t size) {
+    state->SetBytesProcessedPerRun(size);
+
+    zx::socket socket1, socket2;
+    ZX_ASSERT(zx::socket::create(0, &socket1, &socket2) == ZX_OK);
+
+    // Page-align the buffers, as a large-transfer client would.
+    constexpr uintptr_t kPageSize = PAGE_SIZE;
+    const size_t alloc_size = size + kPageSize;
+    fbl::unique_ptr<char[]> src_alloc(new char[alloc_size]);
+    fbl::unique_ptr<char[]> dest_alloc(new char[alloc_size]);
+    char* src = reinterpret_cast<char*>(
+        fbl::round_up(reinterpret_cast<uintptr_t>(src_alloc.get()), kPageSize));
+    char* dest = reinterpret_cast<char*>(
+        fbl::round_up(reinterpret_cast<uintptr_t>(dest_alloc.get()), kPageSize));
+    // Initialize src so that we are not copying from uninitialized memory.
+    memset(src, 0, size);
+
+    while (state->KeepRunning()) {
+        size_t pos = 0;
+        while (pos < size) {
+            size_t written;
+            ZX_ASSERT(socket1.write(0, src + pos, size - pos, &written) == ZX_OK);
+            size_t read_pos = pos;
+            pos += written;
+            while (read_pos < pos) {
+                size_t read;
+                ZX_ASSERT(socket2.read(0, dest + read_pos, pos - read_pos, &read) == ZX_OK);
+                read_pos += read;
+            }
+        }
+    }
+    return true;
+}
+
+void RegisterTests() {
+    static const size_t kSizesBytes[] = {
+        64,
+        1024,
+        4096,
+        16384,
+        65536,
+        262144,
+        1048576,
+    };
+    for (auto size : kSizesBytes) {
+        auto name = fbl::StringPrintf("Socket/WriteRead/%zubytes", size);
+        perftest::RegisterTest(name.c_str(), SocketWriteReadTest, size);
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+}  // namespace
@@ -0,0 +1,147 @@
+// Copyright 2018 The Fuchsia Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <threads.h>
+
+#include <fbl/string_printf.h>
+#include <lib/fzl/spsc-ring.h>
+#include <lib/zx/eventpair.h>
+#include <lib/zx/fifo.h>
+#include <lib/zx/vmo.h>
+#include <perftest/perftest.h>
+#include <zircon/assert.h>
+
+namespace {
+
+// The size of a block_fifo_request_t, as an example of a typical element.
+struct Element {
+    uint64_t data[4];
+};
+
+// The largest power-of-two number of elements that fits in a zx::fifo.
+constexpr uint32_t kElemCount = 128;
+
+// Streams elements from the test's thread to a consumer thread, |batch|
+// elements per write, through a zx::fifo.  The consumer drains the fifo as
+// fast as it can, so this measures the throughput of the pair.
+int FifoConsumer(void* arg) {
+    auto fifo = static_cast<zx::fifo*>(arg);
+    Element elems[kElemCount];
+    for (;;) {
+        size_t actual;
+        zx_status_t status = fifo->read(sizeof(Element), elems, kElemCount, &actual);
+        if (status == ZX_ERR_SHOULD_WAIT) {
+            zx_signals_t pending;
+            ZX_ASSERT(fifo->wait_one(ZX_FIFO_READABLE | ZX_FIFO_PEER_CLOSED,
+                                     zx::time::infinite(), &pending) == ZX_OK);
+            continue;
+        }
+        if (status == ZX_ERR_PEER_CLOSED) {
+            return 0;
+        }
+        ZX_ASSERT(status == ZX_OK);
+    }
+}
+
+bool FifoStreamTest(perftest::RepeatState* state, uint32_t batch) {
+    state->SetBytesProcessedPerRun(batch * sizeof(Element));
+
+    zx::fifo producer, consumer;
+    ZX_ASSERT(zx::fifo::create(kElemCount, sizeof(Element), 0, &producer, &consumer) == ZX_OK);
+    thrd_t thread;
+    ZX_ASSERT(thrd_create(&thread, FifoConsumer, &consumer) == thrd_success);
+
+    Element elems[kElemCount] = {};
+    while (state->KeepRunning()) {
+        size_t written = 0;
+        while (written < batch) {
+            size_t actual;
+            zx_status_t status = producer.write(sizeof(Element), elems + written,
+                                                batch - written, &actual);
+            if (status == ZX_ERR_SHOULD_WAIT) {
+                zx_signals_t pending;
+                ZX_ASSERT(producer.wait_one(ZX_FIFO_WRITABLE, zx::time::infinite(),
+                                            &pending) == ZX_OK);
+                continue;
+            }
+            ZX_ASSERT(status == ZX_OK);
+            written += actual;
+        }
+    }
+
+    producer.reset();
+    ZX_ASSERT(thrd_join(thread, nullptr) == thrd_success);
+    return true;
+}
+
+// The same as FifoStreamTest, but through an fzl::SpscRing.
+int RingConsumer(void* arg) {
+    auto ring = static_cast<fzl::SpscRing*>(arg);
+    Element elems[kElemCount];
+    for (;;) {
+        zx_status_t status = ring->Read(elems, kElemCount, nullptr);
+        if (status == ZX_ERR_SHOULD_WAIT) {
+            status = ring->Wait(zx::time::infinite());
+            if (status == ZX_ERR_PEER_CLOSED) {
+                return 0;
+            }
+            ZX_ASSERT(status == ZX_OK);
+            continue;
+        }
+        ZX_ASSERT(status == ZX_OK);
+    }
+}
+
+bool RingStreamTest(perftest::RepeatState* state, uint32_t batch) {
+    state->SetBytesProcessedPerRun(batch * sizeof(Element));
+
+    zx::vmo vmo;
+    zx::eventpair producer_event, consumer_event;
+    ZX_ASSERT(fzl::SpscRing::Create(sizeof(Element), kElemCount, &vmo,
+                                    &producer_event, &consumer_event) == ZX_OK);
+    fzl::SpscRing consumer;
+    ZX_ASSERT(consumer.Init(fzl::SpscRing::Role::kConsumer, vmo,
+                            fbl::move(consumer_event)) == ZX_OK);
+    thrd_t thread;
+    ZX_ASSERT(thrd_create(&thread, RingConsumer, &consumer) == thrd_success);
+
+    {
+        fzl::SpscRing producer;
+        ZX_ASSERT(producer.Init(fzl::SpscRing::Role::kProducer, vmo,
+                                fbl::move(producer_event)) == ZX_OK);
+
+        Element elems[kElemCount] = {};
+        while (state->KeepRunning()) {
+            size_t written = 0;
+            while (written < batch) {
+                size_t actual;
+                zx_status_t status = producer.Write(elems + written, batch - written, &actual);
+                if (status == ZX_ERR_SHOULD_WAIT) {
+                    ZX_ASSERT(producer.Wait(zx::time::infinite()) == ZX_OK);
+                    continue;
+                }
+                ZX_ASSERT(status == ZX_OK);
+                written += actual;
+            }
+        }
+    }
+
+    // Destroying the producer closed its event, which tells the consumer
+    // to finish.
+    ZX_ASSERT(thrd_join(thread, nullptr) == thrd_success);
+    return true;
+}
+
+void RegisterTests() {
+    static const uint32_t kBatchSizes[] = {1, 4, 16, 64};
+    for (auto batch : kBatchSizes) {
+        auto fifo_name = fbl::StringPrintf("Fifo/Stream/%ubatch", batch);
+        perftest::RegisterTest(fifo_name.c_str(), FifoStreamTest, batch);
+        auto ring_name = fbl::StringPrintf("SpscRing/Stream/%ubatch", batch);
+        perftest::RegisterTest(ring_name.c_str(), RingStreamTest, batch);
+    }
+}
+PERFTEST_CTOR(RegisterTests);
+
+}  // namespace
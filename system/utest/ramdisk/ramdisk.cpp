@@ -807,6 +807,76 @@ bool ramdisk_test_fifo_multiple_vmo(void) {
     END_TEST;
 }
 
+bool ramdisk_test_fifo_pipelined(void) {
+    BEGIN_TEST;
+    // Set up the initial handshake connection with the ramdisk
+    const size_t kBlockSize = PAGE_SIZE;
+    fbl::unique_ptr<RamdiskTest> ramdisk;
+    ASSERT_TRUE(RamdiskTest::Create(kBlockSize, 1 << 18, &ramdisk));
+
+    zx::fifo fifo;
+    ssize_t expected = sizeof(fifo);
+    ASSERT_EQ(ioctl_block_get_fifos(ramdisk->fd(),
+              fifo.reset_and_get_address()), expected, "Failed to get FIFO");
+    block_client::Client client;
+    ASSERT_EQ(block_client::Client::Create(fbl::move(fifo), &client), ZX_OK);
+
+    // Create a VMO per group
+    const size_t num_groups = MAX_TXN_GROUP_COUNT;
+    fbl::AllocChecker ac;
+    fbl::Array<test_vmo_object_t> objs(new (&ac) test_vmo_object_t[num_groups](), num_groups);
+    ASSERT_TRUE(ac.check());
+    for (size_t i = 0; i < objs.size(); i++) {
+        ASSERT_TRUE(create_vmo_helper(ramdisk->fd(), &objs[i], kBlockSize));
+    }
+
+    // Write every VMO at once, each on its own group, then wait for them in
+    // the opposite order.
+    for (size_t i = 0; i < objs.size(); i++) {
+        block_fifo_request_t request;
+        request.group      = static_cast<groupid_t>(i);
+        request.vmoid      = objs[i].vmoid;
+        request.opcode     = BLOCKIO_WRITE;
+        request.length     = static_cast<uint32_t>(objs[i].vmo_size / kBlockSize);
+        request.vmo_offset = 0;
+        request.dev_offset = i * 8;
+        ASSERT_EQ(client.BeginTransaction(&request, 1), ZX_OK);
+    }
+    for (size_t i = objs.size(); i > 0; i--) {
+        ASSERT_EQ(client.WaitTransaction(static_cast<groupid_t>(i - 1)), ZX_OK);
+    }
+
+    // Read them back the same way, into emptied VMOs
+    for (size_t i = 0; i < objs.size(); i++) {
+        fbl::unique_ptr<uint8_t[]> zeroes(new (&ac) uint8_t[objs[i].vmo_size]());
+        ASSERT_TRUE(ac.check());
+        ASSERT_EQ(zx_vmo_write(objs[i].vmo, zeroes.get(), 0, objs[i].vmo_size), ZX_OK);
+
+        block_fifo_request_t request;
+        request.group      = static_cast<groupid_t>(i);
+        request.vmoid      = objs[i].vmoid;
+        request.opcode     = BLOCKIO_READ;
+        request.length     = static_cast<uint32_t>(objs[i].vmo_size / kBlockSize);
+        request.vmo_offset = 0;
+        request.dev_offset = i * 8;
+        ASSERT_EQ(client.BeginTransaction(&request, 1), ZX_OK);
+    }
+    for (size_t i = objs.size(); i > 0; i--) {
+        ASSERT_EQ(client.WaitTransaction(static_cast<groupid_t>(i - 1)), ZX_OK);
+    }
+
+    for (size_t i = 0; i < objs.size(); i++) {
+        fbl::unique_ptr<uint8_t[]> out(new (&ac) uint8_t[objs[i].vmo_size]);
+        ASSERT_TRUE(ac.check());
+        ASSERT_EQ(zx_vmo_read(objs[i].vmo, out.get(), 0, objs[i].vmo_size), ZX_OK);
+        ASSERT_EQ(memcmp(objs[i].buf.get(), out.get(), objs[i].vmo_size), 0,
+                  "Read data not equal to written data");
+        ASSERT_TRUE(close_vmo_helper(&client, &objs[i], 0));
+    }
+
+    END_TEST;
+}
+
 typedef struct {
     test_vmo_object_t* obj;
     size_t i;
@@ -1590,6 +1660,7 @@ RUN_TEST_SMALL(ramdisk_test_fifo_basic)
 RUN_TEST_SMALL(ramdisk_test_fifo_no_group)
 RUN_TEST_SMALL(ramdisk_test_fifo_multiple_vmo)
 RUN_TEST_SMALL(ramdisk_test_fifo_multiple_vmo_multithreaded)
+RUN_TEST_SMALL(ramdisk_test_fifo_pipelined)
 // TODO(smklein): Test ops across different vmos
 RUN_TEST_SMALL(ramdisk_test_fifo_unclean_shutdown)
 RUN_TEST_SMALL(ramdisk_test_fifo_large_ops_count)